@@ -44,6 +44,14 @@ class OmulatorBuilder
     Dir.chdir @proj_dir
   end
 
+  # Build and run each benchmark executable. Results are only meaningful for Release builds!
+  def bench
+    build addl_cmake_args: '-DOMULATOR_BUILD_BENCHMARKS=ON'
+    Dir.glob("#{@build_dir}/test/*_bench{,.exe}").sort.each do |benchmark|
+      spawn_cmd "#{benchmark}"
+    end
+  end
+
   # Basic cmake build
   def build(**kwargs)
     spawn_cmd "cmake -B #{@build_dir} -GNinja -DCMAKE_BUILD_TYPE=#{@build_type} "\
@@ -61,8 +61,9 @@ function(configure_target target_name)
     )
   endif()
 
-  # Use IPO if Release and available
-  if(CMAKE_BUILD_TYPE MATCHES Release)
+  # Use IPO if Release/RelWithDebInfo and available; among other things, this allows Components'
+  # step() functions to be inlined by System::make_static_component_list
+  if(CMAKE_BUILD_TYPE MATCHES "Release|RelWithDebInfo")
     check_ipo_supported(RESULT is_ipo_supported)
     if(is_ipo_supported)
       set_target_properties(
@@ -1,17 +1,38 @@
 set(
   OML_SOURCE_FILE_MANIFEST
     src/main.cpp
+    src/AudioEngine.cpp
+    src/BatchRunner.cpp
+    src/Benchmark.cpp
     src/Clock.cpp
     src/Component.cpp
+    src/Debugger.cpp
+    src/EventScheduler.cpp
     src/InputHandler.cpp
     src/Interpreter.cpp
+    src/MediaImage.cpp
+    src/MediaReadAhead.cpp
+    src/MemoryBus.cpp
+    src/NullAudioSink.cpp
     src/NullWindow.cpp
+    src/RewindBuffer.cpp
+    src/RunAhead.cpp
     src/SpdlogLogger.cpp
+    src/StateArchive.cpp
+    src/StateHasher.cpp
     src/Subsystem.cpp
+    src/System.cpp
+    src/Tracer.cpp
+    src/VirtualClock.cpp
     src/VulkanBackend.cpp
+    src/WavAudioSink.cpp
+    src/cpu/Ref8.cpp
+    src/cpu/Ref8Jit.cpp
     src/di/Injector.cpp
     src/di/injector_rules.cpp
     src/graphics/CoreGraphicsEngine.cpp
+    src/graphics/PixelConvert.cpp
+    src/graphics/VideoOutput.cpp
     src/msg/MessageQueue.cpp
     src/msg/MessageQueueFactory.cpp
     src/msg/MailboxEndpoint.cpp
@@ -22,6 +43,12 @@ set(
     src/util/exception_handler.cpp
     src/util/CLIInput.cpp
     src/util/CLIParser.cpp
+    src/util/ExecutableMemory.cpp
+    src/util/Hash64.cpp
+    src/util/Lz4Block.cpp
+    src/util/Profiler.cpp
+    src/util/Resampler.cpp
+    src/util/XorDelta.cpp
     src/vkmisc/Allocator.cpp
     src/vkmisc/Frame.cpp
     src/vkmisc/Initializer.cpp
@@ -30,8 +57,13 @@ set(
     src/vkmisc/SimpleMesh.cpp
     src/vkmisc/Swapchain.cpp
     src/vkmisc/vkmisc.cpp
+    ${PLATFORM_DIR}/ExecutableMemory.cpp
     ${PLATFORM_DIR}/KillableThread.cpp
+    ${PLATFORM_DIR}/MappedFile.cpp
+    ${PLATFORM_DIR}/os_peak_rss.cpp
+    ${PLATFORM_DIR}/os_sleep.cpp
     ${PLATFORM_DIR}/PrimitiveIO.cpp
+    ${PLATFORM_DIR}/SystemAudioSink.cpp
     ${PLATFORM_DIR}/SystemWindow.cpp
 )
 
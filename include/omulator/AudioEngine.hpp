@@ -0,0 +1,174 @@
+#pragma once
+
+#include "omulator/IAudioSink.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/Subsystem.hpp"
+#include "omulator/msg/MailboxRouter.hpp"
+#include "omulator/msg/MailboxSender.hpp"
+#include "omulator/oml_types.hpp"
+#include "omulator/util/Resampler.hpp"
+#include "omulator/util/SpscRing.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace omulator {
+
+class AudioEngine;
+
+/**
+ * One source of audio feeding an AudioEngine, e.g. an emulated sound chip, at its own sample rate.
+ * The source submits blocks of interleaved stereo frames, which are passed to the AudioEngine's
+ * thread through a lock-free SPSC ring, so submitting never blocks, allocates or sends a message.
+ *
+ * submit() must only be called from one thread at a time (normally the thread which steps the
+ * System); the gain may be changed from any thread.
+ */
+class AudioChannel {
+public:
+  /**
+   * The capacity of the ring, in frames; anything submitted beyond that before the AudioEngine
+   * catches up is dropped.
+   */
+  static constexpr std::size_t RING_FRAMES = 16384;
+
+  AudioChannel(const AudioChannel &)            = delete;
+  AudioChannel &operator=(const AudioChannel &) = delete;
+  AudioChannel(AudioChannel &&)                 = delete;
+  AudioChannel &operator=(AudioChannel &&)      = delete;
+
+  double sample_rate() const noexcept;
+
+  /**
+   * Queue frames for mixing, and return the number of frames accepted. Throws std::invalid_argument
+   * if frames holds an odd number of samples. N.B. that nothing is mixed until the AudioEngine is
+   * told to with AudioEngine::commit().
+   */
+  std::size_t submit(std::span<const float> frames);
+
+  void  set_gain(const float gain) noexcept;
+  float gain() const noexcept;
+
+  /**
+   * The number of frames (at the channel's own sample rate) which have been dropped, either because
+   * the ring was full or because the channel had fallen too far ahead of the others.
+   */
+  U64 dropped() const noexcept;
+
+private:
+  friend class AudioEngine;
+
+  AudioChannel(const double sampleRate, const U32 outRate, const float gain);
+
+  double                sampleRate_;
+  util::SpscRing<float> ring_;
+
+  /**
+   * Only touched by the AudioEngine's thread.
+   */
+  util::Resampler resampler_;
+
+  std::atomic<float> gain_;
+  std::atomic<U64>   dropped_;
+};
+
+/**
+ * Mixes the audio of any number of AudioChannels and writes it to an IAudioSink, on its own
+ * thread. Each channel is resampled from its own rate to the sink's rate (see util::Resampler), and
+ * the channels are summed, scaled by their gains, and clamped.
+ *
+ * Sources submit blocks to their channels and then call commit(), typically once per frame, which
+ * wakes the AudioEngine's thread; it then takes everything the channels have received, and mixes as
+ * much as every channel with any input can provide. A channel with no input at all is treated as
+ * silent, so a source which stops producing audio doesn't hold up the others.
+ *
+ * # RATE CONTROL
+ * The emulation is paced by its own clock rather than by the audio device, so the two drift apart,
+ * and a fixed ratio would eventually underrun or overflow the device's queue. Instead, the ratio is
+ * adjusted each time audio is mixed to steer the sink's fill level towards half full: the fill
+ * level is smoothed, and the number of output frames per input frame is scaled by up to
+ * +/-MAX_ADJUST in proportion to how far it is from the target. At 0.5% the change in pitch is
+ * inaudible, while still covering far more drift than real clocks have. Sinks which don't report a
+ * fill level (e.g. WavAudioSink) are always fed at the nominal ratio.
+ */
+class AudioEngine : public Subsystem {
+public:
+  static constexpr double MAX_ADJUST = 0.005;
+
+  /**
+   * The weight of each new fill level in the smoothed fill level.
+   */
+  static constexpr double FILL_SMOOTHING = 0.05;
+
+  /**
+   * A channel with more than this many output frames buffered ahead of the mix is reset, dropping
+   * what it has buffered; this happens if a source produces audio faster than the others.
+   */
+  static constexpr std::size_t MAX_BUFFERED_FRAMES = 48000;
+
+  /**
+   * The sink must outlive the AudioEngine.
+   */
+  AudioEngine(ILogger &logger, msg::MailboxRouter &mbrouter, IAudioSink &sink);
+
+  /**
+   * Stops the underlying thread before any channels are destroyed.
+   */
+  ~AudioEngine() override;
+
+  /**
+   * Add a channel for a source running at the given rate. The channel lives as long as the
+   * AudioEngine. Threadsafe. Throws std::invalid_argument unless the rate is positive.
+   */
+  AudioChannel &add_channel(const double sampleRate, const float gain = 1.0F);
+
+  /**
+   * Wake the AudioEngine's thread to mix whatever has been submitted. Cheap enough to call every
+   * frame: if the thread already has a mix pending, no further message is sent.
+   */
+  void commit();
+
+  /**
+   * The current output frames per input frame, relative to the nominal ratio.
+   */
+  double rate_adjust() const noexcept;
+
+  /**
+   * The total number of frames written to the sink.
+   */
+  U64 frames_mixed() const noexcept;
+
+private:
+  /**
+   * Drain every channel's ring, and mix and write as much as possible.
+   */
+  void mix_pending_();
+
+  void update_rate_adjust_();
+
+  IAudioSink        &sink_;
+  msg::MailboxSender selfSender_;
+
+  /**
+   * Guards channels_, which may be added to while the AudioEngine's thread is mixing.
+   */
+  std::mutex                                 channelsMtx_;
+  std::vector<std::unique_ptr<AudioChannel>> channels_;
+
+  std::atomic_bool mixPending_;
+
+  /**
+   * Only touched by the AudioEngine's thread.
+   */
+  std::vector<float> input_;
+  std::vector<float> mix_;
+  double             smoothedFill_;
+
+  std::atomic<double> rateAdjust_;
+  std::atomic<U64>    framesMixed_;
+};
+
+}  // namespace omulator
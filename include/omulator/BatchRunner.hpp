@@ -0,0 +1,156 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/System.hpp"
+#include "omulator/di/Injector.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Hosts many independent, headless Systems in a single process (e.g. for regression testing, or
+ * for running a large number of instances of the same game), and steps all of them on a shared
+ * pool of worker threads.
+ *
+ * Each System is created from the Injector given to the BatchRunner, and only its child Injector
+ * and Components are specific to it; anything held by the parent Injector is shared. Recipes for
+ * Components should therefore be added to each System's own Injector (see System). The Systems
+ * should not have any Subsystems, as each Subsystem brings its own thread. Read-only assets such
+ * as ROM images should be loaded once with add_rom() and then mapped into each System's MemoryBus
+ * with MemoryBus::map_rom, which does not copy the image, so every System shares the same pages.
+ *
+ * run() schedules one task per System per frame. Each worker has its own deque of tasks: when a
+ * task finishes, the task for the System's next frame is pushed onto the back of the worker's own
+ * deque and is usually the next task that the worker runs, so that a System tends to stay on the
+ * same core. Idle workers steal from the front of the other workers' deques, which keeps every
+ * core busy when some Systems take longer to run a frame than others. Systems never wait on each
+ * other, so throughput scales with the number of cores for as long as the Systems' working sets
+ * fit in the caches.
+ *
+ * add_system() and add_rom() must not be called while run() is in progress.
+ */
+class BatchRunner {
+public:
+  /**
+   * Called after each frame of each System, on whichever worker thread ran the frame; receives
+   * the System, its index (in the order the Systems were added) and the frame number.
+   */
+  using FrameFn_t = std::function<void(System &, const std::size_t, const U64)>;
+
+  /**
+   * numThreads defaults to the number of hardware threads.
+   */
+  BatchRunner(ILogger &logger, di::Injector &injector, const std::size_t numThreads = 0);
+
+  /**
+   * Stops the worker threads before any of the Systems are destroyed.
+   */
+  ~BatchRunner();
+
+  BatchRunner(const BatchRunner &)            = delete;
+  BatchRunner &operator=(const BatchRunner &) = delete;
+  BatchRunner(BatchRunner &&)                 = delete;
+  BatchRunner &operator=(BatchRunner &&)      = delete;
+
+  /**
+   * Create a new System, which can then be set up as usual (make_component_list, etc.).
+   */
+  System &add_system(std::string_view name);
+
+  /**
+   * Keep a read-only image alive for as long as the BatchRunner, so that it can be mapped into
+   * each System's MemoryBus. Returns a view of the image.
+   */
+  std::span<const U8> add_rom(std::vector<U8> image);
+
+  /**
+   * Run every System for numFrames frames of cyclesPerFrame cycles each, calling onFrame (if given)
+   * after each frame; blocks until every System is done. If a frame throws, that System is not run
+   * any further, and the first such exception (in the order the Systems were added) is rethrown
+   * once the other Systems are done.
+   */
+  void run(const U64 numFrames, const Cycle_t cyclesPerFrame, FrameFn_t onFrame = {});
+
+  System     &system(const std::size_t idx);
+  std::size_t size() const noexcept;
+  std::size_t num_threads() const noexcept;
+
+private:
+  struct Task_ {
+    std::size_t systemIdx;
+    U64         frame;
+  };
+
+  struct Worker_ {
+    std::mutex        mtx;
+    std::deque<Task_> tasks;
+  };
+
+  void worker_proc_(const std::size_t workerIdx);
+
+  /**
+   * Pop a task from the back of the worker's own deque, or failing that, steal one from the front
+   * of another worker's deque. Returns false if there were no tasks anywhere.
+   */
+  bool next_task_(const std::size_t workerIdx, Task_ &task);
+
+  void push_task_(const std::size_t workerIdx, const Task_ task);
+
+  void run_task_(const std::size_t workerIdx, const Task_ task);
+
+  ILogger      &logger_;
+  di::Injector &injector_;
+
+  std::vector<std::unique_ptr<std::vector<U8>>> roms_;
+  std::vector<std::unique_ptr<System>>          systems_;
+
+  /**
+   * The state of the current run; only written by run() while the workers are idle.
+   */
+  U64                             numFrames_;
+  Cycle_t                         cyclesPerFrame_;
+  FrameFn_t                       onFrame_;
+  std::vector<std::exception_ptr> errors_;
+
+  std::vector<std::unique_ptr<Worker_>> workers_;
+
+  /**
+   * The number of tasks sitting in the workers' deques, and the number of Systems which have yet to
+   * finish the current run.
+   */
+  std::atomic<std::size_t> queuedTasks_;
+  std::atomic<std::size_t> activeSystems_;
+
+  /**
+   * The number of workers waiting on workCv_ for a task; new tasks only wake a worker if this is
+   * nonzero, so that the common case of a worker queueing a task for itself stays cheap.
+   */
+  std::atomic<std::size_t> idleWorkers_;
+
+  /**
+   * Guards runId_ and stop_. Idle workers wait on workCv_ for new tasks or a new run, and run()
+   * waits on doneCv_ for every System to finish.
+   */
+  std::mutex              poolMtx_;
+  std::condition_variable workCv_;
+  std::condition_variable doneCv_;
+  U64                     runId_;
+  bool                    stop_;
+
+  std::vector<std::jthread> threads_;
+};
+
+}  // namespace omulator
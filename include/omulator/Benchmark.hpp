@@ -0,0 +1,120 @@
+#pragma once
+
+#include "omulator/IClock.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/PropertyMap.hpp"
+#include "omulator/System.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * The results of a single Benchmark run.
+ */
+struct BenchReport {
+  Cycle_t cycles;
+  U64     frames;
+
+  /**
+   * Wall clock time taken by the run.
+   */
+  double hostSeconds;
+
+  /**
+   * Each Component's share of the time spent in Component::step, in the order of the System's
+   * component list; the shares add up to 1.
+   */
+  std::vector<std::pair<std::string, double>> componentShares;
+
+  /**
+   * The peak resident set size of the process at the end of the run, in bytes.
+   */
+  std::size_t peakRssBytes;
+
+  double cycles_per_second() const noexcept;
+  double frames_per_second() const noexcept;
+};
+
+/**
+ * Runs a System for a fixed number of frames as fast as possible, and reports how quickly it ran,
+ * so that every build can be checked for performance regressions. This is what the --bench switch
+ * runs, in which case the app is headless, does not render, and uses a VirtualClock with an
+ * unlimited speed; see oml_main().
+ *
+ * Each frame steps the System by a fixed number of cycles, and then sleeps on the IClock until the
+ * start of the next frame, as the app's main loop would. With a VirtualClock, the sleep returns
+ * immediately but still moves time forward, so anything paced by the clock sees the same timeline
+ * as it would in real time, and runs are reproducible.
+ */
+class Benchmark {
+public:
+  /**
+   * Called after each frame has been stepped, with the frame number.
+   */
+  using FrameFn_t = std::function<void(const U64)>;
+
+  static constexpr U64 DEFAULT_FRAMES = 600;
+
+  /**
+   * The emulated duration of a frame.
+   */
+  static constexpr auto FRAME_PERIOD = std::chrono::nanoseconds(1'000'000'000) / 60;
+
+  /**
+   * A run is considered a regression if its cycles per second fall more than this fraction below
+   * those of the baseline.
+   */
+  static constexpr double REGRESSION_TOLERANCE = 0.05;
+
+  /**
+   * Process exit code for a run which regressed; any other failure exits with EXIT_FAILURE.
+   */
+  static constexpr int EXIT_REGRESSION = 2;
+
+  /**
+   * Throws if props::BENCH_FRAMES is set to something other than a positive integer.
+   */
+  Benchmark(ILogger &logger, PropertyMap &propertyMap, IClock &clock);
+
+  /**
+   * Run the System for props::BENCH_FRAMES frames of cyclesPerFrame cycles each, with component
+   * timing enabled for the duration of the run; see System::set_component_timing. onFrame (if
+   * given) is called after each frame, and the time it takes counts towards the run.
+   */
+  BenchReport run(System &system, const Cycle_t cyclesPerFrame, FrameFn_t onFrame = {});
+
+  /**
+   * Compare the report against the baseline given by props::BENCH_BASELINE, if any. Returns
+   * EXIT_REGRESSION if the report is a regression, and EXIT_SUCCESS otherwise. Throws if the
+   * baseline can't be read.
+   */
+  int check_baseline(const BenchReport &report);
+
+  /**
+   * Write a report as a JSON object.
+   */
+  static void write_json(const BenchReport &report, std::ostream &os);
+
+  /**
+   * Extract the cycles per second from a report written by write_json(); throws if it can't be
+   * found.
+   */
+  static double read_cycles_per_second(std::istream &is);
+
+private:
+  ILogger     &logger_;
+  PropertyMap &propertyMap_;
+  IClock      &clock_;
+  U64          frames_;
+};
+
+}  // namespace omulator
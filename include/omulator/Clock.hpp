@@ -1,16 +1,95 @@
 #pragma once
 
 #include "omulator/IClock.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <atomic>
+#include <chrono>
 
 namespace omulator {
 
 class Clock : public IClock {
 public:
+  /**
+   * Determines how sleep_until() waits for its deadline.
+   */
+  enum class SleepStrategy : bool {
+    /**
+     * Defer entirely to std::this_thread::sleep_until. Cheap, but on most OSes routinely overshoots
+     * the deadline by anywhere from tens of microseconds to over a millisecond. The default.
+     */
+    STANDARD,
+
+    /**
+     * Sleep with the OS's most precise timer until shortly before the deadline, then spin for the
+     * remainder. The length of the spin is calibrated from the observed wakeup latency of the OS
+     * timer, so the cost in CPU time adapts to how well-behaved the scheduler is. Opt-in, since
+     * every sleep burns a core for the length of the spin.
+     */
+    HYBRID
+  };
+
+  /**
+   * Overshoot statistics for calls to sleep_until(), i.e. how late sleep_until() returned relative
+   * to the requested deadline. Calls with a deadline that had already passed are not counted.
+   */
+  struct SleepStats {
+    U64                      numSleeps;
+    std::chrono::nanoseconds maxOvershoot;
+    std::chrono::nanoseconds totalOvershoot;
+
+    /**
+     * The current length of the spin at the end of a HYBRID sleep.
+     */
+    std::chrono::nanoseconds spinWindow;
+  };
+
+  explicit Clock(const SleepStrategy sleepStrategy = SleepStrategy::STANDARD);
   ~Clock() override = default;
 
   TimePoint_t now() const noexcept override;
 
   virtual void sleep_until(const TimePoint_t then) override;
+
+  /**
+   * For HYBRID sleeps, this leaves out the spin at the end of the sleep.
+   */
+  TimePoint_t host_deadline(const TimePoint_t then) const noexcept override;
+
+  /**
+   * Returns a snapshot of the overshoot statistics. Threadsafe.
+   */
+  SleepStats sleep_stats() const noexcept;
+
+  SleepStrategy sleep_strategy() const noexcept;
+
+  /**
+   * Bounds for the calibrated spin window used by SleepStrategy::HYBRID.
+   */
+  static constexpr std::chrono::nanoseconds MIN_SPIN_WINDOW = std::chrono::microseconds(20);
+  static constexpr std::chrono::nanoseconds MAX_SPIN_WINDOW = std::chrono::milliseconds(2);
+
+private:
+  void hybrid_sleep_until_(const TimePoint_t then);
+
+  /**
+   * Feed the observed wakeup latency of a single OS-level sleep into the spin window estimate.
+   */
+  void calibrate_(const std::chrono::nanoseconds wakeupLatency) noexcept;
+
+  void record_overshoot_(const std::chrono::nanoseconds overshoot) noexcept;
+
+  const SleepStrategy sleepStrategy_;
+
+  /**
+   * Exponentially weighted moving average of the OS timer's wakeup latency, which is used to size
+   * the spin window.
+   */
+  std::atomic<S64> avgWakeupLatencyNs_;
+
+  std::atomic<U64> numSleeps_;
+  std::atomic<S64> maxOvershootNs_;
+  std::atomic<S64> totalOvershootNs_;
 };
 
 }  // namespace omulator
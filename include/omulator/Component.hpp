@@ -7,6 +7,8 @@
 
 namespace omulator {
 
+class StateArchive;
+
 /**
  * An abstract component of an emulated system.
  */
@@ -29,6 +31,24 @@ public:
    */
   virtual Cycle_t step(const Cycle_t numCycles);
 
+  /**
+   * Save or load the Component's state, depending on the archive's mode; see StateArchive.
+   * Components should visit their state in the same order in both cases.
+   *
+   * The default implementation is a no-op, for Components which have no state of their own.
+   */
+  virtual void serialize(StateArchive &archive);
+
+  /**
+   * Called once a state has been loaded into the System which owns the Component, after the state
+   * of every Component has been restored and every pending event has been cancelled (since events
+   * can't be saved). Components which schedule events should reschedule them here, based on their
+   * restored state.
+   *
+   * The default implementation is a no-op.
+   */
+  virtual void post_load();
+
 protected:
   ILogger &logger_;
 
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/MemoryBus.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Breakpoints, watchpoints and single-stepping for a CPU and the MemoryBus it is attached to.
+ *
+ * The Debugger costs nothing until it is attached. A CPU with a Debugger attached (e.g. via
+ * cpu::Ref8::set_debugger) swaps in an instrumented instantiation of its execution loop, which
+ * calls before_insn() ahead of every instruction; the loop used the rest of the time contains no
+ * checks at all. Watchpoints trap the pages which contain them (see MemoryBus::trap_page), so only
+ * accesses to those pages leave the MemoryBus fast path.
+ *
+ * When a breakpoint is reached, a watched address is accessed, a single step completes or pause()
+ * is called, the Debugger stops, and the CPU is frozen (as if halted, consuming every cycle it is
+ * given) until resume() or step() is called. Breakpoints stop the CPU before the instruction at the
+ * breakpoint runs, and watchpoints stop it after the instruction which made the access. N.B. that
+ * the rest of the System keeps running while the CPU is frozen; whoever steps the System can check
+ * stopped() to pause it entirely. Instruction fetches trigger read watchpoints.
+ *
+ * The commands (breakpoints, resume(), etc.) may be called from any thread, e.g. from the Lua
+ * Interpreter (oml.debug.*). attach_bus(), detach_bus() and before_insn() must be called from the
+ * thread which steps the CPU; watchpoints added from other threads take effect at the next
+ * instruction.
+ */
+class Debugger {
+public:
+  enum class StopReason : U8 { NONE, PAUSE, BREAKPOINT, WATCHPOINT, STEP };
+
+  enum class WatchKind : U8 { READ = 1, WRITE = 2, ACCESS = READ | WRITE };
+
+  explicit Debugger(ILogger &logger);
+  ~Debugger();
+
+  Debugger(const Debugger &)            = delete;
+  Debugger &operator=(const Debugger &) = delete;
+  Debugger(Debugger &&)                 = delete;
+  Debugger &operator=(Debugger &&)      = delete;
+
+  /**
+   * Start watching accesses to the given MemoryBus, replacing any previously attached MemoryBus.
+   * The MemoryBus must outlive the Debugger, or be detached first.
+   */
+  void attach_bus(MemoryBus &bus);
+  void detach_bus();
+
+  void add_breakpoint(const U32 addr);
+  void remove_breakpoint(const U32 addr);
+
+  /**
+   * Adding a watchpoint to an address which is already watched replaces its kind.
+   */
+  void add_watchpoint(const U32 addr, const WatchKind kind);
+  void remove_watchpoint(const U32 addr);
+
+  /**
+   * Remove every breakpoint and watchpoint.
+   */
+  void clear();
+
+  /**
+   * Stop before the next instruction.
+   */
+  void pause();
+
+  /**
+   * Run until the next breakpoint or watchpoint. A breakpoint at the address which the CPU is
+   * stopped at does not stop it again.
+   */
+  void resume();
+
+  /**
+   * Run count instructions, then stop; breakpoints and watchpoints may stop the CPU sooner.
+   */
+  void step(const U64 count = 1);
+
+  bool       stopped() const;
+  StopReason stop_reason() const;
+
+  /**
+   * The address of the instruction for breakpoints, steps and pauses, or of the access for
+   * watchpoints.
+   */
+  U32 stop_address() const;
+
+  /**
+   * A human-readable description of the current state, e.g. "stopped at breakpoint 0x0104".
+   */
+  std::string status() const;
+
+  /**
+   * CPU hook, called before executing the instruction at pc. Returns true if the CPU must not
+   * execute it, in which case it should stop running until the next time it is stepped.
+   */
+  bool before_insn(const U32 pc);
+
+  /**
+   * Parse "r", "w" or "rw" (as used by oml.debug.add_watchpoint); throws std::invalid_argument
+   * otherwise.
+   */
+  static WatchKind parse_watch_kind(std::string_view str);
+
+private:
+  static constexpr U64 NOT_STEPPING = std::numeric_limits<U64>::max();
+
+  void on_access_(const U32 addr, const bool write);
+
+  /**
+   * Enter the stopped state; mtx_ must be held.
+   */
+  void stop_(const StopReason reason, const U32 addr);
+
+  /**
+   * Implements status(); mtx_ must be held.
+   */
+  std::string describe_() const;
+
+  /**
+   * Trap the pages containing the current watchpoints, and release those which are no longer
+   * needed; mtx_ must be held.
+   */
+  void sync_bus_();
+
+  /**
+   * Release every page trapped by sync_bus_(); mtx_ must be held.
+   */
+  void untrap_all_();
+
+  ILogger &logger_;
+
+  mutable std::mutex mtx_;
+
+  std::set<U32>            breakpoints_;
+  std::map<U32, WatchKind> watchpoints_;
+
+  MemoryBus *pBus_;
+
+  /**
+   * The addresses which the attached MemoryBus is currently trapping on our behalf, and whether
+   * they are out of date with watchpoints_.
+   */
+  std::vector<U32> trapped_;
+  bool             trapsDirty_;
+
+  bool       stopped_;
+  StopReason stopReason_;
+  U32        stopAddress_;
+
+  /**
+   * Set by resume() and step() so that the CPU can leave the breakpoint it is stopped at.
+   */
+  bool skipBreakpoint_;
+
+  bool pauseRequested_;
+  U64  stepsRemaining_;
+};
+
+}  // namespace omulator
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Identifies an event scheduled with an EventScheduler. Handles become stale once their event has
+ * fired or been cancelled, after which they are safely ignored by the EventScheduler.
+ */
+struct EventHandle {
+  U32 slot       = std::numeric_limits<U32>::max();
+  U32 generation = 0;
+
+  bool operator==(const EventHandle &) const noexcept = default;
+};
+
+/**
+ * A queue of callbacks to be invoked at absolute cycle timestamps, intended for things like "raise
+ * an IRQ in 4096 cycles" or "end of scanline at cycle N". Each System owns one of these; see
+ * System for how it is driven.
+ *
+ * Implemented as a binary min-heap of small POD entries, ordered by timestamp and then by the order
+ * in which events were scheduled, so events due on the same cycle fire in FIFO order. Callbacks
+ * live in a separate slot table indexed by EventHandle. Cancellation is O(1): it bumps the slot's
+ * generation, which marks the heap entry stale, and stale entries are discarded as they reach the
+ * top of the heap (or all at once if they come to outnumber the live entries). Rescheduling
+ * reuses the callback and costs a cancellation plus an O(log n) insertion.
+ *
+ * Not threadsafe; meant to be used from the thread which steps the owning System.
+ */
+class EventScheduler {
+public:
+  using Callback_t = std::function<void()>;
+
+  /**
+   * Returned by next_event_cycle() when there are no pending events.
+   */
+  static constexpr Cycle_t NO_EVENT = std::numeric_limits<Cycle_t>::max();
+
+  EventScheduler();
+  ~EventScheduler() = default;
+
+  EventScheduler(const EventScheduler &)            = delete;
+  EventScheduler &operator=(const EventScheduler &) = delete;
+  EventScheduler(EventScheduler &&)                 = delete;
+  EventScheduler &operator=(EventScheduler &&)      = delete;
+
+  /**
+   * Schedule callback to be invoked once the scheduler reaches the given absolute cycle. Events
+   * scheduled in the past will fire at the next call to run_until().
+   */
+  EventHandle schedule_at(const Cycle_t cycle, Callback_t callback);
+
+  /**
+   * Same as schedule_at(), but relative to now(). N.B. that now() only advances when the owning
+   * System synchronizes its Components (or fires an event), so from within Component::step it may
+   * trail the caller's own cycle by up to a timeslice; Components should use the overload below.
+   */
+  EventHandle schedule_in(const Cycle_t delay, Callback_t callback);
+
+  /**
+   * Same as schedule_at(), but relative to from, e.g. the cycle that a Component has reached in the
+   * middle of its step() method.
+   */
+  EventHandle schedule_in(const Cycle_t from, const Cycle_t delay, Callback_t callback);
+
+  /**
+   * Prevent a pending event from firing. Returns false if the handle is stale.
+   */
+  bool cancel(const EventHandle handle) noexcept;
+
+  /**
+   * Move a pending event to a new absolute cycle, keeping its callback. Returns the handle to use
+   * from now on, or a stale handle if the given handle was itself stale.
+   */
+  EventHandle reschedule(const EventHandle handle, const Cycle_t cycle);
+
+  /**
+   * Whether or not the event referred to by handle has yet to fire or be cancelled.
+   */
+  bool pending(const EventHandle handle) const noexcept;
+
+  /**
+   * The absolute cycle of the pending event with the smallest timestamp, or NO_EVENT.
+   */
+  Cycle_t next_event_cycle() noexcept;
+
+  /**
+   * Fire every event due at or before cycle, in order, then set now() to cycle (unless now() is
+   * already past it). While each callback is running, now() returns that event's timestamp, and
+   * callbacks may freely schedule or cancel other events; newly scheduled events fire in the same
+   * call if they are due.
+   */
+  void run_until(const Cycle_t cycle);
+
+  /**
+   * The cycle that the scheduler has been run up to.
+   */
+  Cycle_t now() const noexcept;
+
+  /**
+   * Set now() without firing any events, e.g. when restoring a save state.
+   */
+  void set_now(const Cycle_t cycle) noexcept;
+
+  /**
+   * Cancel every pending event, e.g. before restoring a save state, since callbacks can't be saved;
+   * whoever scheduled them is responsible for rescheduling them. Every outstanding handle becomes
+   * stale.
+   */
+  void clear() noexcept;
+
+  /**
+   * The number of pending events.
+   */
+  std::size_t size() const noexcept;
+
+private:
+  struct Entry_ {
+    Cycle_t cycle;
+    U64     sequence;
+    U32     slot;
+    U32     generation;
+  };
+
+  struct Slot_ {
+    Callback_t callback;
+    U32        generation;
+    bool       live;
+  };
+
+  /**
+   * Heap comparator which puts the earliest event at the top.
+   */
+  static bool later_(const Entry_ &lhs, const Entry_ &rhs) noexcept;
+
+  bool is_stale_(const Entry_ &entry) const noexcept;
+
+  /**
+   * Mark the slot as dead and invalidate all outstanding handles to it.
+   */
+  void release_slot_(const U32 slot) noexcept;
+
+  void push_entry_(const Cycle_t cycle, const U32 slot);
+
+  /**
+   * Pop stale entries off the top of the heap, and rebuild it entirely if too many have
+   * accumulated.
+   */
+  void prune_();
+
+  std::vector<Entry_> heap_;
+  std::vector<Slot_>  slots_;
+  std::vector<U32>    freeSlots_;
+
+  Cycle_t     now_;
+  U64         nextSequence_;
+  std::size_t numLive_;
+};
+
+}  // namespace omulator
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <optional>
+#include <span>
+
+namespace omulator {
+
+/**
+ * A generic interface for a destination for mixed audio, e.g. an audio device or a file. Audio is
+ * written as interleaved stereo frames of floats in [-1, 1], at the sink's sample_rate().
+ */
+class IAudioSink {
+public:
+  static constexpr U32 DEFAULT_SAMPLE_RATE = 48000;
+
+  virtual ~IAudioSink() = default;
+
+  /**
+   * The rate at which the sink consumes frames, in Hz.
+   */
+  virtual U32 sample_rate() const noexcept = 0;
+
+  /**
+   * Queue frames for output. Called from the AudioEngine's thread.
+   */
+  virtual void write(std::span<const float> frames) = 0;
+
+  /**
+   * How full the sink's queue is, where 1 is its target latency; the AudioEngine adjusts its
+   * resampling ratio to keep this at 0.5. Sinks which aren't consumed in real time, such as files,
+   * return std::nullopt, in which case the ratio is left at its nominal value.
+   */
+  virtual std::optional<double> fill_level() const = 0;
+};
+
+}  // namespace omulator
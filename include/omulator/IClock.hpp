@@ -2,6 +2,8 @@
 
 #include "omulator/oml_types.hpp"
 
+#include <chrono>
+
 namespace omulator {
 
 class IClock {
@@ -11,6 +13,16 @@ public:
   virtual TimePoint_t now() const noexcept = 0;
 
   virtual void sleep_until(const TimePoint_t then) = 0;
+
+  /**
+   * The point on std::chrono::steady_clock up until which a caller which is about to call
+   * sleep_until(then) may instead block on something else, e.g. a mailbox, so that it stays
+   * responsive while it waits. Clocks which aren't tied to the host's time return the current host
+   * time, i.e. the caller shouldn't wait at all.
+   */
+  virtual TimePoint_t host_deadline([[maybe_unused]] const TimePoint_t then) const noexcept {
+    return std::chrono::steady_clock::now();
+  }
 };
 
 }  // namespace omulator
@@ -2,6 +2,7 @@
 
 #include "omulator/ILogger.hpp"
 #include "omulator/di/Injector.hpp"
+#include "omulator/graphics/VideoOutput.hpp"
 
 namespace omulator {
 
@@ -22,6 +23,13 @@ public:
   virtual void render_frame()                               = 0;
   virtual void set_vertex_shader(const std::string &shader) = 0;
 
+  /**
+   * Display an emulated video frame. The frame's pixels are only valid until this returns, so a
+   * backend which needs them later must copy them (e.g. into a staging buffer). Backends which can't
+   * display emulated video ignore it.
+   */
+  virtual void upload_frame([[maybe_unused]] const graphics::VideoOutput::Frame &frame) { }
+
 protected:
   ILogger      &logger_;
   di::Injector &injector_;
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/oml_types.hpp"
+#include "omulator/util/MappedFile.hpp"
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace omulator {
+
+class MediaReadAhead;
+
+/**
+ * The header at the start of a hunked image, which is followed by numHunks HunkEntries and then the
+ * hunks themselves. Every hunk holds hunkSize bytes of the image, except for the last, which holds
+ * whatever remains.
+ */
+struct HunkHeader {
+  static constexpr std::array<char, 8> MAGIC   = {'O', 'M', 'L', 'H', 'U', 'N', 'K', 'S'};
+  static constexpr U32                 VERSION = 1;
+
+  std::array<char, 8> magic;
+  U32                 version;
+  U32                 hunkSize;
+  U64                 imageSize;
+  U64                 numHunks;
+  std::array<U8, 32>  reserved;
+};
+
+static_assert(sizeof(HunkHeader) == 64, "HunkHeader must not contain padding");
+
+/**
+ * The location of one hunk within a hunked image. If flags has COMPRESSED set then the hunk is an
+ * LZ4 block (see util/Lz4Block.hpp); otherwise it is stored as is.
+ */
+struct HunkEntry {
+  static constexpr U32 COMPRESSED = 0x01;
+
+  U64 offset;
+  U32 size;
+  U32 flags;
+};
+
+static_assert(sizeof(HunkEntry) == 16, "HunkEntry must not contain padding");
+
+/**
+ * A read-only ROM, cartridge or disc image, which is memory-mapped rather than read into memory, so
+ * that opening an image and mapping it into a MemoryBus costs the same no matter how large it is;
+ * pages are only read from disk when they are first touched.
+ *
+ * Images are either raw, i.e. the file is the image, or hunked: the image is split into fixed-size
+ * hunks, each of which is compressed separately (see HunkHeader and write_hunked), so that any
+ * part of the image can be read without decompressing what comes before it. Decompressed hunks are
+ * kept in an LRU cache, whose size is given in hunks; a MediaReadAhead can be attached so that the
+ * hunks following a cache miss are decompressed in the background, before they are needed.
+ *
+ * The OS is told to expect random access to raw images, since emulated code jumps around an image
+ * rather than streaming through it, and prefetch() can be used to page a region in ahead of time,
+ * e.g. the data a game is about to load.
+ *
+ * read() and prefetch() are threadsafe, so the cache may be filled from other threads while the
+ * image is mapped into a MemoryBus.
+ */
+class MediaImage {
+public:
+  static constexpr std::size_t DEFAULT_CACHE_HUNKS = 64;
+  static constexpr std::size_t DEFAULT_HUNK_SIZE   = 64 * 1024;
+
+  struct CacheStats {
+    U64 hits;
+    U64 misses;
+  };
+
+  /**
+   * Open an image, which is treated as hunked if it begins with HunkHeader::MAGIC and raw
+   * otherwise. Only the header is read up front. Throws std::runtime_error if the file can't be
+   * opened or is a malformed hunked image, and std::invalid_argument if cacheHunks is 0.
+   */
+  explicit MediaImage(const std::filesystem::path &path,
+                      const std::size_t            cacheHunks = DEFAULT_CACHE_HUNKS);
+
+  /**
+   * Cancels any pending read-ahead for this image.
+   */
+  ~MediaImage();
+
+  MediaImage(const MediaImage &)            = delete;
+  MediaImage &operator=(const MediaImage &) = delete;
+  MediaImage(MediaImage &&)                 = delete;
+  MediaImage &operator=(MediaImage &&)      = delete;
+
+  /**
+   * The size of the image; for hunked images this is the decompressed size.
+   */
+  U64  size() const noexcept;
+  bool compressed() const noexcept;
+
+  /**
+   * The size of each hunk, or 0 for raw images.
+   */
+  std::size_t hunk_size() const noexcept;
+
+  /**
+   * The contents of a raw image, straight from the mapping; empty for hunked images.
+   */
+  std::span<const U8> data() const noexcept;
+
+  /**
+   * Copy out.size() bytes starting at offset into out. Throws std::out_of_range if the range
+   * extends past the end of the image, and std::runtime_error if a hunk is corrupt.
+   */
+  void read(const U64 offset, std::span<U8> out);
+
+  /**
+   * Make the given range available ahead of time: for raw images the OS is asked to start reading
+   * it in, while for hunked images the hunks covering it are decompressed into the cache. The range
+   * is clamped to the image.
+   */
+  void prefetch(const U64 offset, const U64 size);
+
+  /**
+   * After each cache miss, ask readAhead to decompress the next numHunks hunks in the background.
+   * Pass nullptr to stop. The MediaReadAhead must outlive the MediaImage, or be detached first.
+   * Has no effect on raw images.
+   */
+  void set_read_ahead(MediaReadAhead *const readAhead, const std::size_t numHunks);
+
+  /**
+   * Map the image into bus at base, which must be page-aligned; the mapping is rounded up to a
+   * whole number of pages, and the remainder of the last page reads as zero. Raw images are mapped
+   * directly with MemoryBus::map_rom, apart from a partial last page, which is copied. Hunked
+   * images start out mapped as MMIO, with a single handler for the whole image; the first read
+   * from each hunk decompresses it (through the cache) into a page-aligned buffer, which replaces
+   * the MMIO as a ROM mapping once the read has returned (see MemoryBus::defer_map_change), so only
+   * that first read can throw. The buffers belong to the MemoryBus' MMIO handler, so they are kept
+   * for as long as the MemoryBus. Writes are ignored in either case. The MediaImage must outlive
+   * the mapping.
+   */
+  void map_into(MemoryBus &bus, const MemoryBus::Addr_t base);
+
+  /**
+   * Hits and misses in the hunk cache from read() and mapped reads; prefetches are not counted.
+   */
+  CacheStats cache_stats() const;
+
+  /**
+   * Write data to path as a hunked image, with each hunk compressed unless that would make it
+   * larger. Throws std::invalid_argument if hunkSize is 0 or doesn't fit in a U32, and
+   * std::runtime_error if the file can't be written.
+   */
+  static void write_hunked(const std::filesystem::path &path,
+                           std::span<const U8>          data,
+                           const std::size_t            hunkSize = DEFAULT_HUNK_SIZE);
+
+private:
+  using Hunk_t = std::shared_ptr<const std::vector<U8>>;
+
+  struct CacheEntry_ {
+    Hunk_t                           hunk;
+    std::list<std::size_t>::iterator lruPos;
+  };
+
+  /**
+   * Returns the given hunk, decompressing it if it isn't in the cache. Foreground accesses are
+   * counted in the stats and trigger read-ahead on a miss.
+   */
+  Hunk_t get_hunk_(const std::size_t idx, const bool foreground);
+
+  /**
+   * Decompress the given hunk; no locks are held, so that other hunks can be read meanwhile.
+   */
+  Hunk_t decompress_hunk_(const std::size_t idx) const;
+
+  util::MappedFile file_;
+  U64              size_;
+  std::size_t      hunkSize_;
+  std::size_t      numHunks_;
+  const U8        *hunkTable_;
+  std::size_t      cacheHunks_;
+
+  /**
+   * Guards everything below, i.e. the cache, the stats and the read-ahead settings.
+   */
+  mutable std::mutex                           cacheMtx_;
+  std::list<std::size_t>                       lru_;
+  std::unordered_map<std::size_t, CacheEntry_> cache_;
+  CacheStats                                   stats_;
+  MediaReadAhead                              *readAhead_;
+  std::size_t                                  readAheadHunks_;
+
+  /**
+   * The padded copies of the partial last page of a raw image, one per map_into call.
+   */
+  std::vector<std::vector<U8>> tailPages_;
+};
+
+}  // namespace omulator
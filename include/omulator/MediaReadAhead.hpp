@@ -0,0 +1,84 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/Subsystem.hpp"
+#include "omulator/msg/MailboxRouter.hpp"
+#include "omulator/msg/MailboxSender.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace omulator {
+
+class MediaImage;
+
+/**
+ * Prefetches ranges of MediaImages on its own thread, so that hunks are decompressed (or raw pages
+ * read from disk) before the emulation thread needs them; see MediaImage::set_read_ahead.
+ *
+ * Requests are serviced in order. If more than MAX_PENDING are waiting, new ones are dropped rather
+ * than blocking the caller, since read-ahead is only an optimization. A request which fails (e.g.
+ * because a hunk is corrupt) is logged and skipped; the error will be reported again to whoever
+ * reads that part of the image.
+ */
+class MediaReadAhead : public Subsystem {
+public:
+  /**
+   * The maximum number of requests which may be waiting to be serviced.
+   */
+  static constexpr std::size_t MAX_PENDING = 16;
+
+  MediaReadAhead(ILogger &logger, msg::MailboxRouter &mbrouter);
+
+  /**
+   * Stops the underlying thread before any pending requests are discarded.
+   */
+  ~MediaReadAhead() override;
+
+  /**
+   * Queue a prefetch of the given range of image. Returns false if the request was dropped because
+   * too many are already pending. The image must outlive the request, or cancel() it.
+   */
+  bool request(MediaImage &image, const U64 offset, const U64 size);
+
+  /**
+   * Discard any pending requests for image, and wait for one which is in progress to finish.
+   */
+  void cancel(const MediaImage &image);
+
+  /**
+   * The number of requests which have been serviced.
+   */
+  U64 completed() const noexcept;
+
+private:
+  struct Request_ {
+    MediaImage *image;
+    U64         offset;
+    U64         size;
+  };
+
+  /**
+   * Service every pending request.
+   */
+  void drain_pending_();
+
+  msg::MailboxSender selfSender_;
+
+  /**
+   * Guards pending_, which is shared with the threads making requests.
+   */
+  std::mutex           queueMtx_;
+  std::deque<Request_> pending_;
+
+  /**
+   * Held while a request is being serviced, so that cancel() can wait for it.
+   */
+  std::mutex workMtx_;
+
+  std::atomic<U64> completed_;
+};
+
+}  // namespace omulator
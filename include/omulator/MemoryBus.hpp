@@ -0,0 +1,398 @@
+#pragma once
+
+#include "omulator/Component.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/oml_defines.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <concepts>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * An emulated address space, divided into pages of 2^pageBits bytes. Each page is either unmapped,
+ * backed by RAM owned by the MemoryBus, backed by an externally owned ROM image, or handled by a
+ * pair of MMIO callbacks.
+ *
+ * The page table holds a direct host pointer for every page which can be read (RAM/ROM) or written
+ * (RAM) without any side effects, so the common case for a load or store is a shift, a table load
+ * and a host memory access. A null pointer in the table sends the access down the slow path, which
+ * dispatches to MMIO handlers, drops writes to ROM, and returns the open bus value for unmapped
+ * pages.
+ *
+ * Multi-byte accesses are little-endian. Addresses are wrapped to the size of the address space.
+ *
+ * Pages can also be watched, e.g. by a cache of decoded instructions which needs to know when the
+ * memory it was decoded from changes. Writes to watched RAM pages take the slow path, which
+ * notifies every write watcher of the address written; the watchers are also notified whenever a
+ * watched page is remapped. Unwatched pages are unaffected.
+ *
+ * Pages can similarly be trapped, e.g. by a Debugger implementing watchpoints: every read or write
+ * to a trapped page takes the slow path, which passes the address to the access hook before
+ * performing the access as usual. This includes instruction fetches and accesses made by code
+ * generated from the page tables, so the fast path carries no extra checks for untrapped pages.
+ *
+ * MMIO handlers may not change the memory map themselves, since the page being accessed would
+ * change partway through the access; they can instead defer the change until the access has
+ * returned with defer_map_change().
+ *
+ * # DIRTY TRACKING
+ * Each dirty tracker (see add_dirty_tracker()) keeps track of which pages of RAM have been written
+ * since it last collected them with collect_dirty_pages(), e.g. so that a StateHasher only has to
+ * rehash the RAM which has changed, and a RewindBuffer only has to copy it. Trackers are
+ * independent of each other, so collecting for one has no effect on what the others see. This works
+ * the same way as write watching: a page which is clean for any tracker is left out of the write
+ * page table, so the first write to it takes the slow path, which marks it dirty for every tracker
+ * and puts it back in the table; every later write to it takes the fast path until the next
+ * collection. RAM pages are identified by their index among all of the RAM added with add_ram, in
+ * order (see num_ram_pages()), rather than by their address. N.B. that writes made directly through
+ * the span returned by add_ram bypass the tracking, while loading a state marks all RAM dirty.
+ *
+ * The MemoryBus is a Component so that it can be managed by a System's child Injector, which lets
+ * the Components attached to the System take a MemoryBus& as a dependency and share the same
+ * address space. It does nothing when stepped, so it does not need to be added to the System's
+ * component list. As with the EventScheduler, it should not be instantiated by the parent Injector.
+ * Not threadsafe.
+ *
+ * serialize() saves the contents of RAM, with each block added by add_ram stored as a single
+ * region. The memory map itself (along with ROM and MMIO) is not saved, since it is set up by
+ * whoever configures the System; a state can only be loaded into a MemoryBus whose RAM blocks
+ * were added with the same sizes, in the same order.
+ */
+class MemoryBus : public Component {
+public:
+  using Addr_t         = U32;
+  using ReadHandler_t  = std::function<U8(const Addr_t)>;
+  using WriteHandler_t = std::function<void(const Addr_t, const U8)>;
+
+  /**
+   * Receives the start and size of a range of watched memory which has changed.
+   */
+  using WriteWatcher_t = std::function<void(const Addr_t, const std::size_t)>;
+
+  /**
+   * Receives the address of each access to a trapped page, and whether the access is a write.
+   */
+  using AccessHook_t = std::function<void(const Addr_t, const bool)>;
+
+  enum class PageKind : U8 { UNMAPPED, RAM, ROM, MMIO };
+
+  /**
+   * Returned by reads from unmapped pages.
+   */
+  static constexpr U8 OPEN_BUS_VALUE = 0xFF;
+
+  /**
+   * Throws if addressBits is greater than 32, or if pageBits is not between 1 and addressBits.
+   */
+  MemoryBus(ILogger &logger, const U32 addressBits = 16, const U32 pageBits = 12);
+  ~MemoryBus() override = default;
+
+  /**
+   * Write watchers are notified of every watched RAM page after a load, as the contents of the
+   * whole page may have changed.
+   */
+  void serialize(StateArchive &archive) override;
+
+  /**
+   * Allocate size bytes of zeroed RAM and map it at base. Returns the RAM, which remains owned by
+   * the MemoryBus. base and size must be page-aligned.
+   */
+  std::span<U8> add_ram(const Addr_t base, const std::size_t size);
+
+  /**
+   * Map a read-only image at base; writes to it are ignored. The image is not copied, so it must
+   * outlive the MemoryBus (or be unmapped first). base and the size of rom must be page-aligned.
+   */
+  void map_rom(const Addr_t base, std::span<const U8> rom);
+
+  /**
+   * Route all accesses to the given range to the given handlers, which will receive the full
+   * address of each access. base and size must be page-aligned.
+   */
+  void map_mmio(const Addr_t      base,
+                const std::size_t size,
+                ReadHandler_t     onRead,
+                WriteHandler_t    onWrite);
+
+  /**
+   * Unmap the given range. base and size must be page-aligned. N.B. that RAM which is unmapped is
+   * not freed until the MemoryBus is destroyed.
+   */
+  void unmap(const Addr_t base, const std::size_t size);
+
+  /**
+   * Apply change, which modifies the memory map, once the outermost MMIO handler in progress has
+   * returned, e.g. for a handler which replaces its own mapping. add_ram, map_rom, map_mmio and
+   * unmap throw std::logic_error if they are called from within a handler. Changes are applied in
+   * the order they were deferred, and are dropped if the handler throws. Outside of a handler,
+   * change is applied immediately.
+   */
+  void defer_map_change(std::function<void()> change);
+
+  /**
+   * Register a function to be notified of changes to watched pages. Returns an ID which can be used
+   * to remove the watcher. N.B. that watchers may not be added or removed from within a watcher.
+   */
+  std::size_t add_write_watcher(WriteWatcher_t watcher);
+  void        remove_write_watcher(const std::size_t id);
+
+  /**
+   * Start or stop watching the page containing addr. Watches are counted, so a page remains
+   * watched until unwatch_page has been called as many times as watch_page. Watches apply to the
+   * address range rather than whatever happens to be mapped there.
+   */
+  void watch_page(const Addr_t addr);
+  void unwatch_page(const Addr_t addr);
+
+  /**
+   * Set the function which is called for each access to a trapped page; an empty hook disables
+   * the call, but trapped pages still take the slow path.
+   */
+  void set_access_hook(AccessHook_t hook);
+
+  /**
+   * Start or stop trapping the page containing addr; counted in the same way as watch_page.
+   */
+  void trap_page(const Addr_t addr);
+  void untrap_page(const Addr_t addr);
+
+  /**
+   * Start tracking writes to RAM for a new consumer, for which all RAM starts out dirty. Returns an
+   * ID to pass to collect_dirty_pages() and remove_dirty_tracker().
+   */
+  std::size_t add_dirty_tracker();
+  void        remove_dirty_tracker(const std::size_t id);
+
+  /**
+   * True if there are any dirty trackers.
+   */
+  bool dirty_tracking() const noexcept;
+
+  /**
+   * Call fn with the index and contents of each page of RAM which has been written since the last
+   * call for the same tracker (or since the tracker was added), and mark them clean again for that
+   * tracker. Throws std::invalid_argument if there is no such tracker.
+   */
+  void collect_dirty_pages(const std::size_t                                                  id,
+                           const std::function<void(const std::size_t, std::span<const U8>)> &fn);
+
+  /**
+   * The total number of pages in the RAM added with add_ram.
+   */
+  std::size_t num_ram_pages() const noexcept;
+
+  /**
+   * Every block of RAM added with add_ram, in order.
+   */
+  std::vector<std::span<const U8>> ram_blocks() const;
+
+  PageKind page_kind(const Addr_t addr) const noexcept;
+
+  OML_FORCEINLINE U8 read8(Addr_t addr) const {
+    addr &= addressMask_;
+    const U8 *const page = readPages_[addr >> pageBits_];
+    if(page != nullptr) [[likely]] {
+      return page[addr & pageMask_];
+    }
+
+    return read_slow_(addr);
+  }
+
+  OML_FORCEINLINE void write8(Addr_t addr, const U8 val) {
+    addr &= addressMask_;
+    U8 *const page = writePages_[addr >> pageBits_];
+    if(page != nullptr) [[likely]] {
+      page[addr & pageMask_] = val;
+      return;
+    }
+
+    write_slow_(addr, val);
+  }
+
+  /**
+   * Little-endian multi-byte accesses. Accesses which don't straddle a page boundary take the same
+   * fast path as read8/write8; all others are split into byte accesses. N.B. that the fast path
+   * copies bytes as-is, and so assumes a little-endian host.
+   */
+  template<std::unsigned_integral T>
+  OML_FORCEINLINE T read(Addr_t addr) const {
+    addr &= addressMask_;
+    const U8 *const page   = readPages_[addr >> pageBits_];
+    const Addr_t    offset = addr & pageMask_;
+    if(page != nullptr && std::size_t{offset} + (sizeof(T) - 1) <= pageMask_) [[likely]] {
+      T val;
+      std::memcpy(&val, page + offset, sizeof(T));
+      return val;
+    }
+
+    T val = 0;
+    for(std::size_t i = 0; i < sizeof(T); ++i) {
+      val |= static_cast<T>(static_cast<T>(read8(addr + static_cast<Addr_t>(i))) << (8 * i));
+    }
+    return val;
+  }
+
+  template<std::unsigned_integral T>
+  OML_FORCEINLINE void write(Addr_t addr, const T val) {
+    addr &= addressMask_;
+    U8 *const    page   = writePages_[addr >> pageBits_];
+    const Addr_t offset = addr & pageMask_;
+    if(page != nullptr && std::size_t{offset} + (sizeof(T) - 1) <= pageMask_) [[likely]] {
+      std::memcpy(page + offset, &val, sizeof(T));
+      return;
+    }
+
+    for(std::size_t i = 0; i < sizeof(T); ++i) {
+      write8(addr + static_cast<Addr_t>(i), static_cast<U8>(val >> (8 * i)));
+    }
+  }
+
+  U32         address_bits() const noexcept;
+  U32         page_bits() const noexcept;
+  std::size_t page_size() const noexcept;
+  std::size_t num_pages() const noexcept;
+
+  /**
+   * The page tables used by the fast paths, with num_pages() entries each, for code which generates
+   * its own fast paths (e.g. a recompiler). A null entry means that accesses to the page must go
+   * through read8()/write8(). The tables stay at the same address for the life of the MemoryBus.
+   */
+  U8 *const *read_page_table() const noexcept;
+  U8 *const *write_page_table() const noexcept;
+
+private:
+  struct PageInfo_ {
+    PageKind kind;
+
+    /**
+     * Host backing for RAM and ROM pages; null otherwise.
+     */
+    U8 *data;
+
+    /**
+     * Index into mmioHandlers_ for MMIO pages, or into ramPages_ for RAM pages.
+     */
+    std::size_t index;
+  };
+
+  struct RamBlock_ {
+    std::unique_ptr<U8[]> data;
+    std::size_t           size;
+  };
+
+  /**
+   * Bookkeeping for dirty tracking, for each page of RAM.
+   */
+  struct RamPage_ {
+    U8 *data;
+
+    /**
+     * The index of the page which the RAM is mapped at, or NO_PAGE if it has been unmapped.
+     */
+    std::size_t busPage;
+
+    /**
+     * The number of dirty trackers for which the page is clean; the page can only be written from
+     * the fast path when this is zero.
+     */
+    std::size_t numClean;
+  };
+
+  struct DirtyTracker_ {
+    bool active;
+
+    /**
+     * Whether each page of RAM is dirty, and the dirty pages in the order they were first written.
+     */
+    std::vector<bool>        dirty;
+    std::vector<std::size_t> pages;
+  };
+
+  static constexpr std::size_t NO_PAGE = static_cast<std::size_t>(-1);
+
+  struct MmioHandlers_ {
+    ReadHandler_t  onRead;
+    WriteHandler_t onWrite;
+  };
+
+  U8   read_slow_(const Addr_t addr) const;
+  void write_slow_(const Addr_t addr, const U8 val);
+
+  /**
+   * Throws if an MMIO handler is in progress.
+   */
+  void check_map_change_() const;
+
+  /**
+   * Bracket each call to an MMIO handler; once the outermost one returns, the map changes it
+   * deferred are applied, or dropped if it threw.
+   */
+  void enter_handler_() const noexcept;
+  void leave_handler_(const bool apply) const;
+
+  /**
+   * Throws unless base and size are page-aligned and within the address space. Returns the range
+   * of page indices covered.
+   */
+  std::pair<std::size_t, std::size_t> page_range_(const Addr_t base, const std::size_t size) const;
+
+  /**
+   * Set the PageInfo_ for a single page and update its page table entries.
+   */
+  void update_page_(const std::size_t pageIdx, const PageInfo_ &info);
+
+  /**
+   * Recompute the page table entries for a single page from its PageInfo_ and watch count.
+   */
+  void refresh_page_(const std::size_t pageIdx);
+
+  void notify_watchers_(const Addr_t addr, const std::size_t size);
+
+  /**
+   * Add a RAM page to the dirty set of every tracker which doesn't already have it.
+   */
+  void mark_dirty_(const std::size_t ramPage);
+
+  DirtyTracker_ &dirty_tracker_(const std::size_t id);
+
+  const U32    addressBits_;
+  const U32    pageBits_;
+  const Addr_t addressMask_;
+  const Addr_t pageMask_;
+
+  /**
+   * The page table proper; kept separate from pageInfo_ so that the fast path only touches a
+   * single pointer per access.
+   */
+  std::vector<U8 *> readPages_;
+  std::vector<U8 *> writePages_;
+
+  std::vector<PageInfo_>     pageInfo_;
+  std::vector<MmioHandlers_> mmioHandlers_;
+  std::vector<RamBlock_>     ramBlocks_;
+
+  std::vector<U32>            watchCounts_;
+  std::vector<WriteWatcher_t> watchers_;
+
+  std::vector<U32> trapCounts_;
+  AccessHook_t     accessHook_;
+
+  std::vector<RamPage_>      ramPages_;
+  std::vector<DirtyTracker_> dirtyTrackers_;
+  std::size_t                numDirtyTrackers_;
+
+  /**
+   * Mutable since reads dispatch to MMIO handlers.
+   */
+  mutable U32                                handlerDepth_;
+  mutable std::vector<std::function<void()>> deferredChanges_;
+};
+
+}  // namespace omulator
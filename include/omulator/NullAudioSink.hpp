@@ -0,0 +1,32 @@
+#pragma once
+
+#include "omulator/IAudioSink.hpp"
+
+#include <atomic>
+
+namespace omulator {
+
+/**
+ * Discards all audio; useful for running Omulator headless. Counts the frames it is given, so that
+ * tests can check how much audio was produced.
+ */
+class NullAudioSink : public IAudioSink {
+public:
+  explicit NullAudioSink(const U32 sampleRate = DEFAULT_SAMPLE_RATE);
+  ~NullAudioSink() override = default;
+
+  U32                   sample_rate() const noexcept override;
+  void                  write(std::span<const float> frames) override;
+  std::optional<double> fill_level() const override;
+
+  /**
+   * The number of frames written so far. Threadsafe.
+   */
+  U64 frames_written() const noexcept;
+
+private:
+  U32              sampleRate_;
+  std::atomic<U64> framesWritten_;
+};
+
+}  // namespace omulator
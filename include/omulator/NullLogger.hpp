@@ -3,29 +3,41 @@
 #include "omulator/ILogger.hpp"
 
 namespace omulator {
+
+/**
+ * An ILogger which discards everything; useful where nothing should be logged, or where a
+ * LoggerMock would be too heavy, such as in benchmarks.
+ */
 class NullLogger : public ILogger {
 public:
   ~NullLogger() override = default;
 
   void critical(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
   void error(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
   void warn(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
   void info(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
   void debug(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
   void trace(
     [[maybe_unused]] const char * const         msg,
-    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current()) { }
+    [[maybe_unused]] const util::SourceLocation location = util::SourceLocation::current())
+    override { }
 
-  void set_level([[maybe_unused]] LogLevel level) { }
+  void set_level([[maybe_unused]] LogLevel level) override { }
 };
+
 }  // namespace omulator
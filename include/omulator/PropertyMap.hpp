@@ -126,6 +126,25 @@ public:
     return get_prop_<T>(key);
   }
 
+  /**
+   * Same as get_prop, except that a property which does not exist yet is created with the value
+   * defaultVal, rather than a default-initialized value. A property which already exists keeps its
+   * value.
+   */
+  template<typename T>
+  requires prop_map_type<T> PropertyValue<T>
+  &get_prop_or_default(std::string key, const T &defaultVal) {
+    std::scoped_lock lck{mtx_};
+
+    const bool found = query_prop_(key).first;
+    auto      &prop  = get_prop_<T>(key);
+    if(!found) {
+      prop.set(defaultVal);
+    }
+
+    return prop;
+  }
+
   /**
    * Get a property value without knowing the type beforehand. Unlike get_prop, this version returns
    * a copy of the value opposed to a (PropertyValue) reference, and this version will not create an
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/MemoryBus.hpp"
+#include "omulator/PropertyMap.hpp"
+#include "omulator/Subsystem.hpp"
+#include "omulator/System.hpp"
+#include "omulator/msg/MailboxRouter.hpp"
+#include "omulator/msg/MailboxSender.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Keeps a bounded history of a System's save states so that it can be rewound, one snapshot at a
+ * time; typically capture() is called once per frame, and rewind() is called once per frame for as
+ * long as the user holds the rewind button.
+ *
+ * Only the most recent snapshot is kept in full. Each older snapshot is stored as an XOR delta (see
+ * util/XorDelta.hpp) against the snapshot which followed it, so that the oldest snapshots can be
+ * dropped without touching the others, and rewinding one step is a single pass over the newest
+ * delta. Since consecutive frames usually only touch a small part of memory, this typically takes
+ * a small fraction of the space of the full states.
+ *
+ * The emulation thread only pays for serializing the System into a recycled buffer; the delta
+ * encoding happens on the RewindBuffer's own thread. If that thread falls more than MAX_PENDING
+ * snapshots behind, captures are dropped rather than blocking the emulation thread.
+ *
+ * With a MemoryBus attached (see attach_bus()), a capture only copies the pages of RAM which have
+ * been written since the previous capture, using a MemoryBus dirty tracker, and the RewindBuffer's
+ * thread fills in the rest of RAM from the previous snapshot; the cost to the emulation thread is
+ * then proportional to the amount of RAM written per frame rather than the total amount of RAM.
+ * Without one, every capture copies the whole state.
+ *
+ * The history is bounded by both props::REWIND_DEPTH (the number of snapshots) and
+ * props::REWIND_BUDGET_MB (the total size of the full snapshot and the deltas); whichever limit is
+ * hit first causes the oldest snapshots to be dropped. Both are read each time a snapshot is added,
+ * so they can be changed at any time.
+ *
+ * capture(), rewind(), attach_bus() and detach_bus() should be called from the thread which steps
+ * the System.
+ */
+class RewindBuffer : public Subsystem {
+public:
+  static constexpr U64 DEFAULT_DEPTH     = 600;
+  static constexpr U64 DEFAULT_BUDGET_MB = 256;
+
+  /**
+   * The maximum number of snapshots which may be waiting to be encoded.
+   */
+  static constexpr std::size_t MAX_PENDING = 4;
+
+  /**
+   * Sets any of the properties which have not been set to their defaults.
+   */
+  RewindBuffer(ILogger &logger, msg::MailboxRouter &mbrouter, PropertyMap &propertyMap);
+
+  /**
+   * Stops the underlying thread before any snapshots are destroyed, and detaches the MemoryBus.
+   */
+  ~RewindBuffer() override;
+
+  /**
+   * Only copy the parts of the given MemoryBus' RAM which have changed on each capture, replacing
+   * any previously attached MemoryBus. The MemoryBus must be part of the state of every System
+   * passed to capture() (see System::register_state), and must outlive the RewindBuffer, or be
+   * detached first.
+   */
+  void attach_bus(MemoryBus &bus);
+  void detach_bus();
+
+  /**
+   * Take a snapshot of the System. Returns false if the snapshot was dropped because the
+   * RewindBuffer's thread is too far behind.
+   */
+  bool capture(System &system);
+
+  /**
+   * Restore the most recent snapshot and remove it from the history, so that each call steps
+   * further back; the System's pending events are replaced as described by System::load_state.
+   * Returns false if there are no snapshots left. Throws if the System rejects the state, in which
+   * case the snapshot is kept.
+   */
+  bool rewind(System &system);
+
+  /**
+   * Discard every snapshot.
+   */
+  void clear();
+
+  /**
+   * The number of snapshots which are available to rewind to.
+   */
+  std::size_t depth();
+
+  /**
+   * The number of bytes taken up by the encoded history, not counting any buffers waiting to be
+   * encoded or recycled.
+   */
+  std::size_t memory_usage();
+
+  /**
+   * The number of captures which have been dropped.
+   */
+  U64 dropped() const noexcept;
+
+private:
+  /**
+   * A captured state waiting to be encoded.
+   */
+  struct Capture_ {
+    std::vector<U8> image;
+
+    /**
+     * The offsets of the pages of RAM in image which were left out because they hadn't changed
+     * since the previous capture, and so need to be copied from the previous snapshot.
+     */
+    std::vector<std::size_t> stalePages;
+    std::size_t              pageSize;
+  };
+
+  struct Snapshot_ {
+    std::vector<U8> data;
+
+    /**
+     * True if data is a full state rather than a delta, which happens when the size of the state
+     * changes from one snapshot to the next.
+     */
+    bool full;
+  };
+
+  /**
+   * Serialize the System into capture, copying only the pages of RAM which have changed.
+   */
+  void capture_dirty_(System &system, Capture_ &capture);
+
+  /**
+   * Encode every pending snapshot. ringMtx_ must be held, so that snapshots are always added in
+   * order, even if rewind() drains them while the RewindBuffer's thread is doing the same.
+   */
+  void drain_pending_();
+
+  /**
+   * Add a new state to the history. Returns the buffer which is no longer needed.
+   */
+  std::vector<U8> add_snapshot_(std::vector<U8> image);
+
+  void enforce_limits_();
+
+  PropertyValue<U64> &depthProp_;
+  PropertyValue<U64> &budgetMbProp_;
+  msg::MailboxSender  selfSender_;
+
+  MemoryBus  *bus_;
+  std::size_t dirtyTracker_;
+
+  /**
+   * Set when the next capture has to copy all of RAM, since there is no previous snapshot (or not
+   * the one that the dirty tracker was last collected for) to fill it in from.
+   */
+  std::atomic_bool needFullCapture_;
+
+  /**
+   * Guards the history, i.e. latest_, history_ and historyBytes_.
+   */
+  std::mutex ringMtx_;
+
+  /**
+   * The most recent snapshot in full; empty if there are no snapshots.
+   */
+  std::vector<U8> latest_;
+
+  /**
+   * Older snapshots, oldest first; each is a delta against the one which follows it (or latest_).
+   */
+  std::deque<Snapshot_> history_;
+  std::size_t           historyBytes_;
+
+  /**
+   * Guards pending_ and freeBuffers_, which are shared with the emulation thread.
+   */
+  std::mutex                   queueMtx_;
+  std::deque<Capture_>         pending_;
+  std::vector<std::vector<U8>> freeBuffers_;
+
+  std::atomic<U64> dropped_;
+};
+
+}  // namespace omulator
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/PropertyMap.hpp"
+#include "omulator/Subsystem.hpp"
+#include "omulator/System.hpp"
+#include "omulator/msg/MailboxRouter.hpp"
+#include "omulator/msg/MailboxSender.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Hides a game's internal input lag by presenting frames from the future: each host frame, the
+ * System runs one frame with the latest input as usual, and then props::RUN_AHEAD_FRAMES more
+ * frames are run from a copy of the resulting state, again with the latest input, and the last of
+ * those is presented. The copy is then discarded, so the emulated game never sees the extra frames.
+ * A game which takes N frames to react to input appears to react immediately with a run-ahead of
+ * N frames, provided that the extra frames are not affected by inputs the game has yet to see.
+ *
+ * If a secondary System is given, the extra frames run on the RunAhead's own thread: after the
+ * primary System runs a frame, its state is handed to the secondary System, which runs ahead and
+ * presents while the primary moves on to the next frame. The primary thread then only pays for a
+ * save state per frame, rather than N extra frames. This only helps if the host has a core to spare
+ * (see std::thread::hardware_concurrency), so callers should only create a secondary System in
+ * that case. Otherwise, the extra frames run on the primary System itself, which is restored from
+ * a save state afterwards.
+ *
+ * The secondary System must be set up exactly like the primary one; see System::load_state, which
+ * also describes how Components keep their pending events across the state being loaded. The
+ * frame and present functions passed to run_frame() are called with whichever System they
+ * should act on, possibly on the RunAhead's thread, so anything they share (e.g. the current host
+ * input) must be threadsafe. They should also be deterministic, as the same frame may be run more
+ * than once.
+ *
+ * N.B. that, like other Subsystems, start() must be called after construction; this is not
+ * necessary if no secondary System is given.
+ */
+class RunAhead : public Subsystem {
+public:
+  using FrameFn_t = std::function<void(System &)>;
+
+  /**
+   * secondary may be null, in which case everything runs on the calling thread.
+   */
+  RunAhead(ILogger            &logger,
+           msg::MailboxRouter &mbrouter,
+           PropertyMap        &propertyMap,
+           System             &primary,
+           System             *secondary = nullptr);
+
+  /**
+   * Waits for any frame in progress on the RunAhead's thread before stopping it.
+   */
+  ~RunAhead() override;
+
+  /**
+   * Run a single host frame: call runFrame on the primary System, then present a frame which is
+   * props::RUN_AHEAD_FRAMES frames ahead of it. When running ahead on the secondary System, this
+   * returns before the frame has been presented; any exception thrown while running ahead is
+   * rethrown by the next call to run_frame() or wait().
+   */
+  void run_frame(const FrameFn_t &runFrame, const FrameFn_t &present);
+
+  /**
+   * Block until the frame being run ahead on the RunAhead's thread, if any, has been presented.
+   */
+  void wait();
+
+  /**
+   * Whether or not frames are run ahead on the secondary System.
+   */
+  bool parallel() const noexcept;
+
+private:
+  /**
+   * Load stateImage_ into the secondary System, run it ahead and present it; runs on the
+   * RunAhead's thread.
+   */
+  void run_secondary_();
+
+  /**
+   * Block until the RunAhead's thread is idle. lck must hold mtx_.
+   */
+  void wait_idle_(std::unique_lock<std::mutex> &lck);
+
+  PropertyValue<U64> &framesProp_;
+  System             &primary_;
+  System             *secondary_;
+  msg::MailboxSender  selfSender_;
+
+  /**
+   * The state of the primary System as of the end of the last frame.
+   */
+  std::vector<U8> stateImage_;
+
+  /**
+   * Guards everything below, which is shared with the RunAhead's thread.
+   */
+  std::mutex              mtx_;
+  std::condition_variable idleCv_;
+  bool                    busy_;
+  std::exception_ptr      error_;
+
+  FrameFn_t secondaryFrame_;
+  FrameFn_t secondaryPresent_;
+  U64       secondaryFrames_;
+};
+
+}  // namespace omulator
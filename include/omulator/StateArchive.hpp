@@ -0,0 +1,201 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Saves or restores the state of a set of Components. Each Component implements a single
+ * serialize(StateArchive &) which visits each piece of its state, and the same function is used
+ * both to save and to load, e.g.:
+ *
+ *   void Cpu::serialize(StateArchive &archive) {
+ *     archive.value(regs_.pc);
+ *     archive.value(halted_);
+ *     archive.region(ram_);
+ *   }
+ *
+ * When saving, value() records the value, and region() records a reference to the memory (which
+ * must stay alive and unchanged until the image has been written); when loading, both overwrite
+ * their argument from the image.
+ *
+ * # FORMAT
+ * An image consists of a header, a stream of fields, a region table, and then the regions
+ * themselves. All integers are little-endian:
+ *
+ *   Offset  Size  Contents
+ *   0       8     "OMLSTATE"
+ *   8       4     Format version (VERSION)
+ *   12      4     Header size (HEADER_SIZE)
+ *   16      8     Offset of the field stream
+ *   24      8     Size of the field stream
+ *   32      8     Offset of the region table
+ *   40      8     Number of regions
+ *   48      8     Total size of the image
+ *   56      8     Reserved (zero)
+ *
+ * The field stream holds everything passed to value() and tag(), in order, each packed to its
+ * natural size.
+ * The region table holds an (offset, size) pair of U64s for each region, in order, and each region
+ * is stored verbatim at an offset which is a multiple of REGION_ALIGNMENT. Large blocks of memory
+ * (e.g. RAM) should be passed to region(), so that they can be saved and restored with a single
+ * bulk copy each, or mapped directly from an image file since they are page-aligned.
+ *
+ * Loading throws std::runtime_error if the image is malformed or does not match what the
+ * Components expect (e.g. a region of a different size).
+ */
+class StateArchive {
+public:
+  static constexpr std::array<char, 8> MAGIC{'O', 'M', 'L', 'S', 'T', 'A', 'T', 'E'};
+  static constexpr U32                 VERSION          = 1;
+  static constexpr std::size_t         HEADER_SIZE      = 64;
+  static constexpr std::size_t         REGION_ALIGNMENT = 4096;
+
+  enum class Mode : U8 { SAVE, LOAD };
+
+  /**
+   * Create an archive for saving state.
+   */
+  StateArchive();
+
+  /**
+   * Create an archive for loading state from the given image, which must outlive the archive.
+   * Throws if the header or region table are invalid.
+   */
+  explicit StateArchive(std::span<const U8> image);
+
+  Mode mode() const noexcept;
+  bool loading() const noexcept;
+
+  /**
+   * Save or load an integer, bool or enum.
+   */
+  template<typename T>
+  requires std::integral<T> || std::is_enum_v<T>
+  void value(T &val) {
+    if constexpr(std::is_enum_v<T>) {
+      auto underlying = static_cast<std::underlying_type_t<T>>(val);
+      value(underlying);
+      val = static_cast<T>(underlying);
+    }
+    else if constexpr(std::same_as<T, bool>) {
+      U8 byte = val ? 1 : 0;
+      value(byte);
+      val = byte != 0;
+    }
+    else {
+      using Unsigned_t = std::make_unsigned_t<T>;
+      std::array<U8, sizeof(T)> bytes;
+
+      if(mode_ == Mode::SAVE) {
+        const auto bits = static_cast<Unsigned_t>(val);
+        for(std::size_t i = 0; i < sizeof(T); ++i) {
+          bytes[i] = static_cast<U8>(bits >> (8 * i));
+        }
+        put_(bytes);
+      }
+      else {
+        get_(bytes);
+        Unsigned_t bits = 0;
+        for(std::size_t i = 0; i < sizeof(T); ++i) {
+          bits = static_cast<Unsigned_t>(bits | (Unsigned_t{bytes[i]} << (8 * i)));
+        }
+        val = static_cast<T>(bits);
+      }
+    }
+  }
+
+  template<typename T, std::size_t N>
+  void value(std::array<T, N> &vals) {
+    for(T &val : vals) {
+      value(val);
+    }
+  }
+
+  /**
+   * Save a name, or check when loading that the same name was saved at this point; useful for
+   * detecting an image which was saved from a different set of Components.
+   */
+  void tag(std::string_view name);
+
+  /**
+   * Save or load a block of memory in bulk. When loading, the region in the image must be exactly
+   * the same size.
+   */
+  void region(std::span<U8> data);
+
+  /**
+   * The size of the image which write() would produce; only valid when saving.
+   */
+  std::size_t image_size() const;
+
+  /**
+   * Write the image; only valid when saving. The regions are copied straight from the memory
+   * which was passed to region().
+   */
+  void write(std::ostream &out) const;
+  void write(std::span<U8> out) const;
+
+  /**
+   * Same as write(std::span<U8>), except that the regions whose indices are in skip are left as
+   * they are in out, e.g. so that they can be filled in piecemeal.
+   */
+  void write(std::span<U8> out, std::span<const std::size_t> skip) const;
+
+  /**
+   * The offset within the image of each region recorded so far; only valid when saving.
+   */
+  std::vector<std::size_t> region_offsets() const;
+
+  /**
+   * Throws unless every field and region in the image has been loaded; only valid when loading.
+   */
+  void finish() const;
+
+  /**
+   * The field stream and the regions recorded so far, e.g. for hashing a state without writing out
+   * an image; only meaningful when saving.
+   */
+  std::span<const U8>                  fields() const noexcept;
+  std::span<const std::span<const U8>> regions() const noexcept;
+
+private:
+  struct Region_ {
+    U64 offset;
+    U64 size;
+  };
+
+  void put_(std::span<const U8> bytes);
+  void get_(std::span<U8> bytes);
+
+  /**
+   * The header and region table for the current contents of a saving archive.
+   */
+  std::vector<U8> make_prologue_() const;
+
+  std::vector<Region_> layout_regions_() const;
+
+  Mode mode_;
+
+  // When saving
+  std::vector<U8>                  fields_;
+  std::vector<std::span<const U8>> saveRegions_;
+
+  // When loading
+  std::span<const U8>  image_;
+  std::span<const U8>  fieldStream_;
+  std::size_t          fieldPos_;
+  std::vector<Region_> loadRegions_;
+  std::size_t          regionPos_;
+};
+
+}  // namespace omulator
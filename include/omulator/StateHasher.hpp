@@ -0,0 +1,103 @@
+#pragma once
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/System.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace omulator {
+
+/**
+ * Hashes the state of a System once per frame, so that two runs can be checked for determinism by
+ * comparing their streams of hashes: the first frame at which the hashes differ is the frame in
+ * which the runs diverged, which can then be examined more closely, e.g. with a Tracer.
+ *
+ * Each hash covers everything that System::save_state() would save (i.e. each Component in the
+ * component list, plus those passed to System::register_state), along with all of the RAM of the
+ * given MemoryBus. The System is serialized into a StateArchive, which only records references to
+ * large regions rather than copying them, and the field stream and regions are hashed with
+ * util::hash64.
+ *
+ * The MemoryBus RAM is hashed incrementally, using a MemoryBus dirty tracker (which is added for
+ * the life of the StateHasher): a hash is kept for each page of RAM, and only the pages written
+ * since the previous frame are rehashed. The page hashes are summed, so replacing one is O(1), and
+ * each is seeded with the page's index, so that moving data between pages changes the result.
+ * Regions of the archive which are MemoryBus RAM are skipped, since the page hashes cover them. The
+ * cost of a frame is therefore proportional to the amount of RAM written during the frame, plus the
+ * size of the rest of the state.
+ *
+ * A stream of hashes can be written to a file, with one hash per line, to be compared with another
+ * run's stream later; see the --bench-hashes and --hash-diff switches, and oml.hash.compare in the
+ * Lua Interpreter.
+ *
+ * Not threadsafe; hash_frame() must be called from the thread which steps the System, between
+ * calls to System::step.
+ */
+class StateHasher {
+public:
+  /**
+   * The System, and the MemoryBus if given, must outlive the StateHasher.
+   */
+  explicit StateHasher(System &system, MemoryBus *const bus = nullptr);
+
+  /**
+   * Removes the StateHasher's dirty tracker from the MemoryBus.
+   */
+  ~StateHasher();
+
+  StateHasher(const StateHasher &)            = delete;
+  StateHasher &operator=(const StateHasher &) = delete;
+  StateHasher(StateHasher &&)                 = delete;
+  StateHasher &operator=(StateHasher &&)      = delete;
+
+  /**
+   * Hash the current state of the System, and append the hash to hashes().
+   */
+  U64 hash_frame();
+
+  /**
+   * The hash of each frame since the StateHasher was created or last cleared, in order.
+   */
+  const std::vector<U64> &hashes() const noexcept;
+  void                    clear() noexcept;
+
+  /**
+   * Write hashes() to a file as one 16-digit hexadecimal hash per line, so that two streams can
+   * also be compared with an ordinary diff. Throws std::runtime_error if the file can't be written.
+   */
+  void write(const std::filesystem::path &path) const;
+
+  /**
+   * Read a stream written by write(). Throws std::runtime_error if the file can't be read or
+   * contains anything other than hashes.
+   */
+  static std::vector<U64> read(const std::filesystem::path &path);
+
+  /**
+   * Returns the index of the first frame at which two streams differ, or std::nullopt if they are
+   * identical. If one stream is a prefix of the other, they differ at the end of the shorter one.
+   */
+  static std::optional<std::size_t> first_mismatch(std::span<const U64> a, std::span<const U64> b);
+
+private:
+  /**
+   * Rehash the pages of RAM written since the last call, and update ramHash_.
+   */
+  void update_ram_hash_();
+
+  System     &system_;
+  MemoryBus  *bus_;
+  std::size_t dirtyTracker_;
+
+  std::vector<U64> pageHashes_;
+  U64              ramHash_;
+
+  std::vector<U64> hashes_;
+};
+
+}  // namespace omulator
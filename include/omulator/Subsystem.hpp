@@ -1,15 +1,68 @@
 #pragma once
 
+#include "omulator/IClock.hpp"
 #include "omulator/ILogger.hpp"
 #include "omulator/msg/MailboxRouter.hpp"
+#include "omulator/oml_types.hpp"
 
 #include <atomic>
+#include <chrono>
 #include <functional>
+#include <stop_token>
 #include <string_view>
 #include <thread>
 
 namespace omulator {
 
+/**
+ * Determines how a periodic Subsystem (see Subsystem::on_tick) behaves when it wakes up after one
+ * or more of its tick deadlines have already passed, e.g. because the previous tick ran long or the
+ * thread was woken up late.
+ */
+enum class TickPolicy : bool {
+  /**
+   * Invoke the tick hook back to back for each missed deadline (up to
+   * Subsystem::MAX_CATCH_UP_TICKS) so that the total number of ticks matches the elapsed time.
+   */
+  CATCH_UP,
+
+  /**
+   * Invoke the tick hook once and drop any other missed deadlines.
+   */
+  SKIP
+};
+
+/**
+ * Jitter statistics gathered by a periodic Subsystem.
+ */
+struct TickStats {
+  /**
+   * The number of times the tick hook has been invoked.
+   */
+  U64 numTicks;
+
+  /**
+   * The number of times the Subsystem woke up one or more full periods after a deadline.
+   */
+  U64 lateTicks;
+
+  /**
+   * The number of deadlines for which the tick hook was never invoked.
+   */
+  U64 skippedTicks;
+
+  /**
+   * The largest observed delay between a deadline and the point at which it was serviced.
+   */
+  std::chrono::nanoseconds maxLateness;
+
+  /**
+   * The sum of all observed delays between deadlines and the point at which they were serviced;
+   * divide by numTicks to get the average lateness.
+   */
+  std::chrono::nanoseconds totalLateness;
+};
+
 /**
  * Responds to messages in a separate thread.
  */
@@ -41,8 +94,7 @@ public:
             std::function<void()>     onEnd   = PASS_);
 
   /**
-   * Sends a message to wake the underlying thread, in case it is waiting on a recv() call, and
-   * blocks until the thread exits.
+   * Calls stop() followed by join().
    */
   virtual ~Subsystem();
 
@@ -57,12 +109,56 @@ public:
   void start();
 
   /**
-   * Request that the underlying thread return exit its message loop and return.
+   * Request that the underlying thread exit its message loop and return, and send a message to wake
+   * the thread in case it is waiting on a recv() call. Does not block; use join() to wait for the
+   * thread to exit. Has no effect if called more than once.
+   *
+   * Splitting shutdown into stop() and join() allows a group of Subsystems to wind down in
+   * parallel: calling stop() on each of them followed by join() on each of them means that the
+   * total time spent is that of the slowest Subsystem, rather than the sum of them all.
    */
   void stop();
 
+  /**
+   * Block until the underlying thread exits. Has no effect if the thread has already been joined.
+   *
+   * N.B. that this will block indefinitely unless stop() has been called!
+   */
+  void join();
+
+  /**
+   * Returns a snapshot of the jitter statistics for a periodic Subsystem. All fields will be zero
+   * if on_tick() was never called. Threadsafe.
+   */
+  TickStats tick_stats() const noexcept;
+
+  /**
+   * The maximum number of missed deadlines that TickPolicy::CATCH_UP will service back to back
+   * after a single late wakeup; anything beyond this is counted as skipped. Prevents a Subsystem
+   * whose tick hook consistently takes longer than its period from never servicing its mailbox.
+   */
+  static constexpr U64 MAX_CATCH_UP_TICKS = 8;
+
 protected:
 
+  /**
+   * Switch the Subsystem into periodic mode: rather than blocking until a message arrives, the
+   * underlying thread will invoke callback once every period as measured by clock, servicing
+   * messages as they arrive between ticks (see IClock::host_deadline). policy determines what
+   * happens when deadlines are missed.
+   *
+   * Deadlines are scheduled relative to the time of the first tick rather than the time the
+   * previous tick finished, so the schedule does not drift when the callback takes a variable
+   * amount of time.
+   *
+   * N.B. that this must be called before start(), i.e. from the derived class's constructor, in the
+   * same manner as receiver_.on().
+   */
+  void on_tick(IClock                  &clock,
+               std::chrono::nanoseconds period,
+               std::function<void()>    callback,
+               const TickPolicy         policy = TickPolicy::SKIP);
+
   ILogger &logger_;
 
   /**
@@ -75,6 +171,18 @@ private:
 
   void thrd_proc_(std::function<void()> onStart, std::function<void()> onEnd);
 
+  /**
+   * The message loop used in place of the blocking recv() loop once on_tick() has been called.
+   */
+  void tick_loop_(const std::stop_token &stoken);
+
+  /**
+   * Update the jitter statistics for a single wakeup.
+   */
+  void record_tick_(const std::chrono::nanoseconds lateness,
+                    const U64                      missedTicks,
+                    const U64                      skippedTicks) noexcept;
+
   std::string_view name_;
 
   /**
@@ -83,6 +191,25 @@ private:
    */
   msg::MailboxSender sender_;
 
+  /**
+   * Periodic mode configuration, set by on_tick(). pTickClock_ is null unless the Subsystem is in
+   * periodic mode.
+   */
+  IClock                  *pTickClock_;
+  std::chrono::nanoseconds tickPeriod_;
+  std::function<void()>    tickCallback_;
+  TickPolicy               tickPolicy_;
+
+  /**
+   * Backing storage for tick_stats(); written only by the underlying thread. Relaxed ordering is
+   * sufficient since each counter is independent of the others.
+   */
+  std::atomic<U64> numTicks_;
+  std::atomic<U64> lateTicks_;
+  std::atomic<U64> skippedTicks_;
+  std::atomic<S64> maxLatenessNs_;
+  std::atomic<S64> totalLatenessNs_;
+
   std::atomic_bool startSignal_;
   std::jthread     thrd_;
 };
@@ -1,41 +1,129 @@
 #pragma once
 
 #include "omulator/Component.hpp"
+#include "omulator/EventScheduler.hpp"
 #include "omulator/ILogger.hpp"
+#include "omulator/StateArchive.hpp"
 #include "omulator/Subsystem.hpp"
 #include "omulator/di/Injector.hpp"
 
 #include <atomic>
+#include <barrier>
+#include <exception>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <span>
 #include <stdexcept>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 namespace omulator {
 
 using ComponentList_t = std::vector<std::reference_wrapper<Component>>;
 using SubsystemList_t = std::vector<std::reference_wrapper<Subsystem>>;
 
+/**
+ * Determines how the groups set up by System::set_component_groups are executed.
+ */
+enum class GroupExecution : bool {
+  /**
+   * Run each group on the calling thread, one after another. Produces the exact same results as
+   * PARALLEL, which makes it useful for debugging.
+   */
+  SERIAL,
+
+  /**
+   * Run each group on its own thread; the first group runs on the thread which calls System::step.
+   */
+  PARALLEL
+};
+
 /**
  * An emulated system consisting of a list of Components, which are invoked synchronously, and a
  * collection of subsystems, each of which execute in parallel on their own threads.
  *
+ * # SCHEDULING
+ * Rather than stepping every Component one cycle at a time, System::step runs Components in
+ * timeslices of up to timeslice() cycles. Each Component tracks its own local cycle count. The
+ * first Component in the list (the "lead", typically the CPU) runs first, and the point that it
+ * reaches becomes the synchronization point for the slice. The remaining Components are then run
+ * until they catch up to that point.
+ *
+ * Components should use the cycle count returned from step() to adjust the slice:
+ *   - The lead may return fewer cycles than requested to end the slice early, e.g. right before it
+ *     interacts with state owned by another Component, so that the other Components are up to date
+ *     when the interaction happens.
+ *   - Any Component may return more cycles than requested (e.g. an instruction which straddles the
+ *     end of the slice); it will simply not be stepped again until the others have caught up.
+ *   - Returning 0 means that the Component has nothing to do until the next synchronization point.
+ *
+ * A timeslice of 1 is equivalent to running every Component in lockstep, one cycle at a time.
+ *
+ * # EVENTS
+ * Each System has an EventScheduler, which is managed by the child Injector so that Components can
+ * take an EventScheduler& as a dependency. Slices never extend past the next pending event, and
+ * events fire once the lead Component has reached their timestamp and the other Components have
+ * caught up to it. The scheduler's notion of the current cycle is the last synchronization point,
+ * so a Component which schedules an event from within step() should do so relative to its own
+ * cycle (see EventScheduler::schedule_in). N.B. that the EventScheduler should not be instantiated
+ * by the parent Injector, as the System would then share it with the parent instead of getting one
+ * of its own.
+ *
+ * # COMPONENT GROUPS
+ * Components can be split into groups with set_component_groups, which can then run on separate
+ * threads (e.g. a CPU in one group and a video chip in another). This is conservative parallel
+ * discrete event simulation: the System advances in epochs of at most lookahead cycles, and within
+ * an epoch each group runs independently, using the timeslice rules above with the first Component
+ * of the group as its lead. All groups meet at a barrier at the end of each epoch, after which
+ * deferred actions and due events are run on the calling thread.
+ *
+ * The lookahead is a promise that nothing a Component in one group does can affect a Component in
+ * another group sooner than lookahead cycles later. Anything which touches state shared with
+ * another group should be wrapped in a call to defer(), which postpones it until the next point at
+ * which all groups are synchronized; deferred actions run in group order, and then in the order
+ * they were deferred, so the results do not depend on how the threads were scheduled.
+ *
+ * # SAVE STATES
+ * save_state() captures the System's cycle counts along with the state of each Component in the
+ * component list, plus any other Components passed to register_state() (e.g. the MemoryBus), via
+ * Component::serialize; see StateArchive for the format. A state can only be loaded into a System
+ * which has been set up the same way, i.e. with the same Components in the same order. Pending
+ * events and deferred actions can't be saved, so load_state() cancels them, and then calls
+ * Component::post_load on every Component in the state (in the order they are saved) so that they
+ * can reschedule their events; anything else which schedules events on the System's behalf has to
+ * reschedule them itself. Subsystems are not involved.
+ *
  * N.B. that the parentInjector will used to create a child injector (via a call to
  * parentInjector.creat<Injector>()). This child injector will be owned by the System, and any
  * dependencies managed by the child Injector will be destroyed along with the System as part of
- * System's destructor.
+ * System's destructor. Recipes for the System's Components should be added to the child Injector:
+ * a recipe held by the parent Injector can still create an instance for the child, but it resolves
+ * the instance's dependencies from the parent, so Systems sharing a parent would also share e.g.
+ * the MemoryBus that their Components depend on.
  */
 class System : public Component {
 public:
   System(ILogger &logger, std::string_view name, di::Injector &parentInjector);
 
-  ~System() override = default;
+  /**
+   * Shuts down all Subsystems in parallel, i.e. every Subsystem is asked to stop before any of them
+   * are joined, and then releases all dependencies managed by the child Injector.
+   */
+  ~System() override;
 
   /**
    * Get a reference to the child Injector used by the System to manage dependencies.
    */
   di::Injector &get_injector() noexcept;
 
+  /**
+   * Get a reference to the System's EventScheduler.
+   */
+  EventScheduler &get_scheduler() noexcept;
+
   /**
    * Install dependencies for the System. Each Component and Subsystem will be retrieved or created
    * via a call to pInjector_->get<T>().
@@ -48,13 +136,48 @@ public:
     }
 
     components_ = ComponentList_t{pInjector_->get<Ts>()...};
+    init_components_();
+  }
+
+  /**
+   * Same as make_component_list, except that the System will call each Component's step() method
+   * directly, rather than through a virtual call, whenever it runs in timeslices (i.e. unless
+   * set_component_groups is in use). This allows the compiler to inline each Component's step()
+   * into the scheduler, which makes a big difference for small timeslices; declaring the step()
+   * overrides as final, and defining them in headers or building with IPO/LTO, helps it along.
+   *
+   * make_component_list should still be used for Components which are not known at compile time,
+   * e.g. those loaded from plugins.
+   */
+  template<typename TLead, typename... TRest>
+  requires(std::derived_from<TLead, Component> && (std::derived_from<TRest, Component> && ...))
+  void make_static_component_list() {
+    if(componentsCreated_) {
+      throw std::runtime_error("make_component_list() called on a System instance more than once");
+    }
+
+    components_ = ComponentList_t{pInjector_->get<TLead>(), pInjector_->get<TRest>()...};
+    init_components_();
 
-    componentsCreated_ = true;
+    staticSliceRunner_ =
+      [this, components = std::tuple<TLead &, TRest &...>{pInjector_->get<TLead>(),
+                                                          pInjector_->get<TRest>()...}](
+        const Cycle_t sliceEnd) {
+        return std::apply(
+          [this, sliceEnd](TLead &lead, TRest &...rest) {
+            return run_static_slice_(sliceEnd, lead, rest...);
+          },
+          components);
+      };
   }
 
   /**
    * Same as make_component_list but for Subsystems, with the difference being that start() is
    * called for each subsystem once they are all created.
+   *
+   * N.B. that the Subsystems are constructed one at a time, since the Injector serializes calls to
+   * get(), but start() does not block, so each Subsystem's onStart hook (which is where any slow,
+   * thread-specific initialization should go) runs concurrently with those of the others.
    */
   template<typename... Ts>
   requires(std::derived_from<Ts, Subsystem> && ...)
@@ -73,18 +196,188 @@ public:
   }
 
   /**
-   * Invoke step() for each component in components_ numCycles times. Each component will receive 1
-   * as its numCycles parameter. Returns the actual number of cycles taken.
+   * Run the System for at least numCycles cycles, per the scheduling rules described above. Returns
+   * the actual number of cycles taken, which may exceed numCycles if the lead Component overshoots
+   * the end of the final slice. Any events which become due will be fired. The first call warns if
+   * the System has no Components or no Subsystems.
    */
   Cycle_t step(const Cycle_t numCycles) override;
 
+  /**
+   * Save or load the state of every Component in the System, per the rules described above.
+   */
+  void serialize(StateArchive &archive) override;
+
+  /**
+   * Include a Component which is not in the component list in save states. These Components are
+   * saved after the component list, in the order in which they were registered.
+   */
+  void register_state(Component &component);
+
+  /**
+   * Save the state of the System, either to a new buffer or to a file. Throws if the file can't be
+   * written. Must not be called from within step().
+   */
+  std::vector<U8> save_state();
+  void            save_state(const std::filesystem::path &path);
+
+  /**
+   * Same as save_state(), but reuses the storage of image, which is resized to fit the state.
+   */
+  void save_state(std::vector<U8> &image);
+
+  /**
+   * Restore a state produced by save_state(). Throws if the state is malformed or was saved from a
+   * System which was set up differently, in which case the System is left in an unspecified state.
+   * Must not be called from within step().
+   */
+  void load_state(std::span<const U8> image);
+  void load_state(const std::filesystem::path &path);
+
+  /**
+   * The total number of cycles that the System has been run for.
+   */
+  Cycle_t current_cycle() const noexcept;
+
+  /**
+   * The maximum number of cycles that a Component will be asked to run for in a single call to
+   * Component::step. Defaults to 1.
+   */
+  Cycle_t timeslice() const noexcept;
+
+  /**
+   * Set the value returned by timeslice(); throws if timeslice is 0.
+   */
+  void set_timeslice(const Cycle_t timeslice);
+
+  /**
+   * Split the Components into groups which run independently for up to lookahead cycles at a time.
+   * Each group is a list of indices into the list given to make_component_list, and every
+   * Component must appear in exactly one group; the first Component in each group is its lead.
+   * Throws if these requirements aren't met. Any worker threads from a previous call are shut down
+   * first.
+   */
+  void set_component_groups(const std::vector<std::vector<std::size_t>> &groups,
+                            const Cycle_t                                lookahead,
+                            const GroupExecution execution = GroupExecution::PARALLEL);
+
+  /**
+   * The length of an epoch when Component groups are in use, or 0 if they are not.
+   */
+  Cycle_t lookahead() const noexcept;
+
+  /**
+   * Start or stop measuring the time spent in each Component's step() method, in TSC ticks; this
+   * adds a pair of TSC reads to every call to step(), so it is off by default. Enabling it resets
+   * the counts, and makes the System bypass the static dispatch set up by
+   * make_static_component_list. Must not be called from within step().
+   */
+  void set_component_timing(const bool enabled);
+
+  /**
+   * The number of TSC ticks spent in each Component's step() method since component timing was
+   * last enabled, in the same order as the component list; empty if component timing is disabled.
+   */
+  const std::vector<U64> &component_ticks() const noexcept;
+
+  /**
+   * The component list, as created by make_component_list or make_static_component_list.
+   */
+  const ComponentList_t &components() const noexcept;
+
+  /**
+   * Postpone action until all Components are synchronized, i.e. the end of the current timeslice
+   * or epoch. If called from outside of step() (e.g. from an event), action is invoked immediately.
+   *
+   * Threadsafe when called from a Component's step() method.
+   */
+  void defer(std::function<void()> action);
+
 private:
+  /**
+   * A set of Components which are scheduled together, along with the actions that they have
+   * deferred since the last synchronization point.
+   */
+  struct Group_ {
+    std::vector<std::size_t>           members;
+    std::vector<std::function<void()>> deferred;
+    std::exception_ptr                 error;
+  };
+
+  /**
+   * Run a single slice for the given group ending no later than sliceEnd, unless the group's lead
+   * Component overshoots it. Returns the point reached by the lead.
+   */
+  Cycle_t run_slice_(Group_ &group, const Cycle_t sliceEnd);
+
+  /**
+   * Call step() on the Component at the given index of the component list, timing the call if
+   * component timing is enabled.
+   */
+  Cycle_t step_component_(const std::size_t idx, const Cycle_t numCycles);
+
+  /**
+   * Run the given group up to epochEnd_; used when Component groups are in use.
+   */
+  void run_epoch_(const std::size_t groupIdx);
+
+  /**
+   * The loop executed by each worker thread when running groups in parallel.
+   */
+  void worker_proc_(const std::size_t groupIdx);
+
+  /**
+   * Run all deferred actions in group order.
+   */
+  void run_deferred_();
+
+  void stop_workers_();
+
+  /**
+   * Set up the bookkeeping for a newly created components_ list.
+   */
+  void init_components_();
+
+  /**
+   * Equivalent to run_slice_ for a single group containing every Component, but with each call to
+   * step() statically dispatched. N.B. the qualified calls (i.e. T::step) are what prevent virtual
+   * dispatch.
+   */
+  template<typename TLead, typename... TRest>
+  Cycle_t run_static_slice_(const Cycle_t sliceEnd, TLead &lead, TRest &...rest) {
+    Cycle_t &leadCycle = componentCycles_.front();
+    if(leadCycle < sliceEnd) {
+      const Cycle_t budget = sliceEnd - leadCycle;
+      const Cycle_t taken  = lead.TLead::step(budget);
+      leadCycle += taken == 0 ? budget : taken;
+    }
+
+    const Cycle_t syncPoint = leadCycle;
+    std::size_t   idx       = 0;
+    (catch_up_static_(rest, componentCycles_[++idx], syncPoint), ...);
+
+    return syncPoint;
+  }
+
+  template<typename T>
+  static void catch_up_static_(T &component, Cycle_t &componentCycle, const Cycle_t syncPoint) {
+    while(componentCycle < syncPoint) {
+      const Cycle_t taken = component.T::step(syncPoint - componentCycle);
+      componentCycle      = taken == 0 ? syncPoint : componentCycle + taken;
+    }
+  }
+
   /**
    * The Injector instances which manages dependencies for the System. A child Injector which
    * points to an upstream Injector, as set up in the constructor.
    */
   std::unique_ptr<di::Injector> pInjector_;
 
+  /**
+   * Owned by pInjector_.
+   */
+  EventScheduler &scheduler_;
+
   /**
    * Each component in this list will have its step() method invoked during each call to
    * System::step().
@@ -96,12 +389,61 @@ private:
    */
   SubsystemList_t subsystems_;
 
+  /**
+   * Components added with register_state().
+   */
+  ComponentList_t extraState_;
+
+  /**
+   * The local cycle count of each Component, in the same order as components_.
+   */
+  std::vector<Cycle_t> componentCycles_;
+
+  /**
+   * Set by make_static_component_list; runs a single timeslice for every Component and returns the
+   * point reached by the lead.
+   */
+  std::function<Cycle_t(const Cycle_t)> staticSliceRunner_;
+
+  /**
+   * Indexed like componentCycles_; each Component only ever updates its own entry, so this needs
+   * no synchronization when groups run in parallel.
+   */
+  bool             timeComponents_;
+  std::vector<U64> componentTicks_;
+
+  Cycle_t currentCycle_;
+  Cycle_t timeslice_;
+
+  /**
+   * Contains a single group with every Component unless set_component_groups has been called.
+   */
+  std::vector<Group_> groups_;
+  Cycle_t             lookahead_;
+  GroupExecution      groupExecution_;
+
+  /**
+   * Shared with the worker threads; only written by the thread which calls step(), and only while
+   * the workers are waiting on pEpochBarrier_.
+   */
+  Cycle_t epochEnd_;
+  bool    stopWorkers_;
+
+  std::unique_ptr<std::barrier<>> pEpochBarrier_;
+  std::vector<std::jthread>       workers_;
+
   /**
    * The make_*_list() member functions should only be called on a System instance once; these flags
    * are used to track that policy.
    */
   bool componentsCreated_;
   bool subsystemsCreated_;
+
+  /**
+   * Set by the first call to step(), which warns if either list is empty; a System may be run
+   * without Subsystems on purpose (e.g. for benchmarks), so there is no need to repeat it.
+   */
+  bool listsChecked_;
 };
 
 }  // namespace omulator
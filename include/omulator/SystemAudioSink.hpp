@@ -0,0 +1,53 @@
+#pragma once
+
+#include "omulator/IAudioSink.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/util/Pimpl.hpp"
+
+#include <atomic>
+
+namespace omulator {
+
+/**
+ * Plays audio through the OS' default output device. Frames are queued with the device rather than
+ * pulled by a callback, so write() never blocks; if the queue grows past twice the target latency
+ * (e.g. because the emulation is running faster than real time) the excess is dropped, and if it
+ * runs dry the device plays silence.
+ *
+ * The implementation is platform-specific. The constructor throws std::runtime_error if the device
+ * can't be opened.
+ */
+class SystemAudioSink : public IAudioSink {
+public:
+  /**
+   * The target latency, i.e. the queue length at which fill_level() is 1.
+   */
+  static constexpr U32 LATENCY_FRAMES = 2048;
+
+  explicit SystemAudioSink(ILogger &logger);
+  ~SystemAudioSink() override;
+
+  SystemAudioSink(const SystemAudioSink &)            = delete;
+  SystemAudioSink &operator=(const SystemAudioSink &) = delete;
+  SystemAudioSink(SystemAudioSink &&)                 = delete;
+  SystemAudioSink &operator=(SystemAudioSink &&)      = delete;
+
+  U32                   sample_rate() const noexcept override;
+  void                  write(std::span<const float> frames) override;
+  std::optional<double> fill_level() const override;
+
+  /**
+   * The number of frames dropped because the queue was full.
+   */
+  U64 dropped() const noexcept;
+
+private:
+  struct Impl_;
+  util::Pimpl<Impl_> impl_;
+
+  ILogger         &logger_;
+  U32              sampleRate_;
+  std::atomic<U64> dropped_;
+};
+
+}  // namespace omulator
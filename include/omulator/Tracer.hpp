@@ -0,0 +1,239 @@
+#pragma once
+
+#include "omulator/ILogger.hpp"
+#include "omulator/oml_defines.hpp"
+#include "omulator/oml_types.hpp"
+#include "omulator/util/MappedFile.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+namespace omulator {
+
+/**
+ * One traced instruction: the cycle it started on, its address and opcode, and a snapshot of the
+ * CPU's registers from before it ran. The layout of regs is up to the CPU (see e.g. cpu::Ref8),
+ * and any unused bytes are zero.
+ */
+struct TraceEntry {
+  static constexpr std::size_t REGS_SIZE = 16;
+
+  U64                       cycle;
+  U32                       pc;
+  U32                       opcode;
+  std::array<U8, REGS_SIZE> regs;
+
+  bool operator==(const TraceEntry &) const noexcept = default;
+};
+
+static_assert(sizeof(TraceEntry) == 32, "TraceEntry must not contain padding");
+
+/**
+ * The header at the start of a trace file, which is followed by capacity TraceEntries used as a
+ * ring buffer. count is the number of entries written since the trace began, so once it exceeds
+ * capacity the oldest entry is at index (count % capacity).
+ */
+struct TraceHeader {
+  static constexpr std::array<char, 8> MAGIC   = {'O', 'M', 'L', 'T', 'R', 'A', 'C', 'E'};
+  static constexpr U32                 VERSION = 1;
+
+  std::array<char, 8> magic;
+  U32                 version;
+  U32                 entrySize;
+  U64                 capacity;
+  U64                 count;
+  std::array<U8, 32>  reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 64, "TraceHeader must not contain padding");
+
+/**
+ * Records an instruction trace into a memory-mapped binary file, which is used as a ring buffer
+ * holding the most recent entries. Nothing is formatted or copied while tracing, and the OS writes
+ * the file back in the background, so tracing costs little more than the stores into the mapping;
+ * use TraceReader to decode a trace, or to find where two traces diverge.
+ *
+ * Like the Debugger, the Tracer costs nothing until it is attached: a CPU with a Tracer attached
+ * (e.g. via cpu::Ref8::set_tracer) swaps in an instrumented instantiation of its interpreter loop,
+ * which calls next() ahead of every instruction.
+ *
+ * # TRIGGERS
+ * With no start triggers, everything is traced from the moment a file is opened. Otherwise tracing
+ * is paused until a start trigger fires, and resumes each time one does; stop triggers pause it
+ * again. PC triggers fire every time an instruction at that address is reached, while cycle
+ * triggers fire once, at the first instruction starting on or after that cycle. The instruction at
+ * a start PC is traced, while the instruction at a stop PC is not. Changing the triggers or opening
+ * a new file re-arms them.
+ *
+ * The commands may be called from any thread, e.g. from the Lua Interpreter (oml.trace.*), and
+ * take effect at the next instruction; next() must be called from the thread which steps the CPU.
+ * The file for open() is created immediately, so that errors are reported to the caller, but is
+ * only switched to (and the previous file closed) at the next instruction.
+ */
+class Tracer {
+public:
+  static constexpr U64 DEFAULT_CAPACITY = 1 << 20;
+
+  explicit Tracer(ILogger &logger);
+  ~Tracer();
+
+  Tracer(const Tracer &)            = delete;
+  Tracer &operator=(const Tracer &) = delete;
+  Tracer(Tracer &&)                 = delete;
+  Tracer &operator=(Tracer &&)      = delete;
+
+  /**
+   * Start tracing into a new file at path holding the last capacity entries, replacing any existing
+   * file. Throws std::invalid_argument if capacity is zero, or std::runtime_error if the file can't
+   * be created.
+   */
+  void open(const std::filesystem::path &path, const U64 capacity = DEFAULT_CAPACITY);
+
+  /**
+   * Stop tracing and close the current file, if any.
+   */
+  void close();
+
+  void start_at_pc(const U32 pc);
+  void stop_at_pc(const U32 pc);
+  void start_at_cycle(const Cycle_t cycle);
+  void stop_at_cycle(const Cycle_t cycle);
+  void clear_triggers();
+
+  /**
+   * CPU hook, called before executing the instruction at pc which starts on the given cycle.
+   * Returns the entry to fill in with the opcode and registers (with the cycle and pc already set,
+   * and everything else zeroed), or nullptr if the instruction should not be traced. The entry is
+   * only valid until the next call.
+   */
+  OML_FORCEINLINE TraceEntry *next(const Cycle_t cycle, const U32 pc) {
+    if(dirty_.load(std::memory_order_acquire)) [[unlikely]] {
+      apply_();
+    }
+
+    if(hasTriggers_) [[unlikely]] {
+      check_triggers_(cycle, pc);
+    }
+
+    if(!active_) {
+      return nullptr;
+    }
+
+    TraceEntry *const entry = entries_ + pos_;
+    *entry                  = TraceEntry{cycle, pc, 0, {}};
+
+    if(++pos_ == capacity_) {
+      pos_ = 0;
+    }
+    pHeader_->count = ++count_;
+
+    return entry;
+  }
+
+private:
+  struct Triggers_ {
+    std::unordered_set<U32> startPcs;
+    std::unordered_set<U32> stopPcs;
+    std::optional<Cycle_t>  startCycle;
+    std::optional<Cycle_t>  stopCycle;
+
+    bool empty() const noexcept;
+  };
+
+  /**
+   * Switch to the file and triggers set by the commands; called from next().
+   */
+  void apply_();
+
+  void check_triggers_(const Cycle_t cycle, const U32 pc) noexcept;
+
+  ILogger &logger_;
+
+  /**
+   * Guards the pending_* members, which are handed over to the CPU thread by apply_().
+   */
+  std::mutex                        mtx_;
+  std::atomic_bool                  dirty_;
+  std::unique_ptr<util::MappedFile> pendingFile_;
+  bool                              pendingFileChanged_;
+  Triggers_                         pendingTriggers_;
+
+  /**
+   * Only accessed by the CPU thread.
+   */
+  std::unique_ptr<util::MappedFile> file_;
+  Triggers_                         triggers_;
+  bool                              hasTriggers_;
+  bool                              active_;
+  TraceHeader                      *pHeader_;
+  TraceEntry                       *entries_;
+  U64                               capacity_;
+  U64                               pos_;
+  U64                               count_;
+};
+
+/**
+ * Reads back a trace file written by a Tracer.
+ */
+class TraceReader {
+public:
+  /**
+   * Throws std::runtime_error if the file can't be read or is not a trace file.
+   */
+  explicit TraceReader(const std::filesystem::path &path);
+
+  /**
+   * The number of entries retained in the file.
+   */
+  std::size_t size() const noexcept;
+
+  /**
+   * The number of entries written since the trace began, some of which may have been overwritten.
+   */
+  U64 count() const noexcept;
+
+  /**
+   * The sequence number (i.e. the position in the whole trace) of the oldest retained entry.
+   */
+  U64 first() const noexcept;
+
+  /**
+   * The idx-th oldest retained entry. Throws std::out_of_range if idx >= size().
+   */
+  const TraceEntry &at(const std::size_t idx) const;
+
+  /**
+   * Write every retained entry to os, oldest first, one per line; see format().
+   */
+  void decode(std::ostream &os) const;
+
+  /**
+   * Format a single entry as a line of text (without a newline), e.g.
+   * "#42 cycle=100 pc=0x0105 op=0x41 regs=0102...".
+   */
+  static std::string format(const U64 seq, const TraceEntry &entry);
+
+  /**
+   * Returns the sequence number of the first entry at which two traces differ, or std::nullopt if
+   * they are identical. The traces are compared from the first sequence number retained by both,
+   * and if one is a prefix of the other then they differ at the end of the shorter one. Throws
+   * std::runtime_error if they have no retained entries in common.
+   */
+  static std::optional<U64> first_divergence(const TraceReader &a, const TraceReader &b);
+
+private:
+  util::MappedFile  file_;
+  const TraceEntry *entries_;
+  U64               capacity_;
+  U64               count_;
+};
+
+}  // namespace omulator
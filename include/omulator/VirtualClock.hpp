@@ -0,0 +1,93 @@
+#pragma once
+
+#include "omulator/Clock.hpp"
+#include "omulator/IClock.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace omulator {
+
+/**
+ * A clock whose time only moves forward when it is told to, either explicitly via advance() or by a
+ * call to sleep_until(), which advances the clock to the requested time point. Intended for
+ * headless runs (CI, batch jobs, etc.) where we want to run as fast as possible while keeping
+ * everything that is paced by an IClock deterministic.
+ *
+ * The speed multiplier determines how much wall clock time a call to sleep_until() takes: with a
+ * multiplier of 10, sleeping for 1 second of virtual time takes 100ms of real time, and with a
+ * multiplier of UNLIMITED, sleep_until() returns immediately. Pacing is measured against a fixed
+ * anchor rather than against the previous call, so a run that falls behind will catch up instead of
+ * drifting. The anchor is taken by the first paced call to sleep_until() (and again after
+ * reanchor()), so that time spent setting up beforehand isn't made up for with a burst. N.B. that
+ * the value returned by now() never depends on the multiplier; the multiplier only affects how long
+ * sleep_until() blocks.
+ *
+ * Threadsafe. If several threads sleep on the same VirtualClock, then time advances to the latest
+ * deadline requested so far, i.e. the clock is never moved backwards.
+ */
+class VirtualClock : public IClock {
+public:
+  /**
+   * Speed multiplier which causes sleep_until() to return immediately.
+   */
+  static constexpr double UNLIMITED = 0.0;
+
+  /**
+   * The clock starts at TimePoint_t{}, rather than at the current time, so that runs are
+   * reproducible.
+   */
+  explicit VirtualClock(const double speedMultiplier = UNLIMITED);
+  ~VirtualClock() override = default;
+
+  TimePoint_t now() const noexcept override;
+
+  void sleep_until(const TimePoint_t then) override;
+
+  /**
+   * Move the clock forward by the given duration without blocking.
+   */
+  void advance(const std::chrono::nanoseconds duration) noexcept;
+
+  /**
+   * Drop the pacing anchor, so that the next call to sleep_until() paces from the current host and
+   * virtual times. Callers which stop sleeping on the clock for a while (e.g. while paused) should
+   * call this before resuming, otherwise the time spent away is caught up on all at once.
+   */
+  void reanchor();
+
+  double speed_multiplier() const noexcept;
+
+private:
+  /**
+   * Move the clock forward to then, unless it has already passed then.
+   */
+  void advance_to_(const TimePoint_t then) noexcept;
+
+  const double speedMultiplier_;
+
+  /**
+   * A host time and the virtual time which corresponded to it, which sleep_until() is paced from.
+   */
+  struct Anchor_ {
+    TimePoint_t host;
+    TimePoint_t virt;
+  };
+
+  /**
+   * Used to pace sleep_until() when the speed multiplier is not UNLIMITED.
+   */
+  Clock                  hostClock_;
+  std::mutex             anchorMtx_;
+  std::optional<Anchor_> anchor_;
+
+  /**
+   * The current virtual time, as a count of TimePoint_t::duration ticks since TimePoint_t{}.
+   */
+  std::atomic<TimePoint_t::rep> now_;
+};
+
+}  // namespace omulator
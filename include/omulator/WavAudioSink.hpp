@@ -0,0 +1,53 @@
+#pragma once
+
+#include "omulator/IAudioSink.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace omulator {
+
+/**
+ * Writes audio to a 16-bit stereo PCM WAV file, e.g. to record a headless run so that it can be
+ * listened to or compared against a reference. The sizes in the header are filled in when the sink
+ * is destroyed, or when flush() is called.
+ *
+ * Since the file takes frames as fast as they are written, fill_level() is std::nullopt, so the
+ * AudioEngine always resamples at its nominal ratio and the output is deterministic.
+ */
+class WavAudioSink : public IAudioSink {
+public:
+  /**
+   * Throws std::runtime_error if the file can't be created.
+   */
+  explicit WavAudioSink(const std::filesystem::path &path,
+                        const U32                    sampleRate = DEFAULT_SAMPLE_RATE);
+  ~WavAudioSink() override;
+
+  WavAudioSink(const WavAudioSink &)            = delete;
+  WavAudioSink &operator=(const WavAudioSink &) = delete;
+  WavAudioSink(WavAudioSink &&)                 = delete;
+  WavAudioSink &operator=(WavAudioSink &&)      = delete;
+
+  U32                   sample_rate() const noexcept override;
+  void                  write(std::span<const float> frames) override;
+  std::optional<double> fill_level() const override;
+
+  /**
+   * Update the header and flush the file, so that it is valid even if the sink is never destroyed.
+   * Throws std::runtime_error if the file can't be written.
+   */
+  void flush();
+
+  U64 frames_written() const noexcept;
+
+private:
+  void write_header_();
+
+  std::filesystem::path path_;
+  std::ofstream         ofs_;
+  U32                   sampleRate_;
+  U64                   framesWritten_;
+};
+
+}  // namespace omulator
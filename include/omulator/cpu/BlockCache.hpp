@@ -0,0 +1,240 @@
+#pragma once
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omulator::cpu {
+
+/**
+ * A cache of basic blocks, i.e. runs of instructions decoded ahead of time into arrays of TOp (the
+ * CPU's pre-decoded micro-op type), keyed by the address of their first instruction.
+ *
+ * The cache watches every page of the MemoryBus which holds an instruction of a cached block, so
+ * that any block whose memory is written to (i.e. self-modifying code) or remapped is invalidated.
+ * Invalidated blocks are removed from the cache immediately, but are only freed by
+ * collect_garbage(), so that a CPU can finish executing a block which invalidates itself; CPUs
+ * should check Block::valid after any micro-op which may write to memory.
+ *
+ * Each block also carries a TData, for anything else the CPU wants to keep per block (e.g. a
+ * recompiler's host code), and the CPU can register a hook to be told when a block is invalidated.
+ *
+ * Not threadsafe.
+ */
+template<typename TOp, typename TData = std::tuple<>>
+class BlockCache {
+public:
+  using Addr_t = MemoryBus::Addr_t;
+
+  struct Block {
+    /**
+     * The address of the first instruction, and the address one past the last byte of the last
+     * instruction. Blocks do not wrap around the end of the address space.
+     */
+    Addr_t start;
+    Addr_t end;
+
+    std::vector<TOp> ops;
+
+    bool valid = true;
+
+    [[no_unique_address]] TData data{};
+  };
+
+  /**
+   * Invoked for each block as it is invalidated, while it is still in the cache.
+   */
+  using KillHook_t = std::function<void(Block &)>;
+
+  explicit BlockCache(MemoryBus &bus)
+    : bus_{bus},
+      watcherId_{bus_.add_write_watcher(
+        [this](const Addr_t addr, const std::size_t size) { invalidate(addr, size); })} { }
+
+  ~BlockCache() {
+    clear();
+    bus_.remove_write_watcher(watcherId_);
+  }
+
+  BlockCache(const BlockCache &)            = delete;
+  BlockCache &operator=(const BlockCache &) = delete;
+  BlockCache(BlockCache &&)                 = delete;
+  BlockCache &operator=(BlockCache &&)      = delete;
+
+  /**
+   * Returns the block starting at the given address, or nullptr if there is none.
+   */
+  Block *find(const Addr_t start) {
+    auto &entry = lookup_[start % LOOKUP_SIZE];
+    if(entry != nullptr && entry->start == start) [[likely]] {
+      return entry;
+    }
+
+    const auto it = blocks_.find(start);
+    if(it == blocks_.end()) {
+      return nullptr;
+    }
+
+    entry = it->second.get();
+    return entry;
+  }
+
+  /**
+   * Add a block spanning [start, end), replacing any existing block which starts at the same
+   * address, and returns a reference to it.
+   */
+  Block &insert(const Addr_t start, const Addr_t end, std::vector<TOp> &&ops) {
+    if(Block *existing = find(start); existing != nullptr) {
+      kill_(*existing);
+    }
+
+    auto  block    = std::make_unique<Block>(Block{start, end, std::move(ops)});
+    Block &blockRef = *block;
+    blocks_.emplace(start, std::move(block));
+
+    for_each_page_(start, end, [&](const std::size_t pageIdx) {
+      auto &pageBlocks = pageBlocks_[pageIdx];
+      if(pageBlocks.empty()) {
+        bus_.watch_page(static_cast<Addr_t>(pageIdx << bus_.page_bits()));
+      }
+      pageBlocks.push_back(&blockRef);
+    });
+
+    return blockRef;
+  }
+
+  /**
+   * Invalidate every block which overlaps [addr, addr + size).
+   */
+  void invalidate(const Addr_t addr, const std::size_t size) {
+    const U64 end = U64{addr} + size;
+
+    std::vector<Block *> victims;
+    for_each_page_(addr, end, [&](const std::size_t pageIdx) {
+      const auto it = pageBlocks_.find(pageIdx);
+      if(it == pageBlocks_.end()) {
+        return;
+      }
+
+      for(Block *block : it->second) {
+        if(block->start < end && addr < block->end
+           && std::find(victims.begin(), victims.end(), block) == victims.end())
+        {
+          victims.push_back(block);
+        }
+      }
+    });
+
+    for(Block *block : victims) {
+      kill_(*block);
+    }
+  }
+
+  /**
+   * Invalidate every block.
+   */
+  void clear() {
+    while(!blocks_.empty()) {
+      kill_(*(blocks_.begin()->second));
+    }
+  }
+
+  /**
+   * Free the blocks which have been invalidated. No pointers or references to invalidated blocks
+   * may be held when this is called.
+   */
+  void collect_garbage() noexcept { graveyard_.clear(); }
+
+  /**
+   * The number of valid blocks in the cache.
+   */
+  std::size_t size() const noexcept { return blocks_.size(); }
+
+  /**
+   * Invoke fn on each valid block.
+   */
+  template<typename Fn_t>
+  void for_each(Fn_t fn) {
+    for(auto &[start, block] : blocks_) {
+      fn(*block);
+    }
+  }
+
+  void set_kill_hook(KillHook_t hook) { killHook_ = std::move(hook); }
+
+private:
+  /**
+   * The size of the direct-mapped table which sits in front of blocks_.
+   */
+  static constexpr std::size_t LOOKUP_SIZE = 4096;
+
+  template<typename Fn_t>
+  void for_each_page_(const U64 start, const U64 end, Fn_t fn) const {
+    if(end <= start) {
+      return;
+    }
+
+    const U32 pageBits = bus_.page_bits();
+    const std::size_t lastPage = (end - 1) >> pageBits;
+    for(std::size_t pageIdx = start >> pageBits; pageIdx <= lastPage; ++pageIdx) {
+      fn(pageIdx);
+    }
+  }
+
+  void kill_(Block &block) {
+    if(killHook_) {
+      killHook_(block);
+    }
+
+    block.valid = false;
+
+    for_each_page_(block.start, block.end, [&](const std::size_t pageIdx) {
+      auto &pageBlocks = pageBlocks_[pageIdx];
+      std::erase(pageBlocks, &block);
+      if(pageBlocks.empty()) {
+        pageBlocks_.erase(pageIdx);
+        bus_.unwatch_page(static_cast<Addr_t>(pageIdx << bus_.page_bits()));
+      }
+    });
+
+    auto &entry = lookup_[block.start % LOOKUP_SIZE];
+    if(entry == &block) {
+      entry = nullptr;
+    }
+
+    auto it = blocks_.find(block.start);
+    graveyard_.push_back(std::move(it->second));
+    blocks_.erase(it);
+  }
+
+  MemoryBus        &bus_;
+  const std::size_t watcherId_;
+
+  std::unordered_map<Addr_t, std::unique_ptr<Block>> blocks_;
+
+  /**
+   * Recently used blocks, indexed by start address modulo LOOKUP_SIZE, so that the common case for
+   * find() is a single array lookup rather than a hash table lookup.
+   */
+  std::array<Block *, LOOKUP_SIZE> lookup_{};
+
+  /**
+   * The blocks which have instructions in each page, keyed by page index.
+   */
+  std::unordered_map<std::size_t, std::vector<Block *>> pageBlocks_;
+
+  std::vector<std::unique_ptr<Block>> graveyard_;
+
+  KillHook_t killHook_;
+};
+
+}  // namespace omulator::cpu
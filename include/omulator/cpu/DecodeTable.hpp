@@ -0,0 +1,218 @@
+#pragma once
+
+#include "omulator/oml_defines.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+/**
+ * A framework for describing an instruction set declaratively and generating its decode table at
+ * compile time.
+ *
+ * Each instruction is described by an OpcodePattern, e.g. "01dd dsss", where '0' and '1' are fixed
+ * bits and any other character marks a bit which belongs to the operand field with that name
+ * (spaces and underscores are ignored). Each pattern is paired with a handler template, which is
+ * instantiated once for every opcode matching the pattern:
+ *
+ *   constexpr OpcodePattern MOV = "01dd dsss";
+ *
+ *   template<U32 OPCODE>
+ *   struct Mov {
+ *     static constexpr U32 DST = MOV.field('d', OPCODE);
+ *     static constexpr U32 SRC = MOV.field('s', OPCODE);
+ *
+ *     static Cycle_t exec(Cpu &cpu) { cpu.regs[DST] = cpu.regs[SRC]; return 1; }
+ *   };
+ *
+ *   using Table_t = DecodeTable<Cpu, 8, Illegal, Op<MOV, Mov>, ...>;
+ *   ...
+ *   cyclesTaken += Table_t::dispatch(cpu, opcode);
+ *
+ * Since the operand fields are template arguments, each handler is specialized for its exact
+ * opcode (e.g. the register indices above are constants), and executing an instruction is a single
+ * indexed call through the table rather than a cascade of switch statements.
+ */
+namespace omulator::cpu {
+
+/**
+ * An opcode bit pattern, parsed at compile time. Structural, so that it can be used as a template
+ * argument.
+ */
+struct OpcodePattern {
+  static constexpr std::size_t MAX_BITS = 32;
+
+  consteval OpcodePattern(const char *const str) {
+    for(const char c : std::string_view(str)) {
+      if(c == ' ' || c == '_') {
+        continue;
+      }
+
+      if(width == MAX_BITS) {
+        throw std::invalid_argument("OpcodePattern may not be more than 32 bits wide");
+      }
+
+      // Shift the previous bits up, since the string is MSB first
+      for(std::size_t i = width; i > 0; --i) {
+        fields[i] = fields[i - 1];
+      }
+      mask <<= 1;
+      match <<= 1;
+      ++width;
+
+      if(c == '0' || c == '1') {
+        mask |= 1;
+        match |= (c == '1') ? 1U : 0U;
+        fields[0] = '\0';
+      }
+      else {
+        fields[0] = c;
+      }
+    }
+
+    if(width == 0) {
+      throw std::invalid_argument("OpcodePattern may not be empty");
+    }
+  }
+
+  /**
+   * Returns true if the fixed bits of opcode match the pattern.
+   */
+  consteval bool matches(const U32 opcode) const { return (opcode & mask) == match; }
+
+  /**
+   * Gather the bits of opcode belonging to the given field, MSB first, e.g. for the pattern
+   * "01dd dsss", field('d', 0b0110'1011) == 0b101.
+   */
+  consteval U32 field(const char name, const U32 opcode) const {
+    U32  result = 0;
+    bool found  = false;
+
+    for(std::size_t i = width; i > 0; --i) {
+      if(fields[i - 1] == name) {
+        result = (result << 1) | ((opcode >> (i - 1)) & 1);
+        found  = true;
+      }
+    }
+
+    if(!found) {
+      throw std::invalid_argument("OpcodePattern does not contain the requested field");
+    }
+
+    return result;
+  }
+
+  U32         mask  = 0;
+  U32         match = 0;
+  std::size_t width = 0;
+
+  /**
+   * The name of the field that each bit belongs to, indexed from the LSB; '\0' for fixed bits.
+   */
+  std::array<char, MAX_BITS> fields{};
+};
+
+/**
+ * Pairs an OpcodePattern with the handler template to instantiate for each opcode which matches
+ * it. THandler<OPCODE> must have a static member function Cycle_t exec(TState &) which executes the
+ * instruction and returns the number of cycles it took.
+ */
+template<OpcodePattern PATTERN, template<U32> typename THandler>
+struct Op {
+  static constexpr OpcodePattern pattern = PATTERN;
+
+  template<U32 OPCODE>
+  using Handler_t = THandler<OPCODE>;
+};
+
+/**
+ * A table mapping every OPCODE_BITS-wide opcode to the handler of the first Op in TOps whose
+ * pattern matches it, generated at compile time. Since the first match wins, specific patterns
+ * can be listed ahead of more general ones which overlap with them. Opcodes which match no pattern
+ * are dispatched to TIllegal<OPCODE>.
+ */
+template<typename TState, U32 OPCODE_BITS, template<U32> typename TIllegal, typename... TOps>
+class DecodeTable {
+public:
+  static_assert(OPCODE_BITS > 0 && OPCODE_BITS <= 16,
+                "DecodeTable opcodes must be between 1 and 16 bits wide, otherwise the table would "
+                "be unreasonably large");
+  static_assert(((TOps::pattern.width == OPCODE_BITS) && ...),
+                "Every OpcodePattern in a DecodeTable must be OPCODE_BITS wide");
+
+  using Handler_t = Cycle_t (*)(TState &);
+
+  static constexpr std::size_t SIZE    = std::size_t{1} << OPCODE_BITS;
+  static constexpr std::size_t ILLEGAL = sizeof...(TOps);
+
+  /**
+   * Execute the handler for the given opcode, which must be less than SIZE, returning the number
+   * of cycles taken.
+   */
+  OML_FORCEINLINE static Cycle_t dispatch(TState &state, const U32 opcode) {
+    return TABLE[opcode](state);
+  }
+
+  /**
+   * Returns the handler for the given opcode, which must be less than SIZE.
+   */
+  static constexpr Handler_t handler(const U32 opcode) noexcept { return TABLE[opcode]; }
+
+  /**
+   * Generate an additional table over the same decoding, where the entry for each opcode is
+   * TSelect<THandler<OPCODE>>::value (with THandler being the handler template of the matching Op,
+   * or TIllegal). This allows a CPU to derive other per-opcode data from its handlers, e.g.
+   * instruction lengths, or alternate entry points for a block cache.
+   */
+  template<typename T, template<typename> typename TSelect>
+  static consteval std::array<T, SIZE> make_table() {
+    return make_table_<T, TSelect>(std::make_index_sequence<SIZE>{});
+  }
+
+  /**
+   * Returns the index in TOps of the Op used for the given opcode, or ILLEGAL if none matched.
+   */
+  static consteval std::size_t op_index(const U32 opcode) {
+    constexpr std::array<OpcodePattern, sizeof...(TOps)> patterns{TOps::pattern...};
+
+    for(std::size_t i = 0; i < patterns.size(); ++i) {
+      if(patterns[i].matches(opcode)) {
+        return i;
+      }
+    }
+
+    return ILLEGAL;
+  }
+
+private:
+  template<typename THandler>
+  struct SelectExec_ {
+    static constexpr Handler_t value = &THandler::exec;
+  };
+
+  template<typename T, template<typename> typename TSelect, U32 OPCODE>
+  static consteval T make_entry_() {
+    constexpr std::size_t idx = op_index(OPCODE);
+
+    if constexpr(idx == ILLEGAL) {
+      return TSelect<TIllegal<OPCODE>>::value;
+    }
+    else {
+      using Op_t = std::tuple_element_t<idx, std::tuple<TOps...>>;
+      return TSelect<typename Op_t::template Handler_t<OPCODE>>::value;
+    }
+  }
+
+  template<typename T, template<typename> typename TSelect, std::size_t... Is>
+  static consteval std::array<T, SIZE> make_table_(std::index_sequence<Is...>) {
+    return {make_entry_<T, TSelect, static_cast<U32>(Is)>()...};
+  }
+
+  static constexpr std::array<Handler_t, SIZE> TABLE = make_table<Handler_t, SelectExec_>();
+};
+
+}  // namespace omulator::cpu
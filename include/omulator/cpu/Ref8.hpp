@@ -0,0 +1,327 @@
+#pragma once
+
+#include "omulator/Component.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/MemoryBus.hpp"
+#include "omulator/cpu/BlockCache.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace omulator {
+class Debugger;
+class Tracer;
+}  // namespace omulator
+
+namespace omulator::cpu {
+
+/**
+ * A simple 8-bit reference CPU, built on DecodeTable. It is not modeled after any real hardware;
+ * its purpose is to exercise the CPU emulation infrastructure (and provide a baseline for measuring
+ * it) without the baggage of a real instruction set.
+ *
+ * The CPU has eight 8-bit registers, r0-r7, where r0 is the accumulator for ALU operations and
+ * r6:r7 (high:low) form the address used for loads and stores, along with a 16-bit PC, a 16-bit
+ * SP, and zero and carry flags. Memory is accessed through a MemoryBus; multi-byte operands are
+ * little-endian, and the stack grows downwards.
+ *
+ *   Encoding    Mnemonic      Cycles  Operation
+ *   00000000    NOP           1
+ *   00000001    HLT           1       Stop until reset()
+ *   00ddd010    LDI rd, imm8  2       rd = imm8
+ *   00ddd011    INC rd        1       rd += 1; sets Z
+ *   00ddd100    DEC rd        1       rd -= 1; sets Z
+ *   00ddd101    LD rd         2       rd = [r6:r7]
+ *   00sss110    ST rs         2       [r6:r7] = rs
+ *   01dddsss    MOV rd, rs    1       rd = rs
+ *   10ooosss    ALU rs        1       r0 = r0 <op> rs; sets Z and C. ooo is one of ADD, ADC, SUB,
+ *                                     SBC, AND, OR, XOR, CMP (a SUB which discards the result).
+ *                                     C is the carry (or borrow) out, and is cleared by AND/OR/XOR
+ *   11cc0000    JP cc, imm16  3       pc = imm16 if cc, which is one of always, Z, NZ, C
+ *   11000001    CALL imm16    5       push pc; pc = imm16
+ *   11000010    RET           3       pop pc
+ *
+ * All other opcodes are illegal, and halt the CPU.
+ *
+ * # EXECUTION MODES
+ * In INTERPRETER mode, each instruction is fetched, decoded and executed in turn. In BLOCK_CACHE
+ * mode (the default), each basic block is decoded once into an array of micro-ops, each holding
+ * its handler, its operand, and the address of the next instruction, which are then executed one
+ * after another (i.e. call-threaded code). Blocks are invalidated when the memory they were
+ * decoded from is written to or remapped; see BlockCache. All modes produce identical results,
+ * including cycle counts, and code which can't be cached (e.g. code in MMIO space) is always
+ * interpreted. The MemoryBus must have an address space of at least 16 bits.
+ *
+ * JIT mode builds on BLOCK_CACHE mode: once a cached block has run JIT_THRESHOLD times it is
+ * recompiled to x86-64 host code, which keeps the guest registers in memory but performs register,
+ * ALU and branch instructions natively, along with loads and stores to plain RAM/ROM, and calls
+ * back into the instruction handlers for anything else. Recompiled blocks jump directly to one
+ * another (block linking) for as long as the cycle budget allows, and are unlinked when they are
+ * invalidated. JIT mode is only available on x86-64 hosts; elsewhere, set_exec_mode() throws.
+ *
+ * # IDLE LOOPS
+ * Guest code often spins in a short loop while it waits for an interrupt or for a device to become
+ * ready. With idle loop skipping enabled (see set_idle_skip()), the BLOCK_CACHE and JIT modes look
+ * for blocks of at most IDLE_LOOP_MAX_OPS instructions which end in a jump back to their own start,
+ * contain no stores, and leave r6 and r7 alone (so that every load in the loop reads the same
+ * address). Each time such a block runs, the registers are compared with their values from before
+ * it ran; if they are unchanged then the loop has reached a fixed point, i.e. every further
+ * iteration would read the same values and do exactly the same thing, so the CPU consumes the rest
+ * of the cycles it was given without running it. Since the System never steps a Component past its
+ * next scheduled event, this fast-forwards the CPU to that event.
+ *
+ * That is only safe if nothing the loop reads can change before then, so a loop which loads from
+ * memory is only skipped if the address it loads from is MMIO; RAM can be written by any other
+ * Component partway through a timeslice, so loops which poll RAM are always run. This assumes that
+ * reading MMIO has no side effects, and that its value only changes when an event fires. Loops for
+ * which that doesn't hold, or which the detection misses, can be listed in a per-title override
+ * list with set_idle_loop_override(). Skipped iterations are not counted in instructions_retired(),
+ * so skipping is disabled by default.
+ *
+ * # DEBUGGING
+ * step() runs whichever execution loop suits the current mode and configuration through a pointer
+ * to a member function, which is swapped whenever either changes. Attaching a Debugger swaps in
+ * an instantiation of the interpreter loop which calls Debugger::before_insn before each
+ * instruction; the other loops are instantiated without any debugger checks, so the Debugger has
+ * no cost while it is detached. Attaching a Tracer works the same way, calling Tracer::next before
+ * each instruction. Trace entries hold r0-r7 in regs[0-7], the SP (little-endian) in regs[8-9],
+ * and the flags in regs[10] (bit 0 is zero, and bit 1 is carry), and their cycle is cycles().
+ */
+class Ref8 : public Component {
+public:
+  static constexpr std::size_t NUM_REGS = 8;
+
+  /**
+   * The maximum number of instructions in a cached block.
+   */
+  static constexpr std::size_t MAX_BLOCK_OPS = 64;
+
+  /**
+   * The number of times a block must be executed before it is recompiled in JIT mode.
+   */
+  static constexpr U32 JIT_THRESHOLD = 16;
+
+  /**
+   * The maximum number of instructions in a block which can be detected as an idle loop.
+   */
+  static constexpr std::size_t IDLE_LOOP_MAX_OPS = 8;
+
+  enum class ExecMode : U8 { INTERPRETER, BLOCK_CACHE, JIT };
+
+  struct Registers {
+    std::array<U8, NUM_REGS> r{};
+
+    U16  pc    = 0;
+    U16  sp    = 0;
+    bool zero  = false;
+    bool carry = false;
+
+    bool operator==(const Registers &) const noexcept = default;
+  };
+
+  Ref8(ILogger &logger, MemoryBus &bus);
+  ~Ref8() override;
+
+  /**
+   * Execute instructions until at least numCycles cycles have been taken, and return the number of
+   * cycles taken, which may exceed numCycles by up to the length of one instruction. A halted CPU
+   * simply consumes all of the cycles it is given.
+   */
+  Cycle_t step(const Cycle_t numCycles) override;
+
+  /**
+   * Saves the registers, the halted state, and the retired instruction and cycle counts. Cached
+   * blocks are not saved; restoring memory through the MemoryBus invalidates any which are
+   * affected.
+   */
+  void serialize(StateArchive &archive) override;
+
+  /**
+   * Clear all registers and flags and bring the CPU out of the halted state.
+   */
+  void reset() noexcept;
+
+  Registers       &registers() noexcept;
+  const Registers &registers() const noexcept;
+
+  bool halted() const noexcept;
+
+  ExecMode exec_mode() const noexcept;
+
+  /**
+   * Set the execution mode; switching modes discards any cached blocks. Throws if the mode is not
+   * supported on this host.
+   */
+  void set_exec_mode(const ExecMode mode);
+
+  /**
+   * The number of instructions executed since the CPU was created.
+   */
+  U64 instructions_retired() const noexcept;
+
+  /**
+   * The number of cycles the CPU has taken (including any spent halted) since it was created.
+   */
+  Cycle_t cycles() const noexcept;
+
+  bool idle_skip() const noexcept;
+
+  /**
+   * Enable or disable idle loop skipping; see IDLE LOOPS. Discards any cached blocks.
+   */
+  void set_idle_skip(const bool enabled);
+
+  /**
+   * Override idle loop detection for the block starting at pc, e.g. from a list of known idle loops
+   * for the title being run. If skip is false then the block is never skipped; if skip is true then
+   * it is skipped whenever it reaches a fixed point, even if it is long or contains stores. Has no
+   * effect unless idle loop skipping is enabled. Discards any cached blocks.
+   */
+  void set_idle_loop_override(const U16 pc, const bool skip);
+
+  void clear_idle_loop_overrides();
+
+  /**
+   * The number of cycles skipped in idle loops since the CPU was created.
+   */
+  U64 idle_cycles_skipped() const noexcept;
+
+  /**
+   * Attach a Debugger, or detach it if debugger is null; while attached, the CPU always runs in the
+   * interpreter, regardless of its execution mode. Should be called from the thread which steps the
+   * CPU. N.B. that this does not attach the Debugger to the MemoryBus; see Debugger::attach_bus.
+   */
+  void set_debugger(Debugger *debugger);
+
+  /**
+   * Attach a Tracer, or detach it if tracer is null; as with set_debugger, the CPU always runs in
+   * the interpreter while it is attached. Should be called from the thread which steps the CPU.
+   */
+  void set_tracer(Tracer *tracer);
+
+private:
+  /**
+   * The instruction handlers and decode table; defined in Ref8Isa.hpp.
+   */
+  struct Isa_;
+
+  /**
+   * The recompiler used in JIT mode; defined in Ref8Jit.hpp.
+   */
+  class Jit_;
+
+  struct MicroOp_ {
+    void (*run)(Ref8 &, const U16);
+    U16 operand;
+    U16 nextPc;
+    U8  cycles;
+    U8  opcode;
+  };
+
+  struct BlockData_ {
+    /**
+     * The total number of cycles taken by the block's instructions.
+     */
+    Cycle_t cycles = 0;
+
+    /**
+     * The number of times the block has been entered, and its recompiled host code, if any.
+     */
+    U32       execCount = 0;
+    const U8 *hostCode  = nullptr;
+
+    /**
+     * Whether the block is an idle loop candidate; such blocks are never recompiled. idleLoads is
+     * set if the candidate must load from MMIO to be skipped.
+     */
+    bool idleLoop  = false;
+    bool idleLoads = false;
+  };
+
+  using BlockCache_t = BlockCache<MicroOp_, BlockData_>;
+  using Block_t      = BlockCache_t::Block;
+  using RunLoop_t    = Cycle_t (Ref8::*)(const Cycle_t);
+
+  /**
+   * Fetch, decode and execute a single instruction, returning the number of cycles taken.
+   */
+  Cycle_t interpret_one_();
+
+  /**
+   * As interpret_one_, but also records the instruction with the Tracer; cycle is the cycle which
+   * the instruction starts on.
+   */
+  Cycle_t interpret_traced_(const Cycle_t cycle);
+
+  /**
+   * DEBUG and TRACE select the instrumented instantiations used while a Debugger and/or a Tracer
+   * are attached.
+   */
+  template<bool DEBUG, bool TRACE>
+  Cycle_t run_interpreter_(const Cycle_t numCycles);
+
+  Cycle_t run_block_cache_(const Cycle_t numCycles);
+  Cycle_t run_jit_(const Cycle_t numCycles);
+
+  /**
+   * Execute the micro-ops of a block, stopping early if the block is invalidated or if budget
+   * cycles have been taken. Returns the number of cycles taken.
+   */
+  Cycle_t run_block_(const Block_t &block, const Cycle_t budget);
+
+  /**
+   * Run an idle loop candidate once, and if it reached a fixed point, consume the rest of budget.
+   * Returns the number of cycles taken, including any which were skipped.
+   */
+  Cycle_t run_idle_loop_(const Block_t &block, const Cycle_t budget);
+
+  /**
+   * Set data.idleLoop and data.idleLoads for the block starting at pc with the given micro-ops;
+   * see IDLE LOOPS.
+   */
+  void detect_idle_loop_(const U16 pc, const std::vector<MicroOp_> &ops, BlockData_ &data) const;
+
+  /**
+   * Point runLoop_ at the execution loop for the current mode, Debugger and Tracer.
+   */
+  void update_run_loop_() noexcept;
+
+  /**
+   * Returns the cached block starting at pc, decoding it and adding it to the cache if needed.
+   * Returns nullptr if the instruction at pc can't be cached.
+   */
+  Block_t *find_block_(const U16 pc);
+
+  /**
+   * Decode the block starting at pc and add it to the cache; see find_block_.
+   */
+  Block_t *decode_block_(const U16 pc);
+
+  MemoryBus &bus_;
+  Registers  regs_;
+  bool       halted_;
+  U64        instructionsRetired_;
+  Cycle_t    cycles_;
+
+  ExecMode  execMode_;
+  RunLoop_t runLoop_;
+  Debugger *debugger_;
+  Tracer   *tracer_;
+
+  bool                idleSkip_;
+  std::map<U16, bool> idleLoopOverrides_;
+  U64                 idleCyclesSkipped_;
+
+  /**
+   * Created on first use. Declared ahead of blockCache_, since the cache notifies the JIT as it
+   * destroys its blocks.
+   */
+  std::unique_ptr<Jit_> jit_;
+  BlockCache_t          blockCache_;
+};
+
+}  // namespace omulator::cpu
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+namespace omulator::cpu {
+
+/**
+ * A minimal writer for x86-64 machine code, used by dynamic recompilers. It deals in raw bytes,
+ * immediates and rel32 branches; encoding individual instructions is left to the recompiler, which
+ * knows which handful of forms it needs.
+ *
+ * Code is written to [begin, end); once it runs out of space the emitter stops writing and sets
+ * overflowed(), so a recompiler can emit a whole block and check for overflow once at the end.
+ */
+class X64Emitter {
+public:
+  /**
+   * The condition codes for Jcc/SETcc/CMOVcc, i.e. the low nybble of the opcode.
+   */
+  enum class Cond : U8 {
+    O  = 0x0,
+    NO = 0x1,
+    B  = 0x2,
+    AE = 0x3,
+    E  = 0x4,
+    NE = 0x5,
+    BE = 0x6,
+    A  = 0x7,
+    L  = 0xC,
+    GE = 0xD,
+    LE = 0xE,
+    G  = 0xF
+  };
+
+  X64Emitter(U8 *const begin, U8 *const end) noexcept
+    : cursor_{begin}, end_{end}, overflowed_{false} { }
+
+  U8  *cursor() const noexcept { return cursor_; }
+  bool overflowed() const noexcept { return overflowed_; }
+
+  void emit(std::initializer_list<U8> bytes) noexcept {
+    for(const U8 byte : bytes) {
+      emit8(byte);
+    }
+  }
+
+  void emit(std::span<const U8> bytes) noexcept { emit_raw_(bytes.data(), bytes.size()); }
+
+  void emit8(const U8 val) noexcept { emit_raw_(&val, sizeof(val)); }
+  void emit16(const U16 val) noexcept { emit_raw_(&val, sizeof(val)); }
+  void emit32(const U32 val) noexcept { emit_raw_(&val, sizeof(val)); }
+  void emit64(const U64 val) noexcept { emit_raw_(&val, sizeof(val)); }
+
+  /**
+   * Emit JMP rel32 or Jcc rel32 to target. Returns the address of the rel32 field, which can later
+   * be retargeted with patch_rel32, or nullptr if the emitter overflowed.
+   */
+  U8 *jmp(const U8 *const target) {
+    emit8(0xE9);
+    return rel32_(target);
+  }
+
+  U8 *jcc(const Cond cond, const U8 *const target) {
+    emit({0x0F, static_cast<U8>(0x80 | static_cast<U8>(cond))});
+    return rel32_(target);
+  }
+
+  /**
+   * Point the rel32 field at site (as returned by jmp or jcc) at target.
+   */
+  static void patch_rel32(U8 *const site, const U8 *const target) {
+    const std::ptrdiff_t disp = target - (site + sizeof(U32));
+    if(disp < std::numeric_limits<S32>::min() || disp > std::numeric_limits<S32>::max()) {
+      throw std::runtime_error("X64Emitter branch target is out of range");
+    }
+
+    const auto disp32 = static_cast<S32>(disp);
+    std::memcpy(site, &disp32, sizeof(disp32));
+  }
+
+private:
+  void emit_raw_(const void *const src, const std::size_t size) noexcept {
+    if(overflowed_ || static_cast<std::size_t>(end_ - cursor_) < size) {
+      overflowed_ = true;
+      return;
+    }
+
+    std::memcpy(cursor_, src, size);
+    cursor_ += size;
+  }
+
+  U8 *rel32_(const U8 *const target) {
+    U8 *const site = cursor_;
+    emit32(0);
+    if(overflowed_) {
+      return nullptr;
+    }
+
+    patch_rel32(site, target);
+    return site;
+  }
+
+  U8       *cursor_;
+  U8 *const end_;
+  bool      overflowed_;
+};
+
+}  // namespace omulator::cpu
@@ -2,6 +2,7 @@
 
 #include "omulator/PrimitiveIO.hpp"
 #include "omulator/di/TypeMap.hpp"
+#include "omulator/util/Profiler.hpp"
 #include "omulator/util/TypeHash.hpp"
 #include "omulator/util/TypeString.hpp"
 
@@ -285,6 +286,8 @@ public:
    * NOT the upstream injector.
    *
    * Otherwise, the instance of type T managed by this injecor is returned.
+   *
+   * Profiled whenever a new instance has to be created, under the name of the type.
    */
   template<typename Raw_t, typename T = InjType_t<Raw_t>>
   T &get() {
@@ -293,6 +296,7 @@ public:
         return pUpstream_->get<T>();
       }
       else {
+        OML_PROFILE_SPAN(util::TypeString<T>);
         makeDependency_<T>(DepType_t::REFERENCE);
       }
     }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+/**
+ * Kernels which convert the pixel formats produced by emulated video chips to RGBA8, i.e. bytes in
+ * the order R, G, B, A, which is 0xAABBGGRR when read as a little-endian U32. Each kernel converts
+ * one run of pixels (normally a scanline), and converts as many pixels as both src and dst hold.
+ *
+ * With AVX2 (which the build targets on x64) each kernel handles eight pixels per instruction,
+ * using a gather for palette lookups; there is a scalar fallback elsewhere, which also handles the
+ * leftover pixels at the end of a run.
+ */
+namespace omulator::graphics {
+
+using Palette_t = std::array<U32, 256>;
+
+constexpr U32 rgba(const U8 r, const U8 g, const U8 b, const U8 a = 0xFF) noexcept {
+  return static_cast<U32>(r) | (static_cast<U32>(g) << 8) | (static_cast<U32>(b) << 16)
+         | (static_cast<U32>(a) << 24);
+}
+
+/**
+ * One byte per pixel, each an index into the palette.
+ */
+void convert_indexed8(std::span<const U8> src,
+                      const Palette_t    &palette,
+                      std::span<U32>      dst) noexcept;
+
+/**
+ * 0RRRRRGGGGGBBBBB. Each component is widened to 8 bits by replicating its high bits into the low
+ * bits, so that full intensity maps to 0xFF.
+ */
+void convert_rgb555(std::span<const U16> src, std::span<U32> dst) noexcept;
+
+/**
+ * RRRRRGGGGGGBBBBB, widened the same way as convert_rgb555().
+ */
+void convert_rgb565(std::span<const U16> src, std::span<U32> dst) noexcept;
+
+/**
+ * numPlanes (1-8) bitplanes, one after the other, each holding one bit of every pixel's palette
+ * index, with the leftmost pixel in the most significant bit of each byte; plane 0 holds the least
+ * significant bit. src.size() / numPlanes bytes per plane, and so 8 times as many pixels.
+ */
+void convert_planar(std::span<const U8> src,
+                    const std::size_t   numPlanes,
+                    const Palette_t    &palette,
+                    std::span<U32>      dst) noexcept;
+
+}  // namespace omulator::graphics
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "omulator/graphics/PixelConvert.hpp"
+#include "omulator/oml_types.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace omulator::graphics {
+
+/**
+ * The video output stage of an emulated video chip. The chip draws into a source framebuffer in
+ * its native pixel format, one scanline at a time, and calls present() at the end of each frame;
+ * present() converts the scanlines which have changed to RGBA8 (see PixelConvert.hpp) and publishes
+ * the result. The frame is then handed to the CoreGraphicsEngine by sending it a VIDEO_FRAME
+ * message with a pointer to the VideoOutput, and the CoreGraphicsEngine picks up the newest frame
+ * with acquire().
+ *
+ * # DIRTY SCANLINES
+ * Each scanline has a bit per slot (see below) which is set whenever the line is written through
+ * line() or line16(), or explicitly marked dirty. present() only converts the lines whose bit is
+ * set for the slot being drawn, and clears it. Keeping a bit per slot rather than one per line
+ * means a slot which missed a change while it was being displayed still picks it up.
+ *
+ * # BUFFERING
+ * The converted frames live in NUM_SLOTS slots: one being drawn by present(), one being displayed,
+ * and one holding the newest finished frame. present() swaps the slot it drew with the newest, and
+ * acquire() swaps the displayed slot with the newest if present() has been called since; each swap
+ * is a single atomic exchange of slot indices, so no pixels are copied, and neither side ever waits
+ * for the other. If the emulation runs faster than the display, frames which are never acquired are
+ * simply overwritten.
+ *
+ * All methods other than acquire() must be called from the emulation thread; acquire() must only
+ * be called from one other thread (normally the CoreGraphicsEngine's).
+ */
+class VideoOutput {
+public:
+  enum class PixelFormat {
+    /**
+     * One palette index per byte.
+     */
+    INDEXED8,
+
+    /**
+     * One U16 per pixel; see convert_rgb555() and convert_rgb565().
+     */
+    RGB555,
+    RGB565,
+
+    /**
+     * Each scanline holds numPlanes bitplanes, one after the other; see convert_planar().
+     */
+    PLANAR
+  };
+
+  static constexpr std::size_t NUM_SLOTS = 3;
+
+  /**
+   * A converted frame, which stays valid until the next call to acquire().
+   */
+  struct Frame {
+    std::span<const U32> pixels;
+    U32                  width;
+    U32                  height;
+
+    /**
+     * The number of the present() call which produced the frame, counting from 1; 0 if no frame has
+     * been presented yet, in which case the pixels are all zero.
+     */
+    U64 number;
+  };
+
+  /**
+   * Throws std::invalid_argument if either dimension is zero, or for PLANAR if numPlanes isn't in
+   * the range 1-8 or the width isn't a multiple of 8. numPlanes is ignored for other formats.
+   */
+  VideoOutput(const U32 width, const U32 height, const PixelFormat format, const U32 numPlanes = 0);
+
+  U32         width() const noexcept;
+  U32         height() const noexcept;
+  PixelFormat format() const noexcept;
+
+  /**
+   * The size of each scanline of the source framebuffer, in bytes.
+   */
+  std::size_t line_bytes() const noexcept;
+
+  /**
+   * The bytes of scanline y in the source framebuffer, which is marked dirty. Throws
+   * std::out_of_range if y is past the last scanline.
+   */
+  std::span<U8> line(const U32 y);
+
+  /**
+   * The same as line(), as pixels for the 16-bit formats. Throws std::logic_error for other
+   * formats.
+   */
+  std::span<U16> line16(const U32 y);
+
+  /**
+   * For changes made through a span returned by line() or line16() after the frame it was
+   * returned in has been presented.
+   */
+  void mark_dirty(const U32 y);
+  void mark_all_dirty() noexcept;
+
+  /**
+   * Replace the palette entries starting at first with colors (see rgba()). If the format uses the
+   * palette and any entry changes, every scanline is marked dirty. Throws std::out_of_range if the
+   * colors would extend past the end of the palette.
+   */
+  void set_palette(std::span<const U32> colors, const std::size_t first = 0);
+
+  const Palette_t &palette() const noexcept;
+
+  /**
+   * Convert the dirty scanlines and publish the frame. Returns the number of scanlines converted.
+   */
+  std::size_t present();
+
+  /**
+   * Returns the newest presented frame, swapping it in if it hasn't been acquired yet.
+   */
+  Frame acquire() noexcept;
+
+private:
+  /**
+   * Set in ready_ when the slot it holds has been presented but not yet acquired.
+   */
+  static constexpr U8 NEW_FRAME = 0x80;
+  static constexpr U8 SLOT_MASK = 0x7F;
+  static constexpr U8 ALL_SLOTS = (1 << NUM_SLOTS) - 1;
+
+  void convert_line_(const U32 y, std::span<U32> dst) const noexcept;
+
+  U32         width_;
+  U32         height_;
+  PixelFormat format_;
+  U32         numPlanes_;
+  std::size_t lineBytes_;
+
+  /**
+   * Stored as U16s so that the 16-bit formats can be accessed directly; each line starts on a U16
+   * boundary.
+   */
+  std::size_t      lineStride_;
+  std::vector<U16> source_;
+
+  /**
+   * For each scanline, a bit per slot which needs the line to be converted.
+   */
+  std::vector<U8> dirty_;
+  Palette_t       palette_;
+
+  std::array<std::vector<U32>, NUM_SLOTS> slots_;
+  std::array<U64, NUM_SLOTS>              numbers_;
+
+  U8              back_;
+  U8              front_;
+  std::atomic<U8> ready_;
+  U64             frameNumber_;
+};
+
+}  // namespace omulator::graphics
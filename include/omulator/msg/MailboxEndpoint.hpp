@@ -3,6 +3,7 @@
 #include "omulator/ILogger.hpp"
 #include "omulator/msg/MessageQueue.hpp"
 #include "omulator/msg/MessageQueueFactory.hpp"
+#include "omulator/oml_types.hpp"
 #include "omulator/util/Pimpl.hpp"
 
 #include <atomic>
@@ -78,6 +79,12 @@ public:
    */
   void recv(RecvBehavior recvBehavior = RecvBehavior::BLOCK);
 
+  /**
+   * Same as recv(), but only blocks until deadline (on std::chrono::steady_clock). Returns whether
+   * any messages were processed.
+   */
+  bool recv_until(const TimePoint_t deadline);
+
   /**
    * Submit a MessageQueue to this endpoint, which can then be serviced via a call to recv(). seal()
    * will be called on the MessageQueue prior to submission.
@@ -68,6 +68,7 @@ public:
   void off(const MessageType type);
 
   void recv(RecvBehavior recvBehavior = RecvBehavior::BLOCK);
+  bool recv_until(const TimePoint_t deadline);
 
 private:
   MailboxEndpoint &endpoint_;
@@ -59,6 +59,31 @@ enum class MessageType : U32 {
    */
   STDIN_STRING,
 
+  /**
+   * A snapshot is waiting to be encoded by a RewindBuffer.
+   */
+  REWIND_SNAPSHOT,
+
+  /**
+   * A RunAhead should run the secondary System ahead of the latest saved state.
+   */
+  RUN_AHEAD_FRAME,
+
+  /**
+   * A MediaReadAhead has requests waiting to be serviced.
+   */
+  MEDIA_READ_AHEAD,
+
+  /**
+   * Audio has been submitted to an AudioEngine's channels, and is waiting to be mixed.
+   */
+  AUDIO_MIX,
+
+  /**
+   * A VideoOutput (VideoOutput*) has presented a new frame, which should be acquired and displayed.
+   */
+  VIDEO_FRAME,
+
   /**
    * Placeholder messages used for testing and diagnostic purposes.
    */
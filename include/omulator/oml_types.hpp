@@ -21,5 +21,8 @@ using U64 = std::uint64_t;
 using TimePoint_t = decltype(std::chrono::steady_clock::now());
 using Duration_t  = std::chrono::milliseconds;
 
-using Cycle_t = U32;
+/**
+ * 64 bits, since a 32 bit counter would wrap after about 4 seconds of emulated time at 1 GHz.
+ */
+using Cycle_t = U64;
 } /* namespace omulator */
@@ -5,6 +5,62 @@
  */
 namespace omulator::props {
 
+/**
+ * Path to a WAV file to record the mixed audio to (see WavAudioSink) instead of playing it; unset
+ * or empty to use the audio device, or to discard the audio when headless.
+ */
+constexpr auto AUDIO_WAV = "audio.wav";
+
+/**
+ * If true, run the benchmark System headless and report its performance instead of running the
+ * app; see Benchmark.
+ */
+constexpr auto BENCH = "sys.bench";
+
+/**
+ * Path to a report from a previous benchmark run, against which to check for regressions; unset or
+ * empty to skip the check.
+ */
+constexpr auto BENCH_BASELINE = "bench.baseline";
+
+/**
+ * The number of emulated frames to run the benchmark for, as a string.
+ */
+constexpr auto BENCH_FRAMES = "bench.frames";
+
+/**
+ * Path to write the benchmark System's per-frame state hashes to (see StateHasher); unset or empty
+ * to skip hashing.
+ */
+constexpr auto BENCH_HASHES = "bench.hashes";
+
+/**
+ * Path to write the benchmark report to; unset or empty to write it to stdout.
+ */
+constexpr auto BENCH_REPORT = "bench.report";
+
+/**
+ * Which IClock implementation to use; either "real" (the default) or "virtual".
+ */
+constexpr auto CLOCK = "sys.clock";
+
+/**
+ * Speed multiplier used by the virtual clock, as a string; either a positive number or "unlimited"
+ * (the default) to run as fast as possible.
+ */
+constexpr auto CLOCK_SPEED = "sys.clock_speed";
+
+/**
+ * Path to a hash stream (see StateHasher) to compare with HASH_DIFF.
+ */
+constexpr auto HASH_AGAINST = "hash.against";
+
+/**
+ * Path to a hash stream to compare with HASH_AGAINST instead of running the app, reporting the
+ * first frame at which they differ; unset or empty to skip.
+ */
+constexpr auto HASH_DIFF = "hash.diff";
+
 /**
  * If true, don't display a window.
  */
@@ -20,6 +76,38 @@ constexpr auto INTERACTIVE = "sys.interactive";
  */
 constexpr auto RESOURCE_DIR = "sys.resource_dir";
 
+/**
+ * The maximum number of snapshots kept by a RewindBuffer, as a U64.
+ */
+constexpr auto REWIND_DEPTH = "rewind.depth";
+
+/**
+ * The maximum amount of memory used by a RewindBuffer's history, in MiB, as a U64.
+ */
+constexpr auto REWIND_BUDGET_MB = "rewind.budget_mb";
+
+/**
+ * The number of frames a RunAhead presents ahead of the emulated System, as a U64; 0 (the default)
+ * disables run-ahead.
+ */
+constexpr auto RUN_AHEAD_FRAMES = "runahead.frames";
+
+/**
+ * Path to a trace file (see Tracer) to compare with TRACE_DIFF.
+ */
+constexpr auto TRACE_AGAINST = "trace.against";
+
+/**
+ * Path to a trace file to decode to stdout instead of running the app; unset or empty to skip.
+ */
+constexpr auto TRACE_DECODE = "trace.decode";
+
+/**
+ * Path to a trace file to compare with TRACE_AGAINST instead of running the app, reporting the
+ * first entry at which they diverge; unset or empty to skip.
+ */
+constexpr auto TRACE_DIFF = "trace.diff";
+
 /**
  * If true, turn on Vulkan debugging and validation.
  */
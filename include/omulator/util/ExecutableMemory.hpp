@@ -0,0 +1,75 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace omulator::util {
+
+/**
+ * A block of memory for generated machine code, allocated directly from the OS. No page is ever
+ * writable and executable at the same time (W^X): the memory starts out writable, and must be made
+ * executable before any code in it is run, and writable again before it is modified. Protection is
+ * tracked per OS page, so that a small change to a large buffer only changes the protection of the
+ * pages it touches.
+ *
+ * Throws std::runtime_error if the OS refuses a request. Not threadsafe.
+ */
+class ExecutableMemory {
+public:
+  /**
+   * Allocate at least size bytes, rounded up to a whole number of OS pages.
+   */
+  explicit ExecutableMemory(const std::size_t size);
+  ~ExecutableMemory();
+
+  ExecutableMemory(const ExecutableMemory &)            = delete;
+  ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+  ExecutableMemory(ExecutableMemory &&)                 = delete;
+  ExecutableMemory &operator=(ExecutableMemory &&)      = delete;
+
+  U8         *data() noexcept { return data_; }
+  const U8   *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+
+  /**
+   * Returns true if every page is currently executable (and therefore read-only).
+   */
+  bool executable() const noexcept { return numWritable_ == 0; }
+
+  /**
+   * Make the whole block writable.
+   */
+  void make_writable();
+
+  /**
+   * Make only the pages spanned by [begin, begin + len) writable, leaving the rest as they are.
+   * Throws std::out_of_range if the range is not within the block.
+   */
+  void make_writable(U8 *const begin, const std::size_t len);
+
+  /**
+   * Make every writable page executable again, and flush the instruction cache for those pages
+   * where the platform requires it. No-ops if every page is already executable.
+   */
+  void make_executable();
+
+private:
+  /**
+   * Change the protection of numPages pages starting at firstPage; platform-specific.
+   */
+  void protect_(const std::size_t firstPage, const std::size_t numPages, const bool executable);
+
+  U8         *data_;
+  std::size_t size_;
+  std::size_t pageSize_;
+
+  /**
+   * Which pages are currently writable, and how many of them there are.
+   */
+  std::vector<bool> writable_;
+  std::size_t       numWritable_;
+};
+
+}  // namespace omulator::util
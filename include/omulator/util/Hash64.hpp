@@ -0,0 +1,22 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <span>
+
+/**
+ * A fast, non-cryptographic 64-bit hash for large buffers, such as emulated RAM. The design follows
+ * XXH3's long-input path: the input is consumed in 64-byte stripes, each of which is mixed into
+ * eight 64-bit accumulators with a 32x32->64 multiply per lane, and the accumulators are scrambled
+ * after every 1KiB block. On x64 the stripe loop uses SSE2, handling two lanes per instruction,
+ * and there is a scalar fallback elsewhere.
+ *
+ * N.B. that the output is NOT compatible with XXH3 (the key material and the handling of short
+ * inputs differ), and is only meant to be compared with other hashes produced by this function. It
+ * is stable across platforms and builds, so hashes may be stored and compared between runs.
+ */
+namespace omulator::util {
+
+U64 hash64(std::span<const U8> data, const U64 seed = 0) noexcept;
+
+}  // namespace omulator::util
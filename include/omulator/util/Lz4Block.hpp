@@ -0,0 +1,36 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <span>
+#include <vector>
+
+/**
+ * A compressor and decompressor for the LZ4 block format, which decompresses at several GB/s and
+ * so is cheap enough to use for data which is read while the emulation is running, such as the
+ * hunks of a compressed media image.
+ *
+ * A block is a sequence of sequences, each of which is a token byte (the literal length in the high
+ * nibble and the match length minus 4 in the low nibble, with 15 in either meaning that further
+ * bytes follow, each adding up to 255), the literals, and a 16-bit little-endian offset back into
+ * the output. The last sequence consists only of literals. Blocks produced here can be decoded by
+ * any LZ4 block decoder, and vice versa, although the compressor only uses a single-entry hash
+ * table rather than searching for the best match, so it favours speed over ratio.
+ *
+ * N.B. that a block does not record the size of its decompressed data, which must be stored
+ * alongside it.
+ */
+namespace omulator::util {
+
+/**
+ * Append the compressed form of src to out.
+ */
+void lz4_compress(std::span<const U8> src, std::vector<U8> &out);
+
+/**
+ * Decompress a block into dst, which must be exactly the size of the decompressed data. Throws
+ * std::runtime_error if the block is malformed or does not decompress to exactly dst.size() bytes.
+ */
+void lz4_decompress(std::span<const U8> src, std::span<U8> dst);
+
+}  // namespace omulator::util
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <cstddef>
+#include <filesystem>
+
+namespace omulator::util {
+
+/**
+ * A file mapped directly into memory by the OS, either read-only, or read-write with changes
+ * written back to the file. Pages are loaded on first access and written back by the OS, so
+ * nothing is copied up front and nothing needs to be flushed explicitly.
+ *
+ * The constructors are platform-specific, and throw std::runtime_error if the file can't be opened
+ * or mapped. Not threadsafe.
+ */
+class MappedFile {
+public:
+  /**
+   * Hints about how a range of the file will be accessed; see advise().
+   */
+  enum class Advice {
+    NORMAL,
+    SEQUENTIAL,
+    RANDOM,
+    WILL_NEED,
+  };
+
+  /**
+   * Map an existing file read-only. An empty file is valid, and has a null data().
+   */
+  explicit MappedFile(const std::filesystem::path &path);
+
+  /**
+   * Create the file (or truncate it if it already exists), resize it to size bytes, and map it
+   * read-write. The contents are initially zero.
+   */
+  MappedFile(const std::filesystem::path &path, const std::size_t size);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &)            = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&)                 = delete;
+  MappedFile &operator=(MappedFile &&)      = delete;
+
+  /**
+   * N.B. that writing through data() is only permitted if the file is writable().
+   */
+  U8         *data() noexcept { return data_; }
+  const U8   *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  bool        writable() const noexcept { return writable_; }
+
+  /**
+   * Tell the OS how the given range will be accessed, so that it can adjust its read-ahead or start
+   * paging the range in before it is touched. The range is clamped to the file, and widened to
+   * whole OS pages. This is only a hint, so failures are ignored, and platforms which don't support
+   * a given hint ignore it.
+   */
+  void advise(const Advice advice, const std::size_t offset, const std::size_t size) const noexcept;
+
+private:
+  U8         *data_;
+  std::size_t size_;
+  bool        writable_;
+};
+
+}  // namespace omulator::util
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "omulator/oml_defines.hpp"
+#include "omulator/oml_types.hpp"
+#include "omulator/util/intrinsics.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+
+/**
+ * A lightweight timeline profiler. Spans are recorded with OML_PROFILE_SPAN, which times the
+ * enclosing scope with the TSC and writes the result to a ring buffer owned by the current thread.
+ * The contents of all ring buffers can be exported as a Chrome trace JSON file, which can be viewed
+ * in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Capture is off by default. When it is off, a span costs a single relaxed atomic load and a
+ * branch, and no ring buffers are allocated.
+ */
+namespace omulator::util::profiler {
+
+/**
+ * Value used for a span's argument when it does not have one; it will be omitted from the export.
+ */
+constexpr U64 NO_ARG = ~U64{0};
+
+/**
+ * Number of spans retained per thread; once a ring buffer is full the oldest spans are overwritten.
+ */
+constexpr std::size_t RING_CAPACITY = 1 << 16;
+
+namespace detail {
+  extern std::atomic_bool enabledFlag;
+}  // namespace detail
+
+/**
+ * Whether or not spans are currently being recorded. Threadsafe.
+ */
+OML_FORCEINLINE bool enabled() noexcept {
+  return detail::enabledFlag.load(std::memory_order_relaxed);
+}
+
+/**
+ * Start or stop recording spans. Threadsafe.
+ */
+void enable() noexcept;
+void disable() noexcept;
+
+/**
+ * Discard all spans recorded so far. Threadsafe.
+ */
+void clear();
+
+/**
+ * Name the calling thread in exported traces; threads without a name are identified by number.
+ */
+void set_thread_name(std::string_view name);
+
+/**
+ * Append a span to the calling thread's ring buffer, allocating the ring buffer if this is the
+ * first span recorded by the thread. begin and end are TSC values. N.B. that the memory referenced
+ * by name must outlive the profiler, i.e. it should be a string literal or similar.
+ */
+void record(std::string_view name, const U64 begin, const U64 end, const U64 arg) noexcept;
+
+/**
+ * Write all recorded spans from all threads in the Chrome trace event format. Threadsafe, though
+ * spans which are being overwritten while the export is in progress will be dropped.
+ */
+void export_chrome_trace(std::ostream &os);
+
+/**
+ * Same as above, but writes to a file; throws an exception if the file cannot be written.
+ */
+void export_chrome_trace(const std::filesystem::path &path);
+
+/**
+ * Records a span covering its own lifetime, if the profiler is enabled when the ProfileSpan is
+ * created. Use via OML_PROFILE_SPAN.
+ */
+class ProfileSpan {
+public:
+  OML_FORCEINLINE explicit ProfileSpan(std::string_view name, const U64 arg = NO_ARG) noexcept
+    : name_{name}, arg_{arg}, begin_{0}, active_{enabled()} {
+    if(active_) [[unlikely]] {
+      begin_ = OML_INTRIN_RDTSC();
+    }
+  }
+
+  OML_FORCEINLINE ~ProfileSpan() {
+    if(active_) [[unlikely]] {
+      record(name_, begin_, OML_INTRIN_RDTSC(), arg_);
+    }
+  }
+
+  ProfileSpan(const ProfileSpan &)            = delete;
+  ProfileSpan &operator=(const ProfileSpan &) = delete;
+  ProfileSpan(ProfileSpan &&)                 = delete;
+  ProfileSpan &operator=(ProfileSpan &&)      = delete;
+
+private:
+  std::string_view name_;
+  U64              arg_;
+  U64              begin_;
+  bool             active_;
+};
+
+}  // namespace omulator::util::profiler
+
+#define OML_PROFILE_SPAN_CONCAT_IMPL_(a, b) a##b
+#define OML_PROFILE_SPAN_CONCAT_(a, b)      OML_PROFILE_SPAN_CONCAT_IMPL_(a, b)
+
+/**
+ * Profile the remainder of the enclosing scope. Takes a name (a string literal or another
+ * std::string_view with static storage duration) and an optional U64 argument, which will appear
+ * in the exported trace.
+ */
+#define OML_PROFILE_SPAN(...)                                              \
+  const ::omulator::util::profiler::ProfileSpan OML_PROFILE_SPAN_CONCAT_( \
+    omlProfileSpan_, __LINE__)(__VA_ARGS__)
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace omulator::util {
+
+/**
+ * Converts interleaved stereo audio from one sample rate to another with a windowed-sinc polyphase
+ * filter. The filter has TAPS taps, and is tabulated at PHASES fractional positions between input
+ * samples; the coefficients for an output sample are interpolated linearly between the two nearest
+ * phases, which makes the ratio continuously variable. With AVX2 (which the build targets on x64)
+ * the interpolation and the dot product handle eight taps at a time, with a scalar fallback
+ * elsewhere.
+ *
+ * The ratio can be nudged with set_adjust() while running, e.g. to keep an output buffer at a
+ * steady fill level; the filter's cutoff stays where it was set for the nominal ratio, so small
+ * adjustments don't change its response.
+ *
+ * The cutoff is just below the lower of the two Nyquist frequencies, so downsampling is
+ * band-limited. N.B. that with only TAPS taps the transition band widens as the ratio grows, so
+ * sources running at many times the output rate should decimate first.
+ *
+ * The output lags the input by TAPS / 2 - 1 input samples. Not threadsafe.
+ */
+class Resampler {
+public:
+  static constexpr std::size_t TAPS   = 16;
+  static constexpr std::size_t PHASES = 256;
+
+  /**
+   * Throws std::invalid_argument unless both rates are positive.
+   */
+  Resampler(const double inRate, const double outRate);
+
+  /**
+   * Scale the number of output frames produced per input frame by adjust, which should be close to
+   * 1; e.g. 1.001 produces 0.1% more output.
+   */
+  void   set_adjust(const double adjust) noexcept;
+  double adjust() const noexcept;
+
+  /**
+   * Append interleaved stereo input frames. Throws std::invalid_argument if frames holds an odd
+   * number of samples.
+   */
+  void push(std::span<const float> frames);
+
+  /**
+   * The number of output frames which can be produced from the input pushed so far.
+   */
+  std::size_t available() const noexcept;
+
+  /**
+   * Resample up to out.size() / 2 frames, scale them by gain, and add them to the interleaved
+   * stereo frames already in out, consuming input as it goes. Returns the number of frames
+   * produced, which is less than requested if the input runs out.
+   */
+  std::size_t mix_into(std::span<float> out, const float gain);
+
+  /**
+   * Discard all buffered input. Returns the number of input frames which were discarded before any
+   * output was produced from them (allowing for the lag).
+   */
+  std::size_t reset() noexcept;
+
+private:
+  /**
+   * Positions and steps are fixed point with FRAC_BITS fractional bits, so that the position of
+   * each output frame is exact, and doesn't depend on how the input was split between calls to
+   * push().
+   */
+  static constexpr int FRAC_BITS = 32;
+
+  /**
+   * The number of input frames per output frame at the nominal ratio.
+   */
+  double baseStep_;
+  U64    step_;
+  double adjust_;
+
+  /**
+   * The position of the next output frame, in input frames relative to the start of left_/right_.
+   */
+  U64 pos_;
+
+  /**
+   * (PHASES + 1) rows of TAPS coefficients; the extra row lets the last phase interpolate towards
+   * the first phase of the next input sample.
+   */
+  std::vector<float> kernel_;
+
+  /**
+   * The input, deinterleaved so that each channel's taps are contiguous.
+   */
+  std::vector<float> left_;
+  std::vector<float> right_;
+};
+
+}  // namespace omulator::util
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace omulator::util {
+
+/**
+ * A bounded, lock-free ring buffer with a single producer and a single consumer, which moves items
+ * in blocks rather than one at a time. Each side only ever writes its own index, so neither side
+ * waits for the other: push() accepts as much as fits and pop() takes as much as is available.
+ *
+ * push() may only be called from one thread at a time, and likewise pop(); they may run
+ * concurrently with each other. size() and free() are exact when called from either of those
+ * threads with regards to its own side, and a snapshot otherwise.
+ */
+template<typename T>
+class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>, "SpscRing only supports trivially copyable types");
+
+public:
+  /**
+   * The capacity is rounded up to a power of two. Throws std::invalid_argument if it is 0.
+   */
+  explicit SpscRing(const std::size_t capacity) : head_{0}, tail_{0} {
+    if(capacity == 0) {
+      throw std::invalid_argument("SpscRing capacity must be nonzero");
+    }
+
+    std::size_t rounded = 1;
+    while(rounded < capacity) {
+      rounded <<= 1;
+    }
+
+    buf_.resize(rounded);
+    mask_ = rounded - 1;
+  }
+
+  SpscRing(const SpscRing &)            = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+  SpscRing(SpscRing &&)                 = delete;
+  SpscRing &operator=(SpscRing &&)      = delete;
+
+  std::size_t capacity() const noexcept { return buf_.size(); }
+
+  std::size_t size() const noexcept {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  std::size_t free() const noexcept { return capacity() - size(); }
+
+  /**
+   * Append as many of items as will fit, and return how many were appended. Producer only.
+   */
+  std::size_t push(std::span<const T> items) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t tail = tail_.load(std::memory_order_acquire);
+    const std::size_t n    = std::min(items.size(), capacity() - (head - tail));
+
+    write_(head, items.data(), n);
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  /**
+   * Remove up to out.size() items into out, and return how many were removed. Consumer only.
+   */
+  std::size_t pop(std::span<T> out) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t head = head_.load(std::memory_order_acquire);
+    const std::size_t n    = std::min(out.size(), head - tail);
+
+    read_(tail, out.data(), n);
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+private:
+  /**
+   * Copy n items into the ring at the (unmasked) index pos, in two pieces if the range wraps around
+   * the end of the ring.
+   */
+  void write_(const std::size_t pos, const T *const src, const std::size_t n) noexcept {
+    if(n == 0) {
+      return;
+    }
+
+    const std::size_t start = pos & mask_;
+    const std::size_t first = std::min(n, capacity() - start);
+    std::memcpy(buf_.data() + start, src, first * sizeof(T));
+    std::memcpy(buf_.data(), src + first, (n - first) * sizeof(T));
+  }
+
+  void read_(const std::size_t pos, T *const dst, const std::size_t n) const noexcept {
+    if(n == 0) {
+      return;
+    }
+
+    const std::size_t start = pos & mask_;
+    const std::size_t first = std::min(n, capacity() - start);
+    std::memcpy(dst, buf_.data() + start, first * sizeof(T));
+    std::memcpy(dst + first, buf_.data(), (n - first) * sizeof(T));
+  }
+
+  std::vector<T> buf_;
+  std::size_t    mask_;
+
+  /**
+   * The total number of items ever pushed and popped; only the producer writes head_, and only the
+   * consumer writes tail_. They are kept on separate cache lines so that the two sides don't
+   * contend for the same line.
+   */
+  alignas(64) std::atomic<std::size_t> head_;
+  alignas(64) std::atomic<std::size_t> tail_;
+};
+
+}  // namespace omulator::util
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+#include <span>
+#include <vector>
+
+/**
+ * A delta encoding for pairs of equally sized buffers which are mostly identical, such as
+ * consecutive save states. The two buffers are XORed together, and the result is run-length encoded
+ * as a sequence of (skip, length, bytes) records: skip bytes which are unchanged, followed by
+ * length bytes of XORed data. skip and length are stored as LEB128 varints. Short runs of unchanged
+ * bytes in the middle of changed data are folded into the XORed data, since a new record would cost
+ * more than the bytes it saves.
+ *
+ * Since XOR is its own inverse, the same delta turns either buffer into the other.
+ */
+namespace omulator::util {
+
+/**
+ * Append the delta between from and to, which must be the same size, to out. Throws
+ * std::invalid_argument if the sizes differ.
+ */
+void xor_delta_encode(std::span<const U8> from, std::span<const U8> to, std::vector<U8> &out);
+
+/**
+ * Apply a delta produced by xor_delta_encode to either of the buffers it was produced from, in
+ * place. Throws std::runtime_error if the delta is malformed or does not fit within buf.
+ */
+void xor_delta_apply(std::span<const U8> delta, std::span<U8> buf);
+
+}  // namespace omulator::util
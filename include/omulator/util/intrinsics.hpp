@@ -13,6 +13,7 @@
 #endif /* if defined(OML_COMPILER_MSVC) || defined(OML_COMPILER_CLANG_CL) */
 #include <immintrin.h>
 #define OML_INTRIN_PAUSE() _mm_pause()
+#define OML_INTRIN_RDTSC() __rdtsc()
 #else
 #error Need to define intrinsics for target platform
 #endif /* ifdef OML_ARCH_X64 */
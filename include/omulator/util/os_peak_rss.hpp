@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace omulator::util {
+
+/**
+ * The peak resident set size (i.e. the high-water mark of physical memory use) of the current
+ * process, in bytes; 0 if the OS doesn't report it.
+ *
+ * This function is platform-specific.
+ */
+std::size_t os_peak_rss() noexcept;
+
+}  // namespace omulator::util
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "omulator/oml_types.hpp"
+
+namespace omulator::util {
+
+/**
+ * Sleep until a given point in time using the most precise absolute-deadline timer the OS offers.
+ * Returns immediately if the deadline has already passed.
+ *
+ * This is still subject to the scheduler's wakeup latency, and as such may return somewhat later
+ * than the requested deadline (but never earlier); a HYBRID Clock uses this for the bulk of a wait
+ * and spins for the remainder.
+ *
+ * This function is platform-specific.
+ */
+void os_sleep_until(const TimePoint_t then);
+
+}  // namespace omulator::util
@@ -0,0 +1,63 @@
+#include "omulator/util/ExecutableMemory.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+[[noreturn]] void throw_errno(const char *const what) {
+  throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+}  // namespace
+
+namespace omulator::util {
+
+ExecutableMemory::ExecutableMemory(const std::size_t size)
+  : data_{nullptr},
+    size_{0},
+    pageSize_{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))},
+    numWritable_{0} {
+  size_ = ((size + pageSize_ - 1) / pageSize_) * pageSize_;
+  if(size_ == 0) {
+    throw std::invalid_argument("ExecutableMemory may not be empty");
+  }
+
+  void *const mem =
+    mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(mem == MAP_FAILED) {
+    throw_errno("Failed to map memory for ExecutableMemory");
+  }
+
+  data_ = static_cast<U8 *>(mem);
+  writable_.assign(size_ / pageSize_, true);
+  numWritable_ = writable_.size();
+}
+
+ExecutableMemory::~ExecutableMemory() { munmap(data_, size_); }
+
+void ExecutableMemory::protect_(const std::size_t firstPage,
+                                const std::size_t numPages,
+                                const bool        executable) {
+  U8 *const         begin = data_ + firstPage * pageSize_;
+  const std::size_t len   = numPages * pageSize_;
+
+  if(!executable) {
+    if(mprotect(begin, len, PROT_READ | PROT_WRITE) != 0) {
+      throw_errno("Failed to make ExecutableMemory writable");
+    }
+    return;
+  }
+
+  // x86 keeps its instruction cache coherent, but other architectures need an explicit flush
+  __builtin___clear_cache(reinterpret_cast<char *>(begin), reinterpret_cast<char *>(begin + len));
+
+  if(mprotect(begin, len, PROT_READ | PROT_EXEC) != 0) {
+    throw_errno("Failed to make ExecutableMemory executable");
+  }
+}
+
+}  // namespace omulator::util
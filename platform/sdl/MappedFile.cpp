@@ -0,0 +1,125 @@
+#include "omulator/util/MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+[[noreturn]] void throw_errno(const std::string &what) {
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * Closes the file descriptor when leaving scope; the mapping remains valid once it is closed.
+ */
+class FdGuard {
+public:
+  explicit FdGuard(const int fd) : fd_(fd) { }
+  ~FdGuard() { close(fd_); }
+
+  FdGuard(const FdGuard &)            = delete;
+  FdGuard &operator=(const FdGuard &) = delete;
+  FdGuard(FdGuard &&)                 = delete;
+  FdGuard &operator=(FdGuard &&)      = delete;
+
+private:
+  int fd_;
+};
+}  // namespace
+
+namespace omulator::util {
+
+MappedFile::MappedFile(const std::filesystem::path &path)
+  : data_{nullptr}, size_{0}, writable_{false} {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd < 0) {
+    throw_errno("Failed to open " + path.string());
+  }
+  FdGuard guard(fd);
+
+  struct stat st;
+  if(fstat(fd, &st) != 0) {
+    throw_errno("Failed to get the size of " + path.string());
+  }
+
+  size_ = static_cast<std::size_t>(st.st_size);
+  if(size_ == 0) {
+    return;
+  }
+
+  void *const mem = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  if(mem == MAP_FAILED) {
+    throw_errno("Failed to map " + path.string());
+  }
+
+  data_ = static_cast<U8 *>(mem);
+}
+
+MappedFile::MappedFile(const std::filesystem::path &path, const std::size_t size)
+  : data_{nullptr}, size_{size}, writable_{true} {
+  if(size_ == 0) {
+    throw std::invalid_argument("A writable MappedFile may not be empty");
+  }
+
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd < 0) {
+    throw_errno("Failed to create " + path.string());
+  }
+  FdGuard guard(fd);
+
+  if(ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+    throw_errno("Failed to resize " + path.string());
+  }
+
+  void *const mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(mem == MAP_FAILED) {
+    throw_errno("Failed to map " + path.string());
+  }
+
+  data_ = static_cast<U8 *>(mem);
+}
+
+MappedFile::~MappedFile() {
+  if(data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+void MappedFile::advise(const Advice      advice,
+                        const std::size_t offset,
+                        const std::size_t size) const noexcept {
+  if(data_ == nullptr || offset >= size_) {
+    return;
+  }
+
+  int hint = MADV_NORMAL;
+  switch(advice) {
+    case Advice::NORMAL:
+      hint = MADV_NORMAL;
+      break;
+    case Advice::SEQUENTIAL:
+      hint = MADV_SEQUENTIAL;
+      break;
+    case Advice::RANDOM:
+      hint = MADV_RANDOM;
+      break;
+    case Advice::WILL_NEED:
+      hint = MADV_WILLNEED;
+      break;
+  }
+
+  // madvise requires a page-aligned address
+  const auto        pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t begin    = offset - (offset % pageSize);
+  const std::size_t end      = offset + std::min(size, size_ - offset);
+  madvise(data_ + begin, end - begin, hint);
+}
+
+}  // namespace omulator::util
@@ -0,0 +1,81 @@
+#include "omulator/SystemAudioSink.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace omulator {
+
+struct SystemAudioSink::Impl_ {
+  SDL_AudioDeviceID device;
+
+  Impl_() : device(0) { }
+  ~Impl_() = default;
+};
+
+SystemAudioSink::SystemAudioSink(ILogger &logger)
+  : logger_{logger}, sampleRate_{DEFAULT_SAMPLE_RATE}, dropped_{0} {
+  if(SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+    std::stringstream ss;
+    ss << "Failed to initialize SDL audio: " << SDL_GetError();
+    throw std::runtime_error(ss.str());
+  }
+
+  // No callback, so that audio is queued with SDL_QueueAudio
+  SDL_AudioSpec want{};
+  want.freq     = static_cast<int>(DEFAULT_SAMPLE_RATE);
+  want.format   = AUDIO_F32SYS;
+  want.channels = 2;
+  want.samples  = 512;
+  want.callback = nullptr;
+
+  SDL_AudioSpec have{};
+  impl_->device =
+    SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+  if(impl_->device == 0) {
+    std::stringstream ss;
+    ss << "Failed to open an SDL audio device: " << SDL_GetError();
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    throw std::runtime_error(ss.str());
+  }
+
+  sampleRate_ = static_cast<U32>(have.freq);
+  SDL_PauseAudioDevice(impl_->device, 0);
+
+  std::stringstream ss;
+  ss << "Opened SDL audio device at " << sampleRate_ << " Hz";
+  logger_.info(ss);
+}
+
+SystemAudioSink::~SystemAudioSink() {
+  SDL_CloseAudioDevice(impl_->device);
+  SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+U32 SystemAudioSink::sample_rate() const noexcept { return sampleRate_; }
+
+void SystemAudioSink::write(std::span<const float> frames) {
+  constexpr U32 FRAME_BYTES = 2 * sizeof(float);
+
+  const U32 queued = SDL_GetQueuedAudioSize(impl_->device) / FRAME_BYTES;
+  if(queued >= 2 * LATENCY_FRAMES) {
+    dropped_.fetch_add(frames.size() / 2, std::memory_order_relaxed);
+    return;
+  }
+
+  if(SDL_QueueAudio(impl_->device, frames.data(), static_cast<U32>(frames.size_bytes())) != 0) {
+    std::stringstream ss;
+    ss << "Failed to queue audio: " << SDL_GetError();
+    logger_.warn(ss);
+  }
+}
+
+std::optional<double> SystemAudioSink::fill_level() const {
+  constexpr U32 FRAME_BYTES = 2 * sizeof(float);
+  return static_cast<double>(SDL_GetQueuedAudioSize(impl_->device) / FRAME_BYTES) / LATENCY_FRAMES;
+}
+
+U64 SystemAudioSink::dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+}  // namespace omulator
@@ -0,0 +1,21 @@
+#include "omulator/util/os_peak_rss.hpp"
+
+#include <sys/resource.h>
+
+namespace omulator::util {
+
+std::size_t os_peak_rss() noexcept {
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0) {
+    return 0;
+  }
+
+  // Linux reports ru_maxrss in KiB, while macOS reports it in bytes
+#if defined(__APPLE__)
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+}  // namespace omulator::util
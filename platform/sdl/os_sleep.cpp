@@ -0,0 +1,42 @@
+#include "omulator/util/os_sleep.hpp"
+
+#if defined(__APPLE__)
+#include <thread>
+#else
+#include <time.h>
+
+#include <cerrno>
+#include <chrono>
+#endif
+
+#if !defined(__APPLE__)
+namespace {
+constexpr omulator::S64 NS_PER_SEC = 1'000'000'000;
+}  // namespace
+#endif
+
+namespace omulator::util {
+
+void os_sleep_until(const TimePoint_t then) {
+#if defined(__APPLE__)
+  // macOS has no clock_nanosleep, and none of its timers with an absolute deadline are any more
+  // precise than the standard library's
+  std::this_thread::sleep_until(then);
+#else
+  // Both libstdc++ and libc++ implement std::chrono::steady_clock on top of CLOCK_MONOTONIC, so the
+  // deadline can be handed straight to clock_nanosleep as an absolute time. Using an absolute time
+  // also means that we don't accumulate error if we have to restart the sleep after a signal.
+  const S64 deadlineNs =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(then.time_since_epoch()).count();
+
+  timespec ts;
+  ts.tv_sec  = deadlineNs / NS_PER_SEC;
+  ts.tv_nsec = deadlineNs % NS_PER_SEC;
+
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    /* interrupted by a signal; keep waiting */
+  }
+#endif
+}
+
+}  // namespace omulator::util
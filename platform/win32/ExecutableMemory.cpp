@@ -0,0 +1,58 @@
+#include "omulator/util/ExecutableMemory.hpp"
+
+#include <Windows.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+[[noreturn]] void throw_last_error(const char *const what) {
+  throw std::runtime_error(std::string(what) + ": error " + std::to_string(GetLastError()));
+}
+}  // namespace
+
+namespace omulator::util {
+
+ExecutableMemory::ExecutableMemory(const std::size_t size)
+  : data_{nullptr}, size_{0}, pageSize_{0}, numWritable_{0} {
+  SYSTEM_INFO sysInfo;
+  GetSystemInfo(&sysInfo);
+  pageSize_ = sysInfo.dwPageSize;
+  size_     = ((size + pageSize_ - 1) / pageSize_) * pageSize_;
+  if(size_ == 0) {
+    throw std::invalid_argument("ExecutableMemory may not be empty");
+  }
+
+  void *const mem = VirtualAlloc(nullptr, size_, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if(mem == nullptr) {
+    throw_last_error("Failed to allocate memory for ExecutableMemory");
+  }
+
+  data_ = static_cast<U8 *>(mem);
+  writable_.assign(size_ / pageSize_, true);
+  numWritable_ = writable_.size();
+}
+
+ExecutableMemory::~ExecutableMemory() { VirtualFree(data_, 0, MEM_RELEASE); }
+
+void ExecutableMemory::protect_(const std::size_t firstPage,
+                                const std::size_t numPages,
+                                const bool        executable) {
+  U8 *const         begin = data_ + firstPage * pageSize_;
+  const std::size_t len   = numPages * pageSize_;
+
+  DWORD oldProtect;
+  if(!executable) {
+    if(!VirtualProtect(begin, len, PAGE_READWRITE, &oldProtect)) {
+      throw_last_error("Failed to make ExecutableMemory writable");
+    }
+    return;
+  }
+
+  if(!VirtualProtect(begin, len, PAGE_EXECUTE_READ, &oldProtect)) {
+    throw_last_error("Failed to make ExecutableMemory executable");
+  }
+  FlushInstructionCache(GetCurrentProcess(), begin, len);
+}
+
+}  // namespace omulator::util
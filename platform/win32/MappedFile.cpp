@@ -0,0 +1,129 @@
+#include "omulator/util/MappedFile.hpp"
+
+#include <Windows.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+[[noreturn]] void throw_last_error(const std::string &what) {
+  throw std::runtime_error(what + ": error " + std::to_string(GetLastError()));
+}
+
+/**
+ * Closes the handle when leaving scope; the view remains valid once the file and mapping handles
+ * are closed.
+ */
+class HandleGuard {
+public:
+  explicit HandleGuard(HANDLE handle) : handle_(handle) { }
+  ~HandleGuard() { CloseHandle(handle_); }
+
+  HandleGuard(const HandleGuard &)            = delete;
+  HandleGuard &operator=(const HandleGuard &) = delete;
+  HandleGuard(HandleGuard &&)                 = delete;
+  HandleGuard &operator=(HandleGuard &&)      = delete;
+
+private:
+  HANDLE handle_;
+};
+}  // namespace
+
+namespace omulator::util {
+
+MappedFile::MappedFile(const std::filesystem::path &path)
+  : data_{nullptr}, size_{0}, writable_{false} {
+  HANDLE file = CreateFileW(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if(file == INVALID_HANDLE_VALUE) {
+    throw_last_error("Failed to open " + path.string());
+  }
+  HandleGuard fileGuard(file);
+
+  LARGE_INTEGER fileSize;
+  if(!GetFileSizeEx(file, &fileSize)) {
+    throw_last_error("Failed to get the size of " + path.string());
+  }
+
+  size_ = static_cast<std::size_t>(fileSize.QuadPart);
+  if(size_ == 0) {
+    return;
+  }
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(mapping == nullptr) {
+    throw_last_error("Failed to map " + path.string());
+  }
+  HandleGuard mappingGuard(mapping);
+
+  void *const mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size_);
+  if(mem == nullptr) {
+    throw_last_error("Failed to map " + path.string());
+  }
+
+  data_ = static_cast<U8 *>(mem);
+}
+
+MappedFile::MappedFile(const std::filesystem::path &path, const std::size_t size)
+  : data_{nullptr}, size_{size}, writable_{true} {
+  if(size_ == 0) {
+    throw std::invalid_argument("A writable MappedFile may not be empty");
+  }
+
+  HANDLE file = CreateFileW(path.c_str(),
+                            GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if(file == INVALID_HANDLE_VALUE) {
+    throw_last_error("Failed to create " + path.string());
+  }
+  HandleGuard fileGuard(file);
+
+  // Mapping a file with a size larger than the file itself grows the file to that size
+  const auto sizeHigh = static_cast<DWORD>(static_cast<U64>(size_) >> 32);
+  const auto sizeLow  = static_cast<DWORD>(static_cast<U64>(size_) & 0xFFFF'FFFF);
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, sizeHigh, sizeLow, nullptr);
+  if(mapping == nullptr) {
+    throw_last_error("Failed to map " + path.string());
+  }
+  HandleGuard mappingGuard(mapping);
+
+  void *const mem = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size_);
+  if(mem == nullptr) {
+    throw_last_error("Failed to map " + path.string());
+  }
+
+  data_ = static_cast<U8 *>(mem);
+}
+
+MappedFile::~MappedFile() {
+  if(data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+}
+
+void MappedFile::advise(const Advice      advice,
+                        const std::size_t offset,
+                        const std::size_t size) const noexcept {
+  // Windows has no equivalent to the other hints; the memory manager decides on its own how much
+  // to read ahead
+  if(data_ == nullptr || offset >= size_ || advice != Advice::WILL_NEED) {
+    return;
+  }
+
+  // N.B. no std::min here, since Windows.h defines min as a macro
+  WIN32_MEMORY_RANGE_ENTRY entry;
+  entry.VirtualAddress = data_ + offset;
+  entry.NumberOfBytes  = size < size_ - offset ? size : size_ - offset;
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+}
+
+}  // namespace omulator::util
@@ -0,0 +1,124 @@
+#include "omulator/SystemAudioSink.hpp"
+
+#include <Windows.h>
+#include <mmsystem.h>
+
+#include <array>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace omulator {
+
+struct SystemAudioSink::Impl_ {
+  /**
+   * The number of blocks which may be queued with the device at once; each write() takes one.
+   */
+  static constexpr std::size_t NUM_BLOCKS = 32;
+
+  HWAVEOUT                                 waveOut;
+  std::array<WAVEHDR, NUM_BLOCKS>          headers;
+  std::array<std::vector<S16>, NUM_BLOCKS> blocks;
+
+  Impl_() : waveOut(nullptr), headers{} { }
+  ~Impl_() = default;
+
+  bool queued(const WAVEHDR &header) const noexcept {
+    return (header.dwFlags & WHDR_PREPARED) != 0 && (header.dwFlags & WHDR_DONE) == 0;
+  }
+
+  U32 queued_frames() const noexcept {
+    U32 frames = 0;
+    for(const auto &header : headers) {
+      if(queued(header)) {
+        frames += header.dwBufferLength / (2 * sizeof(S16));
+      }
+    }
+
+    return frames;
+  }
+};
+
+SystemAudioSink::SystemAudioSink(ILogger &logger)
+  : logger_{logger}, sampleRate_{DEFAULT_SAMPLE_RATE}, dropped_{0} {
+  WAVEFORMATEX format{};
+  format.wFormatTag      = WAVE_FORMAT_PCM;
+  format.nChannels       = 2;
+  format.nSamplesPerSec  = sampleRate_;
+  format.wBitsPerSample  = 16;
+  format.nBlockAlign     = format.nChannels * format.wBitsPerSample / 8;
+  format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+  const MMRESULT result = waveOutOpen(&impl_->waveOut, WAVE_MAPPER, &format, 0, 0, CALLBACK_NULL);
+  if(result != MMSYSERR_NOERROR) {
+    throw std::runtime_error("Failed to open the audio device: error " + std::to_string(result));
+  }
+
+  std::stringstream ss;
+  ss << "Opened waveOut audio device at " << sampleRate_ << " Hz";
+  logger_.info(ss);
+}
+
+SystemAudioSink::~SystemAudioSink() {
+  waveOutReset(impl_->waveOut);
+  for(auto &header : impl_->headers) {
+    if((header.dwFlags & WHDR_PREPARED) != 0) {
+      waveOutUnprepareHeader(impl_->waveOut, &header, sizeof(header));
+    }
+  }
+  waveOutClose(impl_->waveOut);
+}
+
+U32 SystemAudioSink::sample_rate() const noexcept { return sampleRate_; }
+
+void SystemAudioSink::write(std::span<const float> frames) {
+  if(frames.empty()) {
+    return;
+  }
+
+  // Reuse a block which isn't queued with the device
+  WAVEHDR          *header = nullptr;
+  std::vector<S16> *block  = nullptr;
+  for(std::size_t i = 0; i < Impl_::NUM_BLOCKS; ++i) {
+    if(!impl_->queued(impl_->headers[i])) {
+      header = &impl_->headers[i];
+      block  = &impl_->blocks[i];
+      break;
+    }
+  }
+
+  if(header == nullptr || impl_->queued_frames() >= 2 * LATENCY_FRAMES) {
+    dropped_.fetch_add(frames.size() / 2, std::memory_order_relaxed);
+    return;
+  }
+
+  if((header->dwFlags & WHDR_PREPARED) != 0) {
+    waveOutUnprepareHeader(impl_->waveOut, header, sizeof(*header));
+  }
+
+  block->resize(frames.size());
+  for(std::size_t i = 0; i < frames.size(); ++i) {
+    const float clamped = frames[i] < -1.0F ? -1.0F : (frames[i] > 1.0F ? 1.0F : frames[i]);
+    (*block)[i]         = static_cast<S16>(std::lround(clamped * 32767.0F));
+  }
+
+  *header                = {};
+  header->lpData         = reinterpret_cast<LPSTR>(block->data());
+  header->dwBufferLength = static_cast<DWORD>(block->size() * sizeof(S16));
+
+  if(waveOutPrepareHeader(impl_->waveOut, header, sizeof(*header)) != MMSYSERR_NOERROR
+     || waveOutWrite(impl_->waveOut, header, sizeof(*header)) != MMSYSERR_NOERROR)
+  {
+    logger_.warn("Failed to queue audio");
+  }
+}
+
+std::optional<double> SystemAudioSink::fill_level() const {
+  return static_cast<double>(impl_->queued_frames()) / LATENCY_FRAMES;
+}
+
+U64 SystemAudioSink::dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+}  // namespace omulator
@@ -0,0 +1,19 @@
+#include "omulator/util/os_peak_rss.hpp"
+
+#include <Windows.h>
+
+// N.B. that this must come after Windows.h
+#include <Psapi.h>
+
+namespace omulator::util {
+
+std::size_t os_peak_rss() noexcept {
+  PROCESS_MEMORY_COUNTERS counters;
+  if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+
+  return counters.PeakWorkingSetSize;
+}
+
+}  // namespace omulator::util
@@ -0,0 +1,65 @@
+#include "omulator/util/os_sleep.hpp"
+
+#include <Windows.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+/**
+ * Creating a waitable timer is relatively expensive, so each thread keeps its own around.
+ */
+struct ThreadTimer {
+  ThreadTimer()
+    : handle(CreateWaitableTimerExW(
+      nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS)) { }
+
+  ~ThreadTimer() {
+    if(handle != nullptr) {
+      CloseHandle(handle);
+    }
+  }
+
+  ThreadTimer(const ThreadTimer &)            = delete;
+  ThreadTimer &operator=(const ThreadTimer &) = delete;
+  ThreadTimer(ThreadTimer &&)                 = delete;
+  ThreadTimer &operator=(ThreadTimer &&)      = delete;
+
+  HANDLE handle;
+};
+
+}  // namespace
+
+namespace omulator::util {
+
+void os_sleep_until(const TimePoint_t then) {
+  const auto now = std::chrono::steady_clock::now();
+  if(then <= now) {
+    return;
+  }
+
+  thread_local ThreadTimer timer;
+
+  // High resolution timers are only available on Windows 10 1803 and later
+  if(timer.handle == nullptr) {
+    std::this_thread::sleep_until(then);
+    return;
+  }
+
+  // Waitable timers don't share an epoch with steady_clock, so we have to use a relative due time,
+  // which is expressed as a negative number of 100ns intervals.
+  LARGE_INTEGER dueTime;
+  dueTime.QuadPart =
+    -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(then - now).count()
+                           / 100);
+
+  if(SetWaitableTimer(timer.handle, &dueTime, 0, nullptr, nullptr, FALSE)) {
+    WaitForSingleObject(timer.handle, INFINITE);
+  }
+  else {
+    std::this_thread::sleep_until(then);
+  }
+}
+
+}  // namespace omulator::util
@@ -0,0 +1,158 @@
+#include "omulator/AudioEngine.hpp"
+
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/TypeHash.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace omulator {
+
+namespace {
+
+/**
+ * The number of samples moved out of a channel's ring at a time.
+ */
+constexpr std::size_t DRAIN_CHUNK = 4096;
+
+}  // namespace
+
+AudioChannel::AudioChannel(const double sampleRate, const U32 outRate, const float gain)
+  : sampleRate_{sampleRate},
+    ring_(RING_FRAMES * 2),
+    resampler_(sampleRate, outRate),
+    gain_{gain},
+    dropped_{0} { }
+
+double AudioChannel::sample_rate() const noexcept { return sampleRate_; }
+
+std::size_t AudioChannel::submit(std::span<const float> frames) {
+  if(frames.size() % 2 != 0) {
+    throw std::invalid_argument("AudioChannel input must be whole stereo frames");
+  }
+
+  // The ring's capacity is even and only whole frames are ever pushed or popped, so this never
+  // splits a frame
+  const std::size_t pushed = ring_.push(frames) / 2;
+  dropped_.fetch_add(frames.size() / 2 - pushed, std::memory_order_relaxed);
+  return pushed;
+}
+
+void AudioChannel::set_gain(const float gain) noexcept {
+  gain_.store(gain, std::memory_order_relaxed);
+}
+
+float AudioChannel::gain() const noexcept { return gain_.load(std::memory_order_relaxed); }
+
+U64 AudioChannel::dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+AudioEngine::AudioEngine(ILogger &logger, msg::MailboxRouter &mbrouter, IAudioSink &sink)
+  : Subsystem(logger, util::TypeString<AudioEngine>, mbrouter, util::TypeHash<AudioEngine>),
+    sink_{sink},
+    selfSender_{mbrouter.get_mailbox<AudioEngine>()},
+    mixPending_{false},
+    input_(DRAIN_CHUNK),
+    smoothedFill_{0.5},
+    rateAdjust_{1.0},
+    framesMixed_{0} {
+  receiver_.on(msg::MessageType::AUDIO_MIX, [this] { mix_pending_(); });
+}
+
+AudioEngine::~AudioEngine() {
+  stop();
+  join();
+}
+
+AudioChannel &AudioEngine::add_channel(const double sampleRate, const float gain) {
+  if(!(sampleRate > 0.0)) {
+    throw std::invalid_argument("AudioChannel sample rates must be positive");
+  }
+
+  std::scoped_lock lck{channelsMtx_};
+  channels_.push_back(
+    std::unique_ptr<AudioChannel>(new AudioChannel(sampleRate, sink_.sample_rate(), gain)));
+
+  auto &channel = *channels_.back();
+  channel.resampler_.set_adjust(rateAdjust_.load(std::memory_order_relaxed));
+  return channel;
+}
+
+void AudioEngine::commit() {
+  if(!mixPending_.exchange(true, std::memory_order_acq_rel)) {
+    selfSender_.send_single_message(msg::MessageType::AUDIO_MIX);
+  }
+}
+
+double AudioEngine::rate_adjust() const noexcept {
+  return rateAdjust_.load(std::memory_order_acquire);
+}
+
+U64 AudioEngine::frames_mixed() const noexcept {
+  return framesMixed_.load(std::memory_order_acquire);
+}
+
+void AudioEngine::mix_pending_() {
+  OML_PROFILE_SPAN("AudioEngine::mix_pending_");
+
+  // Cleared first, so that a commit() which arrives while mixing sends another message
+  mixPending_.store(false, std::memory_order_release);
+
+  std::scoped_lock lck{channelsMtx_};
+
+  update_rate_adjust_();
+
+  std::size_t numFrames = std::numeric_limits<std::size_t>::max();
+  for(auto &channel : channels_) {
+    std::size_t numSamples;
+    while((numSamples = channel->ring_.pop(input_)) > 0) {
+      channel->resampler_.push(std::span<const float>(input_).first(numSamples));
+    }
+
+    // N.B. that dropped() counts input frames, as does reset()
+    const std::size_t available = channel->resampler_.available();
+    if(available > MAX_BUFFERED_FRAMES) {
+      channel->dropped_.fetch_add(channel->resampler_.reset(), std::memory_order_relaxed);
+    }
+    else if(available > 0) {
+      numFrames = std::min(numFrames, available);
+    }
+  }
+
+  if(numFrames == std::numeric_limits<std::size_t>::max()) {
+    return;
+  }
+
+  mix_.assign(numFrames * 2, 0.0F);
+  for(auto &channel : channels_) {
+    channel->resampler_.mix_into(mix_, channel->gain());
+  }
+
+  for(float &sample : mix_) {
+    sample = std::clamp(sample, -1.0F, 1.0F);
+  }
+
+  sink_.write(mix_);
+  framesMixed_.fetch_add(numFrames, std::memory_order_release);
+}
+
+void AudioEngine::update_rate_adjust_() {
+  const auto fill = sink_.fill_level();
+  if(!fill) {
+    return;
+  }
+
+  smoothedFill_ += FILL_SMOOTHING * (*fill - smoothedFill_);
+
+  // Below half full the output is stretched, so that the queue fills up, and vice versa
+  const double error  = std::clamp(1.0 - 2.0 * smoothedFill_, -1.0, 1.0);
+  const double adjust = 1.0 + MAX_ADJUST * error;
+
+  rateAdjust_.store(adjust, std::memory_order_release);
+  for(auto &channel : channels_) {
+    channel->resampler_.set_adjust(adjust);
+  }
+}
+
+}  // namespace omulator
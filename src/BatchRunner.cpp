@@ -0,0 +1,224 @@
+#include "omulator/BatchRunner.hpp"
+
+#include "omulator/util/Profiler.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace omulator {
+
+BatchRunner::BatchRunner(ILogger &logger, di::Injector &injector, const std::size_t numThreads)
+  : logger_{logger},
+    injector_{injector},
+    numFrames_{0},
+    cyclesPerFrame_{0},
+    queuedTasks_{0},
+    activeSystems_{0},
+    idleWorkers_{0},
+    runId_{0},
+    stop_{false} {
+  const std::size_t threadCount =
+    numThreads == 0 ? std::max<std::size_t>(std::thread::hardware_concurrency(), 1) : numThreads;
+
+  for(std::size_t i = 0; i < threadCount; ++i) {
+    workers_.push_back(std::make_unique<Worker_>());
+  }
+
+  for(std::size_t i = 0; i < threadCount; ++i) {
+    threads_.emplace_back(&BatchRunner::worker_proc_, this, i);
+  }
+}
+
+BatchRunner::~BatchRunner() {
+  {
+    std::scoped_lock lck{poolMtx_};
+    stop_ = true;
+  }
+  workCv_.notify_all();
+
+  threads_.clear();
+}
+
+System &BatchRunner::add_system(std::string_view name) {
+  systems_.push_back(std::make_unique<System>(logger_, name, injector_));
+  return *systems_.back();
+}
+
+std::span<const U8> BatchRunner::add_rom(std::vector<U8> image) {
+  roms_.push_back(std::make_unique<std::vector<U8>>(std::move(image)));
+  return *roms_.back();
+}
+
+void BatchRunner::run(const U64 numFrames, const Cycle_t cyclesPerFrame, FrameFn_t onFrame) {
+  OML_PROFILE_SPAN("BatchRunner::run", numFrames);
+
+  if(numFrames == 0 || systems_.empty()) {
+    return;
+  }
+
+  std::stringstream ss;
+  ss << "Running " << systems_.size() << " Systems for " << numFrames << " frames on "
+     << threads_.size() << " threads";
+  logger_.debug(ss);
+
+  numFrames_      = numFrames;
+  cyclesPerFrame_ = cyclesPerFrame;
+  onFrame_        = std::move(onFrame);
+  errors_.assign(systems_.size(), nullptr);
+  activeSystems_.store(systems_.size(), std::memory_order_release);
+
+  // Spread the first frame of each System across the workers; from then on each System's tasks
+  // stay with whichever worker ran its previous frame, unless they are stolen
+  for(std::size_t i = 0; i < systems_.size(); ++i) {
+    Worker_         &worker = *workers_[i % workers_.size()];
+    std::scoped_lock lck{worker.mtx};
+    worker.tasks.push_back({i, 0});
+  }
+  queuedTasks_.fetch_add(systems_.size(), std::memory_order_seq_cst);
+
+  std::unique_lock lck{poolMtx_};
+  ++runId_;
+  workCv_.notify_all();
+  doneCv_.wait(lck, [this] { return activeSystems_.load(std::memory_order_acquire) == 0; });
+  lck.unlock();
+
+  onFrame_ = {};
+
+  for(auto &error : errors_) {
+    if(error) {
+      std::rethrow_exception(std::exchange(error, nullptr));
+    }
+  }
+}
+
+System &BatchRunner::system(const std::size_t idx) {
+  if(idx >= systems_.size()) {
+    throw std::out_of_range("BatchRunner::system index out of range");
+  }
+
+  return *systems_[idx];
+}
+
+std::size_t BatchRunner::size() const noexcept { return systems_.size(); }
+
+std::size_t BatchRunner::num_threads() const noexcept { return threads_.size(); }
+
+void BatchRunner::worker_proc_(const std::size_t workerIdx) {
+  util::profiler::set_thread_name("batch worker " + std::to_string(workerIdx));
+
+  U64 lastRunId = 0;
+  while(true) {
+    {
+      std::unique_lock lck{poolMtx_};
+      workCv_.wait(lck, [&] { return stop_ || runId_ != lastRunId; });
+      if(stop_) {
+        return;
+      }
+      lastRunId = runId_;
+    }
+
+    while(true) {
+      Task_ task;
+      if(next_task_(workerIdx, task)) {
+        run_task_(workerIdx, task);
+        continue;
+      }
+
+      // N.B. that idleWorkers_ is incremented before queuedTasks_ is checked, while push_task_ does
+      // the opposite, so a new task can't slip in without either being seen here or waking us up
+      std::unique_lock lck{poolMtx_};
+      idleWorkers_.fetch_add(1, std::memory_order_seq_cst);
+      workCv_.wait(lck, [this] {
+        return stop_ || queuedTasks_.load(std::memory_order_seq_cst) > 0
+               || activeSystems_.load(std::memory_order_acquire) == 0;
+      });
+      idleWorkers_.fetch_sub(1, std::memory_order_relaxed);
+
+      if(stop_) {
+        return;
+      }
+
+      if(activeSystems_.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+    }
+  }
+}
+
+bool BatchRunner::next_task_(const std::size_t workerIdx, Task_ &task) {
+  if(queuedTasks_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+
+  {
+    Worker_         &self = *workers_[workerIdx];
+    std::scoped_lock lck{self.mtx};
+    if(!self.tasks.empty()) {
+      task = self.tasks.back();
+      self.tasks.pop_back();
+      queuedTasks_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  for(std::size_t i = 1; i < workers_.size(); ++i) {
+    Worker_         &victim = *workers_[(workerIdx + i) % workers_.size()];
+    std::scoped_lock lck{victim.mtx};
+    if(!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      queuedTasks_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BatchRunner::push_task_(const std::size_t workerIdx, const Task_ task) {
+  {
+    Worker_         &self = *workers_[workerIdx];
+    std::scoped_lock lck{self.mtx};
+    self.tasks.push_back(task);
+  }
+  queuedTasks_.fetch_add(1, std::memory_order_seq_cst);
+
+  if(idleWorkers_.load(std::memory_order_seq_cst) > 0) {
+    { std::scoped_lock lck{poolMtx_}; }
+    workCv_.notify_one();
+  }
+}
+
+void BatchRunner::run_task_(const std::size_t workerIdx, const Task_ task) {
+  OML_PROFILE_SPAN("BatchRunner::run_task_", task.systemIdx);
+
+  System &system = *systems_[task.systemIdx];
+
+  bool failed = false;
+  try {
+    system.step(cyclesPerFrame_);
+    if(onFrame_) {
+      onFrame_(system, task.systemIdx, task.frame);
+    }
+  }
+  catch(...) {
+    errors_[task.systemIdx] = std::current_exception();
+    failed                  = true;
+  }
+
+  if(!failed && task.frame + 1 < numFrames_) {
+    push_task_(workerIdx, {task.systemIdx, task.frame + 1});
+    return;
+  }
+
+  if(activeSystems_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    { std::scoped_lock lck{poolMtx_}; }
+    doneCv_.notify_all();
+    workCv_.notify_all();
+  }
+}
+
+}  // namespace omulator
@@ -0,0 +1,178 @@
+#include "omulator/Benchmark.hpp"
+
+#include "omulator/props.hpp"
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/os_peak_rss.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr auto CYCLES_PER_SECOND_KEY = "\"cycles_per_second\"";
+
+omulator::U64 parse_frames(const std::string &str) {
+  if(str.empty()) {
+    return omulator::Benchmark::DEFAULT_FRAMES;
+  }
+
+  std::size_t        numParsed = 0;
+  unsigned long long frames    = 0;
+  try {
+    frames = std::stoull(str, &numParsed);
+  }
+  catch(const std::exception &) {
+    numParsed = 0;
+  }
+
+  if(numParsed != str.size() || frames == 0 || str.front() == '-') {
+    std::string msg = "Invalid number of benchmark frames: ";
+    msg += str;
+    throw std::runtime_error(msg);
+  }
+
+  return frames;
+}
+
+}  // namespace
+
+namespace omulator {
+
+double BenchReport::cycles_per_second() const noexcept {
+  return hostSeconds > 0.0 ? static_cast<double>(cycles) / hostSeconds : 0.0;
+}
+
+double BenchReport::frames_per_second() const noexcept {
+  return hostSeconds > 0.0 ? static_cast<double>(frames) / hostSeconds : 0.0;
+}
+
+Benchmark::Benchmark(ILogger &logger, PropertyMap &propertyMap, IClock &clock)
+  : logger_{logger},
+    propertyMap_{propertyMap},
+    clock_{clock},
+    frames_{parse_frames(propertyMap.get_prop<std::string>(props::BENCH_FRAMES).get())} { }
+
+BenchReport Benchmark::run(System &system, const Cycle_t cyclesPerFrame, FrameFn_t onFrame) {
+  OML_PROFILE_SPAN("Benchmark::run", frames_);
+
+  BenchReport report{0, frames_, 0.0, {}, 0};
+
+  system.set_component_timing(true);
+
+  TimePoint_t nextFrame = clock_.now();
+
+  const auto hostBegin = std::chrono::steady_clock::now();
+  for(U64 i = 0; i < frames_; ++i) {
+    report.cycles += system.step(cyclesPerFrame);
+    if(onFrame) {
+      onFrame(i);
+    }
+
+    nextFrame += FRAME_PERIOD;
+    clock_.sleep_until(nextFrame);
+  }
+  const auto hostEnd = std::chrono::steady_clock::now();
+
+  report.hostSeconds  = std::chrono::duration<double>(hostEnd - hostBegin).count();
+  report.peakRssBytes = util::os_peak_rss();
+
+  const ComponentList_t  &components = system.components();
+  const std::vector<U64> &ticks      = system.component_ticks();
+  const U64               totalTicks = std::accumulate(ticks.begin(), ticks.end(), U64{0});
+
+  report.componentShares.reserve(ticks.size());
+  for(std::size_t i = 0; i < ticks.size(); ++i) {
+    report.componentShares.emplace_back(
+      std::string(components[i].get().name()),
+      totalTicks == 0 ? 0.0 : static_cast<double>(ticks[i]) / static_cast<double>(totalTicks));
+  }
+
+  system.set_component_timing(false);
+
+  return report;
+}
+
+int Benchmark::check_baseline(const BenchReport &report) {
+  const std::filesystem::path baselinePath =
+    propertyMap_.get_prop<std::string>(props::BENCH_BASELINE).get();
+  if(baselinePath.empty()) {
+    return EXIT_SUCCESS;
+  }
+
+  std::ifstream ifs(baselinePath);
+  if(!ifs) {
+    std::string msg = "Failed to open benchmark baseline: ";
+    msg += baselinePath.string();
+    throw std::runtime_error(msg);
+  }
+
+  const double baseline = read_cycles_per_second(ifs);
+  const double current  = report.cycles_per_second();
+  const double change   = baseline > 0.0 ? (current - baseline) / baseline : 0.0;
+
+  std::stringstream ss;
+  ss << "Benchmark ran at " << current << " cycles/sec vs. a baseline of " << baseline << " ("
+     << change * 100.0 << "%)";
+
+  if(change < -REGRESSION_TOLERANCE) {
+    logger_.error(ss);
+    return EXIT_REGRESSION;
+  }
+
+  logger_.info(ss);
+  return EXIT_SUCCESS;
+}
+
+void Benchmark::write_json(const BenchReport &report, std::ostream &os) {
+  const auto oldFlags     = os.flags();
+  const auto oldPrecision = os.precision();
+  os.setf(std::ios::fixed, std::ios::floatfield);
+  os.precision(6);
+
+  // N.B. that Component names come from util::TypeString, so they never need to be escaped
+  os << "{\n"
+     << "  \"frames\": " << report.frames << ",\n"
+     << "  \"cycles\": " << report.cycles << ",\n"
+     << "  \"host_seconds\": " << report.hostSeconds << ",\n"
+     << "  " << CYCLES_PER_SECOND_KEY << ": " << report.cycles_per_second() << ",\n"
+     << "  \"frames_per_second\": " << report.frames_per_second() << ",\n"
+     << "  \"peak_rss_bytes\": " << report.peakRssBytes << ",\n"
+     << "  \"components\": [";
+
+  for(std::size_t i = 0; i < report.componentShares.size(); ++i) {
+    const auto &[name, share] = report.componentShares[i];
+    os << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << name << "\", \"time_share\": " << share
+       << '}';
+  }
+
+  os << (report.componentShares.empty() ? "]\n" : "\n  ]\n") << "}\n";
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
+
+double Benchmark::read_cycles_per_second(std::istream &is) {
+  const std::string json{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+
+  std::size_t pos = json.find(CYCLES_PER_SECOND_KEY);
+  if(pos != std::string::npos) {
+    pos = json.find(':', pos);
+  }
+
+  if(pos != std::string::npos) {
+    const char *const begin = json.c_str() + pos + 1;
+    char             *end   = nullptr;
+    const double      val   = std::strtod(begin, &end);
+    if(end != begin) {
+      return val;
+    }
+  }
+
+  throw std::runtime_error("Benchmark baseline does not contain a valid cycles_per_second entry");
+}
+
+}  // namespace omulator
@@ -1,12 +1,106 @@
 #include "omulator/Clock.hpp"
 
+#include "omulator/util/intrinsics.hpp"
+#include "omulator/util/os_sleep.hpp"
+
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
+namespace {
+
+/**
+ * Initial guess for the OS timer's wakeup latency; refined after every HYBRID sleep.
+ */
+constexpr omulator::S64 INITIAL_WAKEUP_LATENCY_NS = 200'000;
+
+/**
+ * Weight given to each new sample is 1 / 2^EWMA_SHIFT.
+ */
+constexpr omulator::S64 EWMA_SHIFT = 3;
+
+}  // namespace
+
 namespace omulator {
 
+Clock::Clock(const SleepStrategy sleepStrategy)
+  : sleepStrategy_{sleepStrategy},
+    avgWakeupLatencyNs_{INITIAL_WAKEUP_LATENCY_NS},
+    numSleeps_{0},
+    maxOvershootNs_{0},
+    totalOvershootNs_{0} { }
+
 TimePoint_t Clock::now() const noexcept { return std::chrono::steady_clock::now(); }
 
-void Clock::sleep_until(const TimePoint_t then) { std::this_thread::sleep_until(then); }
+void Clock::sleep_until(const TimePoint_t then) {
+  if(now() >= then) {
+    return;
+  }
+
+  if(sleepStrategy_ == SleepStrategy::HYBRID) {
+    hybrid_sleep_until_(then);
+  }
+  else {
+    std::this_thread::sleep_until(then);
+  }
+
+  record_overshoot_(std::chrono::duration_cast<std::chrono::nanoseconds>(now() - then));
+}
+
+TimePoint_t Clock::host_deadline(const TimePoint_t then) const noexcept {
+  return sleepStrategy_ == SleepStrategy::HYBRID ? then - sleep_stats().spinWindow : then;
+}
+
+Clock::SleepStats Clock::sleep_stats() const noexcept {
+  // Give the spin window in the same terms as hybrid_sleep_until_ uses it
+  const auto spinWindow = std::clamp(
+    std::chrono::nanoseconds(avgWakeupLatencyNs_.load(std::memory_order_relaxed) * 2),
+    MIN_SPIN_WINDOW,
+    MAX_SPIN_WINDOW);
+
+  return {numSleeps_.load(std::memory_order_relaxed),
+          std::chrono::nanoseconds(maxOvershootNs_.load(std::memory_order_relaxed)),
+          std::chrono::nanoseconds(totalOvershootNs_.load(std::memory_order_relaxed)),
+          spinWindow};
+}
+
+Clock::SleepStrategy Clock::sleep_strategy() const noexcept { return sleepStrategy_; }
+
+void Clock::hybrid_sleep_until_(const TimePoint_t then) {
+  // Leave twice the typical wakeup latency to spin through, so that a typical late wakeup still
+  // lands before the deadline.
+  const auto spinWindow = sleep_stats().spinWindow;
+  const auto osDeadline = then - spinWindow;
+
+  if(now() < osDeadline) {
+    util::os_sleep_until(osDeadline);
+    calibrate_(std::chrono::duration_cast<std::chrono::nanoseconds>(now() - osDeadline));
+  }
+
+  while(now() < then) {
+    OML_INTRIN_PAUSE();
+  }
+}
+
+void Clock::calibrate_(const std::chrono::nanoseconds wakeupLatency) noexcept {
+  // Several threads may share a single Clock, but losing the occasional sample to a race is
+  // harmless, so there is no need for a CAS loop here.
+  const S64 avg = avgWakeupLatencyNs_.load(std::memory_order_relaxed);
+  avgWakeupLatencyNs_.store(avg + ((wakeupLatency.count() - avg) >> EWMA_SHIFT),
+                            std::memory_order_relaxed);
+}
+
+void Clock::record_overshoot_(const std::chrono::nanoseconds overshoot) noexcept {
+  const S64 overshootNs = overshoot.count();
+
+  numSleeps_.fetch_add(1, std::memory_order_relaxed);
+  totalOvershootNs_.fetch_add(overshootNs, std::memory_order_relaxed);
+
+  S64 currentMax = maxOvershootNs_.load(std::memory_order_relaxed);
+  while(overshootNs > currentMax
+        && !maxOvershootNs_.compare_exchange_weak(
+          currentMax, overshootNs, std::memory_order_relaxed, std::memory_order_relaxed))
+  { }
+}
 
 }  // namespace omulator
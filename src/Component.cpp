@@ -15,4 +15,12 @@ Cycle_t Component::step([[maybe_unused]] const Cycle_t numCycles) {
   return 0;
 }
 
+void Component::serialize([[maybe_unused]] StateArchive &archive) {
+  /* no-op */
+}
+
+void Component::post_load() {
+  /* no-op */
+}
+
 }  // namespace omulator
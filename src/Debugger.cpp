@@ -0,0 +1,249 @@
+#include "omulator/Debugger.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace omulator {
+
+Debugger::Debugger(ILogger &logger)
+  : logger_{logger},
+    pBus_{nullptr},
+    trapsDirty_{false},
+    stopped_{false},
+    stopReason_{StopReason::NONE},
+    stopAddress_{0},
+    skipBreakpoint_{false},
+    pauseRequested_{false},
+    stepsRemaining_{NOT_STEPPING} { }
+
+Debugger::~Debugger() { detach_bus(); }
+
+void Debugger::attach_bus(MemoryBus &bus) {
+  std::scoped_lock lck{mtx_};
+  if(pBus_ != nullptr) {
+    untrap_all_();
+    pBus_->set_access_hook({});
+  }
+
+  pBus_ = &bus;
+  pBus_->set_access_hook([this](const U32 addr, const bool write) { on_access_(addr, write); });
+  sync_bus_();
+}
+
+void Debugger::detach_bus() {
+  std::scoped_lock lck{mtx_};
+  if(pBus_ == nullptr) {
+    return;
+  }
+
+  untrap_all_();
+  pBus_->set_access_hook({});
+  pBus_ = nullptr;
+}
+
+void Debugger::add_breakpoint(const U32 addr) {
+  std::scoped_lock lck{mtx_};
+  breakpoints_.insert(addr);
+}
+
+void Debugger::remove_breakpoint(const U32 addr) {
+  std::scoped_lock lck{mtx_};
+  breakpoints_.erase(addr);
+}
+
+void Debugger::add_watchpoint(const U32 addr, const WatchKind kind) {
+  std::scoped_lock lck{mtx_};
+  watchpoints_.insert_or_assign(addr, kind);
+  trapsDirty_ = true;
+}
+
+void Debugger::remove_watchpoint(const U32 addr) {
+  std::scoped_lock lck{mtx_};
+  if(watchpoints_.erase(addr) > 0) {
+    trapsDirty_ = true;
+  }
+}
+
+void Debugger::clear() {
+  std::scoped_lock lck{mtx_};
+  breakpoints_.clear();
+  watchpoints_.clear();
+  trapsDirty_ = true;
+}
+
+void Debugger::pause() {
+  std::scoped_lock lck{mtx_};
+  if(!stopped_) {
+    pauseRequested_ = true;
+  }
+}
+
+void Debugger::resume() { step(NOT_STEPPING); }
+
+void Debugger::step(const U64 count) {
+  std::scoped_lock lck{mtx_};
+
+  // A watchpoint stops the CPU after the instruction which triggered it, so the CPU is not sitting
+  // on a breakpoint which it has already stopped at
+  if(stopped_) {
+    skipBreakpoint_ = stopReason_ != StopReason::WATCHPOINT;
+  }
+
+  stopped_        = false;
+  stopReason_     = StopReason::NONE;
+  pauseRequested_ = false;
+  stepsRemaining_ = count;
+}
+
+bool Debugger::stopped() const {
+  std::scoped_lock lck{mtx_};
+  return stopped_;
+}
+
+Debugger::StopReason Debugger::stop_reason() const {
+  std::scoped_lock lck{mtx_};
+  return stopReason_;
+}
+
+U32 Debugger::stop_address() const {
+  std::scoped_lock lck{mtx_};
+  return stopAddress_;
+}
+
+std::string Debugger::status() const {
+  std::scoped_lock lck{mtx_};
+  return describe_();
+}
+
+bool Debugger::before_insn(const U32 pc) {
+  std::scoped_lock lck{mtx_};
+  if(trapsDirty_) [[unlikely]] {
+    sync_bus_();
+  }
+
+  if(stopped_) {
+    return true;
+  }
+
+  if(!std::exchange(skipBreakpoint_, false) && breakpoints_.contains(pc)) {
+    stop_(StopReason::BREAKPOINT, pc);
+    return true;
+  }
+
+  if(pauseRequested_) {
+    stop_(StopReason::PAUSE, pc);
+    return true;
+  }
+
+  if(stepsRemaining_ != NOT_STEPPING) {
+    if(stepsRemaining_ == 0) {
+      stop_(StopReason::STEP, pc);
+      return true;
+    }
+
+    --stepsRemaining_;
+  }
+
+  return false;
+}
+
+Debugger::WatchKind Debugger::parse_watch_kind(std::string_view str) {
+  if(str == "r") {
+    return WatchKind::READ;
+  }
+  if(str == "w") {
+    return WatchKind::WRITE;
+  }
+  if(str == "rw") {
+    return WatchKind::ACCESS;
+  }
+
+  std::string msg = "Unknown watchpoint kind (expected 'r', 'w' or 'rw'): ";
+  msg += str;
+  throw std::invalid_argument(msg);
+}
+
+void Debugger::on_access_(const U32 addr, const bool write) {
+  std::scoped_lock lck{mtx_};
+  if(stopped_) {
+    return;
+  }
+
+  const auto it = watchpoints_.find(addr);
+  if(it == watchpoints_.end()) {
+    return;
+  }
+
+  const auto kind = write ? WatchKind::WRITE : WatchKind::READ;
+  if((static_cast<U8>(it->second) & static_cast<U8>(kind)) != 0) {
+    stop_(StopReason::WATCHPOINT, addr);
+  }
+}
+
+void Debugger::stop_(const StopReason reason, const U32 addr) {
+  stopped_        = true;
+  stopReason_     = reason;
+  stopAddress_    = addr;
+  pauseRequested_ = false;
+  stepsRemaining_ = NOT_STEPPING;
+
+  std::stringstream ss;
+  ss << "Debugger " << describe_();
+  logger_.info(ss);
+}
+
+std::string Debugger::describe_() const {
+  if(!stopped_) {
+    return "running";
+  }
+
+  std::stringstream ss;
+  ss << "stopped ";
+  switch(stopReason_) {
+    case StopReason::BREAKPOINT:
+      ss << "at breakpoint";
+      break;
+    case StopReason::WATCHPOINT:
+      ss << "by watchpoint";
+      break;
+    case StopReason::STEP:
+      ss << "after step at";
+      break;
+    default:
+      ss << "at";
+      break;
+  }
+
+  ss << " 0x" << std::hex << std::setw(4) << std::setfill('0') << stopAddress_;
+  return ss.str();
+}
+
+void Debugger::sync_bus_() {
+  trapsDirty_ = false;
+  if(pBus_ == nullptr) {
+    return;
+  }
+
+  // Trap the new set of pages before releasing the old one, so that pages which are in both are
+  // never refreshed
+  std::vector<U32> trapped;
+  for(const auto &watchpoint : watchpoints_) {
+    pBus_->trap_page(watchpoint.first);
+    trapped.push_back(watchpoint.first);
+  }
+
+  untrap_all_();
+  trapped_ = std::move(trapped);
+}
+
+void Debugger::untrap_all_() {
+  for(const U32 addr : trapped_) {
+    pBus_->untrap_page(addr);
+  }
+
+  trapped_.clear();
+}
+
+}  // namespace omulator
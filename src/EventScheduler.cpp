@@ -0,0 +1,161 @@
+#include "omulator/EventScheduler.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace omulator {
+
+namespace {
+
+/**
+ * Rebuild the heap once stale entries make up more than this fraction of it. Bounded from below so
+ * that small heaps are simply left to drain.
+ */
+constexpr std::size_t MIN_COMPACTION_SIZE = 64;
+
+}  // namespace
+
+EventScheduler::EventScheduler() : now_{0}, nextSequence_{0}, numLive_{0} { }
+
+EventHandle EventScheduler::schedule_at(const Cycle_t cycle, Callback_t callback) {
+  U32 slot;
+  if(freeSlots_.empty()) {
+    slot = static_cast<U32>(slots_.size());
+    slots_.push_back({std::move(callback), 0, true});
+
+    // Guarantees that release_slot_ never has to allocate
+    freeSlots_.reserve(slots_.size());
+  }
+  else {
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    slots_[slot].callback = std::move(callback);
+    slots_[slot].live     = true;
+  }
+
+  ++numLive_;
+  push_entry_(cycle, slot);
+
+  return {slot, slots_[slot].generation};
+}
+
+EventHandle EventScheduler::schedule_in(const Cycle_t delay, Callback_t callback) {
+  return schedule_in(now_, delay, std::move(callback));
+}
+
+EventHandle EventScheduler::schedule_in(const Cycle_t from,
+                                        const Cycle_t delay,
+                                        Callback_t    callback) {
+  return schedule_at(from + delay, std::move(callback));
+}
+
+bool EventScheduler::cancel(const EventHandle handle) noexcept {
+  if(!pending(handle)) {
+    return false;
+  }
+
+  release_slot_(handle.slot);
+  return true;
+}
+
+EventHandle EventScheduler::reschedule(const EventHandle handle, const Cycle_t cycle) {
+  if(!pending(handle)) {
+    return {};
+  }
+
+  // Invalidate the existing heap entry without releasing the slot, so that the callback stays put
+  ++slots_[handle.slot].generation;
+  push_entry_(cycle, handle.slot);
+
+  return {handle.slot, slots_[handle.slot].generation};
+}
+
+bool EventScheduler::pending(const EventHandle handle) const noexcept {
+  return handle.slot < slots_.size() && slots_[handle.slot].live
+         && slots_[handle.slot].generation == handle.generation;
+}
+
+Cycle_t EventScheduler::next_event_cycle() noexcept {
+  prune_();
+  return heap_.empty() ? NO_EVENT : heap_.front().cycle;
+}
+
+void EventScheduler::run_until(const Cycle_t cycle) {
+  while(true) {
+    // N.B. that cycle may itself be NO_EVENT, e.g. to drain every pending event
+    const Cycle_t next = next_event_cycle();
+    if(next == NO_EVENT || next > cycle) {
+      break;
+    }
+
+    std::pop_heap(heap_.begin(), heap_.end(), later_);
+    const Entry_ entry = heap_.back();
+    heap_.pop_back();
+
+    // Release the slot before invoking the callback, so that the callback is free to schedule
+    // events of its own (which may reuse the slot)
+    Callback_t callback = std::move(slots_[entry.slot].callback);
+    release_slot_(entry.slot);
+
+    now_ = std::max(now_, entry.cycle);
+    callback();
+  }
+
+  now_ = std::max(now_, cycle);
+}
+
+Cycle_t EventScheduler::now() const noexcept { return now_; }
+
+void EventScheduler::set_now(const Cycle_t cycle) noexcept { now_ = cycle; }
+
+void EventScheduler::clear() noexcept {
+  for(std::size_t slot = 0; slot < slots_.size(); ++slot) {
+    if(slots_[slot].live) {
+      release_slot_(static_cast<U32>(slot));
+    }
+  }
+
+  heap_.clear();
+}
+
+std::size_t EventScheduler::size() const noexcept { return numLive_; }
+
+bool EventScheduler::later_(const Entry_ &lhs, const Entry_ &rhs) noexcept {
+  if(lhs.cycle != rhs.cycle) {
+    return lhs.cycle > rhs.cycle;
+  }
+
+  return lhs.sequence > rhs.sequence;
+}
+
+bool EventScheduler::is_stale_(const Entry_ &entry) const noexcept {
+  return !pending({entry.slot, entry.generation});
+}
+
+void EventScheduler::release_slot_(const U32 slot) noexcept {
+  Slot_ &s = slots_[slot];
+  s.callback = nullptr;
+  s.live     = false;
+  ++s.generation;
+  --numLive_;
+  freeSlots_.push_back(slot);
+}
+
+void EventScheduler::push_entry_(const Cycle_t cycle, const U32 slot) {
+  heap_.push_back({cycle, nextSequence_++, slot, slots_[slot].generation});
+  std::push_heap(heap_.begin(), heap_.end(), later_);
+}
+
+void EventScheduler::prune_() {
+  if(heap_.size() > MIN_COMPACTION_SIZE && heap_.size() > 2 * numLive_) {
+    std::erase_if(heap_, [this](const Entry_ &entry) { return is_stale_(entry); });
+    std::make_heap(heap_.begin(), heap_.end(), later_);
+  }
+
+  while(!heap_.empty() && is_stale_(heap_.front())) {
+    std::pop_heap(heap_.begin(), heap_.end(), later_);
+    heap_.pop_back();
+  }
+}
+
+}  // namespace omulator
@@ -1,12 +1,16 @@
 #include "omulator/Interpreter.hpp"
 
 #include "omulator/App.hpp"
+#include "omulator/Debugger.hpp"
 #include "omulator/ILogger.hpp"
 #include "omulator/PropertyMap.hpp"
+#include "omulator/StateHasher.hpp"
+#include "omulator/Tracer.hpp"
 #include "omulator/graphics/CoreGraphicsEngine.hpp"
 #include "omulator/msg/MailboxRouter.hpp"
 #include "omulator/msg/Message.hpp"
 #include "omulator/msg/MessageType.hpp"
+#include "omulator/util/Profiler.hpp"
 #include "omulator/util/TypeHash.hpp"
 #include "omulator/util/TypeString.hpp"
 
@@ -18,6 +22,7 @@
 #include <stdexcept>
 #include <string>
 #include <variant>
+#include <vector>
 
 using omulator::util::TypeHash;
 using omulator::util::TypeString;
@@ -74,6 +79,89 @@ Interpreter::Interpreter(di::Injector &injector)
         injector_.get<msg::MailboxRouter>().get_mailbox<App>().send_single_message(
           msg::MessageType::APP_QUIT);
       });
+
+      auto profiler = oml["profiler"].get_or_create<sol::table>();
+      profiler.set("enable", [] { util::profiler::enable(); });
+      profiler.set("disable", [] { util::profiler::disable(); });
+      profiler.set("clear", [] { util::profiler::clear(); });
+      profiler.set_function("export", [&](std::string path) {
+        try {
+          util::profiler::export_chrome_trace(path);
+        }
+        catch(const std::exception &e) {
+          logger_.error(e.what());
+        }
+      });
+
+      auto debug = oml["debug"].get_or_create<sol::table>();
+      debug.set_function("add_breakpoint",
+                         [&](U32 addr) { injector_.get<Debugger>().add_breakpoint(addr); });
+      debug.set_function("remove_breakpoint",
+                         [&](U32 addr) { injector_.get<Debugger>().remove_breakpoint(addr); });
+      debug.set_function("add_watchpoint", [&](U32 addr, std::string kind) {
+        try {
+          injector_.get<Debugger>().add_watchpoint(addr, Debugger::parse_watch_kind(kind));
+        }
+        catch(const std::exception &e) {
+          logger_.error(e.what());
+        }
+      });
+      debug.set_function("remove_watchpoint",
+                         [&](U32 addr) { injector_.get<Debugger>().remove_watchpoint(addr); });
+      debug.set("clear", [&] { injector_.get<Debugger>().clear(); });
+      debug.set("pause", [&] { injector_.get<Debugger>().pause(); });
+      debug.set("resume", [&] { injector_.get<Debugger>().resume(); });
+      debug.set_function("step", [&](sol::optional<U64> count) {
+        injector_.get<Debugger>().step(count.value_or(1));
+      });
+      debug.set("status", [&] { return injector_.get<Debugger>().status(); });
+
+      auto trace = oml["trace"].get_or_create<sol::table>();
+      trace.set_function("open", [&](std::string path, sol::optional<U64> capacity) {
+        try {
+          injector_.get<Tracer>().open(path, capacity.value_or(Tracer::DEFAULT_CAPACITY));
+        }
+        catch(const std::exception &e) {
+          logger_.error(e.what());
+        }
+      });
+      trace.set("close", [&] { injector_.get<Tracer>().close(); });
+      trace.set_function("start_at_pc", [&](U32 pc) { injector_.get<Tracer>().start_at_pc(pc); });
+      trace.set_function("stop_at_pc", [&](U32 pc) { injector_.get<Tracer>().stop_at_pc(pc); });
+      trace.set_function("start_at_cycle",
+                         [&](U64 cycle) { injector_.get<Tracer>().start_at_cycle(cycle); });
+      trace.set_function("stop_at_cycle",
+                         [&](U64 cycle) { injector_.get<Tracer>().stop_at_cycle(cycle); });
+      trace.set("clear_triggers", [&] { injector_.get<Tracer>().clear_triggers(); });
+
+      // Hash streams are written by StateHasher, e.g. with --bench-hashes
+      auto hash = oml["hash"].get_or_create<sol::table>();
+      hash.set_function("read", [&](std::string path) {
+        sol::optional<std::vector<U64>> hashes;
+        try {
+          hashes = StateHasher::read(path);
+        }
+        catch(const std::exception &e) {
+          logger_.error(e.what());
+        }
+
+        return hashes;
+      });
+      hash.set_function("compare", [&](std::string pathA, std::string pathB) {
+        sol::optional<std::size_t> frame;
+        try {
+          const auto mismatch =
+            StateHasher::first_mismatch(StateHasher::read(pathA), StateHasher::read(pathB));
+          if(mismatch) {
+            frame = *mismatch;
+          }
+        }
+        catch(const std::exception &e) {
+          logger_.error(e.what());
+        }
+
+        return frame;
+      });
     },
     [&] {}),
     injector_(injector),
@@ -0,0 +1,352 @@
+#include "omulator/MediaImage.hpp"
+
+#include "omulator/MediaReadAhead.hpp"
+#include "omulator/util/Lz4Block.hpp"
+#include "omulator/util/Profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace omulator {
+
+namespace {
+
+U64 div_round_up(const U64 num, const U64 denom) noexcept {
+  return num / denom + (num % denom != 0 ? 1 : 0);
+}
+
+}  // namespace
+
+MediaImage::MediaImage(const std::filesystem::path &path, const std::size_t cacheHunks)
+  : file_(path),
+    size_{0},
+    hunkSize_{0},
+    numHunks_{0},
+    hunkTable_{nullptr},
+    cacheHunks_{cacheHunks},
+    stats_{0, 0},
+    readAhead_{nullptr},
+    readAheadHunks_{0} {
+  if(cacheHunks_ == 0) {
+    throw std::invalid_argument("A MediaImage's hunk cache must hold at least one hunk");
+  }
+
+  // Raw images are accessed however the emulated code pleases, and hunks are read individually, so
+  // the OS' default read-ahead would mostly read data which is never used
+  file_.advise(util::MappedFile::Advice::RANDOM, 0, file_.size());
+
+  if(file_.size() < sizeof(HunkHeader)
+     || std::memcmp(file_.data(), HunkHeader::MAGIC.data(), HunkHeader::MAGIC.size()) != 0)
+  {
+    size_ = file_.size();
+    return;
+  }
+
+  HunkHeader header;
+  std::memcpy(&header, file_.data(), sizeof(header));
+  if(header.version != HunkHeader::VERSION) {
+    throw std::runtime_error("Unsupported hunked image version: " + path.string());
+  }
+
+  if(header.hunkSize == 0 || header.numHunks != div_round_up(header.imageSize, header.hunkSize)
+     || (file_.size() - sizeof(HunkHeader)) / sizeof(HunkEntry) < header.numHunks)
+  {
+    throw std::runtime_error("Malformed hunked image: " + path.string());
+  }
+
+  size_      = header.imageSize;
+  hunkSize_  = header.hunkSize;
+  numHunks_  = header.numHunks;
+  hunkTable_ = file_.data() + sizeof(HunkHeader);
+}
+
+MediaImage::~MediaImage() {
+  MediaReadAhead *readAhead;
+  {
+    std::scoped_lock lck{cacheMtx_};
+    readAhead = readAhead_;
+  }
+
+  if(readAhead != nullptr) {
+    readAhead->cancel(*this);
+  }
+}
+
+U64 MediaImage::size() const noexcept { return size_; }
+
+bool MediaImage::compressed() const noexcept { return hunkTable_ != nullptr; }
+
+std::size_t MediaImage::hunk_size() const noexcept { return hunkSize_; }
+
+std::span<const U8> MediaImage::data() const noexcept {
+  if(compressed()) {
+    return {};
+  }
+
+  return {file_.data(), file_.size()};
+}
+
+void MediaImage::read(const U64 offset, std::span<U8> out) {
+  if(offset > size_ || out.size() > size_ - offset) {
+    throw std::out_of_range("MediaImage::read range extends past the end of the image");
+  }
+
+  if(!compressed()) {
+    if(!out.empty()) {
+      std::memcpy(out.data(), file_.data() + offset, out.size());
+    }
+    return;
+  }
+
+  std::size_t done = 0;
+  while(done < out.size()) {
+    const U64         pos    = offset + done;
+    const Hunk_t      hunk   = get_hunk_(pos / hunkSize_, true);
+    const std::size_t within = pos % hunkSize_;
+    const std::size_t len    = std::min(out.size() - done, hunk->size() - within);
+
+    std::memcpy(out.data() + done, hunk->data() + within, len);
+    done += len;
+  }
+}
+
+void MediaImage::prefetch(const U64 offset, const U64 size) {
+  if(offset >= size_ || size == 0) {
+    return;
+  }
+
+  const U64 len = std::min(size, size_ - offset);
+  if(!compressed()) {
+    file_.advise(util::MappedFile::Advice::WILL_NEED, offset, len);
+    return;
+  }
+
+  const std::size_t lastHunk = (offset + len - 1) / hunkSize_;
+  for(std::size_t idx = offset / hunkSize_; idx <= lastHunk; ++idx) {
+    get_hunk_(idx, false);
+  }
+}
+
+void MediaImage::set_read_ahead(MediaReadAhead *const readAhead, const std::size_t numHunks) {
+  MediaReadAhead *prev;
+  {
+    std::scoped_lock lck{cacheMtx_};
+    prev            = readAhead_;
+    readAhead_      = readAhead;
+    readAheadHunks_ = numHunks;
+  }
+
+  if(prev != nullptr && prev != readAhead) {
+    prev->cancel(*this);
+  }
+}
+
+void MediaImage::map_into(MemoryBus &bus, const MemoryBus::Addr_t base) {
+  if(size_ == 0) {
+    return;
+  }
+
+  const std::size_t pageSize = bus.page_size();
+
+  if(!compressed()) {
+    const std::size_t whole = size_ - size_ % pageSize;
+    if(whole > 0) {
+      bus.map_rom(base, data().first(whole));
+    }
+
+    if(whole < size_) {
+      std::vector<U8> tail(pageSize, 0);
+      std::memcpy(tail.data(), file_.data() + whole, size_ - whole);
+      tailPages_.push_back(std::move(tail));
+      bus.map_rom(static_cast<MemoryBus::Addr_t>(base + whole), tailPages_.back());
+    }
+
+    return;
+  }
+
+  // Each hunk is decompressed the first time it is touched, into a page-aligned buffer which then
+  // replaces the MMIO as a ROM mapping, so that from then on it is read (and cached or compiled by
+  // the CPU) like any other ROM, and reading it never decompresses or throws. The remap is deferred
+  // until the read has returned, since the handler's own page can't change underneath it. The
+  // buffers are whole pages, so a hunk which is smaller than a page shares one with its neighbours.
+  // The whole image shares a single MMIO handler.
+  struct PageDelete {
+    std::size_t alignment;
+
+    void operator()(U8 *const p) const noexcept {
+      ::operator delete[](p, std::align_val_t{alignment});
+    }
+  };
+
+  using Buffer_t = std::unique_ptr<U8[], PageDelete>;
+
+  const std::size_t mapSize  = div_round_up(size_, pageSize) * pageSize;
+  const std::size_t unitSize = div_round_up(hunkSize_, pageSize) * pageSize;
+  auto units = std::make_shared<std::vector<Buffer_t>>(div_round_up(mapSize, unitSize));
+
+  bus.map_mmio(
+    base,
+    mapSize,
+    [this, &bus, base, pageSize, mapSize, unitSize, units](const MemoryBus::Addr_t addr) -> U8 {
+      const std::size_t offset = addr - base;
+      const std::size_t idx    = offset / unitSize;
+      const std::size_t start  = idx * unitSize;
+
+      if(!(*units)[idx]) {
+        const std::size_t len    = std::min(unitSize, mapSize - start);
+        const std::size_t filled = std::min<std::size_t>(len, size_ - start);
+
+        // N.B. that the buffer is only kept once it has been filled, so that a corrupt hunk throws
+        // again on the next access rather than reading as garbage
+        Buffer_t unit(static_cast<U8 *>(::operator new[](len, std::align_val_t{pageSize})),
+                      PageDelete{pageSize});
+        read(start, {unit.get(), filled});
+        std::fill(unit.get() + filled, unit.get() + len, U8{0});
+
+        const std::span<const U8> rom{unit.get(), len};
+        (*units)[idx] = std::move(unit);
+        bus.defer_map_change([&bus, base, start, rom] {
+          bus.map_rom(static_cast<MemoryBus::Addr_t>(base + start), rom);
+        });
+      }
+
+      return (*units)[idx][offset - start];
+    },
+    []([[maybe_unused]] const MemoryBus::Addr_t addr, [[maybe_unused]] const U8 val) { });
+}
+
+MediaImage::CacheStats MediaImage::cache_stats() const {
+  std::scoped_lock lck{cacheMtx_};
+  return stats_;
+}
+
+void MediaImage::write_hunked(const std::filesystem::path &path,
+                              std::span<const U8>          data,
+                              const std::size_t            hunkSize) {
+  if(hunkSize == 0 || hunkSize > std::numeric_limits<U32>::max()) {
+    throw std::invalid_argument("Hunk sizes must be nonzero and fit in 32 bits");
+  }
+
+  HunkHeader header{};
+  header.magic     = HunkHeader::MAGIC;
+  header.version   = HunkHeader::VERSION;
+  header.hunkSize  = static_cast<U32>(hunkSize);
+  header.imageSize = data.size();
+  header.numHunks  = div_round_up(data.size(), hunkSize);
+
+  std::vector<HunkEntry> entries(header.numHunks);
+  std::ofstream          ofs(path, std::ios::binary | std::ios::trunc);
+
+  // The table is written once the hunks have been, since their sizes aren't known until then
+  U64 pos = sizeof(HunkHeader) + entries.size() * sizeof(HunkEntry);
+  ofs.seekp(static_cast<std::streamoff>(pos));
+
+  std::vector<U8> block;
+  for(std::size_t i = 0; i < entries.size(); ++i) {
+    const auto hunk = data.subspan(i * hunkSize, std::min(hunkSize, data.size() - i * hunkSize));
+
+    block.clear();
+    util::lz4_compress(hunk, block);
+
+    const bool compress = block.size() < hunk.size();
+    const auto stored   = compress ? std::span<const U8>(block) : hunk;
+    const U32  flags    = compress ? HunkEntry::COMPRESSED : 0;
+    entries[i]          = {pos, static_cast<U32>(stored.size()), flags};
+
+    ofs.write(reinterpret_cast<const char *>(stored.data()),
+              static_cast<std::streamsize>(stored.size()));
+    pos += stored.size();
+  }
+
+  ofs.seekp(0);
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char *>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(HunkEntry)));
+
+  if(!ofs) {
+    throw std::runtime_error("Failed to write hunked image: " + path.string());
+  }
+}
+
+MediaImage::Hunk_t MediaImage::get_hunk_(const std::size_t idx, const bool foreground) {
+  MediaReadAhead *readAhead      = nullptr;
+  std::size_t     readAheadHunks = 0;
+  {
+    std::scoped_lock lck{cacheMtx_};
+    const auto       it = cache_.find(idx);
+    if(it != cache_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+      if(foreground) {
+        ++stats_.hits;
+      }
+      return it->second.hunk;
+    }
+
+    if(foreground) {
+      ++stats_.misses;
+      readAhead      = readAhead_;
+      readAheadHunks = readAheadHunks_;
+    }
+  }
+
+  // Kick off the read-ahead first, so that it runs alongside the decompression of this hunk
+  if(readAhead != nullptr && readAheadHunks > 0 && idx + 1 < numHunks_) {
+    readAhead->request(*this, (idx + 1) * hunkSize_, readAheadHunks * hunkSize_);
+  }
+
+  Hunk_t hunk = decompress_hunk_(idx);
+
+  std::scoped_lock lck{cacheMtx_};
+  const auto [it, inserted] = cache_.try_emplace(idx);
+  if(!inserted) {
+    // Another thread decompressed the same hunk in the meantime
+    return it->second.hunk;
+  }
+
+  lru_.push_front(idx);
+  it->second = {hunk, lru_.begin()};
+  while(cache_.size() > cacheHunks_) {
+    cache_.erase(lru_.back());
+    lru_.pop_back();
+  }
+
+  return hunk;
+}
+
+MediaImage::Hunk_t MediaImage::decompress_hunk_(const std::size_t idx) const {
+  OML_PROFILE_SPAN("MediaImage::decompress_hunk_");
+
+  HunkEntry entry;
+  std::memcpy(&entry, hunkTable_ + idx * sizeof(HunkEntry), sizeof(entry));
+
+  if(entry.offset > file_.size() || entry.size > file_.size() - entry.offset) {
+    throw std::runtime_error("Malformed hunked image: hunk " + std::to_string(idx)
+                             + " extends past the end of the file");
+  }
+
+  const std::span<const U8> src(file_.data() + entry.offset, entry.size);
+  const std::size_t         len = idx + 1 == numHunks_ ? size_ - idx * hunkSize_ : hunkSize_;
+
+  auto hunk = std::make_shared<std::vector<U8>>(len);
+  if((entry.flags & HunkEntry::COMPRESSED) != 0) {
+    util::lz4_decompress(src, *hunk);
+  }
+  else {
+    if(src.size() != len) {
+      throw std::runtime_error("Malformed hunked image: hunk " + std::to_string(idx)
+                               + " has the wrong size");
+    }
+
+    std::memcpy(hunk->data(), src.data(), len);
+  }
+
+  return hunk;
+}
+
+}  // namespace omulator
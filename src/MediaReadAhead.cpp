@@ -0,0 +1,82 @@
+#include "omulator/MediaReadAhead.hpp"
+
+#include "omulator/MediaImage.hpp"
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/TypeHash.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+namespace omulator {
+
+MediaReadAhead::MediaReadAhead(ILogger &logger, msg::MailboxRouter &mbrouter)
+  : Subsystem(logger, util::TypeString<MediaReadAhead>, mbrouter, util::TypeHash<MediaReadAhead>),
+    selfSender_{mbrouter.get_mailbox<MediaReadAhead>()},
+    completed_{0} {
+  receiver_.on(msg::MessageType::MEDIA_READ_AHEAD, [this] { drain_pending_(); });
+}
+
+MediaReadAhead::~MediaReadAhead() {
+  stop();
+  join();
+}
+
+bool MediaReadAhead::request(MediaImage &image, const U64 offset, const U64 size) {
+  {
+    std::scoped_lock lck{queueMtx_};
+    if(pending_.size() >= MAX_PENDING) {
+      return false;
+    }
+
+    pending_.push_back({&image, offset, size});
+  }
+
+  selfSender_.send_single_message(msg::MessageType::MEDIA_READ_AHEAD);
+  return true;
+}
+
+void MediaReadAhead::cancel(const MediaImage &image) {
+  {
+    std::scoped_lock lck{queueMtx_};
+    std::erase_if(pending_, [&image](const Request_ &req) { return req.image == &image; });
+  }
+
+  // Any request for the image which was already taken off the queue finishes before this returns
+  std::scoped_lock lck{workMtx_};
+}
+
+U64 MediaReadAhead::completed() const noexcept {
+  return completed_.load(std::memory_order_acquire);
+}
+
+void MediaReadAhead::drain_pending_() {
+  OML_PROFILE_SPAN("MediaReadAhead::drain_pending_");
+
+  while(true) {
+    std::scoped_lock workLck{workMtx_};
+
+    Request_ req;
+    {
+      std::scoped_lock lck{queueMtx_};
+      if(pending_.empty()) {
+        return;
+      }
+
+      req = pending_.front();
+      pending_.pop_front();
+    }
+
+    try {
+      req.image->prefetch(req.offset, req.size);
+    }
+    catch(const std::exception &e) {
+      logger_.warn(std::string("Media read-ahead failed: ") + e.what());
+    }
+
+    completed_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+}  // namespace omulator
@@ -0,0 +1,459 @@
+#include "omulator/MemoryBus.hpp"
+
+#include "omulator/StateArchive.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace omulator {
+
+MemoryBus::MemoryBus(ILogger &logger, const U32 addressBits, const U32 pageBits)
+  : Component(logger, util::TypeString<MemoryBus>),
+    addressBits_{addressBits},
+    pageBits_{pageBits},
+    addressMask_{addressBits >= 32 ? ~Addr_t{0} : static_cast<Addr_t>((U64{1} << addressBits) - 1)},
+    pageMask_{pageBits >= 32 ? ~Addr_t{0} : static_cast<Addr_t>((U64{1} << pageBits) - 1)},
+    numDirtyTrackers_{0},
+    handlerDepth_{0} {
+  if(addressBits_ > 32) {
+    throw std::invalid_argument("MemoryBus address spaces may not be larger than 32 bits");
+  }
+
+  if(pageBits_ == 0 || pageBits_ > addressBits_) {
+    throw std::invalid_argument(
+      "MemoryBus page size must be at least 2 bytes and no larger than the address space");
+  }
+
+  const std::size_t numPages = std::size_t{1} << (addressBits_ - pageBits_);
+  readPages_.assign(numPages, nullptr);
+  writePages_.assign(numPages, nullptr);
+  pageInfo_.assign(numPages, PageInfo_{PageKind::UNMAPPED, nullptr, 0});
+  watchCounts_.assign(numPages, 0);
+  trapCounts_.assign(numPages, 0);
+}
+
+std::span<U8> MemoryBus::add_ram(const Addr_t base, const std::size_t size) {
+  check_map_change_();
+  const auto [firstPage, lastPage] = page_range_(base, size);
+
+  // N.B. value-initialization, so the RAM starts out zeroed
+  auto &block = ramBlocks_.emplace_back(RamBlock_{std::unique_ptr<U8[]>(new U8[size]()), size});
+
+  for(std::size_t i = firstPage; i < lastPage; ++i) {
+    U8 *const         data    = block.data.get() + ((i - firstPage) << pageBits_);
+    const std::size_t ramPage = ramPages_.size();
+    ramPages_.push_back(RamPage_{data, NO_PAGE, numDirtyTrackers_});
+    for(auto &tracker : dirtyTrackers_) {
+      if(tracker.active) {
+        tracker.dirty.push_back(false);
+      }
+    }
+
+    update_page_(i, PageInfo_{PageKind::RAM, data, ramPage});
+    mark_dirty_(ramPage);
+  }
+
+  return {block.data.get(), size};
+}
+
+void MemoryBus::serialize(StateArchive &archive) {
+  U64 numBlocks = ramBlocks_.size();
+  archive.value(numBlocks);
+  if(numBlocks != ramBlocks_.size()) {
+    std::string msg = "Save state has a different number of MemoryBus RAM blocks: expected ";
+    msg += std::to_string(ramBlocks_.size());
+    msg += ", found ";
+    msg += std::to_string(numBlocks);
+    throw std::runtime_error(msg);
+  }
+
+  for(auto &block : ramBlocks_) {
+    archive.region({block.data.get(), block.size});
+  }
+
+  const bool haveWatchers = std::any_of(watchers_.begin(), watchers_.end(), [](const auto &w) {
+    return static_cast<bool>(w);
+  });
+
+  if(archive.loading() && numDirtyTrackers_ > 0) {
+    for(std::size_t i = 0; i < ramPages_.size(); ++i) {
+      mark_dirty_(i);
+    }
+  }
+
+  if(archive.loading() && haveWatchers) {
+    for(std::size_t i = 0; i < pageInfo_.size(); ++i) {
+      if(watchCounts_[i] > 0 && pageInfo_[i].kind == PageKind::RAM) {
+        notify_watchers_(static_cast<Addr_t>(i << pageBits_), page_size());
+      }
+    }
+  }
+}
+
+void MemoryBus::map_rom(const Addr_t base, std::span<const U8> rom) {
+  check_map_change_();
+  const auto [firstPage, lastPage] = page_range_(base, rom.size());
+
+  // The ROM is never written through this pointer; only readPages_ will refer to it
+  U8 *const data = const_cast<U8 *>(rom.data());
+
+  for(std::size_t i = firstPage; i < lastPage; ++i) {
+    update_page_(i, PageInfo_{PageKind::ROM, data + ((i - firstPage) << pageBits_), 0});
+  }
+}
+
+void MemoryBus::map_mmio(const Addr_t      base,
+                         const std::size_t size,
+                         ReadHandler_t     onRead,
+                         WriteHandler_t    onWrite) {
+  check_map_change_();
+  const auto [firstPage, lastPage] = page_range_(base, size);
+
+  if(!onRead || !onWrite) {
+    throw std::invalid_argument("MemoryBus MMIO ranges require both a read and a write handler");
+  }
+
+  const std::size_t handler = mmioHandlers_.size();
+  mmioHandlers_.push_back(MmioHandlers_{std::move(onRead), std::move(onWrite)});
+
+  for(std::size_t i = firstPage; i < lastPage; ++i) {
+    update_page_(i, PageInfo_{PageKind::MMIO, nullptr, handler});
+  }
+}
+
+void MemoryBus::unmap(const Addr_t base, const std::size_t size) {
+  check_map_change_();
+  const auto [firstPage, lastPage] = page_range_(base, size);
+
+  for(std::size_t i = firstPage; i < lastPage; ++i) {
+    update_page_(i, PageInfo_{PageKind::UNMAPPED, nullptr, 0});
+  }
+}
+
+void MemoryBus::defer_map_change(std::function<void()> change) {
+  if(!change) {
+    throw std::invalid_argument("MemoryBus map changes may not be empty");
+  }
+
+  if(handlerDepth_ > 0) {
+    deferredChanges_.push_back(std::move(change));
+  }
+  else {
+    change();
+  }
+}
+
+std::size_t MemoryBus::add_write_watcher(WriteWatcher_t watcher) {
+  if(!watcher) {
+    throw std::invalid_argument("MemoryBus write watchers may not be empty");
+  }
+
+  // Reuse the slot of a removed watcher if possible, so that IDs remain stable
+  for(std::size_t i = 0; i < watchers_.size(); ++i) {
+    if(!watchers_[i]) {
+      watchers_[i] = std::move(watcher);
+      return i;
+    }
+  }
+
+  watchers_.push_back(std::move(watcher));
+  return watchers_.size() - 1;
+}
+
+void MemoryBus::remove_write_watcher(const std::size_t id) {
+  if(id >= watchers_.size() || !watchers_[id]) {
+    throw std::invalid_argument("Attempted to remove a nonexistent MemoryBus write watcher");
+  }
+
+  watchers_[id] = nullptr;
+}
+
+void MemoryBus::watch_page(const Addr_t addr) {
+  const std::size_t pageIdx = (addr & addressMask_) >> pageBits_;
+  if(watchCounts_[pageIdx]++ == 0) {
+    refresh_page_(pageIdx);
+  }
+}
+
+void MemoryBus::unwatch_page(const Addr_t addr) {
+  const std::size_t pageIdx = (addr & addressMask_) >> pageBits_;
+  if(watchCounts_[pageIdx] == 0) {
+    throw std::runtime_error("MemoryBus::unwatch_page called for a page which is not watched");
+  }
+
+  if(--watchCounts_[pageIdx] == 0) {
+    refresh_page_(pageIdx);
+  }
+}
+
+void MemoryBus::set_access_hook(AccessHook_t hook) { accessHook_ = std::move(hook); }
+
+void MemoryBus::trap_page(const Addr_t addr) {
+  const std::size_t pageIdx = (addr & addressMask_) >> pageBits_;
+  if(trapCounts_[pageIdx]++ == 0) {
+    refresh_page_(pageIdx);
+  }
+}
+
+void MemoryBus::untrap_page(const Addr_t addr) {
+  const std::size_t pageIdx = (addr & addressMask_) >> pageBits_;
+  if(trapCounts_[pageIdx] == 0) {
+    throw std::runtime_error("MemoryBus::untrap_page called for a page which is not trapped");
+  }
+
+  if(--trapCounts_[pageIdx] == 0) {
+    refresh_page_(pageIdx);
+  }
+}
+
+std::size_t MemoryBus::add_dirty_tracker() {
+  DirtyTracker_ tracker{true, std::vector<bool>(ramPages_.size(), true), {}};
+  tracker.pages.resize(ramPages_.size());
+  std::iota(tracker.pages.begin(), tracker.pages.end(), std::size_t{0});
+  ++numDirtyTrackers_;
+
+  // As with write watchers, reuse the slot of a removed tracker if possible
+  for(std::size_t i = 0; i < dirtyTrackers_.size(); ++i) {
+    if(!dirtyTrackers_[i].active) {
+      dirtyTrackers_[i] = std::move(tracker);
+      return i;
+    }
+  }
+
+  dirtyTrackers_.push_back(std::move(tracker));
+  return dirtyTrackers_.size() - 1;
+}
+
+void MemoryBus::remove_dirty_tracker(const std::size_t id) {
+  DirtyTracker_ &tracker = dirty_tracker_(id);
+  for(std::size_t i = 0; i < ramPages_.size(); ++i) {
+    RamPage_ &page = ramPages_[i];
+    if(!tracker.dirty[i] && --page.numClean == 0 && page.busPage != NO_PAGE) {
+      refresh_page_(page.busPage);
+    }
+  }
+
+  tracker = DirtyTracker_{false, {}, {}};
+  --numDirtyTrackers_;
+}
+
+bool MemoryBus::dirty_tracking() const noexcept { return numDirtyTrackers_ > 0; }
+
+void MemoryBus::collect_dirty_pages(
+  const std::size_t                                                  id,
+  const std::function<void(const std::size_t, std::span<const U8>)> &fn) {
+  DirtyTracker_ &tracker = dirty_tracker_(id);
+
+  const std::vector<std::size_t> collected = std::exchange(tracker.pages, {});
+  for(const std::size_t i : collected) {
+    RamPage_ &page   = ramPages_[i];
+    tracker.dirty[i] = false;
+    if(++page.numClean == 1 && page.busPage != NO_PAGE) {
+      refresh_page_(page.busPage);
+    }
+
+    fn(i, {page.data, page_size()});
+  }
+}
+
+std::size_t MemoryBus::num_ram_pages() const noexcept { return ramPages_.size(); }
+
+std::vector<std::span<const U8>> MemoryBus::ram_blocks() const {
+  std::vector<std::span<const U8>> blocks;
+  blocks.reserve(ramBlocks_.size());
+  for(const auto &block : ramBlocks_) {
+    blocks.emplace_back(block.data.get(), block.size);
+  }
+
+  return blocks;
+}
+
+MemoryBus::PageKind MemoryBus::page_kind(const Addr_t addr) const noexcept {
+  return pageInfo_[(addr & addressMask_) >> pageBits_].kind;
+}
+
+U32 MemoryBus::address_bits() const noexcept { return addressBits_; }
+
+U32 MemoryBus::page_bits() const noexcept { return pageBits_; }
+
+std::size_t MemoryBus::page_size() const noexcept { return std::size_t{1} << pageBits_; }
+
+std::size_t MemoryBus::num_pages() const noexcept { return pageInfo_.size(); }
+
+U8 *const *MemoryBus::read_page_table() const noexcept { return readPages_.data(); }
+
+U8 *const *MemoryBus::write_page_table() const noexcept { return writePages_.data(); }
+
+U8 MemoryBus::read_slow_(const Addr_t addr) const {
+  const std::size_t pageIdx = addr >> pageBits_;
+  if(trapCounts_[pageIdx] > 0 && accessHook_) [[unlikely]] {
+    accessHook_(addr, false);
+  }
+
+  const PageInfo_ &info = pageInfo_[pageIdx];
+  if(info.kind == PageKind::MMIO) {
+    U8 val;
+    enter_handler_();
+    try {
+      val = mmioHandlers_[info.index].onRead(addr);
+    }
+    catch(...) {
+      leave_handler_(false);
+      throw;
+    }
+
+    leave_handler_(true);
+    return val;
+  }
+
+  // Only trapped RAM and ROM pages end up here
+  if(info.kind == PageKind::RAM || info.kind == PageKind::ROM) {
+    return info.data[addr & pageMask_];
+  }
+
+  return OPEN_BUS_VALUE;
+}
+
+void MemoryBus::write_slow_(const Addr_t addr, const U8 val) {
+  const std::size_t pageIdx = addr >> pageBits_;
+  if(trapCounts_[pageIdx] > 0 && accessHook_) [[unlikely]] {
+    accessHook_(addr, true);
+  }
+
+  const PageInfo_ &info = pageInfo_[pageIdx];
+  if(info.kind == PageKind::RAM) {
+    // Only watched, trapped or clean RAM pages end up here
+    mark_dirty_(info.index);
+
+    info.data[addr & pageMask_] = val;
+    if(watchCounts_[pageIdx] > 0) {
+      notify_watchers_(addr, 1);
+    }
+  }
+  else if(info.kind == PageKind::MMIO) {
+    enter_handler_();
+    try {
+      mmioHandlers_[info.index].onWrite(addr, val);
+    }
+    catch(...) {
+      leave_handler_(false);
+      throw;
+    }
+
+    leave_handler_(true);
+  }
+
+  // Writes to ROM and unmapped pages are dropped
+}
+
+void MemoryBus::check_map_change_() const {
+  if(handlerDepth_ > 0) {
+    throw std::logic_error(
+      "MemoryBus map changes may not be made from within an MMIO handler; use defer_map_change");
+  }
+}
+
+void MemoryBus::enter_handler_() const noexcept { ++handlerDepth_; }
+
+void MemoryBus::leave_handler_(const bool apply) const {
+  if(--handlerDepth_ > 0) {
+    return;
+  }
+
+  // Take the whole queue first, as the changes may themselves access the bus
+  std::vector<std::function<void()>> changes;
+  changes.swap(deferredChanges_);
+  if(apply) {
+    for(auto &change : changes) {
+      change();
+    }
+  }
+}
+
+std::pair<std::size_t, std::size_t> MemoryBus::page_range_(const Addr_t      base,
+                                                           const std::size_t size) const {
+  const std::size_t pageSize = page_size();
+  const std::size_t spaceEnd = std::size_t{1} << addressBits_;
+
+  if((base & pageMask_) != 0 || (size % pageSize) != 0 || size == 0) {
+    std::string msg = "MemoryBus ranges must be non-empty and aligned to the page size of ";
+    msg += std::to_string(pageSize);
+    throw std::invalid_argument(msg);
+  }
+
+  if(base >= spaceEnd || size > spaceEnd - base) {
+    throw std::invalid_argument("MemoryBus range extends past the end of the address space");
+  }
+
+  return {base >> pageBits_, (base >> pageBits_) + (size >> pageBits_)};
+}
+
+void MemoryBus::update_page_(const std::size_t pageIdx, const PageInfo_ &info) {
+  if(pageInfo_[pageIdx].kind == PageKind::RAM) {
+    ramPages_[pageInfo_[pageIdx].index].busPage = NO_PAGE;
+  }
+
+  if(info.kind == PageKind::RAM) {
+    ramPages_[info.index].busPage = pageIdx;
+  }
+
+  pageInfo_[pageIdx] = info;
+  refresh_page_(pageIdx);
+
+  if(watchCounts_[pageIdx] > 0) {
+    notify_watchers_(static_cast<Addr_t>(pageIdx << pageBits_), page_size());
+  }
+}
+
+void MemoryBus::refresh_page_(const std::size_t pageIdx) {
+  const PageInfo_ &info    = pageInfo_[pageIdx];
+  const bool       trapped = trapCounts_[pageIdx] > 0;
+  readPages_[pageIdx] =
+    ((info.kind == PageKind::RAM || info.kind == PageKind::ROM) && !trapped) ? info.data : nullptr;
+
+  // Clean pages are left out so that the first write to them after each collection is caught
+  const bool writable = info.kind == PageKind::RAM && watchCounts_[pageIdx] == 0 && !trapped
+                        && ramPages_[info.index].numClean == 0;
+  writePages_[pageIdx] = writable ? info.data : nullptr;
+}
+
+void MemoryBus::notify_watchers_(const Addr_t addr, const std::size_t size) {
+  for(const auto &watcher : watchers_) {
+    if(watcher) {
+      watcher(addr, size);
+    }
+  }
+}
+
+void MemoryBus::mark_dirty_(const std::size_t ramPage) {
+  RamPage_ &page = ramPages_[ramPage];
+  if(page.numClean == 0) {
+    return;
+  }
+
+  for(auto &tracker : dirtyTrackers_) {
+    if(tracker.active && !tracker.dirty[ramPage]) {
+      tracker.dirty[ramPage] = true;
+      tracker.pages.push_back(ramPage);
+    }
+  }
+
+  page.numClean = 0;
+  if(page.busPage != NO_PAGE) {
+    refresh_page_(page.busPage);
+  }
+}
+
+MemoryBus::DirtyTracker_ &MemoryBus::dirty_tracker_(const std::size_t id) {
+  if(id >= dirtyTrackers_.size() || !dirtyTrackers_[id].active) {
+    throw std::invalid_argument("Attempted to use a nonexistent MemoryBus dirty tracker");
+  }
+
+  return dirtyTrackers_[id];
+}
+
+}  // namespace omulator
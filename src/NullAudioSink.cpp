@@ -0,0 +1,19 @@
+#include "omulator/NullAudioSink.hpp"
+
+namespace omulator {
+
+NullAudioSink::NullAudioSink(const U32 sampleRate) : sampleRate_{sampleRate}, framesWritten_{0} { }
+
+U32 NullAudioSink::sample_rate() const noexcept { return sampleRate_; }
+
+void NullAudioSink::write(std::span<const float> frames) {
+  framesWritten_.fetch_add(frames.size() / 2, std::memory_order_acq_rel);
+}
+
+std::optional<double> NullAudioSink::fill_level() const { return std::nullopt; }
+
+U64 NullAudioSink::frames_written() const noexcept {
+  return framesWritten_.load(std::memory_order_acquire);
+}
+
+}  // namespace omulator
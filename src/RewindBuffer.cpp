@@ -0,0 +1,269 @@
+#include "omulator/RewindBuffer.hpp"
+
+#include "omulator/StateArchive.hpp"
+#include "omulator/props.hpp"
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/TypeHash.hpp"
+#include "omulator/util/TypeString.hpp"
+#include "omulator/util/XorDelta.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace omulator {
+
+RewindBuffer::RewindBuffer(ILogger &logger, msg::MailboxRouter &mbrouter, PropertyMap &propertyMap)
+  : Subsystem(logger, util::TypeString<RewindBuffer>, mbrouter, util::TypeHash<RewindBuffer>),
+    depthProp_{propertyMap.get_prop_or_default(props::REWIND_DEPTH, DEFAULT_DEPTH)},
+    budgetMbProp_{propertyMap.get_prop_or_default(props::REWIND_BUDGET_MB, DEFAULT_BUDGET_MB)},
+    selfSender_{mbrouter.get_mailbox<RewindBuffer>()},
+    bus_{nullptr},
+    dirtyTracker_{0},
+    needFullCapture_{true},
+    historyBytes_{0},
+    dropped_{0} {
+  receiver_.on(msg::MessageType::REWIND_SNAPSHOT, [this] {
+    std::scoped_lock lck{ringMtx_};
+    drain_pending_();
+  });
+}
+
+RewindBuffer::~RewindBuffer() {
+  stop();
+  join();
+  detach_bus();
+}
+
+void RewindBuffer::attach_bus(MemoryBus &bus) {
+  detach_bus();
+
+  bus_          = &bus;
+  dirtyTracker_ = bus_->add_dirty_tracker();
+  needFullCapture_.store(true);
+}
+
+void RewindBuffer::detach_bus() {
+  if(bus_ != nullptr) {
+    bus_->remove_dirty_tracker(dirtyTracker_);
+    bus_ = nullptr;
+  }
+}
+
+bool RewindBuffer::capture(System &system) {
+  OML_PROFILE_SPAN("RewindBuffer::capture");
+
+  Capture_ capture{{}, {}, 0};
+  {
+    std::scoped_lock lck{queueMtx_};
+    if(pending_.size() >= MAX_PENDING) {
+      // N.B. that the dirty pages haven't been collected, so the next capture will include them
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    if(!freeBuffers_.empty()) {
+      capture.image = std::move(freeBuffers_.back());
+      freeBuffers_.pop_back();
+    }
+  }
+
+  if(bus_ == nullptr) {
+    system.save_state(capture.image);
+  }
+  else {
+    capture_dirty_(system, capture);
+  }
+
+  {
+    std::scoped_lock lck{queueMtx_};
+    pending_.push_back(std::move(capture));
+  }
+
+  selfSender_.send_single_message(msg::MessageType::REWIND_SNAPSHOT);
+  return true;
+}
+
+bool RewindBuffer::rewind(System &system) {
+  OML_PROFILE_SPAN("RewindBuffer::rewind");
+
+  std::scoped_lock lck{ringMtx_};
+  drain_pending_();
+
+  if(latest_.empty()) {
+    return false;
+  }
+
+  system.load_state(latest_);
+
+  if(history_.empty()) {
+    historyBytes_ -= latest_.size();
+    latest_.clear();
+    return true;
+  }
+
+  Snapshot_ &prev = history_.back();
+  historyBytes_ -= latest_.size() + prev.data.size();
+  if(prev.full) {
+    latest_.swap(prev.data);
+  }
+  else {
+    util::xor_delta_apply(prev.data, latest_);
+  }
+
+  historyBytes_ += latest_.size();
+  history_.pop_back();
+  return true;
+}
+
+void RewindBuffer::clear() {
+  std::scoped_lock lck{ringMtx_};
+  drain_pending_();
+
+  latest_.clear();
+  history_.clear();
+  historyBytes_ = 0;
+  needFullCapture_.store(true);
+}
+
+std::size_t RewindBuffer::depth() {
+  std::scoped_lock lck{ringMtx_};
+  drain_pending_();
+
+  return latest_.empty() ? 0 : history_.size() + 1;
+}
+
+std::size_t RewindBuffer::memory_usage() {
+  std::scoped_lock lck{ringMtx_};
+  drain_pending_();
+
+  return historyBytes_;
+}
+
+U64 RewindBuffer::dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+void RewindBuffer::capture_dirty_(System &system, Capture_ &capture) {
+  StateArchive archive;
+  system.serialize(archive);
+
+  const auto        regions  = archive.regions();
+  const auto        offsets  = archive.region_offsets();
+  const std::size_t pageSize = bus_->page_size();
+
+  // Find where each page of RAM goes in the image, in the order in which the MemoryBus numbers them
+  std::vector<std::size_t>                        ramRegions;
+  std::vector<std::pair<std::size_t, const U8 *>> pages;
+  for(const auto block : bus_->ram_blocks()) {
+    const auto it = std::find_if(regions.begin(), regions.end(), [&](const auto region) {
+      return region.data() == block.data();
+    });
+
+    if(it == regions.end()) {
+      throw std::logic_error("The MemoryBus attached to a RewindBuffer must be part of the state");
+    }
+
+    const auto idx = static_cast<std::size_t>(it - regions.begin());
+    ramRegions.push_back(idx);
+    for(std::size_t pos = 0; pos < block.size(); pos += pageSize) {
+      pages.emplace_back(offsets[idx] + pos, block.data() + pos);
+    }
+  }
+
+  capture.image.resize(archive.image_size());
+  archive.write(capture.image, ramRegions);
+
+  std::vector<bool> dirty(pages.size(), needFullCapture_.exchange(false));
+  bus_->collect_dirty_pages(
+    dirtyTracker_,
+    [&](const std::size_t idx, [[maybe_unused]] std::span<const U8> page) { dirty[idx] = true; });
+
+  capture.stalePages.clear();
+  capture.pageSize = pageSize;
+  for(std::size_t i = 0; i < pages.size(); ++i) {
+    const auto [offset, data] = pages[i];
+    if(dirty[i]) {
+      std::memcpy(capture.image.data() + offset, data, pageSize);
+    }
+    else {
+      capture.stalePages.push_back(offset);
+    }
+  }
+}
+
+void RewindBuffer::drain_pending_() {
+  while(true) {
+    Capture_ capture{{}, {}, 0};
+    {
+      std::scoped_lock lck{queueMtx_};
+      if(pending_.empty()) {
+        return;
+      }
+
+      capture = std::move(pending_.front());
+      pending_.pop_front();
+    }
+
+    std::vector<U8> spent;
+    if(!capture.stalePages.empty() && latest_.size() != capture.image.size()) {
+      // The snapshot which the capture was taken against is gone (e.g. it was cleared in the
+      // meantime), so there is nothing to fill in the rest of RAM from
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      needFullCapture_.store(true);
+      spent = std::move(capture.image);
+    }
+    else {
+      for(const std::size_t offset : capture.stalePages) {
+        std::memcpy(capture.image.data() + offset, latest_.data() + offset, capture.pageSize);
+      }
+
+      spent = add_snapshot_(std::move(capture.image));
+    }
+
+    std::scoped_lock lck{queueMtx_};
+    if(freeBuffers_.size() < MAX_PENDING) {
+      freeBuffers_.push_back(std::move(spent));
+    }
+  }
+}
+
+std::vector<U8> RewindBuffer::add_snapshot_(std::vector<U8> image) {
+  OML_PROFILE_SPAN("RewindBuffer::add_snapshot_", image.size());
+
+  if(!latest_.empty()) {
+    Snapshot_ snapshot{{}, latest_.size() != image.size()};
+    historyBytes_ -= latest_.size();
+
+    if(snapshot.full) {
+      snapshot.data = std::move(latest_);
+    }
+    else {
+      util::xor_delta_encode(latest_, image, snapshot.data);
+      snapshot.data.shrink_to_fit();
+    }
+
+    historyBytes_ += snapshot.data.size();
+    history_.push_back(std::move(snapshot));
+  }
+
+  historyBytes_ += image.size();
+  std::swap(latest_, image);
+
+  enforce_limits_();
+
+  // N.B. that this now holds the storage for the previous snapshot, which can be reused by the next
+  // capture
+  return image;
+}
+
+void RewindBuffer::enforce_limits_() {
+  const U64 maxDepth = std::max(depthProp_.get(), U64{1});
+  const U64 maxBytes = budgetMbProp_.get() << 20;
+
+  while(!history_.empty() && (history_.size() + 1 > maxDepth || historyBytes_ > maxBytes)) {
+    historyBytes_ -= history_.front().data.size();
+    history_.pop_front();
+  }
+}
+
+}  // namespace omulator
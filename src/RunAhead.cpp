@@ -0,0 +1,117 @@
+#include "omulator/RunAhead.hpp"
+
+#include "omulator/props.hpp"
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/TypeHash.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace omulator {
+
+RunAhead::RunAhead(ILogger            &logger,
+                   msg::MailboxRouter &mbrouter,
+                   PropertyMap        &propertyMap,
+                   System             &primary,
+                   System             *secondary)
+  : Subsystem(logger, util::TypeString<RunAhead>, mbrouter, util::TypeHash<RunAhead>),
+    // Run-ahead is opt-in, so an unset property means that it is disabled
+    framesProp_{propertyMap.get_prop_or_default(props::RUN_AHEAD_FRAMES, U64{0})},
+    primary_{primary},
+    secondary_{secondary},
+    selfSender_{mbrouter.get_mailbox<RunAhead>()},
+    busy_{false},
+    secondaryFrames_{0} {
+  if(secondary == &primary) {
+    throw std::invalid_argument("RunAhead requires two distinct System instances");
+  }
+
+  receiver_.on(msg::MessageType::RUN_AHEAD_FRAME, [this] { run_secondary_(); });
+}
+
+RunAhead::~RunAhead() {
+  {
+    std::unique_lock lck{mtx_};
+    idleCv_.wait(lck, [this] { return !busy_; });
+  }
+
+  stop();
+  join();
+}
+
+void RunAhead::run_frame(const FrameFn_t &runFrame, const FrameFn_t &present) {
+  OML_PROFILE_SPAN("RunAhead::run_frame");
+
+  const U64 frames = framesProp_.get();
+
+  runFrame(primary_);
+
+  if(frames == 0) {
+    wait();
+    present(primary_);
+    return;
+  }
+
+  if(secondary_ == nullptr) {
+    primary_.save_state(stateImage_);
+    for(U64 i = 0; i < frames; ++i) {
+      runFrame(primary_);
+    }
+    present(primary_);
+    primary_.load_state(stateImage_);
+    return;
+  }
+
+  std::unique_lock lck{mtx_};
+  wait_idle_(lck);
+
+  primary_.save_state(stateImage_);
+  secondaryFrame_   = runFrame;
+  secondaryPresent_ = present;
+  secondaryFrames_  = frames;
+  busy_             = true;
+  lck.unlock();
+
+  selfSender_.send_single_message(msg::MessageType::RUN_AHEAD_FRAME);
+}
+
+void RunAhead::wait() {
+  std::unique_lock lck{mtx_};
+  wait_idle_(lck);
+}
+
+bool RunAhead::parallel() const noexcept { return secondary_ != nullptr; }
+
+void RunAhead::run_secondary_() {
+  OML_PROFILE_SPAN("RunAhead::run_secondary_");
+
+  std::exception_ptr error;
+  try {
+    secondary_->load_state(stateImage_);
+    for(U64 i = 0; i < secondaryFrames_; ++i) {
+      secondaryFrame_(*secondary_);
+    }
+    secondaryPresent_(*secondary_);
+  }
+  catch(...) {
+    error = std::current_exception();
+  }
+
+  {
+    std::scoped_lock lck{mtx_};
+    busy_  = false;
+    error_ = error;
+  }
+  idleCv_.notify_all();
+}
+
+void RunAhead::wait_idle_(std::unique_lock<std::mutex> &lck) {
+  idleCv_.wait(lck, [this] { return !busy_; });
+
+  if(error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+}  // namespace omulator
@@ -0,0 +1,301 @@
+#include "omulator/StateArchive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+
+constexpr std::size_t FIELDS_OFFSET_POS = 16;
+constexpr std::size_t TABLE_OFFSET_POS  = 32;
+constexpr std::size_t IMAGE_SIZE_POS    = 48;
+constexpr std::size_t TABLE_ENTRY_SIZE  = 16;
+
+std::size_t align_up(const std::size_t val, const std::size_t alignment) {
+  return (val + alignment - 1) / alignment * alignment;
+}
+
+template<typename T>
+void store_le(U8 *const dst, const T val) {
+  for(std::size_t i = 0; i < sizeof(T); ++i) {
+    dst[i] = static_cast<U8>(val >> (8 * i));
+  }
+}
+
+template<typename T>
+T load_le(const U8 *const src) {
+  T val = 0;
+  for(std::size_t i = 0; i < sizeof(T); ++i) {
+    val = static_cast<T>(val | (T{src[i]} << (8 * i)));
+  }
+  return val;
+}
+
+[[noreturn]] void malformed(const char *const what) {
+  std::string msg = "Malformed save state: ";
+  msg += what;
+  throw std::runtime_error(msg);
+}
+
+/**
+ * Returns true if [offset, offset + size) lies within a buffer of the given size, without
+ * overflowing.
+ */
+bool in_bounds(const U64 offset, const U64 size, const std::size_t bufSize) {
+  return offset <= bufSize && size <= bufSize - offset;
+}
+
+}  // namespace
+
+namespace omulator {
+
+StateArchive::StateArchive() : mode_{Mode::SAVE}, fieldPos_{0}, regionPos_{0} { }
+
+StateArchive::StateArchive(std::span<const U8> image)
+  : mode_{Mode::LOAD}, image_{image}, fieldPos_{0}, regionPos_{0} {
+  if(image_.size() < HEADER_SIZE) {
+    malformed("too small to contain a header");
+  }
+
+  if(!std::equal(MAGIC.begin(), MAGIC.end(), image_.begin())) {
+    malformed("bad magic number");
+  }
+
+  const U8 *const header = image_.data();
+  if(const U32 version = load_le<U32>(header + MAGIC.size()); version != VERSION) {
+    std::string msg = "Unsupported save state version: ";
+    msg += std::to_string(version);
+    throw std::runtime_error(msg);
+  }
+
+  if(load_le<U32>(header + MAGIC.size() + sizeof(U32)) != HEADER_SIZE) {
+    malformed("unexpected header size");
+  }
+
+  if(load_le<U64>(header + IMAGE_SIZE_POS) != image_.size()) {
+    malformed("the image is truncated, or has trailing data");
+  }
+
+  const U64 fieldsOffset = load_le<U64>(header + FIELDS_OFFSET_POS);
+  const U64 fieldsSize   = load_le<U64>(header + FIELDS_OFFSET_POS + sizeof(U64));
+  if(!in_bounds(fieldsOffset, fieldsSize, image_.size())) {
+    malformed("the field stream is out of bounds");
+  }
+  fieldStream_ = image_.subspan(fieldsOffset, fieldsSize);
+
+  const U64 tableOffset = load_le<U64>(header + TABLE_OFFSET_POS);
+  const U64 numRegions  = load_le<U64>(header + TABLE_OFFSET_POS + sizeof(U64));
+  if(numRegions > image_.size() / TABLE_ENTRY_SIZE
+     || !in_bounds(tableOffset, numRegions * TABLE_ENTRY_SIZE, image_.size()))
+  {
+    malformed("the region table is out of bounds");
+  }
+
+  loadRegions_.reserve(numRegions);
+  for(U64 i = 0; i < numRegions; ++i) {
+    const U8 *const entry = image_.data() + tableOffset + i * TABLE_ENTRY_SIZE;
+    const Region_   region{load_le<U64>(entry), load_le<U64>(entry + sizeof(U64))};
+
+    if(region.offset % REGION_ALIGNMENT != 0
+       || !in_bounds(region.offset, region.size, image_.size()))
+    {
+      malformed("a region is misaligned or out of bounds");
+    }
+
+    loadRegions_.push_back(region);
+  }
+}
+
+StateArchive::Mode StateArchive::mode() const noexcept { return mode_; }
+
+bool StateArchive::loading() const noexcept { return mode_ == Mode::LOAD; }
+
+void StateArchive::tag(std::string_view name) {
+  auto len = static_cast<U32>(name.size());
+  value(len);
+
+  if(mode_ == Mode::SAVE) {
+    put_({reinterpret_cast<const U8 *>(name.data()), name.size()});
+    return;
+  }
+
+  std::string found(len, '\0');
+  get_({reinterpret_cast<U8 *>(found.data()), found.size()});
+  if(found != name) {
+    std::string msg = "Save state mismatch: expected ";
+    msg += name;
+    msg += ", found ";
+    msg += found;
+    throw std::runtime_error(msg);
+  }
+}
+
+void StateArchive::region(std::span<U8> data) {
+  if(mode_ == Mode::SAVE) {
+    saveRegions_.emplace_back(data.data(), data.size());
+    return;
+  }
+
+  if(regionPos_ == loadRegions_.size()) {
+    malformed("expected more regions");
+  }
+
+  const Region_ &region = loadRegions_[regionPos_++];
+  if(region.size != data.size()) {
+    std::string msg = "Save state region size mismatch: expected ";
+    msg += std::to_string(data.size());
+    msg += " bytes, found ";
+    msg += std::to_string(region.size);
+    throw std::runtime_error(msg);
+  }
+
+  std::memcpy(data.data(), image_.data() + region.offset, data.size());
+}
+
+std::size_t StateArchive::image_size() const {
+  if(mode_ != Mode::SAVE) {
+    throw std::logic_error("StateArchive::image_size is only valid when saving");
+  }
+
+  const auto regions = layout_regions_();
+  return regions.empty() ? make_prologue_().size() : regions.back().offset + regions.back().size;
+}
+
+void StateArchive::write(std::ostream &out) const {
+  if(mode_ != Mode::SAVE) {
+    throw std::logic_error("StateArchive::write is only valid when saving");
+  }
+
+  static constexpr std::array<char, REGION_ALIGNMENT> PADDING{};
+
+  const auto prologue = make_prologue_();
+  const auto regions  = layout_regions_();
+
+  out.write(reinterpret_cast<const char *>(prologue.data()),
+            static_cast<std::streamsize>(prologue.size()));
+
+  std::size_t pos = prologue.size();
+  for(std::size_t i = 0; i < regions.size(); ++i) {
+    out.write(PADDING.data(), static_cast<std::streamsize>(regions[i].offset - pos));
+    out.write(reinterpret_cast<const char *>(saveRegions_[i].data()),
+              static_cast<std::streamsize>(regions[i].size));
+    pos = regions[i].offset + regions[i].size;
+  }
+
+  if(!out) {
+    throw std::runtime_error("Failed to write save state");
+  }
+}
+
+void StateArchive::write(std::span<U8> out) const { write(out, {}); }
+
+void StateArchive::write(std::span<U8> out, std::span<const std::size_t> skip) const {
+  if(out.size() < image_size()) {
+    throw std::invalid_argument("Buffer is too small for the save state image");
+  }
+
+  const auto prologue = make_prologue_();
+  const auto regions  = layout_regions_();
+
+  std::memcpy(out.data(), prologue.data(), prologue.size());
+
+  std::size_t pos = prologue.size();
+  for(std::size_t i = 0; i < regions.size(); ++i) {
+    std::memset(out.data() + pos, 0, regions[i].offset - pos);
+    if(std::find(skip.begin(), skip.end(), i) == skip.end()) {
+      std::memcpy(out.data() + regions[i].offset, saveRegions_[i].data(), regions[i].size);
+    }
+    pos = regions[i].offset + regions[i].size;
+  }
+}
+
+std::vector<std::size_t> StateArchive::region_offsets() const {
+  if(mode_ != Mode::SAVE) {
+    throw std::logic_error("StateArchive::region_offsets is only valid when saving");
+  }
+
+  std::vector<std::size_t> offsets;
+  for(const auto &region : layout_regions_()) {
+    offsets.push_back(region.offset);
+  }
+
+  return offsets;
+}
+
+void StateArchive::finish() const {
+  if(mode_ != Mode::LOAD) {
+    throw std::logic_error("StateArchive::finish is only valid when loading");
+  }
+
+  if(fieldPos_ != fieldStream_.size() || regionPos_ != loadRegions_.size()) {
+    malformed("the image contains more data than was loaded");
+  }
+}
+
+std::span<const U8> StateArchive::fields() const noexcept { return fields_; }
+
+std::span<const std::span<const U8>> StateArchive::regions() const noexcept {
+  return saveRegions_;
+}
+
+void StateArchive::put_(std::span<const U8> bytes) {
+  fields_.insert(fields_.end(), bytes.begin(), bytes.end());
+}
+
+void StateArchive::get_(std::span<U8> bytes) {
+  if(bytes.size() > fieldStream_.size() - fieldPos_) {
+    malformed("expected more fields");
+  }
+
+  std::memcpy(bytes.data(), fieldStream_.data() + fieldPos_, bytes.size());
+  fieldPos_ += bytes.size();
+}
+
+std::vector<U8> StateArchive::make_prologue_() const {
+  const std::size_t tableOffset = HEADER_SIZE + fields_.size();
+  const auto        regions     = layout_regions_();
+
+  std::vector<U8> prologue(tableOffset + regions.size() * TABLE_ENTRY_SIZE);
+  U8 *const       header = prologue.data();
+
+  std::copy(MAGIC.begin(), MAGIC.end(), header);
+  store_le<U32>(header + MAGIC.size(), VERSION);
+  store_le<U32>(header + MAGIC.size() + sizeof(U32), HEADER_SIZE);
+  store_le<U64>(header + FIELDS_OFFSET_POS, HEADER_SIZE);
+  store_le<U64>(header + FIELDS_OFFSET_POS + sizeof(U64), fields_.size());
+  store_le<U64>(header + TABLE_OFFSET_POS, tableOffset);
+  store_le<U64>(header + TABLE_OFFSET_POS + sizeof(U64), regions.size());
+  store_le<U64>(header + IMAGE_SIZE_POS,
+                regions.empty() ? prologue.size() : regions.back().offset + regions.back().size);
+
+  std::copy(fields_.begin(), fields_.end(), header + HEADER_SIZE);
+
+  for(std::size_t i = 0; i < regions.size(); ++i) {
+    U8 *const entry = header + tableOffset + i * TABLE_ENTRY_SIZE;
+    store_le<U64>(entry, regions[i].offset);
+    store_le<U64>(entry + sizeof(U64), regions[i].size);
+  }
+
+  return prologue;
+}
+
+std::vector<StateArchive::Region_> StateArchive::layout_regions_() const {
+  std::size_t pos = HEADER_SIZE + fields_.size() + saveRegions_.size() * TABLE_ENTRY_SIZE;
+
+  std::vector<Region_> regions;
+  regions.reserve(saveRegions_.size());
+  for(const auto &region : saveRegions_) {
+    pos = align_up(pos, REGION_ALIGNMENT);
+    regions.push_back({pos, region.size()});
+    pos += region.size();
+  }
+
+  return regions;
+}
+
+}  // namespace omulator
@@ -0,0 +1,125 @@
+#include "omulator/StateHasher.hpp"
+
+#include "omulator/StateArchive.hpp"
+#include "omulator/util/Hash64.hpp"
+#include "omulator/util/Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace omulator {
+
+StateHasher::StateHasher(System &system, MemoryBus *const bus)
+  : system_{system}, bus_{bus}, dirtyTracker_{0}, ramHash_{0} {
+  if(bus_ != nullptr) {
+    dirtyTracker_ = bus_->add_dirty_tracker();
+  }
+}
+
+StateHasher::~StateHasher() {
+  if(bus_ != nullptr) {
+    bus_->remove_dirty_tracker(dirtyTracker_);
+  }
+}
+
+U64 StateHasher::hash_frame() {
+  OML_PROFILE_SPAN("StateHasher::hash_frame");
+
+  std::vector<std::span<const U8>> ramBlocks;
+  if(bus_ != nullptr) {
+    update_ram_hash_();
+    ramBlocks = bus_->ram_blocks();
+  }
+
+  StateArchive archive;
+  system_.serialize(archive);
+
+  U64 hash = util::hash64(archive.fields());
+  for(const auto region : archive.regions()) {
+    const bool isRam = std::any_of(ramBlocks.begin(), ramBlocks.end(), [&](const auto block) {
+      return block.data() == region.data();
+    });
+
+    if(!isRam) {
+      hash = util::hash64(region, hash);
+    }
+  }
+
+  const std::array<U64, 2> parts{hash, ramHash_};
+  hash = util::hash64({reinterpret_cast<const U8 *>(parts.data()), sizeof(parts)});
+
+  hashes_.push_back(hash);
+  return hash;
+}
+
+const std::vector<U64> &StateHasher::hashes() const noexcept { return hashes_; }
+
+void StateHasher::clear() noexcept { hashes_.clear(); }
+
+void StateHasher::write(const std::filesystem::path &path) const {
+  std::ofstream ofs(path, std::ios::trunc);
+  ofs << std::hex << std::setfill('0');
+  for(const U64 hash : hashes_) {
+    ofs << std::setw(16) << hash << '\n';
+  }
+
+  if(!ofs) {
+    std::stringstream ss;
+    ss << "Failed to write hash stream: " << path;
+    throw std::runtime_error(ss.str());
+  }
+}
+
+std::vector<U64> StateHasher::read(const std::filesystem::path &path) {
+  std::ifstream ifs(path);
+  if(!ifs) {
+    std::stringstream ss;
+    ss << "Failed to open hash stream: " << path;
+    throw std::runtime_error(ss.str());
+  }
+
+  std::vector<U64> hashes;
+  std::string      line;
+  while(std::getline(ifs, line)) {
+    U64        hash;
+    const auto end    = line.data() + line.size();
+    const auto result = std::from_chars(line.data(), end, hash, 16);
+    if(line.empty() || result.ec != std::errc{} || result.ptr != end) {
+      std::stringstream ss;
+      ss << "Malformed hash stream " << path << " at line " << hashes.size() + 1;
+      throw std::runtime_error(ss.str());
+    }
+
+    hashes.push_back(hash);
+  }
+
+  return hashes;
+}
+
+std::optional<std::size_t> StateHasher::first_mismatch(std::span<const U64> a,
+                                                       std::span<const U64> b) {
+  const auto [itA, itB] = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+  if(itA == a.end() && itB == b.end()) {
+    return std::nullopt;
+  }
+
+  return static_cast<std::size_t>(itA - a.begin());
+}
+
+void StateHasher::update_ram_hash_() {
+  pageHashes_.resize(bus_->num_ram_pages(), 0);
+
+  bus_->collect_dirty_pages(dirtyTracker_, [this](const std::size_t idx, std::span<const U8> page) {
+    const U64 pageHash = util::hash64(page, idx);
+    ramHash_ += pageHash - pageHashes_[idx];
+    pageHashes_[idx] = pageHash;
+  });
+}
+
+}  // namespace omulator
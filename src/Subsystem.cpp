@@ -1,10 +1,14 @@
 #include "omulator/Subsystem.hpp"
 
+#include "omulator/util/Profiler.hpp"
 #include "omulator/util/exception_handler.hpp"
 #include "omulator/util/to_underlying.hpp"
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace omulator {
 
@@ -18,6 +22,14 @@ Subsystem::Subsystem(ILogger                  &logger,
     receiver_{mbrouter.claim_mailbox(mailboxToken)},
     name_{name},
     sender_{mbrouter.get_mailbox(mailboxToken)},
+    pTickClock_{nullptr},
+    tickPeriod_{0},
+    tickPolicy_{TickPolicy::SKIP},
+    numTicks_{0},
+    lateTicks_{0},
+    skippedTicks_{0},
+    maxLatenessNs_{0},
+    totalLatenessNs_{0},
     startSignal_{false},
     thrd_{&Subsystem::thrd_proc_, this, onStart, onEnd} {
   receiver_.on(msg::MessageType::POKE, [] { /* no-op */ });
@@ -27,13 +39,8 @@ Subsystem::Subsystem(ILogger                  &logger,
 }
 
 Subsystem::~Subsystem() {
-  // Awkward looking, but necessary in case we have a derived Subsystem constructor that throws an
-  // exception before it can call start(). We call stop() first to ensure that the stop token is
-  // set, then call start() to unblock the startSignal_ in case it needs to be signaled.
   stop();
-  start();
-
-  sender_.send_single_message(msg::MessageType::POKE);
+  join();
 }
 
 std::string_view Subsystem::name() const noexcept { return name_; }
@@ -43,16 +50,61 @@ void Subsystem::start() {
   startSignal_.notify_all();
 }
 
-void Subsystem::stop() { thrd_.request_stop(); }
+void Subsystem::stop() {
+  // request_stop() only returns true for the call which actually sets the stop token, so only one
+  // wakeup message will ever be sent.
+  if(thrd_.request_stop()) {
+    sender_.send_single_message(msg::MessageType::POKE);
+  }
+}
+
+void Subsystem::join() {
+  // Awkward looking, but necessary in case we have a derived Subsystem constructor that throws an
+  // exception before it can call start(), or a Subsystem that was never started. The thread will
+  // see the stop token as soon as the startSignal_ is signaled.
+  start();
+
+  if(thrd_.joinable()) {
+    thrd_.join();
+  }
+}
+
+TickStats Subsystem::tick_stats() const noexcept {
+  return {numTicks_.load(std::memory_order_relaxed),
+          lateTicks_.load(std::memory_order_relaxed),
+          skippedTicks_.load(std::memory_order_relaxed),
+          std::chrono::nanoseconds(maxLatenessNs_.load(std::memory_order_relaxed)),
+          std::chrono::nanoseconds(totalLatenessNs_.load(std::memory_order_relaxed))};
+}
+
+void Subsystem::on_tick(IClock                  &clock,
+                        std::chrono::nanoseconds period,
+                        std::function<void()>    callback,
+                        const TickPolicy         policy) {
+  if(period <= std::chrono::nanoseconds::zero()) {
+    throw std::invalid_argument("Subsystem::on_tick requires a positive period");
+  }
+
+  pTickClock_   = &clock;
+  tickPeriod_   = period;
+  tickCallback_ = std::move(callback);
+  tickPolicy_   = policy;
+}
 
 void Subsystem::thrd_proc_(std::function<void()> onStart, std::function<void()> onEnd) {
   // Wrap each thread in its own exception handler
   try {
     startSignal_.wait(false, std::memory_order_acquire);
+    util::profiler::set_thread_name(name_);
     onStart();
     auto stoken = thrd_.get_stop_token();
-    while(!stoken.stop_requested()) {
-      receiver_.recv();
+    if(pTickClock_ != nullptr) {
+      tick_loop_(stoken);
+    }
+    else {
+      while(!stoken.stop_requested()) {
+        receiver_.recv();
+      }
     }
     onEnd();
   }
@@ -60,4 +112,56 @@ void Subsystem::thrd_proc_(std::function<void()> onStart, std::function<void()>
     util::exception_handler();
   }
 }
+
+void Subsystem::tick_loop_(const std::stop_token &stoken) {
+  IClock     &clock    = *pTickClock_;
+  TimePoint_t nextTick = clock.now();
+
+  while(!stoken.stop_requested()) {
+    receiver_.recv(msg::RecvBehavior::NONBLOCK);
+
+    const TimePoint_t now = clock.now();
+    if(now >= nextTick) {
+      const auto lateness    = std::chrono::duration_cast<std::chrono::nanoseconds>(now - nextTick);
+      const U64  missedTicks = static_cast<U64>(lateness / tickPeriod_);
+      const U64  extraTicks =
+        tickPolicy_ == TickPolicy::CATCH_UP ? std::min(missedTicks, MAX_CATCH_UP_TICKS) : 0;
+
+      record_tick_(lateness, missedTicks, missedTicks - extraTicks);
+
+      for(U64 i = 0; i <= extraTicks && !stoken.stop_requested(); ++i) {
+        numTicks_.fetch_add(1, std::memory_order_relaxed);
+        tickCallback_();
+      }
+
+      // Stay aligned to the original schedule, regardless of how many ticks were actually run
+      nextTick += tickPeriod_ * (missedTicks + 1);
+    }
+
+    // Wait on the mailbox rather than sleeping blind, so that messages (including the POKE sent by
+    // stop()) are serviced as they arrive rather than at the next tick; sleep_until() then only
+    // covers what is left, e.g. the spin at the end of a HYBRID sleep
+    if(!receiver_.recv_until(clock.host_deadline(nextTick))) {
+      clock.sleep_until(nextTick);
+    }
+  }
+}
+
+void Subsystem::record_tick_(const std::chrono::nanoseconds lateness,
+                             const U64                      missedTicks,
+                             const U64                      skippedTicks) noexcept {
+  const S64 latenessNs = lateness.count();
+
+  if(missedTicks > 0) {
+    lateTicks_.fetch_add(1, std::memory_order_relaxed);
+  }
+  skippedTicks_.fetch_add(skippedTicks, std::memory_order_relaxed);
+  totalLatenessNs_.fetch_add(latenessNs, std::memory_order_relaxed);
+
+  // Only the underlying thread writes to this value, so no CAS loop is needed
+  if(latenessNs > maxLatenessNs_.load(std::memory_order_relaxed)) {
+    maxLatenessNs_.store(latenessNs, std::memory_order_relaxed);
+  }
+}
+
 }  // namespace omulator
@@ -1,42 +1,444 @@
 #include "omulator/System.hpp"
 
+#include "omulator/util/Profiler.hpp"
+#include "omulator/util/intrinsics.hpp"
+
+#include <algorithm>
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
 
 namespace omulator {
 
+namespace {
+
+/**
+ * Identifies the System and group being run by the current thread, if any; used by
+ * System::defer().
+ */
+thread_local const System *tlsCurrentSystem = nullptr;
+thread_local std::size_t   tlsCurrentGroup  = 0;
+
+/**
+ * Sets the thread_local variables above for the duration of a scope.
+ */
+class CurrentGroupGuard {
+public:
+  CurrentGroupGuard(const System *pSystem, const std::size_t groupIdx) noexcept
+    : prevSystem_{tlsCurrentSystem}, prevGroup_{tlsCurrentGroup} {
+    tlsCurrentSystem = pSystem;
+    tlsCurrentGroup  = groupIdx;
+  }
+
+  ~CurrentGroupGuard() {
+    tlsCurrentSystem = prevSystem_;
+    tlsCurrentGroup  = prevGroup_;
+  }
+
+  CurrentGroupGuard(const CurrentGroupGuard &)            = delete;
+  CurrentGroupGuard &operator=(const CurrentGroupGuard &) = delete;
+  CurrentGroupGuard(CurrentGroupGuard &&)                 = delete;
+  CurrentGroupGuard &operator=(CurrentGroupGuard &&)      = delete;
+
+private:
+  const System *prevSystem_;
+  std::size_t   prevGroup_;
+};
+
+}  // namespace
+
 System::System(ILogger &logger, std::string_view name, di::Injector &parentInjector)
   : Component(logger, name),
     pInjector_(parentInjector.creat<di::Injector>()),
+    scheduler_(pInjector_->get<EventScheduler>()),
+    timeComponents_(false),
+    currentCycle_(0),
+    timeslice_(1),
+    groups_(1),
+    lookahead_(0),
+    groupExecution_(GroupExecution::SERIAL),
+    epochEnd_(0),
+    stopWorkers_(false),
     componentsCreated_(false),
-    subsystemsCreated_(false) { }
+    subsystemsCreated_(false),
+    listsChecked_(false) { }
+
+System::~System() {
+  stop_workers_();
+
+  for(auto &subsys : subsystems_) {
+    subsys.get().stop();
+  }
+
+  for(auto &subsys : subsystems_) {
+    subsys.get().join();
+  }
+}
 
 di::Injector &System::get_injector() noexcept { return *pInjector_; }
 
+EventScheduler &System::get_scheduler() noexcept { return scheduler_; }
+
 Cycle_t System::step(const Cycle_t numCycles) {
-  if(components_.empty()) {
+  OML_PROFILE_SPAN("System::step", numCycles);
+
+  if(!listsChecked_) [[unlikely]] {
+    listsChecked_ = true;
+
+    if(components_.empty()) {
+      std::stringstream ss;
+      ss << "System " << name() << " has no components!" << std::endl;
+      logger_.warn(ss);
+    }
+
+    if(subsystems_.empty()) {
+      std::stringstream ss;
+      ss << "System " << name() << " has no subsystems!" << std::endl;
+      logger_.warn(ss);
+    }
+  }
+
+  const Cycle_t startCycle  = currentCycle_;
+  const Cycle_t targetCycle = startCycle + numCycles;
+
+  // Handles anything scheduled for the current cycle since the last call
+  scheduler_.run_until(currentCycle_);
+
+  while(currentCycle_ < targetCycle) {
+    if(lookahead_ == 0) {
+      const Cycle_t sliceEnd = currentCycle_ + std::min(timeslice_, targetCycle - currentCycle_);
+
+      const Cycle_t clampedEnd = std::min(sliceEnd, scheduler_.next_event_cycle());
+
+      CurrentGroupGuard guard(this, 0);
+      currentCycle_ = staticSliceRunner_ && !timeComponents_
+                        ? staticSliceRunner_(clampedEnd)
+                        : run_slice_(groups_.front(), clampedEnd);
+    }
+    else {
+      epochEnd_ = std::min(currentCycle_ + std::min(lookahead_, targetCycle - currentCycle_),
+                           scheduler_.next_event_cycle());
+
+      if(workers_.empty()) {
+        for(std::size_t i = 0; i < groups_.size(); ++i) {
+          run_epoch_(i);
+        }
+      }
+      else {
+        // The first barrier releases the workers, and the second waits for them to finish
+        pEpochBarrier_->arrive_and_wait();
+        run_epoch_(0);
+        pEpochBarrier_->arrive_and_wait();
+      }
+
+      for(auto &group : groups_) {
+        if(group.error) {
+          std::rethrow_exception(std::exchange(group.error, nullptr));
+        }
+      }
+
+      currentCycle_ = epochEnd_;
+    }
+
+    run_deferred_();
+    scheduler_.run_until(currentCycle_);
+  }
+
+  return currentCycle_ - startCycle;
+}
+
+void System::serialize(StateArchive &archive) {
+  archive.tag(name());
+  archive.value(currentCycle_);
+
+  U64 numComponents = components_.size();
+  archive.value(numComponents);
+  if(numComponents != components_.size()) {
     std::stringstream ss;
-    ss << "System " << name() << " has no components!" << std::endl;
-    logger_.warn(ss);
+    ss << "Save state for System " << name() << " has " << numComponents
+       << " components, but the System has " << components_.size();
+    throw std::runtime_error(ss.str());
+  }
+
+  for(std::size_t i = 0; i < components_.size(); ++i) {
+    Component &component = components_[i].get();
+    archive.tag(component.name());
+    archive.value(componentCycles_[i]);
+    component.serialize(archive);
+  }
+
+  for(auto &component : extraState_) {
+    archive.tag(component.get().name());
+    component.get().serialize(archive);
+  }
+}
+
+void System::register_state(Component &component) {
+  if(&component == this) {
+    throw std::invalid_argument("A System cannot be registered with itself");
   }
 
-  if(subsystems_.empty()) {
+  extraState_.push_back(component);
+}
+
+std::vector<U8> System::save_state() {
+  std::vector<U8> image;
+  save_state(image);
+  return image;
+}
+
+void System::save_state(std::vector<U8> &image) {
+  OML_PROFILE_SPAN("System::save_state");
+
+  StateArchive archive;
+  serialize(archive);
+
+  image.resize(archive.image_size());
+  archive.write(image);
+}
+
+void System::save_state(const std::filesystem::path &path) {
+  OML_PROFILE_SPAN("System::save_state");
+
+  StateArchive archive;
+  serialize(archive);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if(!out) {
     std::stringstream ss;
-    ss << "System " << name() << " has no subsystems!" << std::endl;
-    logger_.warn(ss);
+    ss << "Failed to open save state file for writing: " << path;
+    throw std::runtime_error(ss.str());
   }
 
-  Cycle_t cyclesLeft = numCycles;
+  archive.write(out);
+}
+
+void System::load_state(std::span<const U8> image) {
+  OML_PROFILE_SPAN("System::load_state");
+
+  StateArchive archive(image);
+  serialize(archive);
+  archive.finish();
 
-  while(cyclesLeft > 0) {
-    for(auto &componentRef : components_) {
-      Component &component = componentRef.get();
-      component.step(1);
+  for(auto &group : groups_) {
+    group.deferred.clear();
+  }
+
+  scheduler_.clear();
+  scheduler_.set_now(currentCycle_);
+
+  for(auto &component : components_) {
+    component.get().post_load();
+  }
+
+  for(auto &component : extraState_) {
+    component.get().post_load();
+  }
+}
+
+void System::load_state(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if(!in) {
+    std::stringstream ss;
+    ss << "Failed to open save state file: " << path;
+    throw std::runtime_error(ss.str());
+  }
+
+  std::vector<U8> image(std::filesystem::file_size(path));
+  in.read(reinterpret_cast<char *>(image.data()), static_cast<std::streamsize>(image.size()));
+  if(!in) {
+    std::stringstream ss;
+    ss << "Failed to read save state file: " << path;
+    throw std::runtime_error(ss.str());
+  }
+
+  load_state(image);
+}
+
+Cycle_t System::current_cycle() const noexcept { return currentCycle_; }
+
+Cycle_t System::timeslice() const noexcept { return timeslice_; }
+
+void System::set_timeslice(const Cycle_t timeslice) {
+  if(timeslice == 0) {
+    throw std::invalid_argument("System timeslice must be at least 1 cycle");
+  }
+
+  timeslice_ = timeslice;
+}
+
+void System::set_component_groups(const std::vector<std::vector<std::size_t>> &groups,
+                                  const Cycle_t                                lookahead,
+                                  const GroupExecution                         execution) {
+  if(lookahead == 0) {
+    throw std::invalid_argument("System lookahead must be at least 1 cycle");
+  }
+
+  std::vector<bool> seen(components_.size(), false);
+  for(const auto &group : groups) {
+    if(group.empty()) {
+      throw std::invalid_argument("System component groups cannot be empty");
+    }
+
+    for(const std::size_t idx : group) {
+      if(idx >= components_.size() || seen[idx]) {
+        std::stringstream ss;
+        ss << "Invalid or duplicate component index in System component groups: " << idx;
+        throw std::invalid_argument(ss.str());
+      }
+      seen[idx] = true;
+    }
+  }
+
+  if(std::find(seen.begin(), seen.end(), false) != seen.end()) {
+    throw std::invalid_argument("Every component must belong to a System component group");
+  }
+
+  stop_workers_();
+
+  groups_.clear();
+  for(const auto &group : groups) {
+    groups_.push_back({group, {}, nullptr});
+  }
+
+  lookahead_      = lookahead;
+  groupExecution_ = execution;
+
+  if(groupExecution_ == GroupExecution::PARALLEL && groups_.size() > 1) {
+    pEpochBarrier_ = std::make_unique<std::barrier<>>(static_cast<std::ptrdiff_t>(groups_.size()));
+    stopWorkers_   = false;
+
+    for(std::size_t i = 1; i < groups_.size(); ++i) {
+      workers_.emplace_back(&System::worker_proc_, this, i);
+    }
+  }
+}
+
+Cycle_t System::lookahead() const noexcept { return lookahead_; }
+
+void System::set_component_timing(const bool enabled) {
+  timeComponents_ = enabled;
+  componentTicks_.assign(enabled ? components_.size() : 0, 0);
+}
+
+const std::vector<U64> &System::component_ticks() const noexcept { return componentTicks_; }
+
+const ComponentList_t &System::components() const noexcept { return components_; }
+
+void System::defer(std::function<void()> action) {
+  if(tlsCurrentSystem == this) {
+    groups_[tlsCurrentGroup].deferred.push_back(std::move(action));
+  }
+  else {
+    action();
+  }
+}
+
+Cycle_t System::step_component_(const std::size_t idx, const Cycle_t numCycles) {
+  Component &component = components_[idx].get();
+  if(!timeComponents_) [[likely]] {
+    return component.step(numCycles);
+  }
+
+  const U64     begin = OML_INTRIN_RDTSC();
+  const Cycle_t taken = component.step(numCycles);
+  componentTicks_[idx] += OML_INTRIN_RDTSC() - begin;
+  return taken;
+}
+
+Cycle_t System::run_slice_(Group_ &group, const Cycle_t sliceEnd) {
+  if(group.members.empty()) {
+    return sliceEnd;
+  }
+
+  // The lead may already be past the end of the slice if it overshot a previous one, in which case
+  // the others just continue catching up to it.
+  Cycle_t &leadCycle = componentCycles_[group.members.front()];
+  if(leadCycle < sliceEnd) {
+    const Cycle_t budget = sliceEnd - leadCycle;
+    const Cycle_t taken  = step_component_(group.members.front(), budget);
+    leadCycle += taken == 0 ? budget : taken;
+  }
+
+  const Cycle_t syncPoint = leadCycle;
+
+  for(std::size_t i = 1; i < group.members.size(); ++i) {
+    const std::size_t idx            = group.members[i];
+    Cycle_t          &componentCycle = componentCycles_[idx];
+
+    while(componentCycle < syncPoint) {
+      const Cycle_t taken = step_component_(idx, syncPoint - componentCycle);
+      componentCycle      = taken == 0 ? syncPoint : componentCycle + taken;
     }
+  }
+
+  return syncPoint;
+}
+
+void System::run_epoch_(const std::size_t groupIdx) {
+  CurrentGroupGuard guard(this, groupIdx);
+  Group_           &group     = groups_[groupIdx];
+  const Cycle_t    &leadCycle = componentCycles_[group.members.front()];
+
+  try {
+    // Always run at least one slice, so that the rest of the group catches up to the lead even if
+    // the lead overshot the end of the epoch.
+    do {
+      run_slice_(group, std::min(leadCycle + timeslice_, epochEnd_));
+    } while(leadCycle < epochEnd_);
+  }
+  catch(...) {
+    group.error = std::current_exception();
+  }
+}
+
+void System::worker_proc_(const std::size_t groupIdx) {
+  util::profiler::set_thread_name(name());
+
+  while(true) {
+    pEpochBarrier_->arrive_and_wait();
+    if(stopWorkers_) {
+      return;
+    }
+
+    run_epoch_(groupIdx);
+    pEpochBarrier_->arrive_and_wait();
+  }
+}
+
+void System::run_deferred_() {
+  for(auto &group : groups_) {
+    // Deferred actions may themselves call defer(), which should run the action immediately since
+    // we are now outside of any group; swapping the list out first keeps this well-defined.
+    auto deferred = std::exchange(group.deferred, {});
+    for(auto &action : deferred) {
+      action();
+    }
+  }
+}
+
+void System::init_components_() {
+  componentCycles_.assign(components_.size(), currentCycle_);
+  componentTicks_.assign(timeComponents_ ? components_.size() : 0, 0);
+
+  groups_.assign(1, {});
+  for(std::size_t i = 0; i < components_.size(); ++i) {
+    groups_.front().members.push_back(i);
+  }
+
+  componentsCreated_ = true;
+}
 
-    --cyclesLeft;
+void System::stop_workers_() {
+  if(workers_.empty()) {
+    return;
   }
 
-  return numCycles - cyclesLeft;
+  stopWorkers_ = true;
+  pEpochBarrier_->arrive_and_wait();
+  workers_.clear();
+  pEpochBarrier_.reset();
 }
 
 }  // namespace omulator
@@ -0,0 +1,226 @@
+#include "omulator/Tracer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace omulator {
+
+bool Tracer::Triggers_::empty() const noexcept {
+  return startPcs.empty() && stopPcs.empty() && !startCycle && !stopCycle;
+}
+
+Tracer::Tracer(ILogger &logger)
+  : logger_{logger},
+    dirty_{false},
+    pendingFileChanged_{false},
+    hasTriggers_{false},
+    active_{false},
+    pHeader_{nullptr},
+    entries_{nullptr},
+    capacity_{0},
+    pos_{0},
+    count_{0} { }
+
+Tracer::~Tracer() = default;
+
+void Tracer::open(const std::filesystem::path &path, const U64 capacity) {
+  constexpr U64 MAX_CAPACITY =
+    (std::numeric_limits<std::size_t>::max() - sizeof(TraceHeader)) / sizeof(TraceEntry);
+  if(capacity == 0 || capacity > MAX_CAPACITY) {
+    throw std::invalid_argument("Invalid trace capacity: " + std::to_string(capacity));
+  }
+
+  auto file = std::make_unique<util::MappedFile>(
+    path, sizeof(TraceHeader) + static_cast<std::size_t>(capacity) * sizeof(TraceEntry));
+
+  TraceHeader header{};
+  header.magic     = TraceHeader::MAGIC;
+  header.version   = TraceHeader::VERSION;
+  header.entrySize = sizeof(TraceEntry);
+  header.capacity  = capacity;
+  header.count     = 0;
+  std::memcpy(file->data(), &header, sizeof(header));
+
+  {
+    std::scoped_lock lck{mtx_};
+    pendingFile_        = std::move(file);
+    pendingFileChanged_ = true;
+    dirty_.store(true, std::memory_order_release);
+  }
+
+  std::stringstream ss;
+  ss << "Tracing to " << path << " (" << capacity << " entries)";
+  logger_.info(ss);
+}
+
+void Tracer::close() {
+  std::scoped_lock lck{mtx_};
+  pendingFile_.reset();
+  pendingFileChanged_ = true;
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::start_at_pc(const U32 pc) {
+  std::scoped_lock lck{mtx_};
+  pendingTriggers_.startPcs.insert(pc);
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop_at_pc(const U32 pc) {
+  std::scoped_lock lck{mtx_};
+  pendingTriggers_.stopPcs.insert(pc);
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::start_at_cycle(const Cycle_t cycle) {
+  std::scoped_lock lck{mtx_};
+  pendingTriggers_.startCycle = cycle;
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop_at_cycle(const Cycle_t cycle) {
+  std::scoped_lock lck{mtx_};
+  pendingTriggers_.stopCycle = cycle;
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::clear_triggers() {
+  std::scoped_lock lck{mtx_};
+  pendingTriggers_ = {};
+  dirty_.store(true, std::memory_order_release);
+}
+
+void Tracer::apply_() {
+  std::scoped_lock lck{mtx_};
+  dirty_.store(false, std::memory_order_relaxed);
+
+  if(std::exchange(pendingFileChanged_, false)) {
+    file_ = std::move(pendingFile_);
+    if(file_) {
+      pHeader_  = reinterpret_cast<TraceHeader *>(file_->data());
+      entries_  = reinterpret_cast<TraceEntry *>(file_->data() + sizeof(TraceHeader));
+      capacity_ = pHeader_->capacity;
+    }
+    else {
+      pHeader_  = nullptr;
+      entries_  = nullptr;
+      capacity_ = 0;
+    }
+
+    pos_   = 0;
+    count_ = 0;
+  }
+
+  triggers_    = pendingTriggers_;
+  hasTriggers_ = file_ && !triggers_.empty();
+  active_      = file_ && triggers_.startPcs.empty() && !triggers_.startCycle;
+}
+
+void Tracer::check_triggers_(const Cycle_t cycle, const U32 pc) noexcept {
+  bool start = triggers_.startPcs.contains(pc);
+  if(triggers_.startCycle && cycle >= *triggers_.startCycle) {
+    start = true;
+    triggers_.startCycle.reset();
+  }
+
+  bool stop = triggers_.stopPcs.contains(pc);
+  if(triggers_.stopCycle && cycle >= *triggers_.stopCycle) {
+    stop = true;
+    triggers_.stopCycle.reset();
+  }
+
+  if(stop) {
+    active_ = false;
+  }
+  else if(start) {
+    active_ = true;
+  }
+}
+
+TraceReader::TraceReader(const std::filesystem::path &path)
+  : file_(path), entries_{nullptr}, capacity_{0}, count_{0} {
+  if(file_.size() < sizeof(TraceHeader)) {
+    throw std::runtime_error("Not a trace file: " + path.string());
+  }
+
+  TraceHeader header;
+  std::memcpy(&header, file_.data(), sizeof(header));
+  if(header.magic != TraceHeader::MAGIC) {
+    throw std::runtime_error("Not a trace file: " + path.string());
+  }
+
+  if(header.version != TraceHeader::VERSION || header.entrySize != sizeof(TraceEntry)) {
+    throw std::runtime_error("Unsupported trace file version: " + path.string());
+  }
+
+  if(header.capacity == 0
+     || (file_.size() - sizeof(TraceHeader)) / sizeof(TraceEntry) < header.capacity)
+  {
+    throw std::runtime_error("Truncated trace file: " + path.string());
+  }
+
+  entries_  = reinterpret_cast<const TraceEntry *>(file_.data() + sizeof(TraceHeader));
+  capacity_ = header.capacity;
+  count_    = header.count;
+}
+
+std::size_t TraceReader::size() const noexcept {
+  return static_cast<std::size_t>(std::min(count_, capacity_));
+}
+
+U64 TraceReader::count() const noexcept { return count_; }
+
+U64 TraceReader::first() const noexcept { return count_ - size(); }
+
+const TraceEntry &TraceReader::at(const std::size_t idx) const {
+  if(idx >= size()) {
+    throw std::out_of_range("TraceReader::at index out of range");
+  }
+
+  return entries_[(first() + idx) % capacity_];
+}
+
+void TraceReader::decode(std::ostream &os) const {
+  for(std::size_t i = 0; i < size(); ++i) {
+    os << format(first() + i, at(i)) << '\n';
+  }
+}
+
+std::string TraceReader::format(const U64 seq, const TraceEntry &entry) {
+  std::stringstream ss;
+  ss << '#' << seq << " cycle=" << entry.cycle << std::hex << std::setfill('0')
+     << " pc=0x" << std::setw(4) << entry.pc << " op=0x" << std::setw(2) << entry.opcode
+     << " regs=";
+  for(const U8 reg : entry.regs) {
+    ss << std::setw(2) << static_cast<U32>(reg);
+  }
+
+  return ss.str();
+}
+
+std::optional<U64> TraceReader::first_divergence(const TraceReader &a, const TraceReader &b) {
+  const U64 begin = std::max(a.first(), b.first());
+  const U64 end   = std::min(a.count(), b.count());
+  if(begin > end) {
+    throw std::runtime_error("The traces have no entries in common");
+  }
+
+  for(U64 seq = begin; seq < end; ++seq) {
+    if(a.at(seq - a.first()) != b.at(seq - b.first())) {
+      return seq;
+    }
+  }
+
+  if(a.count() != b.count()) {
+    return end;
+  }
+
+  return std::nullopt;
+}
+
+}  // namespace omulator
@@ -0,0 +1,68 @@
+#include "omulator/VirtualClock.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+
+namespace omulator {
+
+VirtualClock::VirtualClock(const double speedMultiplier)
+  : speedMultiplier_{speedMultiplier}, now_{0} {
+  if(speedMultiplier_ < 0.0) {
+    throw std::invalid_argument("VirtualClock speed multiplier cannot be negative");
+  }
+}
+
+TimePoint_t VirtualClock::now() const noexcept {
+  return TimePoint_t{TimePoint_t::duration{now_.load(std::memory_order_acquire)}};
+}
+
+void VirtualClock::sleep_until(const TimePoint_t then) {
+  if(then <= now()) {
+    return;
+  }
+
+  if(speedMultiplier_ != UNLIMITED) {
+    TimePoint_t hostDeadline;
+    {
+      std::scoped_lock lck{anchorMtx_};
+      if(!anchor_) {
+        anchor_ = Anchor_{hostClock_.now(), now()};
+      }
+
+      const auto virtualElapsed = std::chrono::duration<double>(then - anchor_->virt);
+      const auto hostElapsed    = std::chrono::duration_cast<TimePoint_t::duration>(
+        virtualElapsed / speedMultiplier_);
+
+      hostDeadline = anchor_->host + hostElapsed;
+    }
+
+    hostClock_.sleep_until(hostDeadline);
+  }
+
+  advance_to_(then);
+}
+
+void VirtualClock::advance(const std::chrono::nanoseconds duration) noexcept {
+  now_.fetch_add(std::chrono::duration_cast<TimePoint_t::duration>(duration).count(),
+                 std::memory_order_acq_rel);
+}
+
+void VirtualClock::reanchor() {
+  std::scoped_lock lck{anchorMtx_};
+  anchor_.reset();
+}
+
+double VirtualClock::speed_multiplier() const noexcept { return speedMultiplier_; }
+
+void VirtualClock::advance_to_(const TimePoint_t then) noexcept {
+  const TimePoint_t::rep target  = then.time_since_epoch().count();
+  TimePoint_t::rep       current = now_.load(std::memory_order_acquire);
+
+  while(current < target
+        && !now_.compare_exchange_weak(
+          current, target, std::memory_order_acq_rel, std::memory_order_acquire))
+  { }
+}
+
+}  // namespace omulator
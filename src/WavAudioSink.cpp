@@ -0,0 +1,117 @@
+#include "omulator/WavAudioSink.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using omulator::S16;
+using omulator::U16;
+using omulator::U32;
+using omulator::U8;
+
+constexpr U16 NUM_CHANNELS    = 2;
+constexpr U16 BITS_PER_SAMPLE = 16;
+constexpr U16 BLOCK_ALIGN     = NUM_CHANNELS * BITS_PER_SAMPLE / 8;
+
+constexpr std::size_t HEADER_SIZE = 44;
+
+template<typename T>
+void put_le(U8 *&dst, const T val) noexcept {
+  for(std::size_t i = 0; i < sizeof(T); ++i) {
+    *dst++ = static_cast<U8>(val >> (8 * i));
+  }
+}
+
+void put_tag(U8 *&dst, const char *const tag) noexcept {
+  for(std::size_t i = 0; i < 4; ++i) {
+    *dst++ = static_cast<U8>(tag[i]);
+  }
+}
+
+}  // namespace
+
+namespace omulator {
+
+WavAudioSink::WavAudioSink(const std::filesystem::path &path, const U32 sampleRate)
+  : path_{path},
+    ofs_(path, std::ios::binary | std::ios::trunc),
+    sampleRate_{sampleRate},
+    framesWritten_{0} {
+  if(!ofs_) {
+    throw std::runtime_error("Failed to create WAV file: " + path.string());
+  }
+
+  write_header_();
+}
+
+WavAudioSink::~WavAudioSink() {
+  try {
+    flush();
+  }
+  catch(...) {
+    // Nothing more can be done about it at this point
+  }
+}
+
+U32 WavAudioSink::sample_rate() const noexcept { return sampleRate_; }
+
+void WavAudioSink::write(std::span<const float> frames) {
+  std::vector<U8> buf(frames.size() * sizeof(S16));
+  U8             *dst = buf.data();
+  for(const float sample : frames) {
+    const float clamped = std::clamp(sample, -1.0F, 1.0F);
+    put_le(dst, static_cast<U16>(static_cast<S16>(std::lround(clamped * 32767.0F))));
+  }
+
+  ofs_.write(reinterpret_cast<const char *>(buf.data()), static_cast<std::streamsize>(buf.size()));
+  framesWritten_ += frames.size() / NUM_CHANNELS;
+}
+
+std::optional<double> WavAudioSink::fill_level() const { return std::nullopt; }
+
+void WavAudioSink::flush() {
+  const auto pos = ofs_.tellp();
+  ofs_.seekp(0);
+  write_header_();
+  ofs_.seekp(pos);
+  ofs_.flush();
+
+  if(!ofs_) {
+    throw std::runtime_error("Failed to write WAV file: " + path_.string());
+  }
+}
+
+U64 WavAudioSink::frames_written() const noexcept { return framesWritten_; }
+
+void WavAudioSink::write_header_() {
+  // The sizes are 32 bits, so very long recordings have their sizes clamped; most players stop at
+  // that point
+  const U64 dataBytes = std::min<U64>(framesWritten_ * BLOCK_ALIGN,
+                                      std::numeric_limits<U32>::max() - (HEADER_SIZE - 8));
+  const auto dataSize = static_cast<U32>(dataBytes);
+
+  std::array<U8, HEADER_SIZE> header;
+  U8                         *dst = header.data();
+  put_tag(dst, "RIFF");
+  put_le(dst, static_cast<U32>(dataSize + HEADER_SIZE - 8));
+  put_tag(dst, "WAVE");
+  put_tag(dst, "fmt ");
+  put_le(dst, U32{16});
+  put_le(dst, U16{1});
+  put_le(dst, NUM_CHANNELS);
+  put_le(dst, sampleRate_);
+  put_le(dst, sampleRate_ * U32{BLOCK_ALIGN});
+  put_le(dst, BLOCK_ALIGN);
+  put_le(dst, BITS_PER_SAMPLE);
+  put_tag(dst, "data");
+  put_le(dst, dataSize);
+
+  ofs_.write(reinterpret_cast<const char *>(header.data()), HEADER_SIZE);
+}
+
+}  // namespace omulator
@@ -0,0 +1,423 @@
+#include "omulator/cpu/Ref8.hpp"
+
+#include "Ref8Isa.hpp"
+#include "Ref8Jit.hpp"
+
+#include "omulator/Debugger.hpp"
+#include "omulator/StateArchive.hpp"
+#include "omulator/Tracer.hpp"
+#include "omulator/oml_defines.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace omulator::cpu {
+
+Ref8::Ref8(ILogger &logger, MemoryBus &bus)
+  : Component(logger, util::TypeString<Ref8>),
+    bus_{bus},
+    halted_{false},
+    instructionsRetired_{0},
+    cycles_{0},
+    execMode_{ExecMode::BLOCK_CACHE},
+    runLoop_{nullptr},
+    debugger_{nullptr},
+    tracer_{nullptr},
+    idleSkip_{false},
+    idleCyclesSkipped_{0},
+    blockCache_{bus} {
+  if(bus_.address_bits() < 16) {
+    throw std::invalid_argument("Ref8 requires a MemoryBus with at least a 16 bit address space");
+  }
+
+  update_run_loop_();
+}
+
+// Out of line, since Jit_ is incomplete in the header
+Ref8::~Ref8() = default;
+
+Cycle_t Ref8::step(const Cycle_t numCycles) {
+  Cycle_t cyclesTaken = numCycles;
+  if(!halted_) {
+    cyclesTaken = (this->*runLoop_)(numCycles);
+
+    if(halted_ && cyclesTaken < numCycles) {
+      cyclesTaken = numCycles;
+    }
+  }
+
+  cycles_ += cyclesTaken;
+  return cyclesTaken;
+}
+
+void Ref8::serialize(StateArchive &archive) {
+  archive.value(regs_.r);
+  archive.value(regs_.pc);
+  archive.value(regs_.sp);
+  archive.value(regs_.zero);
+  archive.value(regs_.carry);
+  archive.value(halted_);
+  archive.value(instructionsRetired_);
+  archive.value(cycles_);
+}
+
+void Ref8::reset() noexcept {
+  regs_   = Registers{};
+  halted_ = false;
+}
+
+Ref8::Registers &Ref8::registers() noexcept { return regs_; }
+
+const Ref8::Registers &Ref8::registers() const noexcept { return regs_; }
+
+bool Ref8::halted() const noexcept { return halted_; }
+
+Ref8::ExecMode Ref8::exec_mode() const noexcept { return execMode_; }
+
+void Ref8::set_exec_mode(const ExecMode mode) {
+  if(mode == ExecMode::JIT && !jit_) {
+    jit_ = std::make_unique<Jit_>(*this);
+    blockCache_.set_kill_hook([this](Block_t &block) { jit_->unlink(block); });
+  }
+
+  execMode_ = mode;
+  update_run_loop_();
+  blockCache_.clear();
+  blockCache_.collect_garbage();
+}
+
+U64 Ref8::instructions_retired() const noexcept { return instructionsRetired_; }
+
+Cycle_t Ref8::cycles() const noexcept { return cycles_; }
+
+bool Ref8::idle_skip() const noexcept { return idleSkip_; }
+
+void Ref8::set_idle_skip(const bool enabled) {
+  idleSkip_ = enabled;
+  blockCache_.clear();
+  blockCache_.collect_garbage();
+}
+
+void Ref8::set_idle_loop_override(const U16 pc, const bool skip) {
+  idleLoopOverrides_.insert_or_assign(pc, skip);
+  blockCache_.clear();
+  blockCache_.collect_garbage();
+}
+
+void Ref8::clear_idle_loop_overrides() {
+  idleLoopOverrides_.clear();
+  blockCache_.clear();
+  blockCache_.collect_garbage();
+}
+
+U64 Ref8::idle_cycles_skipped() const noexcept { return idleCyclesSkipped_; }
+
+void Ref8::set_debugger(Debugger *debugger) {
+  debugger_ = debugger;
+  update_run_loop_();
+}
+
+void Ref8::set_tracer(Tracer *tracer) {
+  tracer_ = tracer;
+  update_run_loop_();
+}
+
+Cycle_t Ref8::interpret_one_() {
+  const U8 opcode = Isa_::fetch8(*this);
+  ++instructionsRetired_;
+  return Isa_::Table_t::dispatch(*this, opcode);
+}
+
+Cycle_t Ref8::interpret_traced_(const Cycle_t cycle) {
+  TraceEntry *const entry = tracer_->next(cycle, regs_.pc);
+  if(entry == nullptr) {
+    return interpret_one_();
+  }
+
+  // See DEBUGGING for the layout of the registers
+  std::copy(regs_.r.begin(), regs_.r.end(), entry->regs.begin());
+  entry->regs[NUM_REGS]     = static_cast<U8>(regs_.sp);
+  entry->regs[NUM_REGS + 1] = static_cast<U8>(regs_.sp >> 8);
+  entry->regs[NUM_REGS + 2] = static_cast<U8>((regs_.zero ? 1 : 0) | (regs_.carry ? 2 : 0));
+
+  const U8 opcode = Isa_::fetch8(*this);
+  entry->opcode   = opcode;
+  ++instructionsRetired_;
+  return Isa_::Table_t::dispatch(*this, opcode);
+}
+
+template<bool DEBUG, bool TRACE>
+Cycle_t Ref8::run_interpreter_(const Cycle_t numCycles) {
+  Cycle_t cyclesTaken = 0;
+  while(cyclesTaken < numCycles && !halted_) {
+    if constexpr(DEBUG) {
+      // While the Debugger is stopped, the CPU is frozen and consumes its budget as if halted
+      if(debugger_->before_insn(regs_.pc)) {
+        return numCycles;
+      }
+    }
+
+    if constexpr(TRACE) {
+      cyclesTaken += interpret_traced_(cycles_ + cyclesTaken);
+    }
+    else {
+      cyclesTaken += interpret_one_();
+    }
+  }
+
+  return cyclesTaken;
+}
+
+OML_FORCEINLINE Cycle_t Ref8::run_block_(const Block_t &block, const Cycle_t budget) {
+  const MicroOp_ *op          = block.ops.data();
+  const MicroOp_ *end         = op + block.ops.size();
+  Cycle_t         cyclesTaken = 0;
+
+  // If the whole block fits in the budget then there is no need to check the budget after each
+  // instruction, which is the common case
+  if(budget >= block.data.cycles) [[likely]] {
+    for(; op != end; ++op) {
+      regs_.pc = op->nextPc;
+      op->run(*this, op->operand);
+      cyclesTaken += op->cycles;
+
+      // The block may have been invalidated by one of its own instructions
+      if(!block.valid) [[unlikely]] {
+        ++op;
+        break;
+      }
+    }
+
+    instructionsRetired_ += static_cast<U64>(op - block.ops.data());
+    return cyclesTaken;
+  }
+
+  // Otherwise stop as soon as the budget is used up, exactly where the interpreter would have
+  for(; op != end; ++op) {
+    regs_.pc = op->nextPc;
+    op->run(*this, op->operand);
+    cyclesTaken += op->cycles;
+    ++instructionsRetired_;
+
+    if(cyclesTaken >= budget || !block.valid) [[unlikely]] {
+      break;
+    }
+  }
+
+  return cyclesTaken;
+}
+
+Cycle_t Ref8::run_idle_loop_(const Block_t &block, const Cycle_t budget) {
+  const Registers before = regs_;
+  const Cycle_t   taken  = run_block_(block, budget);
+
+  // N.B. that the registers include the PC, so this also checks that the loop branched back to its
+  // own start
+  if(taken < budget && block.valid && !halted_ && regs_ == before
+     && (!block.data.idleLoads
+         || bus_.page_kind(Isa_::data_addr(*this)) == MemoryBus::PageKind::MMIO))
+  {
+    idleCyclesSkipped_ += budget - taken;
+    return budget;
+  }
+
+  return taken;
+}
+
+OML_FORCEINLINE Ref8::Block_t *Ref8::find_block_(const U16 pc) {
+  if(Block_t *const block = blockCache_.find(pc); block != nullptr) [[likely]] {
+    return block;
+  }
+
+  return decode_block_(pc);
+}
+
+Cycle_t Ref8::run_block_cache_(const Cycle_t numCycles) {
+  Cycle_t cyclesTaken = 0;
+  while(cyclesTaken < numCycles && !halted_) {
+    const Block_t *block = find_block_(regs_.pc);
+    if(block == nullptr) {
+      cyclesTaken += interpret_one_();
+      continue;
+    }
+
+    if(block->data.idleLoop) [[unlikely]] {
+      cyclesTaken += run_idle_loop_(*block, numCycles - cyclesTaken);
+      continue;
+    }
+
+    cyclesTaken += run_block_(*block, numCycles - cyclesTaken);
+  }
+
+  blockCache_.collect_garbage();
+  return cyclesTaken;
+}
+
+Cycle_t Ref8::run_jit_(const Cycle_t numCycles) {
+  Cycle_t cyclesTaken = 0;
+  while(cyclesTaken < numCycles && !halted_) {
+    Block_t *block = find_block_(regs_.pc);
+    if(block == nullptr) {
+      cyclesTaken += interpret_one_();
+      continue;
+    }
+
+    // Idle loops are left to the micro-ops, which can check for a fixed point after each iteration
+    if(block->data.idleLoop) [[unlikely]] {
+      cyclesTaken += run_idle_loop_(*block, numCycles - cyclesTaken);
+      continue;
+    }
+
+    if(block->data.hostCode == nullptr && ++block->data.execCount >= JIT_THRESHOLD) {
+      jit_->compile(*block);
+    }
+
+    // Recompiled blocks only run when they can run to completion, so the tail end of the budget is
+    // left to the micro-ops, which can stop after any instruction
+    const Cycle_t remaining = numCycles - cyclesTaken;
+    if(block->data.hostCode != nullptr && remaining >= block->data.cycles) [[likely]] {
+      cyclesTaken += jit_->run(*block, remaining);
+    }
+    else {
+      cyclesTaken += run_block_(*block, remaining);
+    }
+  }
+
+  blockCache_.collect_garbage();
+  return cyclesTaken;
+}
+
+Ref8::Block_t *Ref8::decode_block_(const U16 pc) {
+  const auto cacheable = [this](const U32 addr) {
+    const auto kind = bus_.page_kind(addr);
+    return kind == MemoryBus::PageKind::RAM || kind == MemoryBus::PageKind::ROM;
+  };
+
+  std::vector<MicroOp_> ops;
+  U32                   addr   = pc;
+  Cycle_t               cycles = 0;
+
+  while(ops.size() < MAX_BLOCK_OPS && cacheable(addr)) {
+    const U8            opcode = bus_.read8(addr);
+    const Isa_::OpInfo &info   = Isa_::OP_INFO[opcode];
+    const U32           next   = addr + info.length;
+
+    // Instructions which wrap around the end of memory, or which span into memory which can't be
+    // cached, are left to the interpreter
+    if(next > 0x10000 || !cacheable(next - 1)) {
+      break;
+    }
+
+    U16 operand = 0;
+    if(info.length == 2) {
+      operand = bus_.read8(addr + 1);
+    }
+    else if(info.length == 3) {
+      operand = bus_.read<U16>(addr + 1);
+    }
+
+    ops.push_back(MicroOp_{info.run, operand, static_cast<U16>(next), info.cycles, opcode});
+    addr = next;
+    cycles += info.cycles;
+
+    if(info.endsBlock) {
+      break;
+    }
+  }
+
+  if(ops.empty()) {
+    return nullptr;
+  }
+
+  BlockData_ data;
+  data.cycles = cycles;
+  detect_idle_loop_(pc, ops, data);
+
+  Block_t &block = blockCache_.insert(pc, addr, std::move(ops));
+  block.data     = data;
+  return &block;
+}
+
+void Ref8::update_run_loop_() noexcept {
+  if(debugger_ != nullptr && tracer_ != nullptr) {
+    runLoop_ = &Ref8::run_interpreter_<true, true>;
+    return;
+  }
+
+  if(debugger_ != nullptr) {
+    runLoop_ = &Ref8::run_interpreter_<true, false>;
+    return;
+  }
+
+  if(tracer_ != nullptr) {
+    runLoop_ = &Ref8::run_interpreter_<false, true>;
+    return;
+  }
+
+  switch(execMode_) {
+    case ExecMode::BLOCK_CACHE:
+      runLoop_ = &Ref8::run_block_cache_;
+      break;
+    case ExecMode::JIT:
+      runLoop_ = &Ref8::run_jit_;
+      break;
+    default:
+      runLoop_ = &Ref8::run_interpreter_<false, false>;
+      break;
+  }
+}
+
+void Ref8::detect_idle_loop_(const U16                    pc,
+                             const std::vector<MicroOp_> &ops,
+                             BlockData_                  &data) const {
+  if(!idleSkip_) [[likely]] {
+    return;
+  }
+
+  if(const auto it = idleLoopOverrides_.find(pc); it != idleLoopOverrides_.end()) {
+    data.idleLoop = it->second;
+    return;
+  }
+
+  if(ops.size() > IDLE_LOOP_MAX_OPS) {
+    return;
+  }
+
+  // Only a jump straight back to the start of the block is considered; any other branch out of the
+  // block is just a branch
+  const MicroOp_ &last = ops.back();
+  if((last.opcode & Isa_::JP.mask) != Isa_::JP.match || last.operand != pc) {
+    return;
+  }
+
+  const auto is = [](const MicroOp_ &op, const auto &pattern) {
+    return (op.opcode & pattern.mask) == pattern.match;
+  };
+
+  for(const MicroOp_ &op : ops) {
+    // CALL and HLT always end a block, so ST is the only other instruction which could have a side
+    // effect
+    if(is(op, Isa_::ST)) {
+      return;
+    }
+
+    // A loop which moves r6:r7 can load from more than one address, so it isn't considered. Every
+    // instruction which writes a register other than r0 keeps the destination in the same bits.
+    const bool writesReg = is(op, Isa_::LDI) || is(op, Isa_::INC) || is(op, Isa_::DEC)
+                           || is(op, Isa_::LD) || is(op, Isa_::MOV);
+    const U32  rd        = (op.opcode >> 3) & 0x7;
+    if(writesReg && rd >= 6) {
+      return;
+    }
+
+    data.idleLoads = data.idleLoads || is(op, Isa_::LD);
+  }
+
+  data.idleLoop = true;
+}
+
+}  // namespace omulator::cpu
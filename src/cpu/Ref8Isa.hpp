@@ -0,0 +1,257 @@
+#pragma once
+
+#include "omulator/cpu/DecodeTable.hpp"
+#include "omulator/cpu/Ref8.hpp"
+
+namespace omulator::cpu {
+
+/**
+ * The instruction set of the Ref8, shared by the interpreter (Ref8.cpp) and the recompiler
+ * (Ref8Jit.cpp). Private to the Ref8 implementation.
+ */
+struct Ref8::Isa_ {
+  static constexpr OpcodePattern NOP  = "0000 0000";
+  static constexpr OpcodePattern HLT  = "0000 0001";
+  static constexpr OpcodePattern LDI  = "00dd d010";
+  static constexpr OpcodePattern INC  = "00dd d011";
+  static constexpr OpcodePattern DEC  = "00dd d100";
+  static constexpr OpcodePattern LD   = "00dd d101";
+  static constexpr OpcodePattern ST   = "00ss s110";
+  static constexpr OpcodePattern MOV  = "01dd dsss";
+  static constexpr OpcodePattern ALU  = "10oo osss";
+  static constexpr OpcodePattern JP   = "11cc 0000";
+  static constexpr OpcodePattern CALL = "1100 0001";
+  static constexpr OpcodePattern RET  = "1100 0010";
+
+  enum class AluOp : U32 { ADD, ADC, SUB, SBC, AND, OR, XOR, CMP };
+  enum class Cond : U32 { ALWAYS, Z, NZ, C };
+
+  static U8 fetch8(Ref8 &cpu) { return cpu.bus_.read8(cpu.regs_.pc++); }
+
+  static U16 fetch16(Ref8 &cpu) {
+    const U16 val = cpu.bus_.read<U16>(cpu.regs_.pc);
+    cpu.regs_.pc  = static_cast<U16>(cpu.regs_.pc + 2);
+    return val;
+  }
+
+  static MemoryBus::Addr_t data_addr(const Ref8 &cpu) {
+    return static_cast<MemoryBus::Addr_t>((cpu.regs_.r[6] << 8) | cpu.regs_.r[7]);
+  }
+
+  /**
+   * Common base for the instruction handlers, which implement run(Ref8 &, U16 operand); run() is
+   * invoked with the PC already pointing at the next instruction. LENGTH is the size of the
+   * instruction including its operand, and ENDS_BLOCK marks instructions which may change the
+   * flow of control.
+   */
+  template<typename THandler, U8 LENGTH_, U8 CYCLES_, bool ENDS_BLOCK_ = false>
+  struct Insn {
+    static constexpr U8   LENGTH     = LENGTH_;
+    static constexpr U8   CYCLES     = CYCLES_;
+    static constexpr bool ENDS_BLOCK = ENDS_BLOCK_;
+
+    static Cycle_t exec(Ref8 &cpu) {
+      U16 operand = 0;
+      if constexpr(LENGTH == 2) {
+        operand = fetch8(cpu);
+      }
+      else if constexpr(LENGTH == 3) {
+        operand = fetch16(cpu);
+      }
+
+      THandler::run(cpu, operand);
+      return CYCLES;
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Nop : Insn<Nop<OPCODE>, 1, 1> {
+    static void run([[maybe_unused]] Ref8 &cpu, [[maybe_unused]] const U16 operand) { }
+  };
+
+  template<U32 OPCODE>
+  struct Hlt : Insn<Hlt<OPCODE>, 1, 1, true> {
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) { cpu.halted_ = true; }
+  };
+
+  template<U32 OPCODE>
+  struct Ldi : Insn<Ldi<OPCODE>, 2, 2> {
+    static constexpr U32 D = LDI.field('d', OPCODE);
+
+    static void run(Ref8 &cpu, const U16 operand) { cpu.regs_.r[D] = static_cast<U8>(operand); }
+  };
+
+  template<U32 OPCODE>
+  struct Inc : Insn<Inc<OPCODE>, 1, 1> {
+    static constexpr U32 D = INC.field('d', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      ++cpu.regs_.r[D];
+      cpu.regs_.zero = cpu.regs_.r[D] == 0;
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Dec : Insn<Dec<OPCODE>, 1, 1> {
+    static constexpr U32 D = DEC.field('d', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      --cpu.regs_.r[D];
+      cpu.regs_.zero = cpu.regs_.r[D] == 0;
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Ld : Insn<Ld<OPCODE>, 1, 2> {
+    static constexpr U32 D = LD.field('d', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      cpu.regs_.r[D] = cpu.bus_.read8(data_addr(cpu));
+    }
+  };
+
+  template<U32 OPCODE>
+  struct St : Insn<St<OPCODE>, 1, 2> {
+    static constexpr U32 S = ST.field('s', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      cpu.bus_.write8(data_addr(cpu), cpu.regs_.r[S]);
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Mov : Insn<Mov<OPCODE>, 1, 1> {
+    static constexpr U32 D = MOV.field('d', OPCODE);
+    static constexpr U32 S = MOV.field('s', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      cpu.regs_.r[D] = cpu.regs_.r[S];
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Alu : Insn<Alu<OPCODE>, 1, 1> {
+    static constexpr auto OP = static_cast<AluOp>(ALU.field('o', OPCODE));
+    static constexpr U32  S  = ALU.field('s', OPCODE);
+
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      auto     &regs = cpu.regs_;
+      const U32 a    = regs.r[0];
+      const U32 b    = regs.r[S];
+      U32       result;
+
+      if constexpr(OP == AluOp::ADD || OP == AluOp::ADC) {
+        result     = a + b + ((OP == AluOp::ADC && regs.carry) ? 1U : 0U);
+        regs.carry = result > 0xFF;
+      }
+      else if constexpr(OP == AluOp::SUB || OP == AluOp::SBC || OP == AluOp::CMP) {
+        const U32 borrow = (OP == AluOp::SBC && regs.carry) ? 1U : 0U;
+        result           = a - b - borrow;
+        regs.carry       = a < b + borrow;
+      }
+      else {
+        if constexpr(OP == AluOp::AND) {
+          result = a & b;
+        }
+        else if constexpr(OP == AluOp::OR) {
+          result = a | b;
+        }
+        else {
+          result = a ^ b;
+        }
+        regs.carry = false;
+      }
+
+      regs.zero = (result & 0xFF) == 0;
+      if constexpr(OP != AluOp::CMP) {
+        regs.r[0] = static_cast<U8>(result);
+      }
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Jp : Insn<Jp<OPCODE>, 3, 3, true> {
+    static constexpr auto COND = static_cast<Cond>(JP.field('c', OPCODE));
+
+    static void run(Ref8 &cpu, const U16 operand) {
+      bool taken;
+      if constexpr(COND == Cond::ALWAYS) {
+        taken = true;
+      }
+      else if constexpr(COND == Cond::Z) {
+        taken = cpu.regs_.zero;
+      }
+      else if constexpr(COND == Cond::NZ) {
+        taken = !cpu.regs_.zero;
+      }
+      else {
+        taken = cpu.regs_.carry;
+      }
+
+      if(taken) {
+        cpu.regs_.pc = operand;
+      }
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Call : Insn<Call<OPCODE>, 3, 5, true> {
+    static void run(Ref8 &cpu, const U16 operand) {
+      cpu.regs_.sp = static_cast<U16>(cpu.regs_.sp - 2);
+      cpu.bus_.write<U16>(cpu.regs_.sp, cpu.regs_.pc);
+      cpu.regs_.pc = operand;
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Ret : Insn<Ret<OPCODE>, 1, 3, true> {
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      cpu.regs_.pc = cpu.bus_.read<U16>(cpu.regs_.sp);
+      cpu.regs_.sp = static_cast<U16>(cpu.regs_.sp + 2);
+    }
+  };
+
+  template<U32 OPCODE>
+  struct Illegal : Insn<Illegal<OPCODE>, 1, 1, true> {
+    static void run(Ref8 &cpu, [[maybe_unused]] const U16 operand) {
+      cpu.logger_.error("Ref8 encountered an illegal opcode; halting");
+      cpu.halted_ = true;
+    }
+  };
+
+  using Table_t = DecodeTable<Ref8,
+                              8,
+                              Illegal,
+                              Op<NOP, Nop>,
+                              Op<HLT, Hlt>,
+                              Op<LDI, Ldi>,
+                              Op<INC, Inc>,
+                              Op<DEC, Dec>,
+                              Op<LD, Ld>,
+                              Op<ST, St>,
+                              Op<MOV, Mov>,
+                              Op<ALU, Alu>,
+                              Op<JP, Jp>,
+                              Op<CALL, Call>,
+                              Op<RET, Ret>>;
+
+  /**
+   * Everything needed to decode an instruction into a MicroOp_.
+   */
+  struct OpInfo {
+    void (*run)(Ref8 &, const U16);
+    U8   length;
+    U8   cycles;
+    bool endsBlock;
+  };
+
+  template<typename THandler>
+  struct SelectOpInfo {
+    static constexpr OpInfo value{
+      &THandler::run, THandler::LENGTH, THandler::CYCLES, THandler::ENDS_BLOCK};
+  };
+
+  static constexpr auto OP_INFO = Table_t::make_table<OpInfo, SelectOpInfo>();
+};
+
+}  // namespace omulator::cpu
@@ -0,0 +1,527 @@
+#include "Ref8Jit.hpp"
+
+#include "Ref8Isa.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+using omulator::U16;
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+
+template<template<U32> typename TTemplate, typename T>
+struct IsInstance : std::false_type { };
+
+template<template<U32> typename TTemplate, U32 OPCODE>
+struct IsInstance<TTemplate, TTemplate<OPCODE>> : std::true_type { };
+
+/**
+ * The parts of the encodings which depend on the host calling convention; the trampoline receives
+ * the Context_ and the code to jump to as its first two arguments, and Jit_::invoke_handler_()
+ * receives the Context_, the operand and the handler.
+ */
+#if defined(_WIN32)
+constexpr std::array<U8, 3> MOV_R12_ARG0   = {0x49, 0x89, 0xCC};  // mov r12, rcx
+constexpr std::array<U8, 2> JMP_ARG1       = {0xFF, 0xE2};        // jmp rdx
+constexpr std::array<U8, 3> MOV_ARG0_R12   = {0x4C, 0x89, 0xE1};  // mov rcx, r12
+constexpr U8                MOV_ARG1_IMM32 = 0xBA;                // mov edx, imm32
+constexpr std::array<U8, 2> MOV_ARG2_IMM64 = {0x49, 0xB8};        // mov r8, imm64
+#else
+constexpr std::array<U8, 3> MOV_R12_ARG0   = {0x49, 0x89, 0xFC};  // mov r12, rdi
+constexpr std::array<U8, 2> JMP_ARG1       = {0xFF, 0xE6};        // jmp rsi
+constexpr std::array<U8, 3> MOV_ARG0_R12   = {0x4C, 0x89, 0xE7};  // mov rdi, r12
+constexpr U8                MOV_ARG1_IMM32 = 0xBE;                // mov esi, imm32
+constexpr std::array<U8, 2> MOV_ARG2_IMM64 = {0x48, 0xBA};        // mov rdx, imm64
+#endif
+
+/**
+ * Returns the offset of a Registers field as an 8-bit displacement from rbx.
+ */
+constexpr U8 disp8(const std::size_t offset) {
+  if(offset > 127) {
+    throw std::logic_error("Displacement does not fit in 8 bits");
+  }
+
+  return static_cast<U8>(offset);
+}
+
+}  // namespace
+
+namespace omulator::cpu {
+
+struct Ref8::Jit_::OpInfo_ {
+  enum class Kind : U8 { HELPER, NOP, LDI, INC, DEC, LD, ST, MOV, ALU, JP, CALL };
+
+  Kind kind;
+
+  /**
+   * Register indices, the ALU operation, or the branch condition, depending on kind.
+   */
+  U8 a;
+  U8 b;
+
+  bool endsBlock;
+};
+
+template<typename THandler>
+struct Ref8::Jit_::SelectOpInfo_ {
+  using Kind_t = OpInfo_::Kind;
+
+  static consteval OpInfo_ make() {
+    if constexpr(IsInstance<Isa_::Nop, THandler>::value) {
+      return {Kind_t::NOP, 0, 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::Ldi, THandler>::value) {
+      return {Kind_t::LDI, static_cast<U8>(THandler::D), 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::Inc, THandler>::value) {
+      return {Kind_t::INC, static_cast<U8>(THandler::D), 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::Dec, THandler>::value) {
+      return {Kind_t::DEC, static_cast<U8>(THandler::D), 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::Ld, THandler>::value) {
+      return {Kind_t::LD, static_cast<U8>(THandler::D), 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::St, THandler>::value) {
+      return {Kind_t::ST, static_cast<U8>(THandler::S), 0, false};
+    }
+    else if constexpr(IsInstance<Isa_::Mov, THandler>::value) {
+      return {Kind_t::MOV, static_cast<U8>(THandler::D), static_cast<U8>(THandler::S), false};
+    }
+    else if constexpr(IsInstance<Isa_::Alu, THandler>::value) {
+      return {Kind_t::ALU, static_cast<U8>(THandler::OP), static_cast<U8>(THandler::S), false};
+    }
+    else if constexpr(IsInstance<Isa_::Jp, THandler>::value) {
+      return {Kind_t::JP, static_cast<U8>(THandler::COND), 0, true};
+    }
+    else if constexpr(IsInstance<Isa_::Call, THandler>::value) {
+      return {Kind_t::CALL, 0, 0, true};
+    }
+    else {
+      return {Kind_t::HELPER, 0, 0, THandler::ENDS_BLOCK};
+    }
+  }
+
+  static constexpr OpInfo_ value = make();
+};
+
+namespace {
+
+// Byte offsets of the guest state from rbx
+constexpr U8 REG_PC    = disp8(offsetof(Ref8::Registers, pc));
+constexpr U8 REG_ZERO  = disp8(offsetof(Ref8::Registers, zero));
+constexpr U8 REG_CARRY = disp8(offsetof(Ref8::Registers, carry));
+
+constexpr U8 reg_r(const std::size_t idx) {
+  return disp8(offsetof(Ref8::Registers, r) + idx);
+}
+
+}  // namespace
+
+Ref8::Jit_::Jit_(Ref8 &cpu)
+  : cpu_{cpu}, code_{CODE_SIZE}, enter_{nullptr}, exitStub_{nullptr}, cursor_{nullptr} {
+#if !defined(OML_ARCH_X64)
+  throw std::runtime_error("Ref8's JIT mode is only supported on x86-64 hosts");
+#else
+  reset_();
+  code_.make_executable();
+#endif
+}
+
+void Ref8::Jit_::compile(Block_t &block) {
+  if(block.data.hostCode != nullptr) {
+    return;
+  }
+
+  if(!try_emit_block_(block)) {
+    reset_();
+    if(!try_emit_block_(block)) {
+      throw std::runtime_error("Ref8 block is too large for the JIT code buffer");
+    }
+  }
+  code_.make_executable();
+}
+
+Cycle_t Ref8::Jit_::run(const Block_t &block, const Cycle_t budget) {
+  Context_ ctx{&cpu_.regs_, &cpu_, static_cast<S64>(budget), 0, nullptr};
+  enter_(&ctx, block.data.hostCode);
+
+  cpu_.instructionsRetired_ += ctx.retired;
+
+  // As with the micro-ops, the block which threw isn't counted
+  if(ctx.exception) {
+    std::rethrow_exception(ctx.exception);
+  }
+
+  return budget - static_cast<Cycle_t>(ctx.budget);
+}
+
+void Ref8::Jit_::unlink(const Block_t &block) {
+  if(block.data.hostCode == nullptr) {
+    return;
+  }
+
+  if(!exits_.contains(static_cast<U16>(block.start))) {
+    return;
+  }
+
+  // N.B. that this may be invoked from an instruction handler called by generated code (i.e. when
+  // a block writes to its own code), in which case the page being executed may briefly be made
+  // non-executable; this is fine, as it is made executable again before the handler returns.
+  const bool wasExecutable = code_.executable();
+  patch_exits_(static_cast<U16>(block.start), exitStub_);
+  if(wasExecutable) {
+    code_.make_executable();
+  }
+}
+
+void Ref8::Jit_::reset_() {
+  exits_.clear();
+  cpu_.blockCache_.for_each([](Block_t &block) {
+    block.data.hostCode  = nullptr;
+    block.data.execCount = 0;
+  });
+
+  constexpr U8 CTX_REGS    = disp8(offsetof(Context_, regs));
+  constexpr U8 CTX_BUDGET  = disp8(offsetof(Context_, budget));
+  constexpr U8 CTX_RETIRED = disp8(offsetof(Context_, retired));
+
+  code_.make_writable(code_.data(), TRAMPOLINE_SIZE);
+  X64Emitter emitter(code_.data(), code_.data() + TRAMPOLINE_SIZE);
+
+  // The trampoline: save the callee-saved registers that we use, and keep the stack 16-byte aligned
+  // with enough room for Win64's shadow space when calling instruction handlers
+  enter_ = reinterpret_cast<Entry_t>(emitter.cursor());
+  emitter.emit({0x53});                                  // push rbx
+  emitter.emit({0x41, 0x54});                            // push r12
+  emitter.emit({0x41, 0x55});                            // push r13
+  emitter.emit({0x41, 0x56});                            // push r14
+  emitter.emit({0x48, 0x83, 0xEC, 0x28});                // sub rsp, 40
+  emitter.emit(MOV_R12_ARG0);                            // mov r12, ctx
+  emitter.emit({0x49, 0x8B, 0x5C, 0x24, CTX_REGS});      // mov rbx, [r12 + regs]
+  emitter.emit({0x4D, 0x8B, 0x6C, 0x24, CTX_BUDGET});    // mov r13, [r12 + budget]
+  emitter.emit({0x45, 0x31, 0xF6});                      // xor r14d, r14d
+  emitter.emit(JMP_ARG1);                                // jmp code
+
+  exitStub_ = emitter.cursor();
+  emitter.emit({0x4D, 0x89, 0x6C, 0x24, CTX_BUDGET});    // mov [r12 + budget], r13
+  emitter.emit({0x4D, 0x89, 0x74, 0x24, CTX_RETIRED});   // mov [r12 + retired], r14
+  emitter.emit({0x48, 0x83, 0xC4, 0x28});                // add rsp, 40
+  emitter.emit({0x41, 0x5E});                            // pop r14
+  emitter.emit({0x41, 0x5D});                            // pop r13
+  emitter.emit({0x41, 0x5C});                            // pop r12
+  emitter.emit({0x5B});                                  // pop rbx
+  emitter.emit({0xC3});                                  // ret
+
+  if(emitter.overflowed()) {
+    throw std::logic_error("Ref8 JIT trampoline does not fit in TRAMPOLINE_SIZE");
+  }
+
+  cursor_ = emitter.cursor();
+}
+
+bool Ref8::Jit_::try_emit_block_(Block_t &block) {
+  U8 *const end = code_.data() + code_.size();
+
+  for(std::size_t window = EMIT_WINDOW;; window *= 2) {
+    const auto room  = static_cast<std::size_t>(end - cursor_);
+    U8 *const  limit = cursor_ + std::min(window, room);
+
+    code_.make_writable(cursor_, static_cast<std::size_t>(limit - cursor_));
+    if(emit_block_(block, limit)) {
+      return true;
+    }
+
+    if(limit == end) {
+      return false;
+    }
+  }
+}
+
+bool Ref8::Jit_::emit_block_(Block_t &block, U8 *const limit) {
+  static constexpr auto OP_INFO = Isa_::Table_t::make_table<OpInfo_, SelectOpInfo_>();
+
+  using Kind_t  = OpInfo_::Kind;
+  using AluOp_t = Isa_::AluOp;
+  using Cond_t  = Isa_::Cond;
+
+  pendingExits_.clear();
+  std::vector<EarlyExit_> earlyExits;
+
+  X64Emitter emitter(cursor_, limit);
+  U8 *const  entry = emitter.cursor();
+
+  // Leave if the budget can't cover the whole block; the guest PC already points at it
+  emitter.emit({0x49, 0x81, 0xFD});  // cmp r13, imm32
+  emitter.emit32(static_cast<U32>(block.data.cycles));
+  emitter.jcc(X64Emitter::Cond::L, exitStub_);
+
+  Cycle_t cycles = 0;
+  U64     count  = 0;
+  bool    ended  = false;
+
+  // Point a forward branch emitted earlier at the current position
+  const auto bind = [&](U8 *const site) {
+    if(site != nullptr) {
+      X64Emitter::patch_rel32(site, emitter.cursor());
+    }
+  };
+
+  // A handler may have written to this block's own code, in which case the rest of the block is
+  // stale
+  const auto emitValidityCheck = [&] {
+    emitter.emit({0x48, 0xB8});  // mov rax, &block.valid
+    emitter.emit64(reinterpret_cast<U64>(&block.valid));
+    emitter.emit({0x80, 0x38, 0x00});  // cmp byte [rax], 0
+    earlyExits.push_back({emitter.jcc(X64Emitter::Cond::E, exitStub_), cycles, count});
+  };
+
+  for(const MicroOp_ &op : block.ops) {
+    const OpInfo_ &info = OP_INFO[op.opcode];
+
+    // The counts at each exit include the instruction which takes it
+    cycles += op.cycles;
+    ++count;
+
+    switch(info.kind) {
+      case Kind_t::NOP:
+        break;
+
+      case Kind_t::LDI:
+        emitter.emit({0xC6, 0x43, reg_r(info.a), static_cast<U8>(op.operand)});  // mov [rd], imm8
+        break;
+
+      case Kind_t::INC:
+        emitter.emit({0xFE, 0x43, reg_r(info.a)});   // inc byte [rd]
+        emitter.emit({0x0F, 0x94, 0x43, REG_ZERO});  // setz [zero]
+        break;
+
+      case Kind_t::DEC:
+        emitter.emit({0xFE, 0x4B, reg_r(info.a)});   // dec byte [rd]
+        emitter.emit({0x0F, 0x94, 0x43, REG_ZERO});  // setz [zero]
+        break;
+
+      case Kind_t::MOV:
+        emitter.emit({0x8A, 0x43, reg_r(info.b)});  // mov al, [rs]
+        emitter.emit({0x88, 0x43, reg_r(info.a)});  // mov [rd], al
+        break;
+
+      case Kind_t::ALU: {
+        const auto aluOp = static_cast<AluOp_t>(info.a);
+
+        emitter.emit({0x8A, 0x43, reg_r(0)});       // mov al, [r0]
+        emitter.emit({0x8A, 0x4B, reg_r(info.b)});  // mov cl, [rs]
+
+        if(aluOp == AluOp_t::ADC || aluOp == AluOp_t::SBC) {
+          // Load the guest carry into CF
+          emitter.emit({0x8A, 0x53, REG_CARRY});  // mov dl, [carry]
+          emitter.emit({0x80, 0xC2, 0xFF});       // add dl, 0xFF
+        }
+
+        // <op> al, cl; the host's CF and ZF match the guest's carry and zero for every operation
+        constexpr U8 ALU_OPCODES[] = {0x00, 0x10, 0x28, 0x18, 0x20, 0x08, 0x30, 0x38};
+        emitter.emit({ALU_OPCODES[info.a], 0xC8});
+
+        emitter.emit({0x0F, 0x92, 0x43, REG_CARRY});  // setc [carry]
+        emitter.emit({0x0F, 0x94, 0x43, REG_ZERO});   // setz [zero]
+        if(aluOp != AluOp_t::CMP) {
+          emitter.emit({0x88, 0x43, reg_r(0)});  // mov [r0], al
+        }
+        break;
+      }
+
+      case Kind_t::JP: {
+        ended = true;
+
+        const auto cond = static_cast<Cond_t>(info.a);
+        if(cond == Cond_t::ALWAYS) {
+          emit_exit_(emitter, op.operand, cycles, count);
+          break;
+        }
+
+        // cmp byte [flag], 0; jcc taken
+        emitter.emit({0x80, 0x7B, cond == Cond_t::C ? REG_CARRY : REG_ZERO, 0x00});
+        U8 *const taken =
+          emitter.jcc(cond == Cond_t::NZ ? X64Emitter::Cond::E : X64Emitter::Cond::NE, exitStub_);
+
+        emit_exit_(emitter, op.nextPc, cycles, count);
+        bind(taken);
+        emit_exit_(emitter, op.operand, cycles, count);
+        break;
+      }
+
+      case Kind_t::CALL:
+        emit_helper_call_(emitter, op);
+        ended = true;
+        emit_exit_(emitter, op.operand, cycles, count);
+        break;
+
+      case Kind_t::LD:
+      case Kind_t::ST: {
+        // Accesses to plain memory go directly through the MemoryBus' page table; anything else
+        // (including writes to watched pages, i.e. to cached code) falls back to the handler
+        U8 *const slowPath = emit_direct_access_(emitter, info.kind == Kind_t::ST, reg_r(info.a));
+        U8 *const done     = emitter.jmp(exitStub_);
+        bind(slowPath);
+        emit_helper_call_(emitter, op);
+        emitValidityCheck();
+        bind(done);
+        break;
+      }
+
+      case Kind_t::HELPER:
+        emit_helper_call_(emitter, op);
+
+        if(info.endsBlock) {
+          // The handler has set the PC (e.g. RET), or halted the CPU
+          ended = true;
+          emit_unlinked_exit_(emitter, cycles, count);
+          break;
+        }
+
+        emitValidityCheck();
+        break;
+    }
+  }
+
+  // The block was cut short (e.g. by MAX_BLOCK_OPS) rather than ending with a branch
+  if(!ended) {
+    emit_exit_(emitter, block.ops.back().nextPc, cycles, count);
+  }
+
+  for(const EarlyExit_ &earlyExit : earlyExits) {
+    bind(earlyExit.site);
+    emit_unlinked_exit_(emitter, earlyExit.cycles, earlyExit.count);
+  }
+
+  if(emitter.overflowed()) {
+    return false;
+  }
+
+  cursor_              = emitter.cursor();
+  block.data.hostCode  = entry;
+  for(const auto &[target, site] : pendingExits_) {
+    exits_[target].push_back(site);
+  }
+
+  // Link in every exit which leads to this block, including its own
+  patch_exits_(static_cast<U16>(block.start), entry);
+
+  return true;
+}
+
+void Ref8::Jit_::emit_exit_(X64Emitter &emitter,
+                            const U16   target,
+                            const Cycle_t cycles,
+                            const U64   count) {
+  emitter.emit({0x66, 0xC7, 0x43, REG_PC});  // mov word [pc], imm16
+  emitter.emit16(target);
+  emitter.emit({0x49, 0x81, 0xED});  // sub r13, imm32
+  emitter.emit32(static_cast<U32>(cycles));
+  emitter.emit({0x49, 0x81, 0xC6});  // add r14, imm32
+  emitter.emit32(static_cast<U32>(count));
+
+  // Link straight to the target if it has already been recompiled
+  const Block_t *const targetBlock = cpu_.blockCache_.find(target);
+  const U8 *const      dest =
+    (targetBlock != nullptr && targetBlock->data.hostCode != nullptr) ? targetBlock->data.hostCode
+                                                                      : exitStub_;
+
+  U8 *const site = emitter.jmp(dest);
+  if(site != nullptr) {
+    pendingExits_.emplace_back(target, site);
+  }
+}
+
+void Ref8::Jit_::emit_unlinked_exit_(X64Emitter &emitter, const Cycle_t cycles, const U64 count) {
+  emitter.emit({0x49, 0x81, 0xED});  // sub r13, imm32
+  emitter.emit32(static_cast<U32>(cycles));
+  emitter.emit({0x49, 0x81, 0xC6});  // add r14, imm32
+  emitter.emit32(static_cast<U32>(count));
+  emitter.jmp(exitStub_);
+}
+
+void Ref8::Jit_::emit_helper_call_(X64Emitter &emitter, const MicroOp_ &op) {
+  // As in the block cache, handlers are invoked with the PC pointing at the next instruction
+  emitter.emit({0x66, 0xC7, 0x43, REG_PC});  // mov word [pc], imm16
+  emitter.emit16(op.nextPc);
+
+  emitter.emit(MOV_ARG0_R12);     // mov arg0, r12
+  emitter.emit8(MOV_ARG1_IMM32);  // mov arg1, imm32
+  emitter.emit32(op.operand);
+  emitter.emit(MOV_ARG2_IMM64);  // mov arg2, imm64
+  emitter.emit64(reinterpret_cast<U64>(op.run));
+  emitter.emit({0x48, 0xB8});  // mov rax, imm64
+  emitter.emit64(reinterpret_cast<U64>(&invoke_handler_));
+  emitter.emit({0xFF, 0xD0});  // call rax
+
+  // Leave without counting the block if the handler threw
+  emitter.emit({0x84, 0xC0});  // test al, al
+  emitter.jcc(X64Emitter::Cond::NE, exitStub_);
+}
+
+bool Ref8::Jit_::invoke_handler_(Context_ *const ctx,
+                                 const U32       operand,
+                                 Handler_t       handler) noexcept {
+  try {
+    handler(*ctx->cpu, static_cast<U16>(operand));
+    return false;
+  }
+  catch(...) {
+    ctx->exception = std::current_exception();
+    return true;
+  }
+}
+
+U8 *Ref8::Jit_::emit_direct_access_(X64Emitter &emitter, const bool store, const U8 reg) {
+  const MemoryBus &bus      = cpu_.bus_;
+  const U32        pageBits = bus.page_bits();
+  const auto       pageMask = static_cast<U32>(bus.page_size() - 1);
+  U8 *const *const table    = store ? bus.write_page_table() : bus.read_page_table();
+
+  // Ref8 addresses are 16 bits, which the MemoryBus is guaranteed to cover, so no masking needed
+  emitter.emit({0x0F, 0xB6, 0x43, reg_r(6)});             // movzx eax, byte [r6]
+  emitter.emit({0xC1, 0xE0, 0x08});                       // shl eax, 8
+  emitter.emit({0x8A, 0x43, reg_r(7)});                   // mov al, [r7]
+  emitter.emit({0x89, 0xC1});                             // mov ecx, eax
+  emitter.emit({0xC1, 0xE9, static_cast<U8>(pageBits)});  // shr ecx, pageBits
+  emitter.emit({0x48, 0xBA});                             // mov rdx, table
+  emitter.emit64(reinterpret_cast<U64>(table));
+  emitter.emit({0x48, 0x8B, 0x14, 0xCA});  // mov rdx, [rdx + rcx * 8]
+  emitter.emit({0x48, 0x85, 0xD2});        // test rdx, rdx
+  U8 *const slowPath = emitter.jcc(X64Emitter::Cond::E, exitStub_);
+
+  emitter.emit8(0x25);  // and eax, pageMask
+  emitter.emit32(pageMask);
+  if(store) {
+    emitter.emit({0x8A, 0x4B, reg});   // mov cl, [rs]
+    emitter.emit({0x88, 0x0C, 0x02});  // mov [rdx + rax], cl
+  }
+  else {
+    emitter.emit({0x8A, 0x04, 0x02});  // mov al, [rdx + rax]
+    emitter.emit({0x88, 0x43, reg});   // mov [rd], al
+  }
+
+  return slowPath;
+}
+
+void Ref8::Jit_::patch_exits_(const U16 target, const U8 *const dest) {
+  const auto it = exits_.find(target);
+  if(it == exits_.end()) {
+    return;
+  }
+
+  for(U8 *const site : it->second) {
+    code_.make_writable(site, sizeof(U32));
+    X64Emitter::patch_rel32(site, dest);
+  }
+}
+
+}  // namespace omulator::cpu
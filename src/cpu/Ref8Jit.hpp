@@ -0,0 +1,172 @@
+#pragma once
+
+#include "omulator/cpu/Ref8.hpp"
+#include "omulator/cpu/X64Emitter.hpp"
+#include "omulator/util/ExecutableMemory.hpp"
+
+#include <exception>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace omulator::cpu {
+
+/**
+ * Recompiles Ref8 blocks to x86-64. Private to the Ref8 implementation.
+ *
+ * Generated code is entered through a trampoline which holds the JIT's state in callee-saved
+ * registers for as long as it runs:
+ *
+ *   rbx  The Ref8's Registers; guest registers and flags live there rather than in host registers,
+ *        so that instruction handlers called from generated code see them as usual.
+ *   r12  The Context_ for this run.
+ *   r13  The cycle budget remaining. Each block checks on entry that the budget can cover all of
+ *        its instructions, and leaves through the exit stub (back to the trampoline) if not.
+ *   r14  The number of instructions retired.
+ *
+ * Each block exit stores the guest PC and updates r13/r14 before jumping to its successor, so the
+ * successor can be linked in directly once it has been recompiled. Exits are tracked by their
+ * guest target address, and are re-pointed at the exit stub when their target is invalidated. When
+ * the code buffer fills up, all generated code is discarded and recompilation starts afresh.
+ *
+ * The generated frames have no unwind information, so exceptions must never pass through them.
+ * Instruction handlers (which may call MMIO handlers and write watchers, and so throw) are called
+ * through invoke_handler_(), which catches anything thrown and leaves through the exit stub; run()
+ * then rethrows it.
+ */
+class Ref8::Jit_ {
+public:
+  /**
+   * The size of the code buffer.
+   */
+  static constexpr std::size_t CODE_SIZE = 4 * 1024 * 1024;
+
+  /**
+   * The space at the start of the code buffer which is set aside for the trampoline and exit stub.
+   */
+  static constexpr std::size_t TRAMPOLINE_SIZE = 64;
+
+  /**
+   * How much of the code buffer past the cursor is made writable for the first attempt to emit a
+   * block; this doubles on each further attempt, until the block fits.
+   */
+  static constexpr std::size_t EMIT_WINDOW = 4096;
+
+  /**
+   * Throws if the host is not x86-64.
+   */
+  explicit Jit_(Ref8 &cpu);
+
+  /**
+   * Recompile the given block, unless it already has host code.
+   */
+  void compile(Block_t &block);
+
+  /**
+   * Run the given (recompiled) block and whichever blocks are linked from it, until an unlinked
+   * exit is reached or the budget is exhausted. Returns the number of cycles taken.
+   */
+  Cycle_t run(const Block_t &block, const Cycle_t budget);
+
+  /**
+   * Re-point every exit which is linked to the given block at the exit stub.
+   */
+  void unlink(const Block_t &block);
+
+private:
+  struct Context_ {
+    Registers *regs;
+    Ref8      *cpu;
+    S64        budget;
+    U64        retired;
+
+    /**
+     * Whatever was thrown by the instruction handler which stopped the run, if any.
+     */
+    std::exception_ptr exception;
+  };
+
+  using Entry_t   = void (*)(Context_ *, const U8 *);
+  using Handler_t = void (*)(Ref8 &, const U16);
+
+  /**
+   * Called by generated code in place of each instruction handler. Returns true if the handler
+   * threw, in which case the exception is stored in the Context_.
+   */
+  static bool invoke_handler_(Context_ *const ctx, const U32 operand, Handler_t handler) noexcept;
+
+  /**
+   * Per-opcode information for the recompiler, derived from Isa_'s handlers.
+   */
+  struct OpInfo_;
+
+  template<typename THandler>
+  struct SelectOpInfo_;
+
+  /**
+   * An exit which is taken if the block is invalidated partway through, i.e. after an instruction
+   * which writes to memory. The guest PC is up to date by then, so only the counters need updating.
+   */
+  struct EarlyExit_ {
+    U8     *site;
+    Cycle_t cycles;
+    U64     count;
+  };
+
+  /**
+   * Discard all generated code and emit the trampoline and exit stub.
+   */
+  void reset_();
+
+  /**
+   * Emit the block at the cursor, making as little of the code buffer writable as possible (see
+   * EMIT_WINDOW). Returns false if the code buffer is full.
+   */
+  bool try_emit_block_(Block_t &block);
+
+  /**
+   * Emit the block between the cursor and limit, which must already be writable. Returns false if
+   * it doesn't fit.
+   */
+  bool emit_block_(Block_t &block, U8 *const limit);
+
+  void emit_exit_(X64Emitter &emitter, const U16 target, const Cycle_t cycles, const U64 count);
+  void emit_unlinked_exit_(X64Emitter &emitter, const Cycle_t cycles, const U64 count);
+  void emit_helper_call_(X64Emitter &emitter, const MicroOp_ &op);
+
+  /**
+   * Emit a load into, or store from, the given guest register (as a displacement from rbx) at the
+   * address in r6:r7, for pages which the MemoryBus has a direct pointer to. Returns the site of
+   * the branch which is taken for all other pages, which must be bound to a slow path.
+   */
+  U8 *emit_direct_access_(X64Emitter &emitter, const bool store, const U8 reg);
+
+  /**
+   * Re-point every exit which leads to target at dest, making just the pages with those exits
+   * writable.
+   */
+  void patch_exits_(const U16 target, const U8 *const dest);
+
+  Ref8                  &cpu_;
+  util::ExecutableMemory code_;
+  Entry_t                enter_;
+  const U8              *exitStub_;
+
+  /**
+   * The start of the free space in the code buffer.
+   */
+  U8 *cursor_;
+
+  /**
+   * The rel32 field of every linkable exit in the code buffer, keyed by guest target address.
+   */
+  std::unordered_map<U16, std::vector<U8 *>> exits_;
+
+  /**
+   * Exits which have been emitted for the block currently being recompiled; only added to exits_
+   * once the block has been emitted successfully.
+   */
+  std::vector<std::pair<U16, U8 *>> pendingExits_;
+};
+
+}  // namespace omulator::cpu
@@ -3,15 +3,23 @@
  * translation unit.
  */
 
+#include "omulator/AudioEngine.hpp"
 #include "omulator/Clock.hpp"
+#include "omulator/Debugger.hpp"
 #include "omulator/IGraphicsBackend.hpp"
 #include "omulator/ILogger.hpp"
 #include "omulator/InputHandler.hpp"
 #include "omulator/Interpreter.hpp"
+#include "omulator/MediaReadAhead.hpp"
+#include "omulator/NullAudioSink.hpp"
 #include "omulator/NullWindow.hpp"
 #include "omulator/PropertyMap.hpp"
 #include "omulator/SpdlogLogger.hpp"
+#include "omulator/SystemAudioSink.hpp"
 #include "omulator/SystemWindow.hpp"
+#include "omulator/Tracer.hpp"
+#include "omulator/VirtualClock.hpp"
+#include "omulator/WavAudioSink.hpp"
 #include "omulator/di/Injector.hpp"
 #include "omulator/graphics/CoreGraphicsEngine.hpp"
 #include "omulator/msg/MailboxRouter.hpp"
@@ -24,10 +32,39 @@
 
 #include <map>
 #include <memory_resource>
+#include <stdexcept>
+#include <string>
 #include <thread>
 
 using omulator::util::TypeHash;
 
+namespace {
+
+double parse_clock_speed(const std::string &str) {
+  if(str.empty() || str == "unlimited") {
+    return omulator::VirtualClock::UNLIMITED;
+  }
+
+  std::size_t numParsed  = 0;
+  double      multiplier = 0.0;
+  try {
+    multiplier = std::stod(str, &numParsed);
+  }
+  catch(const std::exception &) {
+    numParsed = 0;
+  }
+
+  if(numParsed != str.size() || !(multiplier > 0.0)) {
+    std::string msg = "Invalid clock speed: ";
+    msg += str;
+    throw std::runtime_error(msg);
+  }
+
+  return multiplier;
+}
+
+}  // namespace
+
 namespace omulator::di {
 void Injector::installDefaultRules(Injector &injector) {
   /**
@@ -40,13 +77,29 @@ void Injector::installDefaultRules(Injector &injector) {
   injector.addCtorRecipe<Interpreter, di::Injector &>();
   injector.addCtorRecipe<graphics::CoreGraphicsEngine, di::Injector &>();
   injector.addCtorRecipe<util::CLIInput, ILogger &, msg::MailboxRouter &>();
+  injector.addCtorRecipe<Debugger, ILogger &>();
+  injector.addCtorRecipe<Tracer, ILogger &>();
+  injector.addCtorRecipe<MediaReadAhead, ILogger &, msg::MailboxRouter &>();
+  injector.addCtorRecipe<SystemAudioSink, ILogger &>();
+  injector.addCtorRecipe<AudioEngine, ILogger &, msg::MailboxRouter &, IAudioSink &>();
 
   vkmisc::install_vk_initializer_rules(injector);
 
   /**
    * Implementations should be bound to interfaces here.
    */
-  injector.bindImpl<IClock, Clock>();
+  const auto clockType = injector.get<PropertyMap>().get_prop<std::string>(props::CLOCK).get();
+  if(clockType == "virtual") {
+    injector.bindImpl<IClock, VirtualClock>();
+  }
+  else if(clockType.empty() || clockType == "real") {
+    injector.bindImpl<IClock, Clock>();
+  }
+  else {
+    std::string msg = "Unknown clock type: ";
+    msg += clockType;
+    throw std::runtime_error(msg);
+  }
 
   if(injector.get<PropertyMap>().get_prop<bool>(props::HEADLESS).get()) {
     injector.bindImpl<IWindow, NullWindow>();
@@ -55,6 +108,20 @@ void Injector::installDefaultRules(Injector &injector) {
     injector.bindImpl<IWindow, SystemWindow>();
   }
 
+  const auto audioWav = injector.get<PropertyMap>().get_prop<std::string>(props::AUDIO_WAV).get();
+  if(!audioWav.empty()) {
+    injector.addRecipe<WavAudioSink>([audioWav]([[maybe_unused]] Injector &injectorInstance) {
+      return new WavAudioSink(audioWav);
+    });
+    injector.bindImpl<IAudioSink, WavAudioSink>();
+  }
+  else if(injector.get<PropertyMap>().get_prop<bool>(props::HEADLESS).get()) {
+    injector.bindImpl<IAudioSink, NullAudioSink>();
+  }
+  else {
+    injector.bindImpl<IAudioSink, SystemAudioSink>();
+  }
+
   /**
    * Custom recipes for types should be added here.
    */
@@ -64,6 +131,11 @@ void Injector::installDefaultRules(Injector &injector) {
       injectorInstance.get<ILogger>(),
       factoryInstanceCounter.fetch_add(1, std::memory_order_acq_rel));
   });
+
+  injector.addRecipe<VirtualClock>([](Injector &injectorInstance) {
+    return new VirtualClock(parse_clock_speed(
+      injectorInstance.get<PropertyMap>().get_prop<std::string>(props::CLOCK_SPEED).get()));
+  });
 }
 
 void Injector::installMinimalRules(Injector &injector) {
@@ -1,5 +1,6 @@
 #include "omulator/graphics/CoreGraphicsEngine.hpp"
 
+#include "omulator/graphics/VideoOutput.hpp"
 #include "omulator/util/TypeString.hpp"
 
 namespace omulator::graphics {
@@ -16,6 +17,9 @@ CoreGraphicsEngine::CoreGraphicsEngine(di::Injector &injector)
   receiver_.on_managed_payload<std::string>(
     msg::MessageType::SET_VERTEX_SHADER,
     [this](const std::string &shader) { graphicsBackend_.set_vertex_shader(shader); });
+  receiver_.on_unmanaged_payload<VideoOutput>(
+    msg::MessageType::VIDEO_FRAME,
+    [this](VideoOutput &videoOutput) { graphicsBackend_.upload_frame(videoOutput.acquire()); });
 }
 
 }  // namespace omulator
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "omulator/graphics/PixelConvert.hpp"
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+#include "omulator/util/intrinsics.hpp"
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+#include <algorithm>
+
+namespace {
+
+using omulator::U16;
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+using omulator::graphics::Palette_t;
+
+constexpr U32 ALPHA = 0xFF00'0000;
+
+/**
+ * For each byte of a bitplane, the eight pixels it covers with one bit each, as a byte per pixel;
+ * the pixel for bit 7 (the leftmost) is in the low byte. Shifting an entry left by the plane number
+ * and ORing the entries for every plane gives eight palette indices at once.
+ */
+constexpr std::array<U64, 256> PLANE_EXPAND = [] {
+  std::array<U64, 256> table{};
+  for(std::size_t b = 0; b < table.size(); ++b) {
+    for(std::size_t bit = 0; bit < 8; ++bit) {
+      if(b & (0x80U >> bit)) {
+        table[b] |= U64{1} << (bit * 8);
+      }
+    }
+  }
+
+  return table;
+}();
+
+U64 planar_group(const U8 *const src, const std::size_t planeBytes, const std::size_t numPlanes)
+  noexcept {
+  U64 indices = 0;
+  for(std::size_t plane = 0; plane < numPlanes; ++plane) {
+    indices |= PLANE_EXPAND[src[plane * planeBytes]] << plane;
+  }
+
+  return indices;
+}
+
+U32 widen5(const U32 x) noexcept { return (x << 3) | (x >> 2); }
+U32 widen6(const U32 x) noexcept { return (x << 2) | (x >> 4); }
+
+/**
+ * Converts RGB555 if GREEN_BITS is 5, and RGB565 if it is 6.
+ */
+template<U32 GREEN_BITS>
+U32 rgb16_pixel(const U32 px) noexcept {
+  constexpr U32 GREEN_MASK = (1U << GREEN_BITS) - 1;
+
+  const U32 r = widen5((px >> (5 + GREEN_BITS)) & 0x1F);
+  const U32 g = GREEN_BITS == 5 ? widen5((px >> 5) & GREEN_MASK) : widen6((px >> 5) & GREEN_MASK);
+  const U32 b = widen5(px & 0x1F);
+  return r | (g << 8) | (b << 16) | ALPHA;
+}
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+
+/**
+ * Look up eight palette indices, one in each 32-bit lane.
+ */
+__m256i gather_palette(const Palette_t &palette, const __m256i indices) noexcept {
+  return _mm256_i32gather_epi32(reinterpret_cast<const int *>(palette.data()), indices, 4);
+}
+
+void store8(U32 *const dst, const __m256i pixels) noexcept {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), pixels);
+}
+
+std::size_t indexed8_avx2(const U8 *const   src,
+                          const Palette_t  &palette,
+                          U32 *const        dst,
+                          const std::size_t numPixels) noexcept {
+  std::size_t i = 0;
+  for(; i + 8 <= numPixels; i += 8) {
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+    store8(dst + i, gather_palette(palette, _mm256_cvtepu8_epi32(bytes)));
+  }
+
+  return i;
+}
+
+/**
+ * The same as widen5() and widen6(), in each 32-bit lane.
+ */
+template<int BITS>
+__m256i widen_avx2(const __m256i x) noexcept {
+  return _mm256_or_si256(_mm256_slli_epi32(x, 8 - BITS), _mm256_srli_epi32(x, 2 * BITS - 8));
+}
+
+/**
+ * The same as rgb16_pixel(), on eight pixels at a time in 32-bit lanes.
+ */
+template<int GREEN_BITS>
+std::size_t
+  rgb16_avx2(const U16 *const src, U32 *const dst, const std::size_t numPixels) noexcept {
+  const __m256i mask5     = _mm256_set1_epi32(0x1F);
+  const __m256i maskGreen = _mm256_set1_epi32((1 << GREEN_BITS) - 1);
+  const __m256i alpha     = _mm256_set1_epi32(static_cast<int>(ALPHA));
+
+  std::size_t i = 0;
+  for(; i + 8 <= numPixels; i += 8) {
+    const __m256i px =
+      _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+
+    const __m256i r = widen_avx2<5>(_mm256_and_si256(_mm256_srli_epi32(px, 5 + GREEN_BITS), mask5));
+    const __m256i g = widen_avx2<GREEN_BITS>(_mm256_and_si256(_mm256_srli_epi32(px, 5), maskGreen));
+    const __m256i b = widen_avx2<5>(_mm256_and_si256(px, mask5));
+
+    const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi32(g, 8));
+    store8(dst + i, _mm256_or_si256(_mm256_or_si256(rg, _mm256_slli_epi32(b, 16)), alpha));
+  }
+
+  return i;
+}
+
+std::size_t planar_avx2(const U8 *const   src,
+                        const std::size_t planeBytes,
+                        const std::size_t numPlanes,
+                        const Palette_t  &palette,
+                        U32 *const        dst,
+                        const std::size_t numGroups) noexcept {
+  for(std::size_t group = 0; group < numGroups; ++group) {
+    const U64     indices = planar_group(src + group, planeBytes, numPlanes);
+    const __m128i bytes   = _mm_cvtsi64_si128(static_cast<long long>(indices));
+    store8(dst + group * 8, gather_palette(palette, _mm256_cvtepu8_epi32(bytes)));
+  }
+
+  return numGroups;
+}
+
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+}  // namespace
+
+namespace omulator::graphics {
+
+void convert_indexed8(std::span<const U8> src,
+                      const Palette_t    &palette,
+                      std::span<U32>      dst) noexcept {
+  const std::size_t numPixels = std::min(src.size(), dst.size());
+  std::size_t       i         = 0;
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+  i = indexed8_avx2(src.data(), palette, dst.data(), numPixels);
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+  for(; i < numPixels; ++i) {
+    dst[i] = palette[src[i]];
+  }
+}
+
+void convert_rgb555(std::span<const U16> src, std::span<U32> dst) noexcept {
+  const std::size_t numPixels = std::min(src.size(), dst.size());
+  std::size_t       i         = 0;
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+  i = rgb16_avx2<5>(src.data(), dst.data(), numPixels);
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+  for(; i < numPixels; ++i) {
+    dst[i] = rgb16_pixel<5>(src[i]);
+  }
+}
+
+void convert_rgb565(std::span<const U16> src, std::span<U32> dst) noexcept {
+  const std::size_t numPixels = std::min(src.size(), dst.size());
+  std::size_t       i         = 0;
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+  i = rgb16_avx2<6>(src.data(), dst.data(), numPixels);
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+  for(; i < numPixels; ++i) {
+    dst[i] = rgb16_pixel<6>(src[i]);
+  }
+}
+
+void convert_planar(std::span<const U8> src,
+                    const std::size_t   numPlanes,
+                    const Palette_t    &palette,
+                    std::span<U32>      dst) noexcept {
+  if(numPlanes == 0 || numPlanes > 8) {
+    return;
+  }
+
+  const std::size_t planeBytes = src.size() / numPlanes;
+  const std::size_t numPixels  = std::min(planeBytes * 8, dst.size());
+  std::size_t       group      = 0;
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+  group = planar_avx2(src.data(), planeBytes, numPlanes, palette, dst.data(), numPixels / 8);
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+  // Including a partial group at the end, if dst is too small for the whole of src
+  for(; group * 8 < numPixels; ++group) {
+    const U64         indices = planar_group(src.data() + group, planeBytes, numPlanes);
+    const std::size_t n       = std::min(std::size_t{8}, numPixels - group * 8);
+    for(std::size_t px = 0; px < n; ++px) {
+      dst[group * 8 + px] = palette[(indices >> (px * 8)) & 0xFF];
+    }
+  }
+}
+
+}  // namespace omulator::graphics
@@ -0,0 +1,159 @@
+#include "omulator/graphics/VideoOutput.hpp"
+
+#include "omulator/util/Profiler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace omulator::graphics {
+
+VideoOutput::VideoOutput(const U32         width,
+                         const U32         height,
+                         const PixelFormat format,
+                         const U32         numPlanes)
+  : width_{width},
+    height_{height},
+    format_{format},
+    numPlanes_{numPlanes},
+    lineBytes_{0},
+    lineStride_{0},
+    palette_{},
+    numbers_{},
+    back_{0},
+    front_{1},
+    ready_{2},
+    frameNumber_{0} {
+  if(width == 0 || height == 0) {
+    throw std::invalid_argument("VideoOutput dimensions must be nonzero");
+  }
+
+  switch(format_) {
+    case PixelFormat::INDEXED8:
+      lineBytes_ = width_;
+      break;
+    case PixelFormat::RGB555:
+    case PixelFormat::RGB565:
+      lineBytes_ = std::size_t{width_} * sizeof(U16);
+      break;
+    case PixelFormat::PLANAR:
+      if(numPlanes_ == 0 || numPlanes_ > 8 || width_ % 8 != 0) {
+        throw std::invalid_argument(
+          "Planar VideoOutputs must have 1-8 planes and a width which is a multiple of 8");
+      }
+      lineBytes_ = std::size_t{width_} / 8 * numPlanes_;
+      break;
+  }
+
+  lineStride_ = (lineBytes_ + sizeof(U16) - 1) / sizeof(U16);
+  source_.resize(lineStride_ * height_);
+  dirty_.resize(height_, ALL_SLOTS);
+
+  for(auto &slot : slots_) {
+    slot.resize(std::size_t{width_} * height_);
+  }
+}
+
+U32 VideoOutput::width() const noexcept { return width_; }
+
+U32 VideoOutput::height() const noexcept { return height_; }
+
+VideoOutput::PixelFormat VideoOutput::format() const noexcept { return format_; }
+
+std::size_t VideoOutput::line_bytes() const noexcept { return lineBytes_; }
+
+std::span<U8> VideoOutput::line(const U32 y) {
+  mark_dirty(y);
+
+  // N.B. that viewing the U16s as bytes is fine, while the reverse would not be
+  U8 *const start = reinterpret_cast<U8 *>(source_.data() + lineStride_ * y);
+  return {start, lineBytes_};
+}
+
+std::span<U16> VideoOutput::line16(const U32 y) {
+  if(format_ != PixelFormat::RGB555 && format_ != PixelFormat::RGB565) {
+    throw std::logic_error("VideoOutput::line16 is only valid for 16-bit pixel formats");
+  }
+
+  mark_dirty(y);
+  return {source_.data() + lineStride_ * y, width_};
+}
+
+void VideoOutput::mark_dirty(const U32 y) {
+  if(y >= height_) {
+    throw std::out_of_range("VideoOutput scanline out of range");
+  }
+
+  dirty_[y] = ALL_SLOTS;
+}
+
+void VideoOutput::mark_all_dirty() noexcept { std::ranges::fill(dirty_, ALL_SLOTS); }
+
+void VideoOutput::set_palette(std::span<const U32> colors, const std::size_t first) {
+  if(first > palette_.size() || colors.size() > palette_.size() - first) {
+    throw std::out_of_range("VideoOutput palette entries out of range");
+  }
+
+  const auto dst = palette_.begin() + static_cast<std::ptrdiff_t>(first);
+  if(std::equal(colors.begin(), colors.end(), dst)) {
+    return;
+  }
+
+  std::ranges::copy(colors, dst);
+  if(format_ == PixelFormat::INDEXED8 || format_ == PixelFormat::PLANAR) {
+    mark_all_dirty();
+  }
+}
+
+const Palette_t &VideoOutput::palette() const noexcept { return palette_; }
+
+std::size_t VideoOutput::present() {
+  OML_PROFILE_SPAN("VideoOutput::present");
+
+  const U8       slotBit   = static_cast<U8>(1U << back_);
+  std::span<U32> slot      = slots_[back_];
+  std::size_t    converted = 0;
+
+  for(U32 y = 0; y < height_; ++y) {
+    if(dirty_[y] & slotBit) {
+      convert_line_(y, slot.subspan(std::size_t{width_} * y, width_));
+      dirty_[y] = static_cast<U8>(dirty_[y] & ~slotBit);
+      ++converted;
+    }
+  }
+
+  numbers_[back_] = ++frameNumber_;
+
+  // Release the finished slot to acquire(), and take whichever slot was waiting in its place
+  const U8 prev = ready_.exchange(static_cast<U8>(back_ | NEW_FRAME), std::memory_order_acq_rel);
+  back_         = prev & SLOT_MASK;
+  return converted;
+}
+
+VideoOutput::Frame VideoOutput::acquire() noexcept {
+  if(ready_.load(std::memory_order_relaxed) & NEW_FRAME) {
+    front_ = ready_.exchange(front_, std::memory_order_acq_rel) & SLOT_MASK;
+  }
+
+  return {slots_[front_], width_, height_, numbers_[front_]};
+}
+
+void VideoOutput::convert_line_(const U32 y, std::span<U32> dst) const noexcept {
+  const U16 *const start = source_.data() + lineStride_ * y;
+
+  switch(format_) {
+    case PixelFormat::INDEXED8:
+      convert_indexed8({reinterpret_cast<const U8 *>(start), lineBytes_}, palette_, dst);
+      break;
+    case PixelFormat::RGB555:
+      convert_rgb555({start, width_}, dst);
+      break;
+    case PixelFormat::RGB565:
+      convert_rgb565({start, width_}, dst);
+      break;
+    case PixelFormat::PLANAR:
+      convert_planar({reinterpret_cast<const U8 *>(start), lineBytes_}, numPlanes_, palette_, dst);
+      break;
+  }
+}
+
+}  // namespace omulator::graphics
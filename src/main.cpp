@@ -1,38 +1,263 @@
 #include "omulator/main.hpp"
 
 #include "omulator/App.hpp"
+#include "omulator/Benchmark.hpp"
+#include "omulator/Debugger.hpp"
 #include "omulator/IClock.hpp"
 #include "omulator/ILogger.hpp"
 #include "omulator/IWindow.hpp"
 #include "omulator/InputHandler.hpp"
 #include "omulator/Interpreter.hpp"
+#include "omulator/MemoryBus.hpp"
 #include "omulator/PropertyMap.hpp"
+#include "omulator/StateHasher.hpp"
+#include "omulator/System.hpp"
+#include "omulator/Tracer.hpp"
+#include "omulator/cpu/Ref8.hpp"
 #include "omulator/di/Injector.hpp"
 #include "omulator/graphics/CoreGraphicsEngine.hpp"
 #include "omulator/msg/MailboxRouter.hpp"
 #include "omulator/props.hpp"
 #include "omulator/util/CLIInput.hpp"
 #include "omulator/util/CLIParser.hpp"
+#include "omulator/util/Profiler.hpp"
 #include "omulator/util/exception_handler.hpp"
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <utility>
 
 namespace {
 constexpr auto FPS    = 60;
 constexpr auto PERIOD = std::chrono::nanoseconds(1'000'000'000) / FPS;
+
+/**
+ * The benchmark System is a Ref8 clocked at a nominal 4MHz, running in timeslices of
+ * BENCH_TIMESLICE cycles.
+ */
+constexpr omulator::Cycle_t BENCH_CYCLES_PER_FRAME = 4'000'000 / FPS;
+constexpr omulator::Cycle_t BENCH_TIMESLICE        = 1024;
+
+/**
+ * An endless loop which mixes register, ALU, memory and branch instructions; the same workload as
+ * BM_ref8_ips.
+ */
+constexpr std::array<omulator::U8, 19> BENCH_PROGRAM{
+  0x32, 0x80,        // 0x00: LDI r6, 0x80
+  0x3A, 0x00,        // 0x02: LDI r7, 0x00
+  0x0A, 0x00,        // 0x04: LDI r1, 0x00
+  0x81,              // 0x06: ADD r1
+  0xA9,              // 0x07: XOR r1
+  0x16,              // 0x08: ST r2
+  0x1D,              // 0x09: LD r3
+  0x5C,              // 0x0A: MOV r3, r4
+  0x3B,              // 0x0B: INC r7
+  0x0C,              // 0x0C: DEC r1
+  0xE0, 0x06, 0x00,  // 0x0D: JP NZ, 0x0006
+  0xC0, 0x04, 0x00,  // 0x10: JP 0x0004
+};
 }  // namespace
 
 namespace omulator {
 
+namespace {
+
+/**
+ * Attaches the Injector's Debugger and Tracer to a System's CPU (and the Debugger to its
+ * MemoryBus) for as long as it exists, so that the Lua Interpreter's oml.debug.* and oml.trace.*
+ * commands act on that System.
+ */
+class AttachedDebugTools {
+public:
+  AttachedDebugTools(di::Injector &injector, cpu::Ref8 &cpu, MemoryBus &bus)
+    : debugger_{injector.get<Debugger>()}, tracer_{injector.get<Tracer>()}, cpu_{cpu} {
+    debugger_.attach_bus(bus);
+    cpu_.set_debugger(&debugger_);
+    cpu_.set_tracer(&tracer_);
+  }
+
+  ~AttachedDebugTools() {
+    cpu_.set_tracer(nullptr);
+    cpu_.set_debugger(nullptr);
+    debugger_.detach_bus();
+  }
+
+  AttachedDebugTools(const AttachedDebugTools &)            = delete;
+  AttachedDebugTools &operator=(const AttachedDebugTools &) = delete;
+  AttachedDebugTools(AttachedDebugTools &&)                 = delete;
+  AttachedDebugTools &operator=(AttachedDebugTools &&)      = delete;
+
+private:
+  Debugger  &debugger_;
+  Tracer    &tracer_;
+  cpu::Ref8 &cpu_;
+};
+
+/**
+ * Run the benchmark System and report the results; returns the process exit code. See Benchmark.
+ */
+int run_benchmark(di::Injector &injector) {
+  auto &propertyMap = injector.get<PropertyMap>();
+  Benchmark benchmark(injector.get<ILogger>(), propertyMap, injector.get<IClock>());
+
+  System system(injector.get<ILogger>(), "bench", injector);
+
+  // The System's hardware belongs to its own Injector, so that its recipes resolve their
+  // dependencies (e.g. the Ref8's MemoryBus) from the System rather than from the app
+  auto &systemInjector = system.get_injector();
+  systemInjector.addCtorRecipe<MemoryBus, ILogger &>();
+  systemInjector.addCtorRecipe<cpu::Ref8, ILogger &, MemoryBus &>();
+
+  auto      &bus = systemInjector.get<MemoryBus>();
+  const auto ram = bus.add_ram(0x0000, 0x10000);
+  std::copy(BENCH_PROGRAM.begin(), BENCH_PROGRAM.end(), ram.begin());
+
+  system.make_static_component_list<cpu::Ref8>();
+  system.set_timeslice(BENCH_TIMESLICE);
+
+  // The debugging tools force the CPU into its interpreter, so they are only attached on request
+  std::unique_ptr<AttachedDebugTools> debugTools;
+  if(propertyMap.get_prop<bool>(props::INTERACTIVE).get()) {
+    debugTools =
+      std::make_unique<AttachedDebugTools>(injector, systemInjector.get<cpu::Ref8>(), bus);
+
+    [[maybe_unused]] auto &cliinput    = injector.get<util::CLIInput>();
+    [[maybe_unused]] auto &interpreter = injector.get<Interpreter>();
+    interpreter.start();
+  }
+
+  const std::string hashesPath = propertyMap.get_prop<std::string>(props::BENCH_HASHES).get();
+
+  std::unique_ptr<StateHasher> hasher;
+  Benchmark::FrameFn_t         onFrame;
+  if(!hashesPath.empty()) {
+    hasher  = std::make_unique<StateHasher>(system, &bus);
+    onFrame = [&](U64) { hasher->hash_frame(); };
+  }
+
+  const BenchReport report = benchmark.run(system, BENCH_CYCLES_PER_FRAME, onFrame);
+
+  if(hasher) {
+    hasher->write(hashesPath);
+  }
+
+  const std::string reportPath = propertyMap.get_prop<std::string>(props::BENCH_REPORT).get();
+  if(reportPath.empty()) {
+    Benchmark::write_json(report, std::cout);
+  }
+  else {
+    std::ofstream ofs(reportPath);
+    Benchmark::write_json(report, ofs);
+    if(!ofs) {
+      throw std::runtime_error("Failed to write benchmark report: " + reportPath);
+    }
+  }
+
+  return benchmark.check_baseline(report);
+}
+
+/**
+ * Print every entry retained in a trace file; returns the process exit code.
+ */
+int run_trace_decode(const std::string &path) {
+  const TraceReader reader(path);
+  reader.decode(std::cout);
+  return 0;
+}
+
+/**
+ * Report the first entry at which two trace files diverge, along with each trace's version of it;
+ * returns the process exit code, which is 1 if they diverge.
+ */
+int run_trace_diff(const std::string &pathA, const std::string &pathB) {
+  const TraceReader a(pathA);
+  const TraceReader b(pathB);
+
+  const auto divergence = TraceReader::first_divergence(a, b);
+  if(!divergence) {
+    std::cout << "The traces are identical (" << a.count() << " entries)\n";
+    return 0;
+  }
+
+  const U64 seq = *divergence;
+  std::cout << "The traces diverge at entry " << seq << '\n';
+  for(const auto &[path, reader] : {std::pair{pathA, &a}, std::pair{pathB, &b}}) {
+    std::cout << "  " << path << ": ";
+    if(seq < reader->count()) {
+      std::cout << TraceReader::format(seq, reader->at(seq - reader->first())) << '\n';
+    }
+    else {
+      std::cout << "(end of trace)\n";
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Report the first frame at which two hash streams differ; returns the process exit code, which is
+ * 1 if they differ.
+ */
+int run_hash_diff(const std::string &pathA, const std::string &pathB) {
+  const auto a = StateHasher::read(pathA);
+  const auto b = StateHasher::read(pathB);
+
+  const auto mismatch = StateHasher::first_mismatch(a, b);
+  if(!mismatch) {
+    std::cout << "The hash streams are identical (" << a.size() << " frames)\n";
+    return 0;
+  }
+
+  std::cout << "The hash streams differ at frame " << *mismatch << '\n';
+  return 1;
+}
+
+}  // namespace
+
 int oml_main(const int argc, const char **argv) {
   try {
+    util::profiler::set_thread_name("main");
+
     di::Injector injector;
     di::Injector::installMinimalRules(injector);
 
     auto &cliparser = injector.get<util::CLIParser>();
     cliparser.parse_args(argc, argv);
 
+    // The trace and hash tools only read files, so they need none of the app's other dependencies
+    auto      &cliProps    = injector.get<PropertyMap>();
+    const auto traceDecode = cliProps.get_prop<std::string>(props::TRACE_DECODE).get();
+    if(!traceDecode.empty()) {
+      return run_trace_decode(traceDecode);
+    }
+
+    const auto traceDiff = cliProps.get_prop<std::string>(props::TRACE_DIFF).get();
+    if(!traceDiff.empty()) {
+      return run_trace_diff(traceDiff,
+                            cliProps.get_prop<std::string>(props::TRACE_AGAINST).get());
+    }
+
+    const auto hashDiff = cliProps.get_prop<std::string>(props::HASH_DIFF).get();
+    if(!hashDiff.empty()) {
+      return run_hash_diff(hashDiff, cliProps.get_prop<std::string>(props::HASH_AGAINST).get());
+    }
+
+    // Benchmarks are always headless, and run on a virtual clock so that nothing waits on real time
+    const bool isBench = injector.get<PropertyMap>().get_prop<bool>(props::BENCH).get();
+    if(isBench) {
+      auto &propertyMap = injector.get<PropertyMap>();
+      propertyMap.get_prop<bool>(props::HEADLESS).set(true);
+      propertyMap.get_prop<std::string>(props::CLOCK).set("virtual");
+      propertyMap.get_prop<std::string>(props::CLOCK_SPEED).set("unlimited");
+    }
+
     di::Injector::installDefaultRules(injector);
 
     // TODO: find a better place to initialize these
@@ -42,6 +267,10 @@ int oml_main(const int argc, const char **argv) {
     propertyMap.get_prop<std::string>(props::RESOURCE_DIR)
       .set(std::filesystem::absolute(*argv).parent_path().string());
 
+    if(isBench) {
+      return run_benchmark(injector);
+    }
+
     auto &wnd = injector.get<IWindow>();
     // The window MUST be shown prior to creating the graphics backend, otherwise we may not be able
     // to associate the window with the graphics API.
@@ -1,5 +1,6 @@
 #include "omulator/msg/MailboxEndpoint.hpp"
 
+#include "omulator/util/Profiler.hpp"
 #include "omulator/util/to_underlying.hpp"
 
 #include <cassert>
@@ -71,6 +72,8 @@ void MailboxEndpoint::recv(RecvBehavior recvBehavior) {
     MessageQueue    &currentMQ = queue_.front();
 
     currentMQ.pump_msgs([this](const Message &msg) {
+      OML_PROFILE_SPAN("MailboxEndpoint::dispatch", util::to_underlying(msg.type));
+
       auto it = callbacks_.find(msg.type);
       if(it != callbacks_.end()) {
         it->second(msg);
@@ -89,6 +92,18 @@ void MailboxEndpoint::recv(RecvBehavior recvBehavior) {
   }
 }
 
+bool MailboxEndpoint::recv_until(const TimePoint_t deadline) {
+  {
+    std::unique_lock lck{mtx_};
+    if(!cv_.wait_until(lck, deadline, [this] { return !(queue_.empty()); })) {
+      return false;
+    }
+  }
+
+  recv(RecvBehavior::NONBLOCK);
+  return true;
+}
+
 void MailboxEndpoint::send(MessageQueue &mq) {
   if(!mq.valid()) {
     logger_.error("Attempted to send an invalid MessageQueue");
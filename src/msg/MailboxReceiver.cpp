@@ -12,4 +12,8 @@ void MailboxReceiver::on(const MessageType type, std::function<void(void)> callb
 
 void MailboxReceiver::recv(RecvBehavior recvBehavior) { endpoint_.recv(recvBehavior); }
 
+bool MailboxReceiver::recv_until(const TimePoint_t deadline) {
+  return endpoint_.recv_until(deadline);
+}
+
 }  // namespace omulator::msg
@@ -13,9 +13,22 @@ namespace {
  * Maps CLI switches to internal property names.
  */
 const std::map<std::string_view, std::string_view> cliArgToProp{
-  {"--headless",    omulator::props::HEADLESS   },
-  {"--interactive", omulator::props::INTERACTIVE},
-  {"--vkdebug",     omulator::props::VKDEBUG    },
+  {"--audio-wav",      omulator::props::AUDIO_WAV     },
+  {"--bench",          omulator::props::BENCH         },
+  {"--bench-baseline", omulator::props::BENCH_BASELINE},
+  {"--bench-frames",   omulator::props::BENCH_FRAMES  },
+  {"--bench-hashes",   omulator::props::BENCH_HASHES  },
+  {"--bench-report",   omulator::props::BENCH_REPORT  },
+  {"--clock",          omulator::props::CLOCK         },
+  {"--clock-speed",    omulator::props::CLOCK_SPEED   },
+  {"--hash-against",   omulator::props::HASH_AGAINST  },
+  {"--hash-diff",      omulator::props::HASH_DIFF     },
+  {"--headless",       omulator::props::HEADLESS      },
+  {"--interactive",    omulator::props::INTERACTIVE   },
+  {"--trace-against",  omulator::props::TRACE_AGAINST },
+  {"--trace-decode",   omulator::props::TRACE_DECODE  },
+  {"--trace-diff",     omulator::props::TRACE_DIFF    },
+  {"--vkdebug",        omulator::props::VKDEBUG       },
 };
 
 /**
@@ -25,12 +38,30 @@ const std::map<std::string_view, std::string_view> cliArgToProp{
  * prematurely and print the help message if either flag is provided.
  */
 constexpr auto USAGE = R"(
-Usage: omulator [--help] [--headless] [--interactive] [--vkdebug]
+Usage:
+  omulator [--help] [--headless] [--interactive] [--vkdebug] [--clock=<type>] [--clock-speed=<mult>] [--audio-wav=<file>]
+  omulator --bench [--bench-frames=<n>] [--bench-baseline=<file>] [--bench-report=<file>] [--bench-hashes=<file>] [--interactive]
+  omulator --trace-decode=<file>
+  omulator --trace-diff=<file> --trace-against=<file>
+  omulator --hash-diff=<file> --hash-against=<file>
 
---help         Show this help
---headless     Run without a GUI window
---interactive  Accept input from stdin, which will be interpreted as Python code   
---vkdebug      Perform additional Vulkan validation (will cause application slowdown)
+--help                   Show this help
+--headless               Run without a GUI window
+--interactive            Accept input from stdin, which will be interpreted as Python code   
+--vkdebug                Perform additional Vulkan validation (will cause application slowdown)
+--clock=<type>           Use the 'real' clock or a deterministic 'virtual' clock [default: real]
+--clock-speed=<mult>     Speed multiplier for the virtual clock, or 'unlimited' [default: unlimited]
+--audio-wav=<file>       Record the audio output to a WAV file instead of playing it
+--bench                  Run the benchmark System headless and report its performance as JSON
+--bench-frames=<n>       Number of emulated frames to run the benchmark for [default: 600]
+--bench-baseline=<file>  Exit with status 2 if the benchmark is slower than this previous report
+--bench-report=<file>    Write the benchmark report to a file rather than to stdout
+--bench-hashes=<file>    Write a hash of the benchmark System's state after each frame to a file
+--trace-decode=<file>    Print the entries of an instruction trace file as text
+--trace-diff=<file>      Report the first entry at which two instruction trace files diverge
+--trace-against=<file>   The trace file to compare with --trace-diff
+--hash-diff=<file>       Report the first frame at which two state hash files differ
+--hash-against=<file>    The hash file to compare with --hash-diff
 )";
 }  // namespace
 
@@ -59,6 +90,10 @@ void CLIParser::parse_args(const int argc, const char **argv) {
       else if(v.isString()) {
         propertyMap_.get_prop<std::string>(propName).set(v.asString());
       }
+      else if(!v) {
+        // An option which takes a value, has no default, and was not given; leave it unset
+        continue;
+      }
       else {
         // Should never happen unless something is set up incorrectly in the USAGE string
         std::string msg = "Failed to parse arg: ";
@@ -0,0 +1,61 @@
+#include "omulator/util/ExecutableMemory.hpp"
+
+#include <stdexcept>
+
+namespace omulator::util {
+
+void ExecutableMemory::make_writable() { make_writable(data_, size_); }
+
+void ExecutableMemory::make_writable(U8 *const begin, const std::size_t len) {
+  const U8 *const end = data_ + size_;
+  if(begin < data_ || begin > end || len > static_cast<std::size_t>(end - begin)) {
+    throw std::out_of_range("Range passed to ExecutableMemory::make_writable is out of bounds");
+  }
+
+  if(len == 0) {
+    return;
+  }
+
+  const auto        offset = static_cast<std::size_t>(begin - data_);
+  const std::size_t first  = offset / pageSize_;
+  const std::size_t last   = (offset + len - 1) / pageSize_;
+
+  // Change the protection of each run of executable pages with a single call
+  std::size_t page = first;
+  while(page <= last) {
+    if(writable_[page]) {
+      ++page;
+      continue;
+    }
+
+    const std::size_t runStart = page;
+    while(page <= last && !writable_[page]) {
+      writable_[page] = true;
+      ++page;
+    }
+
+    protect_(runStart, page - runStart, false);
+    numWritable_ += page - runStart;
+  }
+}
+
+void ExecutableMemory::make_executable() {
+  std::size_t page = 0;
+  while(numWritable_ > 0) {
+    if(!writable_[page]) {
+      ++page;
+      continue;
+    }
+
+    const std::size_t runStart = page;
+    while(page < writable_.size() && writable_[page]) {
+      writable_[page] = false;
+      ++page;
+    }
+
+    protect_(runStart, page - runStart, true);
+    numWritable_ -= page - runStart;
+  }
+}
+
+}  // namespace omulator::util
@@ -0,0 +1,214 @@
+#include "omulator/util/Hash64.hpp"
+
+#ifdef OML_ARCH_X64
+#include "omulator/util/intrinsics.hpp"
+#endif /* ifdef OML_ARCH_X64 */
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+
+constexpr std::size_t STRIPE_SIZE       = 64;
+constexpr std::size_t NUM_LANES         = STRIPE_SIZE / sizeof(U64);
+constexpr std::size_t STRIPES_PER_BLOCK = 16;
+
+constexpr U64 PRIME32_1 = 0x9E3779B1U;
+constexpr U64 PRIME32_2 = 0x85EBCA77U;
+constexpr U64 PRIME32_3 = 0xC2B2AE3DU;
+constexpr U64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr U64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr U64 PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr U64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr U64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+using Lanes_t = std::array<U64, NUM_LANES>;
+
+/**
+ * Each stripe of a block uses its own set of keys, starting one lane further along; otherwise the
+ * accumulators would be the same no matter which stripe of a block a given lane of data was in.
+ */
+constexpr std::size_t NUM_STRIPE_KEYS = NUM_LANES + STRIPES_PER_BLOCK - 1;
+
+using StripeKeys_t = std::array<U64, NUM_STRIPE_KEYS>;
+
+constexpr U64 splitmix64(U64 &state) noexcept {
+  U64 z = (state += 0x9E3779B97F4A7C15ULL);
+  z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z     = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Key material for the stripes, the scrambles and the final merge, generated at compile time.
+ */
+struct Keys {
+  StripeKeys_t stripe;
+  Lanes_t      scramble;
+  Lanes_t      merge;
+};
+
+constexpr Keys KEYS = [] {
+  Keys keys{};
+  U64  state = PRIME64_5;
+  for(U64 &key : keys.stripe) {
+    key = splitmix64(state);
+  }
+  for(U64 &key : keys.scramble) {
+    key = splitmix64(state);
+  }
+  for(U64 &key : keys.merge) {
+    key = splitmix64(state);
+  }
+  return keys;
+}();
+
+/**
+ * The full 128-bit product of a and b, with its halves XORed together. Only used to merge the
+ * accumulators, so it is written portably rather than with __int128 or _umul128.
+ */
+U64 mul128_fold64(const U64 a, const U64 b) noexcept {
+  const U64 aLo = a & 0xFFFF'FFFF;
+  const U64 aHi = a >> 32;
+  const U64 bLo = b & 0xFFFF'FFFF;
+  const U64 bHi = b >> 32;
+
+  const U64 loLo  = aLo * bLo;
+  const U64 hiLo  = aHi * bLo;
+  const U64 loHi  = aLo * bHi;
+  const U64 hiHi  = aHi * bHi;
+  const U64 cross = (loLo >> 32) + (hiLo & 0xFFFF'FFFF) + loHi;
+
+  const U64 lo = (cross << 32) | (loLo & 0xFFFF'FFFF);
+  const U64 hi = (hiLo >> 32) + (cross >> 32) + hiHi;
+  return lo ^ hi;
+}
+
+U64 avalanche(U64 h) noexcept {
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+#ifdef OML_ARCH_X64
+
+/**
+ * For each lane: acc[lane ^ 1] += data, and acc[lane] += lo32(data ^ key) * hi32(data ^ key).
+ */
+void accumulate_stripe(Lanes_t &acc, const U8 *const stripe, const U64 *const keys) noexcept {
+  for(std::size_t i = 0; i < NUM_LANES; i += 2) {
+    __m128i *const accPtr = reinterpret_cast<__m128i *>(acc.data() + i);
+
+    const __m128i data      = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe) + i / 2);
+    const __m128i key       = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+    const __m128i dataKey   = _mm_xor_si128(data, key);
+    const __m128i dataKeyHi = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(3, 3, 1, 1));
+    const __m128i product   = _mm_mul_epu32(dataKey, dataKeyHi);
+    const __m128i swapped   = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+    const __m128i sum = _mm_add_epi64(_mm_loadu_si128(accPtr), swapped);
+    _mm_storeu_si128(accPtr, _mm_add_epi64(product, sum));
+  }
+}
+
+/**
+ * For each lane: acc = (acc ^ (acc >> 47) ^ key) * PRIME32_1.
+ */
+void scramble(Lanes_t &acc, const Lanes_t &keys) noexcept {
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(static_cast<U32>(PRIME32_1)));
+
+  for(std::size_t i = 0; i < NUM_LANES; i += 2) {
+    __m128i *const accPtr = reinterpret_cast<__m128i *>(acc.data() + i);
+
+    const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys.data() + i));
+    __m128i       val = _mm_loadu_si128(accPtr);
+    val               = _mm_xor_si128(val, _mm_srli_epi64(val, 47));
+    val               = _mm_xor_si128(val, key);
+
+    // There is no 64-bit multiply in SSE2, so multiply the low and high halves separately
+    const __m128i productLo = _mm_mul_epu32(val, prime);
+    const __m128i productHi = _mm_mul_epu32(_mm_srli_epi64(val, 32), prime);
+    _mm_storeu_si128(accPtr, _mm_add_epi64(productLo, _mm_slli_epi64(productHi, 32)));
+  }
+}
+
+#else
+
+U64 load64(const U8 *const src) noexcept {
+  U64 val;
+  std::memcpy(&val, src, sizeof(val));
+  return val;
+}
+
+void accumulate_stripe(Lanes_t &acc, const U8 *const stripe, const U64 *const keys) noexcept {
+  for(std::size_t i = 0; i < NUM_LANES; ++i) {
+    const U64 data    = load64(stripe + i * sizeof(U64));
+    const U64 dataKey = data ^ keys[i];
+    acc[i ^ 1] += data;
+    acc[i] += (dataKey & 0xFFFF'FFFF) * (dataKey >> 32);
+  }
+}
+
+void scramble(Lanes_t &acc, const Lanes_t &keys) noexcept {
+  for(std::size_t i = 0; i < NUM_LANES; ++i) {
+    acc[i] = (acc[i] ^ (acc[i] >> 47) ^ keys[i]) * PRIME32_1;
+  }
+}
+
+#endif /* ifdef OML_ARCH_X64 */
+
+}  // namespace
+
+namespace omulator::util {
+
+U64 hash64(std::span<const U8> data, const U64 seed) noexcept {
+  StripeKeys_t stripeKeys;
+  for(std::size_t i = 0; i < NUM_STRIPE_KEYS; ++i) {
+    stripeKeys[i] = KEYS.stripe[i] + seed;
+  }
+
+  Lanes_t acc{
+    PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+
+  const U8         *p         = data.data();
+  const std::size_t n         = data.size();
+  const std::size_t numBlocks = n / (STRIPE_SIZE * STRIPES_PER_BLOCK);
+  for(std::size_t block = 0; block < numBlocks; ++block) {
+    for(std::size_t i = 0; i < STRIPES_PER_BLOCK; ++i) {
+      accumulate_stripe(acc, p, stripeKeys.data() + i);
+      p += STRIPE_SIZE;
+    }
+    scramble(acc, KEYS.scramble);
+  }
+
+  // What remains is less than a block, so each stripe still has its own keys
+  const U8 *const end    = data.data() + n;
+  std::size_t     stripe = 0;
+  while(static_cast<std::size_t>(end - p) >= STRIPE_SIZE) {
+    accumulate_stripe(acc, p, stripeKeys.data() + stripe++);
+    p += STRIPE_SIZE;
+  }
+
+  // The final partial stripe is zero-padded; the length is mixed in below, so that trailing zeroes
+  // still change the hash
+  if(p != end) {
+    std::array<U8, STRIPE_SIZE> last{};
+    std::memcpy(last.data(), p, static_cast<std::size_t>(end - p));
+    accumulate_stripe(acc, last.data(), stripeKeys.data() + stripe);
+  }
+
+  U64 h = (static_cast<U64>(n) * PRIME64_1) ^ seed;
+  for(std::size_t i = 0; i < NUM_LANES; i += 2) {
+    h += mul128_fold64(acc[i] ^ KEYS.merge[i], acc[i + 1] ^ KEYS.merge[i + 1]);
+  }
+
+  return avalanche(h);
+}
+
+}  // namespace omulator::util
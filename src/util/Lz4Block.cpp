@@ -0,0 +1,203 @@
+#include "omulator/util/Lz4Block.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+using omulator::U32;
+using omulator::U8;
+
+constexpr std::size_t MIN_MATCH  = 4;
+constexpr std::size_t MAX_OFFSET = 0xFFFF;
+
+/**
+ * The format requires the last 5 bytes to be literals, and the last match to start at least 12
+ * bytes before the end of the block, so that decoders can copy in wide chunks without checking
+ * every byte.
+ */
+constexpr std::size_t LAST_LITERALS = 5;
+constexpr std::size_t MF_LIMIT      = 12;
+
+constexpr std::size_t HASH_BITS = 12;
+
+/**
+ * After this many consecutive positions without a match, the compressor starts skipping ahead
+ * further on each miss, so that incompressible data is passed over quickly.
+ */
+constexpr std::size_t SKIP_TRIGGER = 6;
+
+constexpr U8 RUN_MASK = 0x0F;
+
+U32 load32(const U8 *const src) noexcept {
+  U32 val;
+  std::memcpy(&val, src, sizeof(val));
+  return val;
+}
+
+std::size_t hash_pos(const U8 *const src) noexcept {
+  return static_cast<std::size_t>((load32(src) * 2654435761U) >> (32 - HASH_BITS));
+}
+
+/**
+ * Write the remainder of a length which didn't fit in its token nibble.
+ */
+void put_length(std::vector<U8> &out, std::size_t len) {
+  while(len >= 0xFF) {
+    out.push_back(0xFF);
+    len -= 0xFF;
+  }
+  out.push_back(static_cast<U8>(len));
+}
+
+std::size_t get_length(std::span<const U8> src, std::size_t &pos, std::size_t len) {
+  U8 byte;
+  do {
+    if(pos == src.size()) {
+      throw std::runtime_error("Malformed LZ4 block: truncated length");
+    }
+
+    byte = src[pos++];
+    len += byte;
+  } while(byte == 0xFF);
+
+  return len;
+}
+
+void put_literals(std::vector<U8> &out, const U8 *const literals, const std::size_t len) {
+  const std::size_t pos = out.size();
+  out.resize(pos + len);
+  if(len > 0) {
+    std::memcpy(out.data() + pos, literals, len);
+  }
+}
+
+}  // namespace
+
+namespace omulator::util {
+
+void lz4_compress(std::span<const U8> src, std::vector<U8> &out) {
+  const U8 *const   p      = src.data();
+  const std::size_t n      = src.size();
+  std::size_t       anchor = 0;
+
+  if(n >= MF_LIMIT + 1) {
+    std::array<std::size_t, std::size_t{1} << HASH_BITS> table{};
+
+    const std::size_t matchLimit = n - LAST_LITERALS;
+    std::size_t       pos        = 0;
+    std::size_t       misses     = 0;
+
+    while(pos + MF_LIMIT <= n) {
+      const std::size_t h    = hash_pos(p + pos);
+      const std::size_t cand = table[h];
+      table[h]               = pos;
+
+      if(cand >= pos || pos - cand > MAX_OFFSET || load32(p + cand) != load32(p + pos)) {
+        pos += 1 + (misses++ >> SKIP_TRIGGER);
+        continue;
+      }
+
+      std::size_t len = MIN_MATCH;
+      while(pos + len < matchLimit && p[cand + len] == p[pos + len]) {
+        ++len;
+      }
+
+      const std::size_t litLen   = pos - anchor;
+      const std::size_t matchLen = len - MIN_MATCH;
+      out.push_back(static_cast<U8>(((litLen < RUN_MASK ? litLen : RUN_MASK) << 4)
+                                    | (matchLen < RUN_MASK ? matchLen : RUN_MASK)));
+      if(litLen >= RUN_MASK) {
+        put_length(out, litLen - RUN_MASK);
+      }
+      put_literals(out, p + anchor, litLen);
+
+      const std::size_t offset = pos - cand;
+      out.push_back(static_cast<U8>(offset));
+      out.push_back(static_cast<U8>(offset >> 8));
+      if(matchLen >= RUN_MASK) {
+        put_length(out, matchLen - RUN_MASK);
+      }
+
+      pos += len;
+      anchor = pos;
+      misses = 0;
+    }
+  }
+
+  const std::size_t litLen = n - anchor;
+  out.push_back(static_cast<U8>((litLen < RUN_MASK ? litLen : RUN_MASK) << 4));
+  if(litLen >= RUN_MASK) {
+    put_length(out, litLen - RUN_MASK);
+  }
+  put_literals(out, p + anchor, litLen);
+}
+
+void lz4_decompress(std::span<const U8> src, std::span<U8> dst) {
+  std::size_t ip = 0;
+  std::size_t op = 0;
+
+  while(true) {
+    if(ip == src.size()) {
+      throw std::runtime_error("Malformed LZ4 block: truncated sequence");
+    }
+
+    const U8    token  = src[ip++];
+    std::size_t litLen = token >> 4;
+    if(litLen == RUN_MASK) {
+      litLen = get_length(src, ip, litLen);
+    }
+
+    if(litLen > src.size() - ip || litLen > dst.size() - op) {
+      throw std::runtime_error("Malformed LZ4 block: literals extend past the end of the block");
+    }
+
+    if(litLen > 0) {
+      std::memcpy(dst.data() + op, src.data() + ip, litLen);
+    }
+    ip += litLen;
+    op += litLen;
+
+    // The last sequence has no match
+    if(ip == src.size()) {
+      break;
+    }
+
+    if(src.size() - ip < 2) {
+      throw std::runtime_error("Malformed LZ4 block: truncated offset");
+    }
+
+    const std::size_t offset = src[ip] | (std::size_t{src[ip + 1]} << 8);
+    ip += 2;
+
+    std::size_t matchLen = token & RUN_MASK;
+    if(matchLen == RUN_MASK) {
+      matchLen = get_length(src, ip, matchLen);
+    }
+    matchLen += MIN_MATCH;
+
+    if(offset == 0 || offset > op || matchLen > dst.size() - op) {
+      throw std::runtime_error("Malformed LZ4 block: match extends outside of the output");
+    }
+
+    // Matches may overlap the bytes they produce, e.g. an offset of 1 repeats a single byte
+    U8 *const       out = dst.data() + op;
+    const U8 *const in  = out - offset;
+    if(offset >= matchLen) {
+      std::memcpy(out, in, matchLen);
+    }
+    else {
+      for(std::size_t i = 0; i < matchLen; ++i) {
+        out[i] = in[i];
+      }
+    }
+    op += matchLen;
+  }
+
+  if(op != dst.size()) {
+    throw std::runtime_error("Malformed LZ4 block: decompressed size does not match");
+  }
+}
+
+}  // namespace omulator::util
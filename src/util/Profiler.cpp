@@ -0,0 +1,276 @@
+#include "omulator/util/Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace omulator::util::profiler {
+
+namespace detail {
+  std::atomic_bool enabledFlag = false;
+}  // namespace detail
+
+namespace {
+
+/**
+ * A single span. The fields are atomic only so that an export can safely run concurrently with the
+ * owning thread; all accesses are relaxed, which compiles to plain loads and stores on x64.
+ */
+struct Event {
+  std::atomic<const char *> name;
+  std::atomic<U64>          nameLen;
+  std::atomic<U64>          begin;
+  std::atomic<U64>          end;
+  std::atomic<U64>          arg;
+};
+
+/**
+ * Ring buffer of spans, written only by the owning thread. head and tail are monotonically
+ * increasing counts of events, rather than indices into the ring.
+ */
+struct ThreadBuffer {
+  std::unique_ptr<Event[]> events{new Event[RING_CAPACITY]};
+
+  /**
+   * The total number of events ever written.
+   */
+  std::atomic<U64> head{0};
+
+  /**
+   * Events before this point were discarded by clear().
+   */
+  std::atomic<U64> tail{0};
+
+  U64 tid{0};
+
+  /**
+   * Guarded by Registry::mtx.
+   */
+  std::string name;
+};
+
+/**
+ * Keeps every ThreadBuffer alive until the end of the program, so that spans recorded by threads
+ * which have since exited can still be exported.
+ */
+struct Registry {
+  std::mutex                                 mtx;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  U64                                        nextTid = 1;
+};
+
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+/**
+ * Reference point used to convert TSC values to wall clock time; the longer the interval between
+ * this and the time of export, the more accurate the conversion.
+ */
+struct Calibration {
+  U64                                   tsc;
+  std::chrono::steady_clock::time_point time;
+};
+
+const Calibration calibrationOrigin{OML_INTRIN_RDTSC(), std::chrono::steady_clock::now()};
+
+thread_local std::shared_ptr<ThreadBuffer> tlsBuffer;
+thread_local std::string                   tlsName;
+
+ThreadBuffer &register_thread() {
+  auto  pBuffer = std::make_shared<ThreadBuffer>();
+  auto &reg     = registry();
+
+  std::scoped_lock lck(reg.mtx);
+  pBuffer->tid  = reg.nextTid++;
+  pBuffer->name = tlsName;
+  reg.buffers.push_back(pBuffer);
+  tlsBuffer = std::move(pBuffer);
+
+  return *tlsBuffer;
+}
+
+void write_json_string(std::ostream &os, std::string_view str) {
+  constexpr std::string_view HEX_DIGITS = "0123456789abcdef";
+
+  os << '"';
+  for(const char c : str) {
+    if(c == '"' || c == '\\') {
+      os << '\\' << c;
+    }
+    else if(static_cast<unsigned char>(c) < 0x20) {
+      const auto uc = static_cast<unsigned char>(c);
+      os << "\\u00" << HEX_DIGITS[uc >> 4] << HEX_DIGITS[uc & 0xF];
+    }
+    else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+}  // namespace
+
+void enable() noexcept { detail::enabledFlag.store(true, std::memory_order_relaxed); }
+
+void disable() noexcept { detail::enabledFlag.store(false, std::memory_order_relaxed); }
+
+void clear() {
+  auto            &reg = registry();
+  std::scoped_lock lck(reg.mtx);
+  for(auto &pBuffer : reg.buffers) {
+    pBuffer->tail.store(pBuffer->head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+}
+
+void set_thread_name(std::string_view name) {
+  tlsName = name;
+
+  if(tlsBuffer) {
+    auto            &reg = registry();
+    std::scoped_lock lck(reg.mtx);
+    tlsBuffer->name = tlsName;
+  }
+}
+
+void record(std::string_view name, const U64 begin, const U64 end, const U64 arg) noexcept {
+  // Allocating the buffer can throw, in which case we have no choice but to drop the span
+  ThreadBuffer *pBuffer = tlsBuffer.get();
+  if(pBuffer == nullptr) [[unlikely]] {
+    try {
+      pBuffer = &register_thread();
+    }
+    catch(...) {
+      return;
+    }
+  }
+
+  const U64 idx = pBuffer->head.load(std::memory_order_relaxed);
+  Event    &evt = pBuffer->events[idx % RING_CAPACITY];
+  evt.name.store(name.data(), std::memory_order_relaxed);
+  evt.nameLen.store(name.size(), std::memory_order_relaxed);
+  evt.begin.store(begin, std::memory_order_relaxed);
+  evt.end.store(end, std::memory_order_relaxed);
+  evt.arg.store(arg, std::memory_order_relaxed);
+  pBuffer->head.store(idx + 1, std::memory_order_release);
+}
+
+void export_chrome_trace(std::ostream &os) {
+  struct Snapshot {
+    std::shared_ptr<ThreadBuffer> pBuffer;
+    U64                           tid;
+    std::string                   name;
+  };
+
+  std::vector<Snapshot> snapshots;
+  {
+    auto            &reg = registry();
+    std::scoped_lock lck(reg.mtx);
+    for(const auto &pBuffer : reg.buffers) {
+      snapshots.push_back({pBuffer, pBuffer->tid, pBuffer->name});
+    }
+  }
+
+  const U64  tscNow    = OML_INTRIN_RDTSC();
+  const auto timeNow   = std::chrono::steady_clock::now();
+  const auto elapsedUs = std::chrono::duration<double, std::micro>(timeNow - calibrationOrigin.time);
+  const double ticksPerUs =
+    elapsedUs.count() > 0.0
+      ? static_cast<double>(tscNow - calibrationOrigin.tsc) / elapsedUs.count()
+      : 1.0;
+
+  const auto to_us = [&](const U64 tsc) {
+    return static_cast<double>(tsc - calibrationOrigin.tsc) / ticksPerUs;
+  };
+
+  const auto oldFlags     = os.flags();
+  const auto oldPrecision = os.precision();
+  os.setf(std::ios::fixed, std::ios::floatfield);
+  os.precision(3);
+
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+
+  const auto begin_event = [&] {
+    if(!first) {
+      os << ',';
+    }
+    first = false;
+  };
+
+  for(const auto &snapshot : snapshots) {
+    if(!snapshot.name.empty()) {
+      begin_event();
+      os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << snapshot.tid
+         << ",\"args\":{\"name\":";
+      write_json_string(os, snapshot.name);
+      os << "}}";
+    }
+
+    const ThreadBuffer &buffer = *snapshot.pBuffer;
+    const U64           head   = buffer.head.load(std::memory_order_acquire);
+    const U64           tail   = buffer.tail.load(std::memory_order_acquire);
+    const U64 start = std::max(tail, head > RING_CAPACITY ? head - RING_CAPACITY : U64{0});
+
+    struct EventCopy {
+      std::string_view name;
+      U64              begin;
+      U64              end;
+      U64              arg;
+    };
+    std::vector<EventCopy> copies;
+    copies.reserve(head - start);
+    for(U64 i = start; i < head; ++i) {
+      const Event &evt = buffer.events[i % RING_CAPACITY];
+      copies.push_back({std::string_view(evt.name.load(std::memory_order_relaxed),
+                                         evt.nameLen.load(std::memory_order_relaxed)),
+                        evt.begin.load(std::memory_order_relaxed),
+                        evt.end.load(std::memory_order_relaxed),
+                        evt.arg.load(std::memory_order_relaxed)});
+    }
+
+    // Any event which the owning thread may have started to overwrite while we were copying is
+    // suspect and must be dropped; the thread may currently be writing to the slot for index
+    // newHead, which is the same slot as index newHead - RING_CAPACITY.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const U64 newHead    = buffer.head.load(std::memory_order_relaxed);
+    const U64 firstValid = newHead >= RING_CAPACITY ? newHead - RING_CAPACITY + 1 : U64{0};
+
+    for(U64 i = std::max(start, firstValid); i < head; ++i) {
+      const EventCopy &evt = copies[i - start];
+      begin_event();
+      os << "{\"name\":";
+      write_json_string(os, evt.name);
+      os << ",\"cat\":\"oml\",\"ph\":\"X\",\"pid\":1,\"tid\":" << snapshot.tid
+         << ",\"ts\":" << to_us(evt.begin) << ",\"dur\":" << to_us(evt.end) - to_us(evt.begin);
+      if(evt.arg != NO_ARG) {
+        os << ",\"args\":{\"arg\":" << evt.arg << '}';
+      }
+      os << '}';
+    }
+  }
+
+  os << "]}\n";
+
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+}
+
+void export_chrome_trace(const std::filesystem::path &path) {
+  std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+  if(!ofs) {
+    std::string msg = "Could not open profiler trace file for writing: ";
+    msg += path.string();
+    throw std::runtime_error(msg);
+  }
+
+  export_chrome_trace(ofs);
+}
+
+}  // namespace omulator::util::profiler
@@ -0,0 +1,208 @@
+#include "omulator/util/Resampler.hpp"
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+#include "omulator/util/intrinsics.hpp"
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace {
+
+using omulator::util::Resampler;
+
+/**
+ * The cutoff as a fraction of the lower Nyquist frequency, leaving room for the transition band.
+ */
+constexpr double CUTOFF_SCALE = 0.9;
+
+/**
+ * The number of bits of a fixed point position which select its phase.
+ */
+constexpr int PHASE_BITS = std::countr_zero(Resampler::PHASES);
+
+static_assert(std::has_single_bit(Resampler::PHASES), "PHASES must be a power of two");
+
+/**
+ * The windowed sinc at x input samples from the centre of the filter.
+ */
+double windowed_sinc(const double x, const double cutoff) noexcept {
+  constexpr double HALF_WIDTH = Resampler::TAPS / 2;
+  if(std::abs(x) >= HALF_WIDTH) {
+    return 0.0;
+  }
+
+  const double arg    = std::numbers::pi * cutoff * x;
+  const double sinc   = x == 0.0 ? 1.0 : std::sin(arg) / arg;
+  const double theta  = std::numbers::pi * x / HALF_WIDTH;
+  const double window = 0.42 + 0.5 * std::cos(theta) + 0.08 * std::cos(2.0 * theta);
+  return cutoff * sinc * window;
+}
+
+#if defined(OML_ARCH_X64) && defined(__AVX2__)
+
+/**
+ * The dot products of both channels with the coefficients for a fractional position t between the
+ * phases at k0 and k0 + TAPS.
+ */
+std::array<float, 4> filter(const float *const k0,
+                            const float        t,
+                            const float *const left,
+                            const float *const right) noexcept {
+  const __m256 tv   = _mm256_set1_ps(t);
+  __m256       accL = _mm256_setzero_ps();
+  __m256       accR = _mm256_setzero_ps();
+
+  for(std::size_t i = 0; i < Resampler::TAPS; i += 8) {
+    const __m256 c0 = _mm256_loadu_ps(k0 + i);
+    const __m256 c1 = _mm256_loadu_ps(k0 + Resampler::TAPS + i);
+    const __m256 c  = _mm256_add_ps(c0, _mm256_mul_ps(tv, _mm256_sub_ps(c1, c0)));
+
+    accL = _mm256_add_ps(accL, _mm256_mul_ps(c, _mm256_loadu_ps(left + i)));
+    accR = _mm256_add_ps(accR, _mm256_mul_ps(c, _mm256_loadu_ps(right + i)));
+  }
+
+  // Sum both accumulators at once, leaving the left sum in lane 0 and the right sum in lane 1
+  const __m256 pairs = _mm256_hadd_ps(accL, accR);
+  __m128       sum   = _mm_add_ps(_mm256_castps256_ps128(pairs), _mm256_extractf128_ps(pairs, 1));
+  sum                = _mm_hadd_ps(sum, sum);
+
+  std::array<float, 4> result;
+  _mm_storeu_ps(result.data(), sum);
+  return result;
+}
+
+#else
+
+std::array<float, 4> filter(const float *const k0,
+                            const float        t,
+                            const float *const left,
+                            const float *const right) noexcept {
+  float sumL = 0.0F;
+  float sumR = 0.0F;
+  for(std::size_t i = 0; i < Resampler::TAPS; ++i) {
+    const float c = k0[i] + t * (k0[Resampler::TAPS + i] - k0[i]);
+    sumL += c * left[i];
+    sumR += c * right[i];
+  }
+
+  return {sumL, sumR, 0.0F, 0.0F};
+}
+
+#endif /* if defined(OML_ARCH_X64) && defined(__AVX2__) */
+
+}  // namespace
+
+namespace omulator::util {
+
+Resampler::Resampler(const double inRate, const double outRate)
+  : baseStep_{0.0}, step_{0}, adjust_{1.0}, pos_{0}, kernel_((PHASES + 1) * TAPS) {
+  if(!(inRate > 0.0) || !(outRate > 0.0)) {
+    throw std::invalid_argument("Resampler rates must be positive");
+  }
+
+  baseStep_ = inRate / outRate;
+  set_adjust(1.0);
+
+  // Row p is centred between taps TAPS / 2 - 1 and TAPS / 2, p / PHASES of the way along. Each row
+  // is normalized so that a constant input passes through unchanged.
+  const double cutoff = std::min(1.0, outRate / inRate) * CUTOFF_SCALE;
+  for(std::size_t p = 0; p <= PHASES; ++p) {
+    const double frac = static_cast<double>(p) / PHASES;
+
+    std::array<double, TAPS> row;
+    double                   sum = 0.0;
+    for(std::size_t i = 0; i < TAPS; ++i) {
+      row[i] = windowed_sinc(static_cast<double>(i) - (TAPS / 2 - 1) - frac, cutoff);
+      sum += row[i];
+    }
+
+    for(std::size_t i = 0; i < TAPS; ++i) {
+      kernel_[p * TAPS + i] = static_cast<float>(row[i] / sum);
+    }
+  }
+}
+
+void Resampler::set_adjust(const double adjust) noexcept {
+  adjust_ = adjust;
+  step_   = static_cast<U64>(std::round(std::ldexp(baseStep_ / adjust, FRAC_BITS)));
+}
+
+double Resampler::adjust() const noexcept { return adjust_; }
+
+void Resampler::push(std::span<const float> frames) {
+  if(frames.size() % 2 != 0) {
+    throw std::invalid_argument("Resampler input must be whole stereo frames");
+  }
+
+  const std::size_t offset = left_.size();
+  left_.resize(offset + frames.size() / 2);
+  right_.resize(offset + frames.size() / 2);
+  for(std::size_t i = 0; i < frames.size() / 2; ++i) {
+    left_[offset + i]  = frames[2 * i];
+    right_[offset + i] = frames[2 * i + 1];
+  }
+}
+
+std::size_t Resampler::available() const noexcept {
+  // Step through the positions exactly as mix_into() would, so that the two always agree
+  std::size_t n   = 0;
+  U64         pos = pos_;
+  while((pos >> FRAC_BITS) + TAPS <= left_.size()) {
+    ++n;
+    pos += step_;
+  }
+
+  return n;
+}
+
+std::size_t Resampler::mix_into(std::span<float> out, const float gain) {
+  const std::size_t frames   = out.size() / 2;
+  std::size_t       produced = 0;
+
+  for(; produced < frames; ++produced) {
+    const std::size_t idx = pos_ >> FRAC_BITS;
+    if(idx + TAPS > left_.size()) {
+      break;
+    }
+
+    // The bits below the phase are the fraction of the way to the next phase
+    constexpr int     T_BITS = FRAC_BITS - PHASE_BITS;
+    constexpr U64     T_MASK = (U64{1} << T_BITS) - 1;
+    const std::size_t phase  = (pos_ >> T_BITS) & (PHASES - 1);
+    const float       t      = std::ldexp(static_cast<float>(pos_ & T_MASK), -T_BITS);
+
+    const auto result =
+      filter(kernel_.data() + phase * TAPS, t, left_.data() + idx, right_.data() + idx);
+    out[2 * produced] += gain * result[0];
+    out[2 * produced + 1] += gain * result[1];
+
+    pos_ += step_;
+  }
+
+  // Drop the input which no later output frame will need
+  const std::size_t consumed = std::min<std::size_t>(pos_ >> FRAC_BITS, left_.size());
+  left_.erase(left_.begin(), left_.begin() + static_cast<std::ptrdiff_t>(consumed));
+  right_.erase(right_.begin(), right_.begin() + static_cast<std::ptrdiff_t>(consumed));
+  pos_ -= U64{consumed} << FRAC_BITS;
+
+  return produced;
+}
+
+std::size_t Resampler::reset() noexcept {
+  // The output frame at pos_ is centred on the input frame TAPS / 2 - 1 frames further on
+  const std::size_t next      = std::min(left_.size(), (pos_ >> FRAC_BITS) + TAPS / 2 - 1);
+  const std::size_t discarded = left_.size() - next;
+
+  left_.clear();
+  right_.clear();
+  pos_ = 0;
+
+  return discarded;
+}
+
+}  // namespace omulator::util
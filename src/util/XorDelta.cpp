@@ -0,0 +1,132 @@
+#include "omulator/util/XorDelta.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+using omulator::U64;
+using omulator::U8;
+
+/**
+ * Runs of unchanged bytes shorter than this are folded into the surrounding XORed data.
+ */
+constexpr std::size_t MIN_SKIP = 4;
+
+U64 load64(const U8 *const src) noexcept {
+  U64 val;
+  std::memcpy(&val, src, sizeof(val));
+  return val;
+}
+
+void put_varint(std::vector<U8> &out, U64 val) {
+  while(val >= 0x80) {
+    out.push_back(static_cast<U8>(val | 0x80));
+    val >>= 7;
+  }
+  out.push_back(static_cast<U8>(val));
+}
+
+U64 get_varint(std::span<const U8> delta, std::size_t &pos) {
+  U64 val = 0;
+  for(U64 shift = 0; shift < 64; shift += 7) {
+    if(pos == delta.size()) {
+      break;
+    }
+
+    const U8 byte = delta[pos++];
+    val |= U64{byte & 0x7Fu} << shift;
+    if((byte & 0x80) == 0) {
+      return val;
+    }
+  }
+
+  throw std::runtime_error("Malformed XOR delta: truncated or oversized varint");
+}
+
+}  // namespace
+
+namespace omulator::util {
+
+void xor_delta_encode(std::span<const U8> from, std::span<const U8> to, std::vector<U8> &out) {
+  if(from.size() != to.size()) {
+    throw std::invalid_argument("XOR deltas can only be computed between buffers of the same size");
+  }
+
+  const U8 *const   a   = from.data();
+  const U8 *const   b   = to.data();
+  const std::size_t n   = from.size();
+  std::size_t       pos = 0;
+  std::size_t       end = 0;
+
+  while(pos < n) {
+    // Skip unchanged data a word at a time, which is the common case
+    while(pos + sizeof(U64) <= n && load64(a + pos) == load64(b + pos)) {
+      pos += sizeof(U64);
+    }
+    while(pos < n && a[pos] == b[pos]) {
+      ++pos;
+    }
+
+    if(pos == n) {
+      break;
+    }
+
+    // Extend the changed run until the next sufficiently long run of unchanged bytes
+    const std::size_t runStart = pos;
+    while(pos < n) {
+      if(a[pos] != b[pos]) {
+        ++pos;
+        continue;
+      }
+
+      std::size_t gapEnd = pos;
+      while(gapEnd < n && gapEnd - pos < MIN_SKIP && a[gapEnd] == b[gapEnd]) {
+        ++gapEnd;
+      }
+
+      if(gapEnd - pos >= MIN_SKIP || gapEnd == n) {
+        break;
+      }
+
+      pos = gapEnd;
+    }
+
+    put_varint(out, runStart - end);
+    put_varint(out, pos - runStart);
+
+    const std::size_t outPos = out.size();
+    out.resize(outPos + (pos - runStart));
+    for(std::size_t i = runStart; i < pos; ++i) {
+      out[outPos + (i - runStart)] = static_cast<U8>(a[i] ^ b[i]);
+    }
+
+    end = pos;
+  }
+}
+
+void xor_delta_apply(std::span<const U8> delta, std::span<U8> buf) {
+  std::size_t deltaPos = 0;
+  std::size_t bufPos   = 0;
+
+  while(deltaPos < delta.size()) {
+    const U64 skip = get_varint(delta, deltaPos);
+    const U64 len  = get_varint(delta, deltaPos);
+
+    if(skip > buf.size() - bufPos || len > buf.size() - bufPos - skip
+       || len > delta.size() - deltaPos)
+    {
+      throw std::runtime_error("Malformed XOR delta: run extends past the end of the buffer");
+    }
+
+    bufPos += skip;
+    for(std::size_t i = 0; i < len; ++i) {
+      buf[bufPos + i] ^= delta[deltaPos + i];
+    }
+
+    bufPos += len;
+    deltaPos += len;
+  }
+}
+
+}  // namespace omulator::util
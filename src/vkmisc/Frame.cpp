@@ -1,5 +1,6 @@
 #include "omulator/vkmisc/Frame.hpp"
 
+#include "omulator/util/Profiler.hpp"
 #include "omulator/vkmisc/vkmisc.hpp"
 
 namespace {
@@ -59,6 +60,8 @@ Frame::Frame(ILogger                 &logger,
     deviceQueues_(deviceQueues) { }
 
 bool Frame::render(std::function<void(vk::raii::CommandBuffer &)> cmdfn) {
+  OML_PROFILE_SPAN("Frame::render");
+
   cmdBuff_.reset();
   pipeline_.update_dynamic_state();
 
@@ -84,6 +87,8 @@ bool Frame::render(std::function<void(vk::raii::CommandBuffer &)> cmdfn) {
 }
 
 bool Frame::wait() {
+  OML_PROFILE_SPAN("Frame::wait");
+
   const auto result = device_.waitForFences({*fence_}, VK_TRUE, GPU_MAX_TIMEOUT_NS);
   validate_vk_return(logger_, "waitForFences", result);
   // I _think_ we're good to continue if we get eTimeout here; in a situation where this times out
@@ -1,6 +1,7 @@
 #include "omulator/vkmisc/Pipeline.hpp"
 
 #include "omulator/props.hpp"
+#include "omulator/util/Profiler.hpp"
 
 #include <array>
 #include <utility>
@@ -126,6 +127,8 @@ vk::raii::Pipeline &Pipeline::pipeline() { return pipeline_; }
 vk::raii::PipelineLayout &Pipeline::pipelineLayout() { return pipelineLayout_; }
 
 void Pipeline::rebuild_pipeline() {
+  OML_PROFILE_SPAN("Pipeline::rebuild_pipeline");
+
   if(!pipelineDirty_) {
     logger_.warn("rebuild_pipeline called without a dirty pipeline");
   }
@@ -0,0 +1,45 @@
+#include "omulator/Clock.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+using omulator::Clock;
+
+namespace {
+
+/**
+ * Sleep for state.range(0) microseconds per iteration and report how far past each deadline the
+ * Clock returned.
+ */
+void BM_sleep_until(benchmark::State &state, const Clock::SleepStrategy strategy) {
+  Clock      clock(strategy);
+  const auto sleepDuration = std::chrono::microseconds(state.range(0));
+
+  for([[maybe_unused]] auto _ : state) {
+    clock.sleep_until(clock.now() + sleepDuration);
+  }
+
+  const auto   stats = clock.sleep_stats();
+  const double usPerNs = 1.0 / 1000.0;
+  state.counters["avg_overshoot_us"] =
+    static_cast<double>(stats.totalOvershoot.count()) * usPerNs
+    / static_cast<double>(stats.numSleeps);
+  state.counters["max_overshoot_us"] = static_cast<double>(stats.maxOvershoot.count()) * usPerNs;
+  state.counters["spin_window_us"]   = static_cast<double>(stats.spinWindow.count()) * usPerNs;
+}
+
+}  // namespace
+
+// 1 kHz and 60 Hz periods
+BENCHMARK_CAPTURE(BM_sleep_until, standard, Clock::SleepStrategy::STANDARD)
+  ->Arg(1'000)
+  ->Arg(16'667)
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_sleep_until, hybrid, Clock::SleepStrategy::HYBRID)
+  ->Arg(1'000)
+  ->Arg(16'667)
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
@@ -0,0 +1,127 @@
+#include "omulator/MemoryBus.hpp"
+
+#include "omulator/NullLogger.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using omulator::MemoryBus;
+using omulator::NullLogger;
+using omulator::S64;
+using omulator::U16;
+using omulator::U32;
+using omulator::U8;
+
+namespace {
+
+constexpr U32 ACCESSES_PER_ITERATION = 1 << 16;
+
+/**
+ * A 64 KiB address space with 4 KiB pages: 32 KiB of RAM, 16 KiB of ROM, and an MMIO page at the
+ * top.
+ */
+struct BusFixture {
+  BusFixture() : bus(logger, 16, 12), rom(0x4000, 0xA5) {
+    bus.add_ram(0x0000, 0x8000);
+    bus.map_rom(0x8000, rom);
+    bus.map_mmio(
+      0xF000,
+      0x1000,
+      [this](const U32 addr) { return static_cast<U8>(addr ^ latch); },
+      [this]([[maybe_unused]] const U32 addr, const U8 val) { latch = val; });
+  }
+
+  NullLogger      logger;
+  MemoryBus       bus;
+  std::vector<U8> rom;
+  U8              latch = 0;
+};
+
+/**
+ * A sequence of addresses within [0, range), visited in a pseudorandom order so that the accesses
+ * aren't trivially predictable.
+ */
+std::vector<U32> random_addresses(const U32 base, const U32 range) {
+  std::vector<U32> addrs(ACCESSES_PER_ITERATION);
+  U32              x = 0x12345678;
+  for(auto &addr : addrs) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    addr = base + (x % range);
+  }
+  return addrs;
+}
+
+void BM_read_sequential(benchmark::State &state) {
+  BusFixture fixture;
+  for(auto _ : state) {
+    U32 acc = 0;
+    for(U32 addr = 0; addr < ACCESSES_PER_ITERATION; ++addr) {
+      acc += fixture.bus.read8(addr & 0xBFFF);
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * S64{ACCESSES_PER_ITERATION});
+}
+BENCHMARK(BM_read_sequential);
+
+void BM_write_sequential(benchmark::State &state) {
+  BusFixture fixture;
+  for(auto _ : state) {
+    for(U32 addr = 0; addr < ACCESSES_PER_ITERATION; ++addr) {
+      fixture.bus.write8(addr & 0x7FFF, static_cast<U8>(addr));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * S64{ACCESSES_PER_ITERATION});
+}
+BENCHMARK(BM_write_sequential);
+
+void BM_read16_random(benchmark::State &state) {
+  BusFixture       fixture;
+  std::vector<U32> addrs = random_addresses(0x0000, 0xC000);
+  for(auto _ : state) {
+    U32 acc = 0;
+    for(const U32 addr : addrs) {
+      acc += fixture.bus.read<U16>(addr);
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * S64{ACCESSES_PER_ITERATION});
+}
+BENCHMARK(BM_read16_random);
+
+void BM_write16_random(benchmark::State &state) {
+  BusFixture       fixture;
+  std::vector<U32> addrs = random_addresses(0x0000, 0x8000);
+  for(auto _ : state) {
+    for(const U32 addr : addrs) {
+      fixture.bus.write<U16>(addr, static_cast<U16>(addr));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * S64{ACCESSES_PER_ITERATION});
+}
+BENCHMARK(BM_write16_random);
+
+/**
+ * Every access goes down the slow path to an MMIO handler, for comparison with the fast path.
+ */
+void BM_mmio(benchmark::State &state) {
+  BusFixture       fixture;
+  std::vector<U32> addrs = random_addresses(0xF000, 0x1000);
+  for(auto _ : state) {
+    U32 acc = 0;
+    for(const U32 addr : addrs) {
+      fixture.bus.write8(addr, static_cast<U8>(acc));
+      acc += fixture.bus.read8(addr);
+    }
+    benchmark::DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * S64{ACCESSES_PER_ITERATION} * 2);
+}
+BENCHMARK(BM_mmio);
+
+}  // namespace
@@ -0,0 +1,82 @@
+#include "omulator/cpu/Ref8.hpp"
+
+#include "omulator/NullLogger.hpp"
+#include "omulator/Tracer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <memory>
+
+using omulator::Cycle_t;
+using omulator::MemoryBus;
+using omulator::NullLogger;
+using omulator::S64;
+using omulator::Tracer;
+using omulator::U64;
+using omulator::U8;
+using omulator::cpu::Ref8;
+
+namespace {
+
+/**
+ * An endless loop which mixes register, ALU, memory and branch instructions. items_per_second is
+ * the number of emulated instructions executed per second. If trace is true, every instruction is
+ * recorded with a Tracer.
+ */
+void BM_ref8_ips(benchmark::State &state, const Ref8::ExecMode mode, const bool trace = false) {
+  constexpr Cycle_t CYCLES_PER_ITERATION = 1 << 16;
+
+  NullLogger logger;
+  MemoryBus  bus(logger, 16, 12);
+  auto       ram = bus.add_ram(0x0000, 0x10000);
+
+  constexpr std::array<U8, 19> PROGRAM{
+    0x32, 0x80,        // 0x00: LDI r6, 0x80
+    0x3A, 0x00,        // 0x02: LDI r7, 0x00
+    0x0A, 0x00,        // 0x04: LDI r1, 0x00
+    0x81,              // 0x06: ADD r1
+    0xA9,              // 0x07: XOR r1
+    0x16,              // 0x08: ST r2
+    0x1D,              // 0x09: LD r3
+    0x5C,              // 0x0A: MOV r3, r4
+    0x3B,              // 0x0B: INC r7
+    0x0C,              // 0x0C: DEC r1
+    0xE0, 0x06, 0x00,  // 0x0D: JP NZ, 0x0006
+    0xC0, 0x04, 0x00,  // 0x10: JP 0x0004
+  };
+  std::copy(PROGRAM.begin(), PROGRAM.end(), ram.begin());
+
+  Ref8 cpu(logger, bus);
+  cpu.set_exec_mode(mode);
+
+  const auto tracePath = std::filesystem::temp_directory_path() / "Ref8_bench.omltrace";
+
+  std::unique_ptr<Tracer> tracer;
+  if(trace) {
+    tracer = std::make_unique<Tracer>(logger);
+    tracer->open(tracePath);
+    cpu.set_tracer(tracer.get());
+  }
+
+  for(auto _ : state) {
+    cpu.step(CYCLES_PER_ITERATION);
+  }
+
+  if(trace) {
+    cpu.set_tracer(nullptr);
+    tracer.reset();
+    std::filesystem::remove(tracePath);
+  }
+
+  benchmark::DoNotOptimize(cpu.registers());
+  state.SetItemsProcessed(static_cast<S64>(cpu.instructions_retired()));
+}
+BENCHMARK_CAPTURE(BM_ref8_ips, interpreter, Ref8::ExecMode::INTERPRETER);
+BENCHMARK_CAPTURE(BM_ref8_ips, block_cache, Ref8::ExecMode::BLOCK_CACHE);
+BENCHMARK_CAPTURE(BM_ref8_ips, jit, Ref8::ExecMode::JIT);
+BENCHMARK_CAPTURE(BM_ref8_ips, trace, Ref8::ExecMode::INTERPRETER, true);
+
+}  // namespace
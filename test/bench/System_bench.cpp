@@ -0,0 +1,121 @@
+#include "omulator/System.hpp"
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/NullLogger.hpp"
+
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using omulator::Component;
+using omulator::Cycle_t;
+using omulator::ILogger;
+using omulator::MemoryBus;
+using omulator::NullLogger;
+using omulator::S64;
+using omulator::System;
+using omulator::U64;
+using omulator::U8;
+using omulator::di::Injector;
+using omulator::util::TypeString;
+
+namespace {
+
+/**
+ * Does a trivial amount of work for each cycle, so that the overhead of the scheduler dominates.
+ * step() is final so that make_static_component_list can inline it.
+ */
+template<int N>
+class BusyComponent : public Component {
+public:
+  explicit BusyComponent(ILogger &logger)
+    : Component(logger, TypeString<BusyComponent>), acc_{N} { }
+
+  Cycle_t step(const Cycle_t numCycles) final {
+    for(Cycle_t i = 0; i < numCycles; ++i) {
+      acc_ ^= acc_ << 13;
+      acc_ ^= acc_ >> 7;
+      acc_ ^= acc_ << 17;
+    }
+    benchmark::DoNotOptimize(acc_);
+    return numCycles;
+  }
+
+private:
+  U64 acc_;
+};
+
+/**
+ * Run a System of three Components with a timeslice of state.range(0) cycles; a timeslice of 1 is
+ * the old lockstep behavior. items_per_second is the number of emulated cycles per second.
+ */
+void BM_system_step(benchmark::State &state, const bool isStatic) {
+  constexpr Cycle_t CYCLES_PER_ITERATION = 1 << 16;
+
+  Injector injector;
+  injector.bindImpl<ILogger, NullLogger>();
+  injector.addCtorRecipe<BusyComponent<1>, ILogger &>();
+  injector.addCtorRecipe<BusyComponent<2>, ILogger &>();
+  injector.addCtorRecipe<BusyComponent<3>, ILogger &>();
+
+  System system(injector.get<ILogger>(), "benchsystem", injector);
+  if(isStatic) {
+    system.make_static_component_list<BusyComponent<1>, BusyComponent<2>, BusyComponent<3>>();
+  }
+  else {
+    system.make_component_list<BusyComponent<1>, BusyComponent<2>, BusyComponent<3>>();
+  }
+  system.set_timeslice(static_cast<Cycle_t>(state.range(0)));
+
+  for([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(system.step(CYCLES_PER_ITERATION));
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<S64>(CYCLES_PER_ITERATION));
+}
+
+/**
+ * Save or restore a System with state.range(0) MiB of RAM, all of which ends up in a single region
+ * of the state.
+ */
+void BM_system_state(benchmark::State &state, const bool load) {
+  const auto ramSize = static_cast<std::size_t>(state.range(0)) << 20;
+
+  Injector injector;
+  injector.bindImpl<ILogger, NullLogger>();
+  injector.addCtorRecipe<BusyComponent<1>, ILogger &>();
+  injector.addRecipe<MemoryBus>([&](Injector &inj) {
+    auto *bus = new MemoryBus(inj.get<ILogger>(), 32, 12);
+    auto  ram = bus->add_ram(0, ramSize);
+    for(std::size_t i = 0; i < ram.size(); ++i) {
+      ram[i] = static_cast<U8>(i * 13);
+    }
+    return bus;
+  });
+
+  System system(injector.get<ILogger>(), "benchsystem", injector);
+  system.make_component_list<BusyComponent<1>>();
+  system.register_state(system.get_injector().get<MemoryBus>());
+
+  const std::vector<U8> image = system.save_state();
+  for([[maybe_unused]] auto _ : state) {
+    if(load) {
+      system.load_state(image);
+    }
+    else {
+      benchmark::DoNotOptimize(system.save_state());
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * static_cast<S64>(image.size()));
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_system_step, dynamic, false)->RangeMultiplier(16)->Range(1, 1 << 16);
+BENCHMARK_CAPTURE(BM_system_step, static, true)->RangeMultiplier(16)->Range(1, 1 << 16);
+BENCHMARK_CAPTURE(BM_system_state, save, false)->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK_CAPTURE(BM_system_state, load, true)->RangeMultiplier(4)->Range(1, 64);
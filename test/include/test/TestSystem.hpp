@@ -0,0 +1,142 @@
+#pragma once
+
+#include "omulator/Component.hpp"
+#include "omulator/EventScheduler.hpp"
+#include "omulator/ILogger.hpp"
+#include "omulator/MemoryBus.hpp"
+#include "omulator/StateArchive.hpp"
+#include "omulator/System.hpp"
+#include "omulator/di/Injector.hpp"
+#include "omulator/oml_types.hpp"
+#include "omulator/util/TypeString.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <span>
+
+namespace omulator::test {
+
+/**
+ * Writes a byte to a different address in RAM every cycle, so that each frame dirties a few pages.
+ * The addresses wrap at the end of RAM, and every address is written once (with the same byte each
+ * time) every RAM-size cycles.
+ */
+class Scribbler : public Component {
+public:
+  Scribbler(ILogger &logger, MemoryBus &bus)
+    : Component(logger, util::TypeString<Scribbler>),
+      bus_(bus),
+      ramMask_(bus.num_ram_pages() * bus.page_size() - 1) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    for(Cycle_t i = 0; i < numCycles; ++i) {
+      ++count_;
+      bus_.write8(static_cast<MemoryBus::Addr_t>((count_ * 0x25) & ramMask_),
+                  static_cast<U8>(count_));
+    }
+
+    return numCycles;
+  }
+
+  void serialize(StateArchive &archive) override { archive.value(count_); }
+
+private:
+  MemoryBus  &bus_;
+  std::size_t ramMask_;
+  U64         count_ = 0;
+};
+
+/**
+ * Fires an event every PERIOD cycles, and counts the events it has fired. The cycle of the next
+ * event is part of its state, from which it reschedules the event after a state is loaded.
+ */
+class Ticker : public Component {
+public:
+  static constexpr Cycle_t PERIOD = 100;
+
+  Ticker(ILogger &logger, EventScheduler &scheduler)
+    : Component(logger, util::TypeString<Ticker>), scheduler_(scheduler) {
+    arm_();
+  }
+
+  void serialize(StateArchive &archive) override {
+    archive.value(next_);
+    archive.value(numFired_);
+  }
+
+  void post_load() override { arm_(); }
+
+  U64 num_fired() const noexcept { return numFired_; }
+
+private:
+  void arm_() {
+    scheduler_.schedule_at(next_, [this] {
+      ++numFired_;
+      next_ += PERIOD;
+      arm_();
+    });
+  }
+
+  EventScheduler &scheduler_;
+  Cycle_t         next_     = PERIOD;
+  U64             numFired_ = 0;
+};
+
+/**
+ * Set up a System the same way each time, so that states can be passed between instances: a
+ * MemoryBus with 16-bit addresses, 4KiB pages and ramSize bytes of RAM at address 0 (which must be
+ * a power of two), followed by rom if it isn't empty, and a component list of Ts. Each of the Ts is
+ * constructed from the logger, plus the MemoryBus or the System's EventScheduler if it takes one.
+ * The MemoryBus is registered with the System's state. The recipes are added to the System's own
+ * Injector, per the rules in System.
+ */
+template<typename... Ts>
+requires(std::derived_from<Ts, Component> && ...)
+void setup_test_system(ILogger            &logger,
+                       System             &system,
+                       const std::size_t   ramSize,
+                       std::span<const U8> rom = {}) {
+  di::Injector &injector = system.get_injector();
+
+  injector.addRecipe<MemoryBus>([&logger, ramSize, rom]([[maybe_unused]] di::Injector &inj) {
+    auto *pBus = new MemoryBus(logger, 16, 12);
+    pBus->add_ram(0x0000, ramSize);
+    if(!rom.empty()) {
+      pBus->map_rom(static_cast<MemoryBus::Addr_t>(ramSize), rom);
+    }
+    return pBus;
+  });
+
+  (injector.addRecipe<Ts>([&logger](di::Injector &inj) {
+    if constexpr(std::constructible_from<Ts, ILogger &, MemoryBus &>) {
+      return new Ts(logger, inj.get<MemoryBus>());
+    }
+    else if constexpr(std::constructible_from<Ts, ILogger &, EventScheduler &>) {
+      return new Ts(logger, inj.get<EventScheduler>());
+    }
+    else {
+      return new Ts(logger);
+    }
+  }),
+   ...);
+
+  system.make_component_list<Ts...>();
+  system.register_state(injector.get<MemoryBus>());
+}
+
+/**
+ * A System which owns its parent Injector, set up with setup_test_system().
+ */
+template<typename... Ts>
+struct TestSystem {
+  TestSystem(ILogger &logger, const std::size_t ramSize) : system(logger, "system", injector) {
+    setup_test_system<Ts...>(logger, system, ramSize);
+  }
+
+  MemoryBus &bus() { return system.get_injector().get<MemoryBus>(); }
+
+  di::Injector injector;
+  System       system;
+};
+
+}  // namespace omulator::test
@@ -0,0 +1,230 @@
+#include "omulator/AudioEngine.hpp"
+
+#include "omulator/NullAudioSink.hpp"
+#include "omulator/WavAudioSink.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using omulator::AudioChannel;
+using omulator::AudioEngine;
+using omulator::IAudioSink;
+using omulator::NullAudioSink;
+using omulator::U16;
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+using omulator::WavAudioSink;
+using omulator::msg::MailboxRouter;
+using omulator::msg::MessageQueueFactory;
+
+namespace {
+
+/**
+ * Keeps everything written to it, and reports whatever fill level it is told to.
+ */
+class CaptureSink : public IAudioSink {
+public:
+  U32 sample_rate() const noexcept override { return DEFAULT_SAMPLE_RATE; }
+
+  void write(std::span<const float> frames) override {
+    std::scoped_lock lck{mtx};
+    samples.insert(samples.end(), frames.begin(), frames.end());
+  }
+
+  std::optional<double> fill_level() const override {
+    std::scoped_lock lck{mtx};
+    return fill;
+  }
+
+  mutable std::mutex    mtx;
+  std::vector<float>    samples;
+  std::optional<double> fill;
+};
+
+struct AudioFixture {
+  AudioFixture() : mqfactory(logger, 0), mbrouter(logger, mqfactory) { }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MessageQueueFactory                  mqfactory;
+  MailboxRouter                        mbrouter;
+};
+
+/**
+ * Wait for the engine to have mixed at least the given number of frames.
+ */
+bool wait_for_frames(const AudioEngine &engine, const U64 numFrames) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while(engine.frames_mixed() < numFrames) {
+    if(std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+}  // namespace
+
+TEST(AudioEngine_test, mix) {
+  AudioFixture f;
+  CaptureSink  sink;
+  AudioEngine  engine(f.logger, f.mbrouter, sink);
+  engine.start();
+
+  AudioChannel &a = engine.add_channel(IAudioSink::DEFAULT_SAMPLE_RATE);
+  AudioChannel &b = engine.add_channel(IAudioSink::DEFAULT_SAMPLE_RATE, 0.5F);
+  EXPECT_EQ(0.5F, b.gain());
+
+  std::vector<float> left(2 * 100, 0.0F);
+  std::vector<float> right(2 * 100, 0.0F);
+  for(std::size_t i = 0; i < 100; ++i) {
+    left[2 * i]      = 0.25F;
+    right[2 * i + 1] = 0.5F;
+  }
+
+  // Submitted in several blocks, as a sound chip would each frame. With matching rates, all but
+  // the last TAPS - 1 frames can be mixed; waiting for them keeps one channel from being mixed
+  // while the other is still empty.
+  U64 expected = 0;
+  for(int i = 0; i < 10; ++i) {
+    EXPECT_EQ(100, a.submit(left));
+    EXPECT_EQ(100, b.submit(right));
+    engine.commit();
+
+    expected = 100 * static_cast<U64>(i + 1) - (omulator::util::Resampler::TAPS - 1);
+    ASSERT_TRUE(wait_for_frames(engine, expected));
+  }
+
+  EXPECT_EQ(1.0, engine.rate_adjust()) << "The ratio should be left alone without a fill level";
+
+  std::scoped_lock lck{sink.mtx};
+  ASSERT_EQ(expected * 2, sink.samples.size());
+  for(std::size_t i = 0; i < expected; ++i) {
+    ASSERT_NEAR(0.25F, sink.samples[2 * i], 1e-5F);
+    ASSERT_NEAR(0.25F, sink.samples[2 * i + 1], 1e-5F) << "Channels should be scaled by their gain";
+  }
+
+  EXPECT_THROW(a.submit(std::vector<float>(3)), std::invalid_argument);
+  EXPECT_THROW(engine.add_channel(0.0), std::invalid_argument);
+}
+
+TEST(AudioEngine_test, resample) {
+  AudioFixture  f;
+  NullAudioSink sink;
+  AudioEngine   engine(f.logger, f.mbrouter, sink);
+  engine.start();
+
+  AudioChannel &channel = engine.add_channel(32000.0);
+  EXPECT_EQ(32000.0, channel.sample_rate());
+
+  // Paced as the emulation would be, so that the ring never overflows
+  const std::vector<float> block(2 * 320, 0.1F);
+  for(U64 i = 1; i <= 100; ++i) {
+    EXPECT_EQ(320, channel.submit(block));
+    engine.commit();
+    ASSERT_TRUE(wait_for_frames(engine, 480 * i - 2 * omulator::util::Resampler::TAPS));
+  }
+
+  EXPECT_EQ(0, channel.dropped());
+  EXPECT_EQ(engine.frames_mixed(), sink.frames_written());
+  EXPECT_LE(sink.frames_written(), 48000) << "One second of input should produce one second";
+
+  // Overflowing the ring drops what doesn't fit rather than blocking
+  const std::vector<float> huge(2 * (AudioChannel::RING_FRAMES + 10), 0.0F);
+  EXPECT_GE(AudioChannel::RING_FRAMES, channel.submit(huge));
+  EXPECT_LE(10, channel.dropped());
+}
+
+TEST(AudioEngine_test, rateControl) {
+  AudioFixture f;
+  CaptureSink  sink;
+  AudioEngine  engine(f.logger, f.mbrouter, sink);
+  engine.start();
+
+  AudioChannel            &channel = engine.add_channel(IAudioSink::DEFAULT_SAMPLE_RATE);
+  const std::vector<float> block(2 * 64, 0.0F);
+  U64                      submitted = 0;
+
+  const auto run = [&](const double fill) {
+    {
+      std::scoped_lock lck{sink.mtx};
+      sink.fill = fill;
+    }
+
+    for(int i = 0; i < 100; ++i) {
+      channel.submit(block);
+      submitted += 64;
+      engine.commit();
+      const auto target = static_cast<double>(submitted) * (1.0 - AudioEngine::MAX_ADJUST);
+      ASSERT_TRUE(wait_for_frames(
+        engine, static_cast<U64>(target) - 2 * omulator::util::Resampler::TAPS));
+    }
+  };
+
+  run(0.9);
+  EXPECT_LT(engine.rate_adjust(), 1.0) << "A filling queue should slow the output down";
+  EXPECT_GE(engine.rate_adjust(), 1.0 - AudioEngine::MAX_ADJUST);
+
+  run(0.1);
+  run(0.1);
+  EXPECT_GT(engine.rate_adjust(), 1.0) << "A draining queue should speed the output up";
+  EXPECT_LE(engine.rate_adjust(), 1.0 + AudioEngine::MAX_ADJUST);
+}
+
+TEST(AudioEngine_test, wav) {
+  const auto path = std::filesystem::temp_directory_path() / "AudioEngine_test_wav.wav";
+
+  {
+    WavAudioSink sink(path, 44100);
+    EXPECT_EQ(44100, sink.sample_rate());
+    EXPECT_FALSE(sink.fill_level());
+
+    sink.write(std::vector<float>{0.5F, -0.5F, 2.0F, -2.0F});
+    sink.write(std::vector<float>{0.0F, 1.0F});
+    EXPECT_EQ(3, sink.frames_written());
+  }
+
+  std::vector<U8> file(std::filesystem::file_size(path));
+  ASSERT_EQ(44 + 3 * 4, file.size());
+  std::ifstream(path, std::ios::binary)
+    .read(reinterpret_cast<char *>(file.data()), static_cast<std::streamsize>(file.size()));
+
+  const auto u16 = [&file](const std::size_t pos) {
+    return static_cast<U16>(file[pos] | (file[pos + 1] << 8));
+  };
+  const auto u32 = [&](const std::size_t pos) {
+    return u16(pos) | (static_cast<U32>(u16(pos + 2)) << 16);
+  };
+
+  EXPECT_EQ(0, std::memcmp(file.data(), "RIFF", 4));
+  EXPECT_EQ(file.size() - 8, u32(4));
+  EXPECT_EQ(0, std::memcmp(file.data() + 8, "WAVEfmt ", 8));
+  EXPECT_EQ(2, u16(22)) << "WAV files should be stereo";
+  EXPECT_EQ(44100, u32(24));
+  EXPECT_EQ(16, u16(34));
+  EXPECT_EQ(0, std::memcmp(file.data() + 36, "data", 4));
+  EXPECT_EQ(3 * 4, u32(40));
+
+  EXPECT_EQ(16384, u16(44));
+  EXPECT_EQ(static_cast<U16>(-16384), u16(46));
+  EXPECT_EQ(32767, u16(48)) << "Samples should be clamped";
+  EXPECT_EQ(static_cast<U16>(-32767), u16(50));
+  EXPECT_EQ(0, u16(52));
+  EXPECT_EQ(32767, u16(54));
+
+  std::filesystem::remove(path);
+  EXPECT_THROW(WavAudioSink(std::filesystem::path("/nonexistent/file.wav")), std::runtime_error);
+}
@@ -0,0 +1,151 @@
+#include "omulator/BatchRunner.hpp"
+
+#include "omulator/MemoryBus.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+#include "test/TestSystem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using omulator::BatchRunner;
+using omulator::Component;
+using omulator::Cycle_t;
+using omulator::ILogger;
+using omulator::MemoryBus;
+using omulator::System;
+using omulator::U64;
+using omulator::U8;
+using omulator::di::Injector;
+using omulator::test::setup_test_system;
+using omulator::util::TypeString;
+
+namespace {
+
+constexpr std::size_t NUM_SYSTEMS = 16;
+constexpr U64         NUM_FRAMES  = 50;
+constexpr Cycle_t     CYCLES      = 100;
+
+/**
+ * Sums the byte at the start of ROM once per cycle, and throws once it has been stepped past
+ * failAt cycles (if nonzero).
+ */
+class RomReader : public Component {
+public:
+  RomReader(ILogger &logger, MemoryBus &bus)
+    : Component(logger, TypeString<RomReader>), bus_(bus) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    for(Cycle_t i = 0; i < numCycles; ++i) {
+      sum_ += bus_.read8(0x1000);
+    }
+    cycles_ += numCycles;
+
+    if(failAt_ != 0 && cycles_ > failAt_) {
+      throw std::runtime_error("RomReader failure");
+    }
+
+    return numCycles;
+  }
+
+  void fail_at(const Cycle_t failAt) noexcept { failAt_ = failAt; }
+
+  MemoryBus &bus() noexcept { return bus_; }
+  U64        sum() const noexcept { return sum_; }
+
+private:
+  MemoryBus &bus_;
+  U64        sum_    = 0;
+  Cycle_t    cycles_ = 0;
+  Cycle_t    failAt_ = 0;
+};
+
+struct BatchFixture {
+  explicit BatchFixture(const std::size_t numThreads) : runner(logger, injector, numThreads) {
+    rom = runner.add_rom(std::vector<U8>(0x1000, 3));
+
+    // Each System gets its own MemoryBus, but they all share the same ROM image
+    for(std::size_t i = 0; i < NUM_SYSTEMS; ++i) {
+      setup_test_system<RomReader>(logger, runner.add_system("batch"), 0x1000, rom);
+    }
+  }
+
+  RomReader &reader(const std::size_t idx) {
+    return runner.system(idx).get_injector().get<RomReader>();
+  }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+  BatchRunner                          runner;
+  std::span<const U8>                  rom;
+};
+
+}  // namespace
+
+TEST(BatchRunner_test, run) {
+  BatchFixture f(4);
+  EXPECT_EQ(4, f.runner.num_threads());
+  ASSERT_EQ(NUM_SYSTEMS, f.runner.size());
+
+  std::mutex                    mtx;
+  std::vector<std::vector<U64>> frames(NUM_SYSTEMS);
+
+  f.runner.run(NUM_FRAMES, CYCLES, [&](System &system, const std::size_t idx, const U64 frame) {
+    EXPECT_EQ(&f.runner.system(idx), &system);
+    EXPECT_EQ((frame + 1) * CYCLES, system.current_cycle())
+      << "The frame callback should be invoked after the System has been stepped";
+
+    std::scoped_lock lck{mtx};
+    frames[idx].push_back(frame);
+  });
+
+  for(std::size_t i = 0; i < NUM_SYSTEMS; ++i) {
+    EXPECT_EQ(NUM_FRAMES * CYCLES, f.runner.system(i).current_cycle());
+    EXPECT_EQ(NUM_FRAMES * CYCLES * 3, f.reader(i).sum());
+
+    ASSERT_EQ(NUM_FRAMES, frames[i].size());
+    for(U64 frame = 0; frame < NUM_FRAMES; ++frame) {
+      EXPECT_EQ(frame, frames[i][frame]) << "Each System's frames should be run in order";
+    }
+  }
+
+  EXPECT_NE(&f.reader(0).bus(), &f.reader(1).bus()) << "Each System should have its own MemoryBus";
+
+  f.runner.run(NUM_FRAMES, CYCLES);
+  for(std::size_t i = 0; i < NUM_SYSTEMS; ++i) {
+    EXPECT_EQ(2 * NUM_FRAMES * CYCLES, f.runner.system(i).current_cycle())
+      << "A BatchRunner should be able to run its Systems more than once";
+  }
+}
+
+TEST(BatchRunner_test, singleThread) {
+  BatchFixture f(1);
+  f.runner.run(NUM_FRAMES, CYCLES);
+
+  for(std::size_t i = 0; i < NUM_SYSTEMS; ++i) {
+    EXPECT_EQ(NUM_FRAMES * CYCLES, f.runner.system(i).current_cycle());
+  }
+}
+
+TEST(BatchRunner_test, errors) {
+  BatchFixture f(4);
+  f.reader(3).fail_at(10 * CYCLES);
+  f.reader(5).fail_at(5 * CYCLES);
+
+  EXPECT_THROW(f.runner.run(NUM_FRAMES, CYCLES), std::runtime_error);
+
+  for(std::size_t i = 0; i < NUM_SYSTEMS; ++i) {
+    const Cycle_t expected = i == 3 ? 10 * CYCLES : i == 5 ? 5 * CYCLES : NUM_FRAMES * CYCLES;
+    EXPECT_EQ(expected, f.runner.system(i).current_cycle())
+      << "A System which throws should not be run any further, while the others should be "
+         "unaffected";
+  }
+
+  EXPECT_THROW(f.runner.system(NUM_SYSTEMS), std::out_of_range);
+}
@@ -0,0 +1,162 @@
+#include "omulator/Benchmark.hpp"
+
+#include "omulator/VirtualClock.hpp"
+#include "omulator/props.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+#include "test/TestSystem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using omulator::Benchmark;
+using omulator::BenchReport;
+using omulator::Component;
+using omulator::Cycle_t;
+using omulator::ILogger;
+using omulator::PropertyMap;
+using omulator::TimePoint_t;
+using omulator::U64;
+using omulator::VirtualClock;
+using omulator::test::TestSystem;
+using omulator::util::TypeString;
+
+namespace {
+
+template<int N>
+class Spinner : public Component {
+public:
+  explicit Spinner(ILogger &logger) : Component(logger, TypeString<Spinner>), acc_{N} { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    for(Cycle_t i = 0; i < numCycles * N; ++i) {
+      acc_ = acc_ * 6364136223846793005 + 1442695040888963407;
+    }
+    return numCycles;
+  }
+
+  U64 acc() const noexcept { return acc_; }
+
+private:
+  U64 acc_;
+};
+
+struct BenchFixture {
+  BenchFixture() : propertyMap(logger), ts(logger, 0x1000) { ts.system.set_timeslice(100); }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  PropertyMap                          propertyMap;
+  VirtualClock                         clock;
+  TestSystem<Spinner<1>, Spinner<8>>   ts;
+};
+
+/**
+ * A report for the given number of cycles per second.
+ */
+BenchReport make_report(const double cyclesPerSecond) {
+  return BenchReport{static_cast<Cycle_t>(cyclesPerSecond), 60, 1.0, {}, 0};
+}
+
+}  // namespace
+
+TEST(Benchmark_test, run) {
+  BenchFixture f;
+  f.propertyMap.get_prop<std::string>(omulator::props::BENCH_FRAMES).set("30");
+
+  Benchmark         benchmark(f.logger, f.propertyMap, f.clock);
+  const BenchReport report = benchmark.run(f.ts.system, 1000);
+
+  EXPECT_EQ(30, report.frames);
+  EXPECT_EQ(30'000, report.cycles);
+  EXPECT_EQ(30'000, f.ts.system.current_cycle());
+  EXPECT_EQ(TimePoint_t{} + 30 * Benchmark::FRAME_PERIOD, f.clock.now())
+    << "Benchmark should sleep on the clock until the start of each frame";
+  EXPECT_LT(0.0, report.hostSeconds);
+  EXPECT_LT(0.0, report.cycles_per_second());
+  EXPECT_DOUBLE_EQ(report.cycles_per_second() / 1000, report.frames_per_second());
+  EXPECT_LT(0, report.peakRssBytes);
+
+  ASSERT_EQ(2, report.componentShares.size());
+  EXPECT_EQ(TypeString<Spinner<1>>, report.componentShares[0].first);
+  EXPECT_EQ(TypeString<Spinner<8>>, report.componentShares[1].first);
+  EXPECT_DOUBLE_EQ(1.0, report.componentShares[0].second + report.componentShares[1].second);
+  EXPECT_LT(report.componentShares[0].second, report.componentShares[1].second)
+    << "Each Component's time share should reflect the time spent in its step() method";
+
+  EXPECT_TRUE(f.ts.system.component_ticks().empty())
+    << "Benchmark should disable component timing once it is done";
+}
+
+TEST(Benchmark_test, frames) {
+  BenchFixture f;
+
+  f.propertyMap.get_prop<std::string>(omulator::props::BENCH_FRAMES).set("");
+  Benchmark benchmark(f.logger, f.propertyMap, f.clock);
+  EXPECT_EQ(Benchmark::DEFAULT_FRAMES, benchmark.run(f.ts.system, 1).frames);
+
+  for(const char *const frames : {"0", "-1", "abc", "10x"}) {
+    f.propertyMap.get_prop<std::string>(omulator::props::BENCH_FRAMES).set(frames);
+    EXPECT_THROW(Benchmark(f.logger, f.propertyMap, f.clock), std::runtime_error)
+      << "Benchmark should reject invalid frame counts, such as '" << frames << "'";
+  }
+}
+
+TEST(Benchmark_test, json) {
+  BenchReport report = make_report(12345.5);
+  report.componentShares.emplace_back("omulator::cpu::Ref8", 0.75);
+  report.componentShares.emplace_back("omulator::MemoryBus", 0.25);
+  report.peakRssBytes = 4096;
+
+  std::stringstream ss;
+  Benchmark::write_json(report, ss);
+  const std::string json = ss.str();
+
+  for(const char *const key : {"\"frames\": 60",
+                               "\"cycles\": 12345",
+                               "\"frames_per_second\": 60.0",
+                               "\"peak_rss_bytes\": 4096",
+                               "{\"name\": \"omulator::cpu::Ref8\", \"time_share\": 0.75"})
+  {
+    EXPECT_NE(std::string::npos, json.find(key)) << "Missing '" << key << "' in " << json;
+  }
+
+  std::stringstream roundTrip(json);
+  EXPECT_DOUBLE_EQ(12345.0, Benchmark::read_cycles_per_second(roundTrip))
+    << "A report written by Benchmark::write_json should be usable as a baseline";
+
+  std::stringstream invalid("{\"frames\": 60}");
+  EXPECT_THROW(Benchmark::read_cycles_per_second(invalid), std::runtime_error);
+}
+
+TEST(Benchmark_test, baseline) {
+  BenchFixture f;
+  Benchmark    benchmark(f.logger, f.propertyMap, f.clock);
+
+  auto &baselineProp = f.propertyMap.get_prop<std::string>(omulator::props::BENCH_BASELINE);
+  baselineProp.set("");
+  EXPECT_EQ(EXIT_SUCCESS, benchmark.check_baseline(make_report(1.0)))
+    << "Benchmark should skip the baseline check if there is no baseline";
+
+  const auto path = std::filesystem::temp_directory_path() / "Benchmark_test_baseline.json";
+  {
+    std::ofstream ofs(path);
+    Benchmark::write_json(make_report(1'000'000), ofs);
+  }
+  baselineProp.set(path.string());
+
+  EXPECT_EQ(EXIT_SUCCESS, benchmark.check_baseline(make_report(2'000'000)));
+  EXPECT_EQ(EXIT_SUCCESS, benchmark.check_baseline(make_report(960'000)))
+    << "Benchmark should tolerate small slowdowns";
+  EXPECT_EQ(Benchmark::EXIT_REGRESSION, benchmark.check_baseline(make_report(900'000)));
+
+  std::filesystem::remove(path);
+  EXPECT_THROW(benchmark.check_baseline(make_report(1.0)), std::runtime_error);
+}
@@ -0,0 +1,40 @@
+#include "omulator/Clock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+using omulator::Clock;
+using omulator::TimePoint_t;
+
+namespace {
+
+void check_sleep(const Clock::SleepStrategy strategy) {
+  Clock clock(strategy);
+
+  EXPECT_EQ(strategy, clock.sleep_strategy());
+
+  for(int i = 0; i < 5; ++i) {
+    const TimePoint_t deadline = clock.now() + std::chrono::milliseconds(2);
+    clock.sleep_until(deadline);
+    EXPECT_GE(clock.now(), deadline) << "Clock::sleep_until should never return before the deadline";
+  }
+
+  const auto stats = clock.sleep_stats();
+  EXPECT_EQ(5, stats.numSleeps) << "Clock::sleep_stats should count each call to sleep_until";
+  EXPECT_GE(stats.maxOvershoot.count(), 0);
+  EXPECT_GE(stats.totalOvershoot, stats.maxOvershoot)
+    << "Clock::sleep_stats should accumulate the overshoot of each call to sleep_until";
+  EXPECT_GE(stats.spinWindow, Clock::MIN_SPIN_WINDOW);
+  EXPECT_LE(stats.spinWindow, Clock::MAX_SPIN_WINDOW);
+
+  clock.sleep_until(clock.now() - std::chrono::milliseconds(1));
+  EXPECT_EQ(5, clock.sleep_stats().numSleeps)
+    << "Clock::sleep_until should not count deadlines which have already passed";
+}
+
+}  // namespace
+
+TEST(Clock_test, standardSleep) { check_sleep(Clock::SleepStrategy::STANDARD); }
+
+TEST(Clock_test, hybridSleep) { check_sleep(Clock::SleepStrategy::HYBRID); }
@@ -0,0 +1,163 @@
+#include "omulator/Debugger.hpp"
+
+#include "omulator/cpu/Ref8.hpp"
+
+#include "mocks/LoggerMock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+
+using omulator::Cycle_t;
+using omulator::Debugger;
+using omulator::MemoryBus;
+using omulator::U8;
+using omulator::cpu::Ref8;
+
+namespace {
+
+/**
+ * Counts r1 up forever, storing it to 0x1000 on each iteration.
+ */
+constexpr std::initializer_list<U8> PROGRAM{
+  0x32, 0x10,        // 0x00: LDI r6, 0x10
+  0x3A, 0x00,        // 0x02: LDI r7, 0x00
+  0x0B,              // 0x04: INC r1
+  0x41,              // 0x05: MOV r0, r1
+  0x06,              // 0x06: ST r0
+  0xC0, 0x04, 0x00,  // 0x07: JP 0x0004
+};
+
+struct DebuggerFixture {
+  DebuggerFixture()
+    : bus(logger, 16, 12),
+      ram(bus.add_ram(0x0000, 0x10000)),
+      cpu(logger, bus),
+      debugger(logger) {
+    std::copy(PROGRAM.begin(), PROGRAM.end(), ram.begin());
+    cpu.set_debugger(&debugger);
+    debugger.attach_bus(bus);
+  }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus;
+  std::span<U8>                        ram;
+  Ref8                                 cpu;
+  Debugger                             debugger;
+};
+
+}  // namespace
+
+TEST(Debugger_test, breakpoints) {
+  DebuggerFixture f;
+  f.debugger.add_breakpoint(0x05);
+
+  EXPECT_EQ(1000, f.cpu.step(1000))
+    << "A CPU stopped by the Debugger should consume its budget as if it were halted";
+  EXPECT_TRUE(f.debugger.stopped());
+  EXPECT_EQ(Debugger::StopReason::BREAKPOINT, f.debugger.stop_reason());
+  EXPECT_EQ(0x05, f.debugger.stop_address());
+  EXPECT_EQ(0x05, f.cpu.registers().pc) << "Breakpoints should stop the CPU before the instruction";
+  EXPECT_EQ(1, f.cpu.registers().r[1]);
+  EXPECT_EQ("stopped at breakpoint 0x0005", f.debugger.status());
+
+  f.cpu.step(1000);
+  EXPECT_EQ(3, f.cpu.instructions_retired()) << "The CPU should stay frozen until resumed";
+
+  f.debugger.resume();
+  EXPECT_EQ("running", f.debugger.status());
+  f.cpu.step(1000);
+  EXPECT_EQ(0x05, f.cpu.registers().pc)
+    << "Resuming from a breakpoint should run until the breakpoint is reached again";
+  EXPECT_EQ(2, f.cpu.registers().r[1]);
+
+  f.debugger.remove_breakpoint(0x05);
+  f.debugger.resume();
+  f.cpu.step(7 * 10);
+  EXPECT_FALSE(f.debugger.stopped());
+  EXPECT_EQ(12, f.cpu.registers().r[1]);
+}
+
+TEST(Debugger_test, step) {
+  DebuggerFixture f;
+  f.cpu.step(2 + 2);
+  EXPECT_EQ(0x04, f.cpu.registers().pc);
+
+  f.debugger.pause();
+  f.cpu.step(100);
+  EXPECT_EQ(Debugger::StopReason::PAUSE, f.debugger.stop_reason());
+  EXPECT_EQ(0x04, f.debugger.stop_address());
+
+  f.debugger.step();
+  f.cpu.step(100);
+  EXPECT_EQ(Debugger::StopReason::STEP, f.debugger.stop_reason());
+  EXPECT_EQ(0x05, f.cpu.registers().pc);
+  EXPECT_EQ(1, f.cpu.registers().r[1]);
+
+  f.debugger.step(4);
+  f.cpu.step(100);
+  EXPECT_EQ(0x05, f.cpu.registers().pc)
+    << "Debugger::step should run the given number of instructions";
+  EXPECT_EQ(2, f.cpu.registers().r[1]);
+
+  f.debugger.add_breakpoint(0x07);
+  f.debugger.step(100);
+  f.cpu.step(100);
+  EXPECT_EQ(Debugger::StopReason::BREAKPOINT, f.debugger.stop_reason())
+    << "Breakpoints should interrupt a step";
+  EXPECT_EQ(0x07, f.cpu.registers().pc);
+}
+
+TEST(Debugger_test, watchpoints) {
+  DebuggerFixture f;
+  f.debugger.add_watchpoint(0x1000, Debugger::WatchKind::READ);
+  f.cpu.step(7 * 10);
+  EXPECT_FALSE(f.debugger.stopped()) << "Read watchpoints should ignore writes";
+
+  f.debugger.add_watchpoint(0x1000, Debugger::parse_watch_kind("rw"));
+  f.cpu.step(7 * 10);
+  EXPECT_TRUE(f.debugger.stopped());
+  EXPECT_EQ(Debugger::StopReason::WATCHPOINT, f.debugger.stop_reason());
+  EXPECT_EQ(0x1000, f.debugger.stop_address());
+  EXPECT_EQ(0x07, f.cpu.registers().pc)
+    << "Watchpoints should stop the CPU after the instruction which made the access";
+  EXPECT_EQ(f.cpu.registers().r[1], f.ram[0x1000]);
+  EXPECT_EQ(nullptr, f.bus.write_page_table()[1]);
+
+  const U8 count = f.cpu.registers().r[1];
+  f.debugger.resume();
+  f.cpu.step(100);
+  EXPECT_EQ(count + 1, f.ram[0x1000]);
+  EXPECT_EQ("stopped by watchpoint 0x1000", f.debugger.status());
+
+  f.debugger.remove_watchpoint(0x1000);
+  f.debugger.resume();
+  f.cpu.step(7 * 10);
+  EXPECT_FALSE(f.debugger.stopped());
+  EXPECT_NE(nullptr, f.bus.write_page_table()[1])
+    << "Pages should no longer be trapped once their watchpoints are removed";
+
+  EXPECT_EQ(Debugger::WatchKind::READ, Debugger::parse_watch_kind("r"));
+  EXPECT_EQ(Debugger::WatchKind::WRITE, Debugger::parse_watch_kind("w"));
+  EXPECT_THROW(Debugger::parse_watch_kind("x"), std::invalid_argument);
+}
+
+TEST(Debugger_test, detach) {
+  DebuggerFixture f;
+  f.debugger.add_breakpoint(0x05);
+  f.debugger.add_watchpoint(0x1000, Debugger::WatchKind::WRITE);
+  f.cpu.step(100);
+  ASSERT_TRUE(f.debugger.stopped());
+
+  f.cpu.set_debugger(nullptr);
+  f.debugger.detach_bus();
+  EXPECT_NE(nullptr, f.bus.write_page_table()[1]);
+
+  const Cycle_t cycles = f.cpu.step(7 * 10);
+  EXPECT_EQ(7 * 10, cycles);
+  EXPECT_EQ(11, f.cpu.registers().r[1]) << "A detached Debugger should have no effect on the CPU";
+  EXPECT_EQ(Ref8::ExecMode::BLOCK_CACHE, f.cpu.exec_mode());
+}
@@ -0,0 +1,119 @@
+#include "omulator/cpu/DecodeTable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using omulator::Cycle_t;
+using omulator::U32;
+using omulator::cpu::DecodeTable;
+using omulator::cpu::Op;
+using omulator::cpu::OpcodePattern;
+
+namespace {
+
+constexpr OpcodePattern HALT = "0000";
+constexpr OpcodePattern LOAD = "01rr";
+constexpr OpcodePattern MOVE = "1dds";
+
+struct ToyCpu {
+  std::vector<U32> log;
+};
+
+template<U32 OPCODE>
+struct Halt {
+  static Cycle_t exec(ToyCpu &cpu) {
+    cpu.log.push_back(0xF00);
+    return 1;
+  }
+};
+
+template<U32 OPCODE>
+struct Load {
+  static Cycle_t exec(ToyCpu &cpu) {
+    cpu.log.push_back(0x100 | LOAD.field('r', OPCODE));
+    return 2;
+  }
+};
+
+template<U32 OPCODE>
+struct Move {
+  static constexpr U32 D = MOVE.field('d', OPCODE);
+  static constexpr U32 S = MOVE.field('s', OPCODE);
+
+  static Cycle_t exec(ToyCpu &cpu) {
+    cpu.log.push_back(0x200 | (D << 4) | S);
+    return 3;
+  }
+};
+
+template<U32 OPCODE>
+struct Illegal {
+  static Cycle_t exec(ToyCpu &cpu) {
+    cpu.log.push_back(0xE00 | OPCODE);
+    return 0;
+  }
+};
+
+// "0000" is listed first so that it takes precedence over "00xx"
+constexpr OpcodePattern ANY_LOW = "00xx";
+
+template<U32 OPCODE>
+struct AnyLow {
+  static Cycle_t exec(ToyCpu &cpu) {
+    cpu.log.push_back(0x300 | OPCODE);
+    return 4;
+  }
+};
+
+using Table_t = DecodeTable<ToyCpu,
+                            4,
+                            Illegal,
+                            Op<HALT, Halt>,
+                            Op<ANY_LOW, AnyLow>,
+                            Op<LOAD, Load>,
+                            Op<MOVE, Move>>;
+
+}  // namespace
+
+TEST(DecodeTable_test, opcodePattern) {
+  static_assert(MOVE.width == 4);
+  static_assert(MOVE.mask == 0b1000);
+  static_assert(MOVE.match == 0b1000);
+  static_assert(MOVE.field('d', 0b1101) == 0b10);
+  static_assert(MOVE.field('s', 0b1101) == 0b1);
+
+  constexpr OpcodePattern spaced = "10_ab ba 01";
+  static_assert(spaced.width == 8);
+  static_assert(spaced.mask == 0b1100'0011);
+  static_assert(spaced.match == 0b1000'0001);
+  static_assert(spaced.field('a', 0b0010'0000) == 0b10,
+                "Fields which are split across the pattern should be gathered MSB first");
+  static_assert(spaced.field('b', 0b0001'1000) == 0b11);
+
+  SUCCEED();
+}
+
+TEST(DecodeTable_test, decode) {
+  static_assert(Table_t::SIZE == 16);
+  static_assert(Table_t::op_index(0b0000) == 0, "The first matching pattern should win");
+  static_assert(Table_t::op_index(0b0010) == 1);
+  static_assert(Table_t::op_index(0b0111) == 2);
+  static_assert(Table_t::op_index(0b1111) == 3);
+
+  using IllegalTable_t = DecodeTable<ToyCpu, 4, Illegal, Op<LOAD, Load>>;
+  static_assert(IllegalTable_t::op_index(0b0000) == IllegalTable_t::ILLEGAL);
+
+  ToyCpu  cpu;
+  Cycle_t cycles = 0;
+  for(U32 opcode : {0b0000U, 0b0011U, 0b0110U, 0b1101U}) {
+    cycles += Table_t::dispatch(cpu, opcode);
+  }
+  cycles += IllegalTable_t::dispatch(cpu, 0b1010);
+
+  EXPECT_EQ((std::vector<U32>{0xF00, 0x303, 0x102, 0x221, 0xE0A}), cpu.log)
+    << "DecodeTable should dispatch each opcode to the handler for the first matching pattern, "
+       "instantiated for that specific opcode";
+  EXPECT_EQ(1 + 4 + 2 + 3, cycles)
+    << "DecodeTable::dispatch should return the cycle count returned by the handler";
+}
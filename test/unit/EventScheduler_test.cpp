@@ -0,0 +1,152 @@
+#include "omulator/EventScheduler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using omulator::Cycle_t;
+using omulator::EventHandle;
+using omulator::EventScheduler;
+
+TEST(EventScheduler_test, ordering) {
+  EventScheduler   scheduler;
+  std::vector<int> fired;
+
+  scheduler.schedule_at(20, [&] { fired.push_back(2); });
+  scheduler.schedule_at(10, [&] { fired.push_back(0); });
+  scheduler.schedule_at(10, [&] { fired.push_back(1); });
+  scheduler.schedule_at(30, [&] { fired.push_back(3); });
+
+  EXPECT_EQ(4, scheduler.size());
+  EXPECT_EQ(10, scheduler.next_event_cycle());
+
+  scheduler.run_until(9);
+  EXPECT_TRUE(fired.empty()) << "EventScheduler::run_until should not fire events early";
+  EXPECT_EQ(9, scheduler.now());
+
+  scheduler.run_until(20);
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), fired)
+    << "EventScheduler should fire events in timestamp order, and events with the same timestamp "
+       "in the order they were scheduled";
+  EXPECT_EQ(20, scheduler.now());
+  EXPECT_EQ(30, scheduler.next_event_cycle());
+
+  scheduler.run_until(100);
+  EXPECT_EQ(EventScheduler::NO_EVENT, scheduler.next_event_cycle());
+  EXPECT_EQ(0, scheduler.size());
+}
+
+TEST(EventScheduler_test, runUntilNoEvent) {
+  EventScheduler scheduler;
+  scheduler.run_until(EventScheduler::NO_EVENT);
+  EXPECT_EQ(EventScheduler::NO_EVENT, scheduler.now())
+    << "Running an empty EventScheduler until NO_EVENT should only advance now()";
+
+  EventScheduler   draining;
+  std::vector<int> fired;
+  draining.schedule_at(5, [&] { fired.push_back(0); });
+  draining.schedule_at(1'000'000, [&] { fired.push_back(1); });
+  draining.run_until(EventScheduler::NO_EVENT);
+  EXPECT_EQ((std::vector<int>{0, 1}), fired);
+  EXPECT_EQ(0, draining.size());
+}
+
+TEST(EventScheduler_test, cancelAndReschedule) {
+  EventScheduler   scheduler;
+  std::vector<int> fired;
+
+  const EventHandle a = scheduler.schedule_at(10, [&] { fired.push_back(0); });
+  const EventHandle b = scheduler.schedule_at(20, [&] { fired.push_back(1); });
+
+  EXPECT_TRUE(scheduler.pending(a));
+  EXPECT_TRUE(scheduler.cancel(a));
+  EXPECT_FALSE(scheduler.pending(a));
+  EXPECT_FALSE(scheduler.cancel(a)) << "Cancelling a stale handle should have no effect";
+  EXPECT_EQ(20, scheduler.next_event_cycle());
+
+  const EventHandle b2 = scheduler.reschedule(b, 5);
+  EXPECT_FALSE(scheduler.pending(b)) << "Rescheduling an event should invalidate the old handle";
+  EXPECT_TRUE(scheduler.pending(b2));
+  EXPECT_EQ(5, scheduler.next_event_cycle());
+  EXPECT_EQ(1, scheduler.size());
+
+  // The freed slot will be reused; the stale handle must not refer to the new event
+  const EventHandle c = scheduler.schedule_at(15, [&] { fired.push_back(2); });
+  EXPECT_FALSE(scheduler.cancel(a));
+  EXPECT_TRUE(scheduler.pending(c));
+
+  scheduler.run_until(30);
+  EXPECT_EQ((std::vector<int>{1, 2}), fired);
+  EXPECT_FALSE(scheduler.pending(b2)) << "Handles should become stale once their event fires";
+}
+
+TEST(EventScheduler_test, scheduleFromCallback) {
+  EventScheduler       scheduler;
+  std::vector<Cycle_t> fired;
+
+  // Periodic event which reschedules itself every 100 cycles
+  std::function<void()> periodic = [&] {
+    fired.push_back(scheduler.now());
+    scheduler.schedule_in(100, periodic);
+  };
+  scheduler.schedule_at(50, periodic);
+
+  scheduler.run_until(350);
+  EXPECT_EQ((std::vector<Cycle_t>{50, 150, 250, 350}), fired)
+    << "EventScheduler::now should return the timestamp of the event being fired, and events "
+       "scheduled by callbacks should fire in the same call to run_until if they are due";
+  EXPECT_EQ(1, scheduler.size());
+}
+
+TEST(EventScheduler_test, scheduleFromCycle) {
+  EventScheduler       scheduler;
+  std::vector<Cycle_t> fired;
+
+  // e.g. a Component which is partway through a timeslice that started at cycle 0
+  scheduler.schedule_in(150, 10, [&] { fired.push_back(scheduler.now()); });
+  scheduler.schedule_in(10, [&] { fired.push_back(scheduler.now()); });
+
+  scheduler.run_until(200);
+  EXPECT_EQ((std::vector<Cycle_t>{10, 160}), fired)
+    << "EventScheduler::schedule_in should schedule relative to the given cycle if there is one, "
+       "and relative to now() otherwise";
+}
+
+TEST(EventScheduler_test, clear) {
+  EventScheduler scheduler;
+  int            numFired = 0;
+
+  const EventHandle handle = scheduler.schedule_at(10, [&] { ++numFired; });
+  scheduler.schedule_at(20, [&] { ++numFired; });
+
+  scheduler.clear();
+  EXPECT_EQ(0, scheduler.size());
+  EXPECT_EQ(EventScheduler::NO_EVENT, scheduler.next_event_cycle());
+  EXPECT_FALSE(scheduler.pending(handle)) << "EventScheduler::clear should make every handle stale";
+
+  scheduler.schedule_at(30, [&] { ++numFired; });
+  scheduler.run_until(100);
+  EXPECT_EQ(1, numFired) << "Events cancelled by EventScheduler::clear should never fire";
+}
+
+TEST(EventScheduler_test, manyCancellations) {
+  EventScheduler scheduler;
+  int            numFired = 0;
+
+  std::vector<EventHandle> handles;
+  for(Cycle_t i = 0; i < 1000; ++i) {
+    handles.push_back(scheduler.schedule_at(i, [&] { ++numFired; }));
+  }
+
+  for(std::size_t i = 0; i < handles.size(); ++i) {
+    if(i % 10 != 0) {
+      scheduler.cancel(handles[i]);
+    }
+  }
+
+  EXPECT_EQ(100, scheduler.size());
+  EXPECT_EQ(0, scheduler.next_event_cycle());
+
+  scheduler.run_until(EventScheduler::NO_EVENT - 1);
+  EXPECT_EQ(100, numFired) << "Cancelled events should never fire";
+}
@@ -0,0 +1,63 @@
+#include "omulator/util/ExecutableMemory.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdexcept>
+
+using omulator::S32;
+using omulator::U8;
+using omulator::util::ExecutableMemory;
+
+#if defined(OML_ARCH_X64)
+TEST(ExecutableMemory_test, runGeneratedCode) {
+  ExecutableMemory mem(1);
+  EXPECT_GE(mem.size(), 1) << "ExecutableMemory should allocate at least the requested size";
+  EXPECT_FALSE(mem.executable()) << "ExecutableMemory should start out writable";
+
+  using Fn_t = S32 (*)();
+
+  // mov eax, 42; ret
+  const U8 code[] = {0xB8, 42, 0, 0, 0, 0xC3};
+  std::memcpy(mem.data(), code, sizeof(code));
+  mem.make_executable();
+  EXPECT_TRUE(mem.executable());
+  EXPECT_EQ(42, reinterpret_cast<Fn_t>(mem.data())());
+
+  mem.make_writable();
+  EXPECT_FALSE(mem.executable());
+  mem.data()[1] = 43;
+  mem.make_executable();
+  mem.make_executable();
+  EXPECT_EQ(43, reinterpret_cast<Fn_t>(mem.data())())
+    << "ExecutableMemory should run code which has been modified after being made writable again";
+}
+
+TEST(ExecutableMemory_test, partiallyWritable) {
+  ExecutableMemory  probe(1);
+  const std::size_t pageSize = probe.size();
+
+  ExecutableMemory mem(pageSize * 2);
+
+  using Fn_t = S32 (*)();
+
+  // mov eax, 42; ret
+  const U8 code[] = {0xB8, 42, 0, 0, 0, 0xC3};
+  std::memcpy(mem.data(), code, sizeof(code));
+  mem.make_executable();
+
+  mem.make_writable(mem.data() + pageSize, 1);
+  EXPECT_FALSE(mem.executable());
+  EXPECT_EQ(42, reinterpret_cast<Fn_t>(mem.data())())
+    << "ExecutableMemory::make_writable should leave pages outside of the given range executable";
+
+  std::memcpy(mem.data() + pageSize, code, sizeof(code));
+  mem.data()[pageSize + 1] = 43;
+  mem.make_executable();
+  EXPECT_TRUE(mem.executable());
+  EXPECT_EQ(43, reinterpret_cast<Fn_t>(mem.data() + pageSize)());
+
+  EXPECT_THROW(mem.make_writable(mem.data() + mem.size(), 1), std::out_of_range)
+    << "ExecutableMemory::make_writable should reject ranges outside of the memory";
+}
+#endif
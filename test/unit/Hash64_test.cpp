@@ -0,0 +1,55 @@
+#include "omulator/util/Hash64.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <span>
+#include <vector>
+
+using omulator::U64;
+using omulator::U8;
+using omulator::util::hash64;
+
+TEST(Hash64_test, deterministic) {
+  std::mt19937    rng(1234);
+  std::vector<U8> data(5000);
+  for(auto &byte : data) {
+    byte = static_cast<U8>(rng());
+  }
+
+  const std::vector<U8> copy = data;
+  EXPECT_EQ(hash64(data), hash64(copy));
+  EXPECT_EQ(hash64(data, 42), hash64(copy, 42));
+  EXPECT_NE(hash64(data), hash64(data, 42)) << "The seed should change the hash";
+
+  // The same data at a different alignment
+  std::vector<U8> shifted(data.size() + 1);
+  std::copy(data.begin(), data.end(), shifted.begin() + 1);
+  EXPECT_EQ(hash64(data), hash64(std::span<const U8>(shifted).subspan(1)))
+    << "hash64 should not depend on the alignment of its input";
+
+  EXPECT_EQ(hash64({}), hash64({})) << "hash64 should accept empty input";
+}
+
+TEST(Hash64_test, sensitivity) {
+  // Covers whole 1KiB blocks, whole stripes, and a partial stripe
+  std::vector<U8> data(2 * 1024 + 3 * 64 + 10, 0);
+  std::set<U64>   hashes{hash64(data)};
+
+  for(std::size_t i = 0; i < data.size(); ++i) {
+    data[i] ^= static_cast<U8>(1 << (i % 8));
+    hashes.insert(hash64(data));
+    data[i] ^= static_cast<U8>(1 << (i % 8));
+  }
+
+  EXPECT_EQ(data.size() + 1, hashes.size()) << "Flipping any single bit should change the hash";
+
+  for(std::size_t len = 0; len < 200; ++len) {
+    hashes.insert(hash64(std::span<const U8>(data).first(len)));
+  }
+
+  EXPECT_EQ(data.size() + 1 + 200, hashes.size())
+    << "Inputs of zeroes of different lengths should have different hashes";
+}
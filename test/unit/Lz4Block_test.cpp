@@ -0,0 +1,85 @@
+#include "omulator/util/Lz4Block.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using omulator::U8;
+using omulator::util::lz4_compress;
+using omulator::util::lz4_decompress;
+
+namespace {
+
+std::vector<U8> round_trip(const std::vector<U8> &src, std::vector<U8> &block) {
+  block.clear();
+  lz4_compress(src, block);
+
+  std::vector<U8> dst(src.size());
+  lz4_decompress(block, dst);
+  return dst;
+}
+
+}  // namespace
+
+TEST(Lz4Block_test, roundTrip) {
+  std::mt19937    rng(1234);
+  std::vector<U8> block;
+
+  // Repetitive data, with runs long enough to need extra length bytes and overlapping matches
+  std::vector<U8> repetitive;
+  for(int i = 0; i < 2000; ++i) {
+    repetitive.push_back(static_cast<U8>(i % 7));
+  }
+  repetitive.insert(repetitive.end(), 1000, 0xAA);
+  EXPECT_EQ(repetitive, round_trip(repetitive, block));
+  EXPECT_LT(block.size(), repetitive.size() / 20) << "Repetitive data should compress well";
+
+  std::vector<U8> random(5000);
+  for(auto &byte : random) {
+    byte = static_cast<U8>(rng());
+  }
+  EXPECT_EQ(random, round_trip(random, block));
+  EXPECT_LT(block.size(), random.size() + random.size() / 100)
+    << "Incompressible data should only grow slightly";
+
+  // Every size around the minimum length for a match
+  for(std::size_t size = 0; size < 40; ++size) {
+    std::vector<U8> small(size, 0x55);
+    EXPECT_EQ(small, round_trip(small, block)) << "Failed to round trip " << size << " bytes";
+  }
+}
+
+TEST(Lz4Block_test, knownBlock) {
+  // "abcabcabcabcabcabc" as 3 literals followed by a 15 byte match at offset 3, plus 5 more
+  // literals at the end, encoded by hand
+  const std::vector<U8> block{
+    0x3B, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'x', 'y', 'z', 'w', 'v'};
+
+  std::vector<U8> dst(23);
+  lz4_decompress(block, dst);
+  EXPECT_EQ(std::vector<U8>({'a', 'b', 'c', 'a', 'b', 'c', 'a', 'b', 'c', 'a', 'b', 'c',
+                             'a', 'b', 'c', 'a', 'b', 'c', 'x', 'y', 'z', 'w', 'v'}),
+            dst);
+}
+
+TEST(Lz4Block_test, malformed) {
+  std::vector<U8> src(100, 0x11);
+  std::vector<U8> block;
+  lz4_compress(src, block);
+
+  std::vector<U8> dst(src.size());
+  std::vector<U8> bigger(src.size() + 1);
+  EXPECT_THROW(lz4_decompress(block, bigger), std::runtime_error)
+    << "Decompressing to the wrong size should fail";
+
+  std::vector<U8> truncated(block.begin(), block.end() - 1);
+  EXPECT_THROW(lz4_decompress(truncated, dst), std::runtime_error);
+  EXPECT_THROW(lz4_decompress({}, dst), std::runtime_error);
+
+  // A match which refers to data before the start of the output
+  const std::vector<U8> badOffset{0x10, 'a', 0x05, 0x00, 0x00};
+  std::vector<U8>       out(5);
+  EXPECT_THROW(lz4_decompress(badOffset, out), std::runtime_error);
+}
@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <vector>
 
 using omulator::U64;
@@ -48,6 +49,27 @@ TEST(MailboxEndpoint_test, usageTest) {
   EXPECT_EQ(LIFE, i) << "MailboxEndpoints should properly send and recv messages";
 }
 
+TEST(MailboxEndpoint_test, recvUntil) {
+  LoggerMock          logger;
+  MessageQueueFactory mqf(logger, 0);
+  MailboxEndpoint     me(0, logger, mqf);
+  me.claim();
+
+  U64 i = 0;
+  me.on(MessageType::DEMO_MSG_A, [&](const Message &msg) { i = msg.payload; });
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);
+  EXPECT_FALSE(me.recv_until(deadline));
+  EXPECT_LE(deadline, std::chrono::steady_clock::now())
+    << "MailboxEndpoint::recv_until should block until the deadline if no messages are sent";
+
+  auto mq = me.get_mq();
+  mq.push(MessageType::DEMO_MSG_A, LIFE);
+  me.send(mq);
+  EXPECT_TRUE(me.recv_until(std::chrono::steady_clock::now() + std::chrono::hours(1)));
+  EXPECT_EQ(LIFE, i) << "MailboxEndpoint::recv_until should process messages as they arrive";
+}
+
 // TODO: test off, on w/ other trivial types, on_managed_payload, log missed msgs, esp. log if
 // missed managed msg
 
@@ -0,0 +1,71 @@
+#include "omulator/util/MappedFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using omulator::U8;
+using omulator::util::MappedFile;
+
+TEST(MappedFile_test, readWrite) {
+  const auto path = std::filesystem::temp_directory_path() / "MappedFile_test_readWrite.bin";
+
+  {
+    MappedFile file(path, 5000);
+    EXPECT_TRUE(file.writable());
+    ASSERT_EQ(5000, file.size());
+    EXPECT_EQ(0, file.data()[0]) << "A newly created MappedFile should be zero-filled";
+    EXPECT_EQ(0, file.data()[4999]);
+
+    file.data()[0]    = 0x12;
+    file.data()[4999] = 0x34;
+  }
+
+  EXPECT_EQ(5000, std::filesystem::file_size(path));
+
+  {
+    const MappedFile file(path);
+    EXPECT_FALSE(file.writable());
+    ASSERT_EQ(5000, file.size());
+    EXPECT_EQ(0x12, file.data()[0]) << "Writes to a MappedFile should be written back to the file";
+    EXPECT_EQ(0x34, file.data()[4999]);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(MappedFile_test, emptyAndMissing) {
+  const auto path = std::filesystem::temp_directory_path() / "MappedFile_test_empty.bin";
+  std::ofstream(path).close();
+
+  {
+    const MappedFile file(path);
+    EXPECT_EQ(0, file.size());
+    EXPECT_EQ(nullptr, file.data());
+  }
+
+  EXPECT_THROW(MappedFile(path, 0), std::invalid_argument);
+  std::filesystem::remove(path);
+
+  EXPECT_THROW(MappedFile(std::filesystem::path("/nonexistent/file.bin")), std::runtime_error);
+}
+
+TEST(MappedFile_test, advise) {
+  const auto path = std::filesystem::temp_directory_path() / "MappedFile_test_advise.bin";
+
+  {
+    MappedFile file(path, 3 * 4096 + 5);
+    file.data()[5000] = 0x56;
+
+    // Hints are clamped to the file and may be unaligned, and must not disturb its contents
+    file.advise(MappedFile::Advice::RANDOM, 0, file.size());
+    file.advise(MappedFile::Advice::WILL_NEED, 4097, 1 << 20);
+    file.advise(MappedFile::Advice::SEQUENTIAL, 1 << 20, 100);
+    file.advise(MappedFile::Advice::NORMAL, 1, 1);
+    EXPECT_EQ(0x56, file.data()[5000]);
+  }
+
+  std::filesystem::remove(path);
+}
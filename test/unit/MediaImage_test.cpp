@@ -0,0 +1,240 @@
+#include "omulator/MediaImage.hpp"
+
+#include "omulator/MediaReadAhead.hpp"
+#include "omulator/MemoryBus.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using omulator::HunkHeader;
+using omulator::MediaImage;
+using omulator::MediaReadAhead;
+using omulator::MemoryBus;
+using omulator::U8;
+using omulator::msg::MailboxRouter;
+using omulator::msg::MessageQueueFactory;
+
+namespace {
+
+constexpr std::size_t HUNK_SIZE = 0x400;
+
+/**
+ * Half random bytes and half a repeating pattern, so that some hunks are compressed and some are
+ * stored as is.
+ */
+std::vector<U8> make_image(const std::size_t size) {
+  std::mt19937    rng(1234);
+  std::vector<U8> image(size);
+  for(std::size_t i = 0; i < size; ++i) {
+    image[i] = i < size / 2 ? static_cast<U8>(rng()) : static_cast<U8>(i % 13);
+  }
+  return image;
+}
+
+void write_raw(const std::filesystem::path &path, const std::vector<U8> &data) {
+  std::ofstream(path, std::ios::binary)
+    .write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+}  // namespace
+
+TEST(MediaImage_test, raw) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+
+  const auto path  = std::filesystem::temp_directory_path() / "MediaImage_test_raw.bin";
+  const auto image = make_image(0x2345);
+  write_raw(path, image);
+
+  {
+    MediaImage media(path);
+    EXPECT_FALSE(media.compressed());
+    EXPECT_EQ(image.size(), media.size());
+    EXPECT_EQ(image.data()[0x1000], media.data()[0x1000]);
+
+    std::vector<U8> buf(0x100);
+    media.read(0x2245, buf);
+    EXPECT_TRUE(std::equal(buf.begin(), buf.end(), image.begin() + 0x2245));
+    EXPECT_THROW(media.read(0x2246, buf), std::out_of_range);
+    media.prefetch(0x1000, 0x100000);
+
+    MemoryBus bus(logger, 16, 12);
+    media.map_into(bus, 0x4000);
+    EXPECT_EQ(image[0], bus.read8(0x4000));
+    EXPECT_EQ(image[0x1FFF], bus.read8(0x5FFF));
+    EXPECT_EQ(image[0x2344], bus.read8(0x6344)) << "The partial last page should be mapped";
+    EXPECT_EQ(0, bus.read8(0x6345)) << "The remainder of the last page should read as zero";
+    EXPECT_EQ(MemoryBus::OPEN_BUS_VALUE, bus.read8(0x7000));
+
+    bus.write8(0x4000, static_cast<U8>(~image[0]));
+    EXPECT_EQ(image[0], bus.read8(0x4000)) << "Mapped images should be read-only";
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(MediaImage_test, hunked) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+
+  const auto path  = std::filesystem::temp_directory_path() / "MediaImage_test_hunked.bin";
+  const auto image = make_image(0x3456);
+  MediaImage::write_hunked(path, image, HUNK_SIZE);
+  EXPECT_LT(std::filesystem::file_size(path), image.size())
+    << "Compressible hunks should be stored compressed";
+
+  {
+    MediaImage media(path, 4);
+    EXPECT_TRUE(media.compressed());
+    EXPECT_EQ(image.size(), media.size());
+    EXPECT_EQ(HUNK_SIZE, media.hunk_size());
+    EXPECT_TRUE(media.data().empty());
+
+    std::vector<U8> all(image.size());
+    media.read(0, all);
+    EXPECT_EQ(image, all) << "Hunked images should decompress to the original image";
+
+    // Reads which straddle hunks
+    std::vector<U8> buf(HUNK_SIZE + 2);
+    media.read(3 * HUNK_SIZE - 1, buf);
+    EXPECT_TRUE(std::equal(buf.begin(), buf.end(), image.begin() + 3 * HUNK_SIZE - 1));
+    EXPECT_THROW(media.read(image.size() - 1, buf), std::out_of_range);
+
+    MemoryBus bus(logger, 16, 12);
+    media.map_into(bus, 0x8000);
+    EXPECT_EQ(MemoryBus::PageKind::MMIO, bus.page_kind(0x9000));
+    for(std::size_t i = 0; i < image.size(); i += 0x111) {
+      ASSERT_EQ(image[i], bus.read8(static_cast<MemoryBus::Addr_t>(0x8000 + i)));
+    }
+    EXPECT_EQ(image.back(), bus.read8(static_cast<MemoryBus::Addr_t>(0x8000 + image.size() - 1)));
+    EXPECT_EQ(0, bus.read8(static_cast<MemoryBus::Addr_t>(0x8000 + image.size())));
+
+    for(MemoryBus::Addr_t addr = 0x8000; addr < 0xC000; addr += 0x1000) {
+      EXPECT_EQ(MemoryBus::PageKind::ROM, bus.page_kind(addr))
+        << "Each page of a hunked image should be mapped as ROM once it has been touched";
+    }
+    EXPECT_NE(nullptr, bus.read_page_table()[0x9]);
+
+    bus.write8(0x9000, static_cast<U8>(~image[0x1000]));
+    EXPECT_EQ(image[0x1000], bus.read8(0x9000)) << "Mapped images should be read-only";
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(MediaImage_test, cache) {
+  const auto path  = std::filesystem::temp_directory_path() / "MediaImage_test_cache.bin";
+  const auto image = make_image(8 * HUNK_SIZE);
+  MediaImage::write_hunked(path, image, HUNK_SIZE);
+
+  {
+    MediaImage media(path, 2);
+    U8         byte;
+    media.read(0, {&byte, 1});
+    media.read(1, {&byte, 1});
+    EXPECT_EQ(1, media.cache_stats().hits);
+    EXPECT_EQ(1, media.cache_stats().misses);
+
+    media.read(HUNK_SIZE, {&byte, 1});
+    media.read(0, {&byte, 1});
+    media.read(2 * HUNK_SIZE, {&byte, 1});
+    EXPECT_EQ(2, media.cache_stats().hits);
+    EXPECT_EQ(3, media.cache_stats().misses);
+
+    media.read(HUNK_SIZE, {&byte, 1});
+    EXPECT_EQ(4, media.cache_stats().misses)
+      << "The least recently used hunk should be evicted when the cache is full";
+
+    media.prefetch(4 * HUNK_SIZE, 2 * HUNK_SIZE);
+    EXPECT_EQ(4, media.cache_stats().misses) << "Prefetches should not count as misses";
+    media.read(5 * HUNK_SIZE, {&byte, 1});
+    media.read(4 * HUNK_SIZE, {&byte, 1});
+    EXPECT_EQ(4, media.cache_stats().hits);
+  }
+
+  EXPECT_THROW(MediaImage(path, 0), std::invalid_argument);
+  std::filesystem::remove(path);
+}
+
+TEST(MediaImage_test, readAhead) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MessageQueueFactory                  mqfactory(logger, 0);
+  MailboxRouter                        mbrouter(logger, mqfactory);
+  MediaReadAhead                       readAhead(logger, mbrouter);
+  readAhead.start();
+
+  const auto path  = std::filesystem::temp_directory_path() / "MediaImage_test_readAhead.bin";
+  const auto image = make_image(8 * HUNK_SIZE);
+  MediaImage::write_hunked(path, image, HUNK_SIZE);
+
+  {
+    MediaImage media(path);
+    media.set_read_ahead(&readAhead, 3);
+
+    U8 byte;
+    media.read(0, {&byte, 1});
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(readAhead.completed() < 1 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(1, readAhead.completed());
+
+    for(std::size_t i = 1; i <= 3; ++i) {
+      media.read(i * HUNK_SIZE, {&byte, 1});
+      EXPECT_EQ(image[i * HUNK_SIZE], byte);
+    }
+    EXPECT_EQ(3, media.cache_stats().hits)
+      << "The hunks following a miss should be decompressed in the background";
+    EXPECT_EQ(1, media.cache_stats().misses);
+
+    // Destroying the image cancels anything still pending
+    media.read(6 * HUNK_SIZE, {&byte, 1});
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(MediaImage_test, malformed) {
+  const auto path  = std::filesystem::temp_directory_path() / "MediaImage_test_malformed.bin";
+  const auto image = make_image(4 * HUNK_SIZE);
+  MediaImage::write_hunked(path, image, HUNK_SIZE);
+
+  std::vector<U8> file(std::filesystem::file_size(path));
+  std::ifstream(path, std::ios::binary)
+    .read(reinterpret_cast<char *>(file.data()), static_cast<std::streamsize>(file.size()));
+
+  // Claim that there are more hunks than fit in the file
+  std::vector<U8> badHeader = file;
+  HunkHeader      header;
+  std::memcpy(&header, badHeader.data(), sizeof(header));
+  header.imageSize *= 1000;
+  header.numHunks *= 1000;
+  std::memcpy(badHeader.data(), &header, sizeof(header));
+  write_raw(path, badHeader);
+  EXPECT_THROW(MediaImage{path}, std::runtime_error);
+
+  // Corrupt the last (compressed) hunk; the error should only surface when it is read
+  std::vector<U8> badHunk = file;
+  badHunk.back() ^= 0xFF;
+  badHunk.resize(badHunk.size() - 3);
+  write_raw(path, badHunk);
+  {
+    MediaImage media(path);
+    U8         byte;
+    media.read(0, {&byte, 1});
+    EXPECT_THROW(media.read(media.size() - 1, {&byte, 1}), std::runtime_error);
+  }
+
+  std::filesystem::remove(path);
+  EXPECT_THROW(MediaImage{path}, std::runtime_error);
+}
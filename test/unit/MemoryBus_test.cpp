@@ -0,0 +1,406 @@
+#include "omulator/MemoryBus.hpp"
+
+#include "omulator/StateArchive.hpp"
+
+#include "mocks/LoggerMock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using omulator::MemoryBus;
+using omulator::StateArchive;
+using omulator::U16;
+using omulator::U32;
+using omulator::U8;
+
+TEST(MemoryBus_test, ram) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  EXPECT_EQ(256, bus.page_size());
+  EXPECT_EQ(256, bus.num_pages());
+
+  auto ram = bus.add_ram(0x1000, 0x200);
+  EXPECT_EQ(0x200, ram.size());
+  EXPECT_EQ(0, bus.read8(0x1000)) << "MemoryBus RAM should be zero-initialized";
+
+  bus.write8(0x1001, 0xAB);
+  EXPECT_EQ(0xAB, bus.read8(0x1001));
+  EXPECT_EQ(0xAB, ram[1]) << "MemoryBus::add_ram should return the RAM backing the mapped range";
+
+  bus.write<U16>(0x1010, 0x1234);
+  EXPECT_EQ(0x34, bus.read8(0x1010)) << "MemoryBus multi-byte accesses should be little-endian";
+  EXPECT_EQ(0x12, bus.read8(0x1011)) << "MemoryBus multi-byte accesses should be little-endian";
+  EXPECT_EQ(0x1234, bus.read<U16>(0x1010));
+
+  bus.write<U32>(0x10FE, 0xDEADBEEF);
+  EXPECT_EQ(0xDEADBEEF, bus.read<U32>(0x10FE))
+    << "MemoryBus accesses which straddle a page boundary should behave like any other access";
+  EXPECT_EQ(0xAD, bus.read8(0x1100));
+
+  bus.write8(0x11001, 0x56);
+  EXPECT_EQ(0x56, bus.read8(0x1001)) << "MemoryBus addresses should wrap to the address space";
+}
+
+TEST(MemoryBus_test, romAndOpenBus) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  std::vector<U8> rom(0x100);
+  for(std::size_t i = 0; i < rom.size(); ++i) {
+    rom[i] = static_cast<U8>(i);
+  }
+
+  bus.map_rom(0x8000, rom);
+  EXPECT_EQ(0x42, bus.read8(0x8042));
+  EXPECT_EQ(0x4342, bus.read<U16>(0x8042));
+  EXPECT_EQ(rom.data(), bus.read_page_table()[0x80]);
+  EXPECT_EQ(nullptr, bus.write_page_table()[0x80])
+    << "MemoryBus ROM pages should not be writable through the page table";
+
+  bus.write8(0x8042, 0xFF);
+  EXPECT_EQ(0x42, bus.read8(0x8042)) << "Writes to MemoryBus ROM should be ignored";
+  EXPECT_EQ(0x42, rom[0x42]) << "Writes to MemoryBus ROM should be ignored";
+
+  EXPECT_EQ(MemoryBus::OPEN_BUS_VALUE, bus.read8(0x0000))
+    << "Reads from unmapped MemoryBus pages should return the open bus value";
+  EXPECT_EQ(0xFFFF, bus.read<U16>(0x80FF)) << "The open bus value should apply per-byte";
+  bus.write8(0x0000, 0x12);
+
+  bus.unmap(0x8000, 0x100);
+  EXPECT_EQ(MemoryBus::OPEN_BUS_VALUE, bus.read8(0x8042));
+}
+
+TEST(MemoryBus_test, mmio) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  std::vector<std::pair<U32, U8>> writes;
+  std::vector<U32>                reads;
+
+  bus.map_mmio(
+    0xFF00,
+    0x100,
+    [&](const U32 addr) {
+      reads.push_back(addr);
+      return static_cast<U8>(addr & 0xF);
+    },
+    [&](const U32 addr, const U8 val) { writes.emplace_back(addr, val); });
+
+  EXPECT_EQ(0x03, bus.read8(0xFF03));
+  EXPECT_EQ(0x0504, bus.read<U16>(0xFF04))
+    << "Multi-byte MemoryBus accesses to MMIO should be split into byte accesses";
+  EXPECT_EQ((std::vector<U32>{0xFF03, 0xFF04, 0xFF05}), reads)
+    << "MemoryBus MMIO handlers should receive the full address of each access";
+
+  bus.write<U16>(0xFF10, 0xBEEF);
+  EXPECT_EQ((std::vector<std::pair<U32, U8>>{{0xFF10, 0xEF}, {0xFF11, 0xBE}}), writes);
+
+  // Remapping a page as RAM should take it off of the slow path
+  bus.add_ram(0xFF00, 0x100);
+  bus.write8(0xFF10, 0x99);
+  EXPECT_EQ(0x99, bus.read8(0xFF10));
+  EXPECT_EQ(2, writes.size());
+}
+
+TEST(MemoryBus_test, deferredMapChanges) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  std::array<U8, 0x100> rom{};
+  rom.fill(0x42);
+
+  bool threw = false;
+  bus.map_mmio(
+    0xFF00,
+    0x100,
+    [&](const U32 addr) {
+      // Changing the map directly from within a handler is an error
+      try {
+        bus.unmap(0xFF00, 0x100);
+      }
+      catch(const std::logic_error &) {
+        threw = true;
+      }
+
+      bus.defer_map_change([&] { bus.map_rom(0xFF00, rom); });
+      EXPECT_EQ(MemoryBus::PageKind::MMIO, bus.page_kind(addr))
+        << "Deferred MemoryBus map changes should not be applied while the handler is running";
+      return U8{0x11};
+    },
+    []([[maybe_unused]] const U32 addr, [[maybe_unused]] const U8 val) { });
+
+  EXPECT_EQ(0x11, bus.read8(0xFF20));
+  EXPECT_TRUE(threw);
+  EXPECT_EQ(MemoryBus::PageKind::ROM, bus.page_kind(0xFF20))
+    << "Deferred MemoryBus map changes should be applied once the access has returned";
+  EXPECT_EQ(0x42, bus.read8(0xFF20));
+
+  // Changes deferred by a handler which throws are dropped
+  bus.map_mmio(
+    0xFE00,
+    0x100,
+    [&]([[maybe_unused]] const U32 addr) -> U8 {
+      bus.defer_map_change([&] { bus.unmap(0xFE00, 0x100); });
+      throw std::runtime_error("MMIO read failed");
+    },
+    []([[maybe_unused]] const U32 addr, [[maybe_unused]] const U8 val) { });
+
+  EXPECT_THROW(bus.read8(0xFE00), std::runtime_error);
+  EXPECT_EQ(MemoryBus::PageKind::MMIO, bus.page_kind(0xFE00));
+
+  // Outside of a handler, changes are applied immediately
+  bus.defer_map_change([&] { bus.unmap(0xFE00, 0x100); });
+  EXPECT_EQ(MemoryBus::PageKind::UNMAPPED, bus.page_kind(0xFE00));
+  EXPECT_THROW(bus.defer_map_change({}), std::invalid_argument);
+}
+
+TEST(MemoryBus_test, invalidMappings) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+
+  EXPECT_THROW(MemoryBus(logger, 33, 12), std::invalid_argument);
+  EXPECT_THROW(MemoryBus(logger, 16, 0), std::invalid_argument);
+  EXPECT_THROW(MemoryBus(logger, 12, 16), std::invalid_argument);
+
+  MemoryBus bus(logger, 16, 12);
+
+  EXPECT_THROW(bus.add_ram(0x0800, 0x1000), std::invalid_argument)
+    << "MemoryBus ranges must be page-aligned";
+  EXPECT_THROW(bus.add_ram(0x0000, 0x0800), std::invalid_argument)
+    << "MemoryBus ranges must be page-aligned";
+  EXPECT_THROW(bus.add_ram(0x0000, 0), std::invalid_argument);
+  EXPECT_THROW(bus.add_ram(0xF000, 0x2000), std::invalid_argument)
+    << "MemoryBus ranges must fit within the address space";
+  EXPECT_THROW(bus.map_mmio(0x0000, 0x1000, {}, {}), std::invalid_argument);
+
+  std::array<U8, 0x800> rom{};
+  EXPECT_THROW(bus.map_rom(0x0000, rom), std::invalid_argument);
+}
+
+TEST(MemoryBus_test, fullAddressSpace) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 32, 16);
+
+  EXPECT_EQ(0x10000, bus.num_pages());
+
+  bus.add_ram(0xFFFF0000, 0x10000);
+  bus.write<U32>(0xFFFFFFFE, 0x11223344);
+  EXPECT_EQ(0x3344, bus.read<U16>(0xFFFFFFFE));
+  EXPECT_EQ(MemoryBus::OPEN_BUS_VALUE, bus.read8(0x00000000))
+    << "Accesses which run off of the end of the address space should wrap around";
+}
+
+TEST(MemoryBus_test, writeWatchers) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  std::vector<std::pair<U32, std::size_t>> changes;
+  const std::size_t                        id = bus.add_write_watcher(
+    [&](const U32 addr, const std::size_t size) { changes.emplace_back(addr, size); });
+
+  auto ram = bus.add_ram(0x0000, 0x200);
+  bus.write8(0x0010, 1);
+  EXPECT_TRUE(changes.empty())
+    << "MemoryBus write watchers should only be notified of writes to watched pages";
+
+  bus.watch_page(0x0010);
+  bus.watch_page(0x0020);
+  bus.write8(0x0011, 2);
+  bus.write8(0x0111, 3);
+  EXPECT_EQ(2, ram[0x11]) << "Writes to watched pages should still be performed";
+  EXPECT_EQ((std::vector<std::pair<U32, std::size_t>>{{0x0011, 1}}), changes);
+
+  bus.unwatch_page(0x0000);
+  bus.write8(0x0012, 4);
+  EXPECT_EQ(2, changes.size()) << "MemoryBus page watches should be counted";
+
+  bus.unwatch_page(0x0000);
+  bus.write8(0x0013, 5);
+  EXPECT_EQ(2, changes.size());
+  EXPECT_THROW(bus.unwatch_page(0x0000), std::runtime_error);
+
+  bus.watch_page(0x0100);
+  bus.unmap(0x0000, 0x200);
+  EXPECT_EQ((std::pair<U32, std::size_t>{0x0100, 0x100}), changes.back())
+    << "MemoryBus write watchers should be notified when a watched page is remapped";
+  EXPECT_EQ(3, changes.size());
+
+  bus.remove_write_watcher(id);
+  bus.add_ram(0x0100, 0x100);
+  bus.write8(0x0100, 6);
+  EXPECT_EQ(3, changes.size());
+  EXPECT_EQ(MemoryBus::PageKind::RAM, bus.page_kind(0x0100));
+  EXPECT_EQ(MemoryBus::PageKind::UNMAPPED, bus.page_kind(0x0000));
+}
+
+TEST(MemoryBus_test, traps) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  std::vector<std::pair<U32, bool>> accesses;
+  bus.set_access_hook(
+    [&](const U32 addr, const bool write) { accesses.emplace_back(addr, write); });
+
+  auto                  ram = bus.add_ram(0x0000, 0x200);
+  std::array<U8, 0x100> rom{};
+  rom[0x10] = 0x42;
+  bus.map_rom(0x0200, rom);
+
+  bus.write8(0x0010, 1);
+  EXPECT_EQ(1, bus.read8(0x0010));
+  EXPECT_TRUE(accesses.empty()) << "The MemoryBus access hook should only see trapped pages";
+  EXPECT_NE(nullptr, bus.read_page_table()[0]);
+
+  bus.trap_page(0x0000);
+  bus.trap_page(0x0210);
+  EXPECT_EQ(nullptr, bus.read_page_table()[0])
+    << "Trapped pages should be removed from the page tables, so that they take the slow path";
+  EXPECT_EQ(nullptr, bus.write_page_table()[0]);
+
+  bus.write8(0x0011, 2);
+  EXPECT_EQ(2, bus.read8(0x0011));
+  EXPECT_EQ(2, ram[0x11]) << "Accesses to trapped pages should still be performed";
+  EXPECT_EQ(0x42, bus.read8(0x0210));
+  bus.write8(0x0110, 3);
+  EXPECT_EQ((std::vector<std::pair<U32, bool>>{{0x0011, true}, {0x0011, false}, {0x0210, false}}),
+            accesses);
+
+  bus.untrap_page(0x0000);
+  bus.untrap_page(0x0200);
+  EXPECT_THROW(bus.untrap_page(0x0000), std::runtime_error);
+  EXPECT_EQ(ram.data(), bus.write_page_table()[0]);
+  bus.write8(0x0012, 4);
+  EXPECT_EQ(3, accesses.size());
+}
+
+TEST(MemoryBus_test, serialize) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  auto ramA = bus.add_ram(0x0000, 0x100);
+  auto ramB = bus.add_ram(0x8000, 0x300);
+  bus.write8(0x0010, 0x11);
+  bus.write8(0x8210, 0x22);
+
+  StateArchive saver;
+  bus.serialize(saver);
+  std::vector<U8> image(saver.image_size());
+  saver.write(image);
+
+  std::vector<std::pair<U32, std::size_t>> changes;
+  bus.add_write_watcher(
+    [&](const U32 addr, const std::size_t size) { changes.emplace_back(addr, size); });
+  bus.watch_page(0x8100);
+
+  bus.write8(0x0010, 0x33);
+  ramB[0x210] = 0x44;
+  changes.clear();
+
+  StateArchive loader(image);
+  bus.serialize(loader);
+  loader.finish();
+  EXPECT_EQ(0x11, bus.read8(0x0010)) << "MemoryBus::serialize should restore the contents of RAM";
+  EXPECT_EQ(0x22, bus.read8(0x8210));
+  EXPECT_EQ(0x22, ramB[0x210]) << "MemoryBus::serialize should restore RAM in place";
+  EXPECT_EQ(&ramA[0], bus.read_page_table()[0]);
+  EXPECT_EQ((std::vector<std::pair<U32, std::size_t>>{{0x8100, 0x100}}), changes)
+    << "MemoryBus write watchers should be notified of every watched RAM page after a load";
+
+  MemoryBus other(logger, 16, 8);
+  other.add_ram(0x0000, 0x100);
+  StateArchive mismatched(image);
+  EXPECT_THROW(other.serialize(mismatched), std::runtime_error)
+    << "MemoryBus::serialize should throw if the state has a different set of RAM blocks";
+}
+
+TEST(MemoryBus_test, dirtyTracking) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 16, 8);
+
+  auto ram = bus.add_ram(0x0000, 0x300);
+  bus.add_ram(0x8000, 0x100);
+  ASSERT_EQ(4, bus.num_ram_pages());
+  EXPECT_FALSE(bus.dirty_tracking());
+  EXPECT_THROW(bus.collect_dirty_pages(0, [](std::size_t, std::span<const U8>) {}),
+               std::invalid_argument);
+
+  std::vector<std::size_t> dirty;
+
+  const auto collect = [&](const std::size_t id) {
+    dirty.clear();
+    bus.collect_dirty_pages(id, [&](const std::size_t idx, std::span<const U8> page) {
+      EXPECT_EQ(bus.page_size(), page.size());
+      dirty.push_back(idx);
+    });
+  };
+
+  const std::size_t tracker = bus.add_dirty_tracker();
+  EXPECT_TRUE(bus.dirty_tracking());
+  collect(tracker);
+  EXPECT_EQ((std::vector<std::size_t>{0, 1, 2, 3}), dirty)
+    << "Adding a dirty tracker should mark all RAM as dirty for it";
+  EXPECT_EQ(nullptr, bus.write_page_table()[0])
+    << "Clean pages should be removed from the write page table, so that writes are caught";
+  EXPECT_EQ(ram.data(), bus.read_page_table()[0]) << "Dirty tracking should not affect reads";
+
+  collect(tracker);
+  EXPECT_TRUE(dirty.empty());
+
+  bus.write8(0x0210, 1);
+  bus.write8(0x0211, 2);
+  bus.write8(0x8000, 3);
+  EXPECT_EQ(ram.data() + 0x200, bus.write_page_table()[2])
+    << "Writing to a clean page should make it writable from the fast path again";
+  EXPECT_EQ(2, ram[0x211]);
+  collect(tracker);
+  EXPECT_EQ((std::vector<std::size_t>{2, 3}), dirty)
+    << "Each written page should be collected once, in the order in which it was first written";
+
+  bus.write8(0x4000, 4);
+  bus.write8(0x0100, 5);
+  bus.unmap(0x0100, 0x100);
+  collect(tracker);
+  EXPECT_EQ((std::vector<std::size_t>{1}), dirty)
+    << "RAM pages should keep their index once unmapped";
+
+  // A second tracker sees every page as dirty, regardless of what the first has collected
+  const std::size_t other = bus.add_dirty_tracker();
+  EXPECT_NE(tracker, other);
+  collect(other);
+  EXPECT_EQ(4, dirty.size());
+
+  bus.write8(0x0000, 6);
+  collect(tracker);
+  EXPECT_EQ((std::vector<std::size_t>{0}), dirty);
+  EXPECT_EQ(nullptr, bus.write_page_table()[0])
+    << "A page should be removed from the write page table once any tracker has collected it";
+  bus.write8(0x0001, 7);
+  bus.write8(0x0200, 8);
+  collect(other);
+  EXPECT_EQ((std::vector<std::size_t>{0, 2}), dirty)
+    << "Collecting for one dirty tracker should not affect the others";
+  collect(tracker);
+  EXPECT_EQ((std::vector<std::size_t>{0, 2}), dirty);
+
+  bus.remove_dirty_tracker(other);
+  EXPECT_THROW(bus.remove_dirty_tracker(other), std::invalid_argument);
+
+  StateArchive saver;
+  bus.serialize(saver);
+  std::vector<U8> image(saver.image_size());
+  saver.write(image);
+  StateArchive loader(image);
+  bus.serialize(loader);
+  collect(tracker);
+  EXPECT_EQ(4, dirty.size()) << "Loading a state should mark all RAM as dirty";
+
+  bus.remove_dirty_tracker(tracker);
+  EXPECT_FALSE(bus.dirty_tracking());
+  EXPECT_EQ(ram.data(), bus.write_page_table()[0])
+    << "Removing the last dirty tracker should restore the write page table";
+}
@@ -0,0 +1,123 @@
+#include "omulator/graphics/PixelConvert.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using omulator::U16;
+using omulator::U32;
+using omulator::U8;
+using omulator::graphics::convert_indexed8;
+using omulator::graphics::convert_planar;
+using omulator::graphics::convert_rgb555;
+using omulator::graphics::convert_rgb565;
+using omulator::graphics::Palette_t;
+using omulator::graphics::rgba;
+
+namespace {
+
+// Not a multiple of 8, so that the vectorized kernels' leftovers are covered as well
+constexpr std::size_t NUM_PIXELS = 8 * 5 + 3;
+
+Palette_t make_palette() {
+  Palette_t palette{};
+  for(U32 i = 0; i < palette.size(); ++i) {
+    palette[i] = rgba(static_cast<U8>(i), static_cast<U8>(255 - i), static_cast<U8>(i * 7));
+  }
+
+  return palette;
+}
+
+}  // namespace
+
+TEST(PixelConvert_test, rgba) {
+  EXPECT_EQ(0xFF03'0201, rgba(1, 2, 3));
+  EXPECT_EQ(0x0403'0201, rgba(1, 2, 3, 4));
+}
+
+TEST(PixelConvert_test, indexed8) {
+  const Palette_t palette = make_palette();
+
+  std::vector<U8> src(NUM_PIXELS);
+  for(std::size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<U8>(i * 37 + 5);
+  }
+
+  std::vector<U32> dst(NUM_PIXELS + 1, 0xDEAD'BEEF);
+  convert_indexed8(src, palette, dst);
+  for(std::size_t i = 0; i < src.size(); ++i) {
+    EXPECT_EQ(palette[src[i]], dst[i]) << "at pixel " << i;
+  }
+  EXPECT_EQ(0xDEAD'BEEF, dst.back()) << "Only as many pixels as src holds should be converted";
+}
+
+TEST(PixelConvert_test, rgb16) {
+  std::vector<U16> src(NUM_PIXELS);
+  for(std::size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<U16>(i * 1499 + 17);
+  }
+  src[0] = 0x7FFF;
+  src[1] = 0x0000;
+  src[2] = 0x7C00;
+
+  std::vector<U32> dst(NUM_PIXELS);
+  convert_rgb555(src, dst);
+  EXPECT_EQ(rgba(0xFF, 0xFF, 0xFF), dst[0]);
+  EXPECT_EQ(rgba(0, 0, 0), dst[1]);
+  EXPECT_EQ(rgba(0xFF, 0, 0), dst[2]);
+
+  const auto widen5 = [](const U32 x) { return static_cast<U8>((x << 3) | (x >> 2)); };
+  const auto widen6 = [](const U32 x) { return static_cast<U8>((x << 2) | (x >> 4)); };
+
+  for(std::size_t i = 0; i < src.size(); ++i) {
+    const U32 px = src[i];
+    EXPECT_EQ(rgba(widen5((px >> 10) & 0x1F), widen5((px >> 5) & 0x1F), widen5(px & 0x1F)),
+              dst[i])
+      << "at pixel " << i;
+  }
+
+  src[0] = 0xFFFF;
+  src[2] = 0x07E0;
+  convert_rgb565(src, dst);
+  EXPECT_EQ(rgba(0xFF, 0xFF, 0xFF), dst[0]);
+  EXPECT_EQ(rgba(0, 0, 0), dst[1]);
+  EXPECT_EQ(rgba(0, 0xFF, 0), dst[2]);
+
+  for(std::size_t i = 0; i < src.size(); ++i) {
+    const U32 px = src[i];
+    EXPECT_EQ(rgba(widen5((px >> 11) & 0x1F), widen6((px >> 5) & 0x3F), widen5(px & 0x1F)),
+              dst[i])
+      << "at pixel " << i;
+  }
+}
+
+TEST(PixelConvert_test, planar) {
+  const Palette_t palette = make_palette();
+
+  for(std::size_t numPlanes = 1; numPlanes <= 8; ++numPlanes) {
+    constexpr std::size_t PLANE_BYTES = 6;
+
+    std::vector<U8> src(PLANE_BYTES * numPlanes);
+    for(std::size_t i = 0; i < src.size(); ++i) {
+      src[i] = static_cast<U8>(i * 113 + numPlanes);
+    }
+
+    std::vector<U32> dst(PLANE_BYTES * 8);
+    convert_planar(src, numPlanes, palette, dst);
+
+    for(std::size_t px = 0; px < dst.size(); ++px) {
+      std::size_t index = 0;
+      for(std::size_t plane = 0; plane < numPlanes; ++plane) {
+        const U8 bits = src[plane * PLANE_BYTES + px / 8];
+        index |= static_cast<std::size_t>((bits >> (7 - px % 8)) & 1) << plane;
+      }
+
+      EXPECT_EQ(palette[index], dst[px]) << numPlanes << " planes, pixel " << px;
+    }
+
+    // A destination which ends partway through a byte
+    std::vector<U32> partial(13);
+    convert_planar(src, numPlanes, palette, partial);
+    EXPECT_TRUE(std::equal(partial.begin(), partial.end(), dst.begin()));
+  }
+}
@@ -0,0 +1,85 @@
+#include "omulator/util/Profiler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace profiler = omulator::util::profiler;
+
+namespace {
+
+std::string export_trace() {
+  std::stringstream ss;
+  profiler::export_chrome_trace(ss);
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(Profiler_test, disabledByDefault) {
+  profiler::clear();
+  EXPECT_FALSE(profiler::enabled()) << "The profiler should not record spans unless enabled";
+
+  {
+    OML_PROFILE_SPAN("disabledSpan");
+  }
+
+  EXPECT_EQ(std::string::npos, export_trace().find("disabledSpan"))
+    << "Spans should not be recorded while the profiler is disabled";
+}
+
+TEST(Profiler_test, recordAndExport) {
+  profiler::clear();
+  profiler::enable();
+
+  {
+    OML_PROFILE_SPAN("outerSpan");
+    OML_PROFILE_SPAN("innerSpan", 42);
+  }
+
+  std::jthread thrd([] {
+    profiler::set_thread_name("workerThread");
+    OML_PROFILE_SPAN("workerSpan");
+  });
+  thrd.join();
+
+  profiler::disable();
+
+  const std::string trace = export_trace();
+  EXPECT_EQ(0, trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["))
+    << "Profiler exports should be in the Chrome trace event format";
+  EXPECT_NE(std::string::npos, trace.find("{\"name\":\"outerSpan\",\"cat\":\"oml\",\"ph\":\"X\""))
+    << "Spans should be exported as complete events";
+  EXPECT_NE(std::string::npos, trace.find("\"args\":{\"arg\":42}"))
+    << "Span arguments should be exported";
+  EXPECT_NE(std::string::npos, trace.find("workerSpan"))
+    << "Spans recorded on other threads should be exported, even after the thread has exited";
+  EXPECT_NE(std::string::npos, trace.find("\"args\":{\"name\":\"workerThread\"}"))
+    << "Thread names should be exported as metadata events";
+
+  profiler::clear();
+  EXPECT_EQ(std::string::npos, export_trace().find("outerSpan"))
+    << "Profiler::clear should discard all recorded spans";
+}
+
+TEST(Profiler_test, ringBufferWraps) {
+  profiler::clear();
+  profiler::enable();
+
+  for(std::size_t i = 0; i < profiler::RING_CAPACITY + 10; ++i) {
+    OML_PROFILE_SPAN("wrapSpan", i);
+  }
+
+  profiler::disable();
+
+  const std::string trace = export_trace();
+  EXPECT_EQ(std::string::npos, trace.find("\"args\":{\"arg\":9}"))
+    << "The oldest spans should be overwritten once a thread's ring buffer is full";
+  EXPECT_NE(std::string::npos,
+            trace.find("\"args\":{\"arg\":" + std::to_string(profiler::RING_CAPACITY + 9) + "}"))
+    << "The newest spans should be retained once a thread's ring buffer is full";
+
+  profiler::clear();
+}
@@ -38,6 +38,14 @@ TEST(PropertyMap_test, usageTest) {
   EXPECT_EQ("test", pvs.get())
     << "PropertyValues should be able to get and set their internal value";
 
+  PropertyValue<U64> &pvd = propertyMap.get_prop_or_default("defaultKey", U64{789});
+  EXPECT_EQ(789, pvd.get())
+    << "PropertyMap::get_prop_or_default should initialize new properties to the given default";
+  pvd.set(1);
+  EXPECT_EQ(&pvd, &propertyMap.get_prop_or_default("defaultKey", U64{789}));
+  EXPECT_EQ(1, pvd.get())
+    << "PropertyMap::get_prop_or_default should not reset existing properties";
+
   EXPECT_THROW(propertyMap.get_prop<bool>("stringkey"), std::runtime_error)
     << "PropertyMap::get_prop should throw when attempting to interpret a property as a different "
        "type than the type used to intialize it";
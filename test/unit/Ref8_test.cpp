@@ -0,0 +1,593 @@
+#include "omulator/cpu/Ref8.hpp"
+
+#include "omulator/StateArchive.hpp"
+
+#include "mocks/LoggerMock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using ::testing::_;
+using ::testing::HasSubstr;
+
+using omulator::Cycle_t;
+using omulator::MemoryBus;
+using omulator::StateArchive;
+using omulator::U32;
+using omulator::U8;
+using omulator::cpu::Ref8;
+
+namespace {
+
+struct Ref8Fixture {
+  explicit Ref8Fixture(std::span<const U8> program,
+                       const Ref8::ExecMode mode = Ref8::ExecMode::BLOCK_CACHE)
+    : bus(logger, 16, 12), ram(bus.add_ram(0x0000, 0x10000)), cpu(logger, bus) {
+    std::copy(program.begin(), program.end(), ram.begin());
+    cpu.set_exec_mode(mode);
+  }
+
+  explicit Ref8Fixture(std::initializer_list<U8> program,
+                       const Ref8::ExecMode      mode = Ref8::ExecMode::BLOCK_CACHE)
+    : Ref8Fixture(std::span<const U8>(program.begin(), program.size()), mode) { }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus;
+  std::span<U8>                        ram;
+  Ref8                                 cpu;
+};
+
+/**
+ * Run the same program in each execution mode, stepping each CPU by each of the given budgets in
+ * turn, and check that they stay in lockstep.
+ */
+void expect_modes_match(std::span<const U8> program, const std::vector<Cycle_t> &budgets) {
+  Ref8Fixture interp(program, Ref8::ExecMode::INTERPRETER);
+  Ref8Fixture cached(program, Ref8::ExecMode::BLOCK_CACHE);
+  Ref8Fixture jit(program, Ref8::ExecMode::JIT);
+
+  for(const Cycle_t budget : budgets) {
+    const Cycle_t expected = interp.cpu.step(budget);
+    for(Ref8Fixture *f : {&cached, &jit}) {
+      ASSERT_EQ(expected, f->cpu.step(budget))
+        << "Ref8 should take the same number of cycles regardless of its execution mode";
+
+      const auto &a = interp.cpu.registers();
+      const auto &b = f->cpu.registers();
+      ASSERT_EQ(a.r, b.r);
+      ASSERT_EQ(a.pc, b.pc);
+      ASSERT_EQ(a.sp, b.sp);
+      ASSERT_EQ(a.zero, b.zero);
+      ASSERT_EQ(a.carry, b.carry);
+      ASSERT_EQ(interp.cpu.halted(), f->cpu.halted());
+      ASSERT_EQ(interp.cpu.instructions_retired(), f->cpu.instructions_retired());
+    }
+  }
+
+  EXPECT_TRUE(std::equal(interp.ram.begin(), interp.ram.end(), cached.ram.begin()));
+  EXPECT_TRUE(std::equal(interp.ram.begin(), interp.ram.end(), jit.ram.begin()));
+}
+
+}  // namespace
+
+TEST(Ref8_test, loop) {
+  // Sum 10..1 into r0
+  Ref8Fixture f({
+    0x0A, 10,          // 0x00: LDI r1, 10
+    0x02, 0,           // 0x02: LDI r0, 0
+    0x81,              // 0x04: ADD r1
+    0x0C,              // 0x05: DEC r1
+    0xE0, 0x04, 0x00,  // 0x06: JP NZ, 0x0004
+    0x01,              // 0x09: HLT
+  });
+
+  const Cycle_t cycles = f.cpu.step(1000);
+  EXPECT_TRUE(f.cpu.halted());
+  EXPECT_EQ(1000, cycles) << "A halted Ref8 should consume the remainder of its budget";
+  EXPECT_EQ(55, f.cpu.registers().r[0]);
+  EXPECT_EQ(0, f.cpu.registers().r[1]);
+  EXPECT_EQ(0x0A, f.cpu.registers().pc);
+  EXPECT_EQ(2 + 10 * 3 + 1, f.cpu.instructions_retired());
+
+  f.cpu.reset();
+  EXPECT_FALSE(f.cpu.halted());
+  EXPECT_EQ(4, f.cpu.step(3))
+    << "Ref8::step should run whole instructions, overshooting the budget if necessary";
+  EXPECT_EQ(0x04, f.cpu.registers().pc);
+  EXPECT_EQ(10 * (1 + 1 + 3), f.cpu.step(10 * (1 + 1 + 3)))
+    << "Ref8 instructions should take the documented number of cycles";
+  EXPECT_EQ(0x09, f.cpu.registers().pc);
+  EXPECT_FALSE(f.cpu.halted());
+}
+
+TEST(Ref8_test, memoryAndCalls) {
+  Ref8Fixture f({
+    0x32, 0x80,        // 0x00: LDI r6, 0x80
+    0x3A, 0x10,        // 0x02: LDI r7, 0x10
+    0x12, 0x42,        // 0x04: LDI r2, 0x42
+    0x16,              // 0x06: ST r2
+    0xC1, 0x20, 0x00,  // 0x07: CALL 0x0020
+    0x01,              // 0x0A: HLT
+  });
+  f.ram[0x20] = 0x1D;  // LD r3
+  f.ram[0x21] = 0x1B;  // INC r3
+  f.ram[0x22] = 0x5B;  // MOV r3, r3
+  f.ram[0x23] = 0x63;  // MOV r4, r3
+  f.ram[0x24] = 0xC2;  // RET
+
+  f.cpu.step(100);
+  EXPECT_TRUE(f.cpu.halted());
+  EXPECT_EQ(0x42, f.ram[0x8010]);
+  EXPECT_EQ(0x43, f.cpu.registers().r[3]);
+  EXPECT_EQ(0x43, f.cpu.registers().r[4]);
+  EXPECT_EQ(0, f.cpu.registers().sp) << "Ref8 CALL and RET should leave the stack balanced";
+  EXPECT_EQ(0x0A, f.ram[0xFFFE]) << "Ref8 CALL should push the return address";
+  EXPECT_EQ(0x0B, f.cpu.registers().pc);
+}
+
+TEST(Ref8_test, alu) {
+  Ref8Fixture f({
+    0x81,  // ADD r1
+    0x89,  // ADC r1
+    0xB9,  // CMP r1
+    0x99,  // SBC r1
+    0xB0,  // XOR r0
+  });
+  auto &regs = f.cpu.registers();
+
+  regs.r[0] = 0xF0;
+  regs.r[1] = 0x20;
+  EXPECT_EQ(1, f.cpu.step(1));
+  EXPECT_EQ(0x10, regs.r[0]);
+  EXPECT_TRUE(regs.carry);
+  EXPECT_FALSE(regs.zero);
+
+  f.cpu.step(1);
+  EXPECT_EQ(0x31, regs.r[0]) << "Ref8 ADC should add in the carry flag";
+  EXPECT_FALSE(regs.carry);
+
+  regs.r[1] = 0x31;
+  f.cpu.step(1);
+  EXPECT_EQ(0x31, regs.r[0]) << "Ref8 CMP should not modify r0";
+  EXPECT_TRUE(regs.zero);
+  EXPECT_FALSE(regs.carry);
+
+  regs.r[1]  = 0x40;
+  regs.carry = true;
+  f.cpu.step(1);
+  EXPECT_EQ(0xF0, regs.r[0]) << "Ref8 SBC should subtract the carry flag";
+  EXPECT_TRUE(regs.carry) << "Ref8 SBC should set the carry flag on a borrow";
+
+  f.cpu.step(1);
+  EXPECT_EQ(0, regs.r[0]);
+  EXPECT_TRUE(regs.zero);
+  EXPECT_FALSE(regs.carry) << "Ref8 logical operations should clear the carry flag";
+}
+
+TEST(Ref8_test, illegalOpcode) {
+  Ref8Fixture f({
+    0x00,  // NOP
+    0x07,  // illegal
+    0x00,  // NOP
+  });
+
+  EXPECT_CALL(f.logger, error(HasSubstr("illegal opcode"), _)).Times(1);
+  EXPECT_EQ(50, f.cpu.step(50));
+  EXPECT_TRUE(f.cpu.halted()) << "Ref8 should halt on illegal opcodes";
+  EXPECT_EQ(2, f.cpu.registers().pc);
+  EXPECT_EQ(2, f.cpu.instructions_retired());
+}
+
+TEST(Ref8_test, execModesMatch) {
+  // Copies a counter into successive bytes of memory via a subroutine, checking the carry flag
+  std::vector<U8> program{
+    0x32, 0x80,        // 0x00: LDI r6, 0x80
+    0x3A, 0x00,        // 0x02: LDI r7, 0x00
+    0x0A, 0x03,        // 0x04: LDI r1, 0x03
+    0xC1, 0x20, 0x00,  // 0x06: CALL 0x0020
+    0xF0, 0x00, 0x00,  // 0x09: JP C, 0x0000
+    0xC0, 0x06, 0x00,  // 0x0C: JP 0x0006
+  };
+  program.resize(0x20);
+  program.insert(program.end(),
+                 {
+                   0x81,  // 0x20: ADD r1
+                   0x16,  // 0x21: ST r2
+                   0x3B,  // 0x22: INC r7
+                   0x50,  // 0x23: MOV r2, r0
+                   0xC2,  // 0x24: RET
+                 });
+
+  // Uneven budgets, so that the block cache has to stop partway through blocks, along with some
+  // which are large enough for entire blocks to run without checking the budget
+  std::vector<Cycle_t> budgets;
+  for(Cycle_t budget = 1; budget < 200; budget += 7) {
+    budgets.push_back(budget);
+  }
+  budgets.insert(budgets.end(), {1000, 333, 5000, 1});
+
+  expect_modes_match(program, budgets);
+}
+
+TEST(Ref8_test, execModesMatchSelfModifyingCode) {
+  // Stores zeroes to descending addresses, until the loop eventually overwrites itself
+  const std::vector<U8> program{
+    0x32, 0x00,        // 0x00: LDI r6, 0x00
+    0x3A, 0x30,        // 0x02: LDI r7, 0x30
+    0x0A, 0x30,        // 0x04: LDI r1, 0x30
+    0x16,              // 0x06: ST r2
+    0x3C,              // 0x07: DEC r7
+    0x0C,              // 0x08: DEC r1
+    0xE0, 0x06, 0x00,  // 0x09: JP NZ, 0x0006
+    0x01,              // 0x0C: HLT
+  };
+
+  std::vector<Cycle_t> budgets(100, 10);
+  budgets.insert(budgets.end(), {1000, 17, 5000, 100'000});
+
+  expect_modes_match(program, budgets);
+}
+
+TEST(Ref8_test, execModesMatchRandomPrograms) {
+  // Random instruction sequences, with branches, calls and memory accesses which stay mostly within
+  // the first page so that the code frequently jumps between blocks and writes over itself
+  std::mt19937 rng(0x5EED);
+  const auto   pick = [&](const U32 bound) { return static_cast<U8>(rng() % bound); };
+
+  for(int i = 0; i < 20; ++i) {
+    std::vector<U8> program{
+      0x32, 0x00,  // LDI r6, 0x00
+      0x3A, 0x80,  // LDI r7, 0x80
+    };
+
+    while(program.size() < 0xF0) {
+      const U8 choice = pick(100);
+      if(choice < 30) {
+        program.push_back(static_cast<U8>(0x80 | pick(0x40)));  // ALU
+      }
+      else if(choice < 45) {
+        // MOV, except into r6, so that loads and stores stay within the first page
+        const U8 opcode = static_cast<U8>(0x40 | pick(0x40));
+        program.push_back((opcode & 0x38) == 0x30 ? 0x00 : opcode);
+      }
+      else if(choice < 55) {
+        program.insert(program.end(), {static_cast<U8>((pick(8) << 3) | 0x02), pick(0xFF)});  // LDI
+      }
+      else if(choice < 65) {
+        program.push_back(static_cast<U8>((pick(8) << 3) | (3 + pick(2))));  // INC/DEC
+      }
+      else if(choice < 75) {
+        program.push_back(static_cast<U8>((pick(8) << 3) | (5 + pick(2))));  // LD/ST
+      }
+      else if(choice < 87) {
+        program.insert(program.end(),
+                       {static_cast<U8>(0xC0 | (pick(4) << 4)), pick(0xF0), 0x00});  // JP
+      }
+      else if(choice < 90) {
+        program.insert(program.end(), {0xC1, pick(0xF0), 0x00});  // CALL
+      }
+      else if(choice < 92) {
+        program.push_back(0xC2);  // RET
+      }
+      else {
+        program.push_back(0x00);  // NOP
+      }
+    }
+
+    std::vector<Cycle_t> budgets;
+    for(Cycle_t budget = 1; budget < 2000; budget += pick(100)) {
+      budgets.push_back(budget);
+    }
+
+    SCOPED_TRACE(i);
+    expect_modes_match(program, budgets);
+  }
+}
+
+TEST(Ref8_test, jitExternalWrites) {
+  // An endless loop which the JIT will link to itself, and which is then modified from outside
+  Ref8Fixture f(
+    {
+      0x0B,              // 0x00: INC r1
+      0xC0, 0x00, 0x00,  // 0x01: JP 0x0000
+    },
+    Ref8::ExecMode::JIT);
+
+  f.cpu.step(4 * 100);
+  EXPECT_EQ(100, f.cpu.registers().r[1]);
+  EXPECT_EQ(0, f.cpu.registers().pc);
+  EXPECT_EQ(200, f.cpu.instructions_retired());
+
+  f.bus.write8(0x00, 0x13);  // INC r2
+  f.cpu.step(4 * 100);
+  EXPECT_EQ(100, f.cpu.registers().r[1])
+    << "Writes to memory which has been recompiled by Ref8 should invalidate the host code";
+  EXPECT_EQ(100, f.cpu.registers().r[2]);
+
+  f.cpu.set_exec_mode(Ref8::ExecMode::INTERPRETER);
+  f.cpu.step(4);
+  EXPECT_EQ(101, f.cpu.registers().r[2]);
+}
+
+TEST(Ref8_test, handlerExceptions) {
+  // Copies an MMIO register to itself forever, counting the iterations in r2
+  const std::vector<U8> program{
+    0x32, 0xF0,        // 0x00: LDI r6, 0xF0
+    0x3A, 0x00,        // 0x02: LDI r7, 0x00
+    0x05,              // 0x04: LD r0
+    0x13,              // 0x05: INC r2
+    0x06,              // 0x06: ST r0
+    0xC0, 0x04, 0x00,  // 0x07: JP 0x0004
+  };
+
+  for(const auto mode :
+      {Ref8::ExecMode::INTERPRETER, Ref8::ExecMode::BLOCK_CACHE, Ref8::ExecMode::JIT}) {
+    Ref8Fixture f(program, mode);
+    U32         reads      = 0;
+    bool        throwRead  = false;
+    bool        throwWrite = false;
+    f.bus.map_mmio(
+      0xF000,
+      0x1000,
+      [&]([[maybe_unused]] const U32 addr) {
+        if(throwRead) {
+          throw std::runtime_error("read");
+        }
+        ++reads;
+        return U8{0};
+      },
+      [&]([[maybe_unused]] const U32 addr, [[maybe_unused]] const U8 val) {
+        if(throwWrite) {
+          throw std::runtime_error("write");
+        }
+      });
+
+    // Long enough for the loop to be recompiled in JIT mode
+    f.cpu.step(10'000);
+    EXPECT_LT(100, reads);
+
+    // The JIT's generated code has no unwind information, so this would terminate if the
+    // exception were allowed to pass through it
+    throwRead = true;
+    EXPECT_THROW(f.cpu.step(1000), std::runtime_error)
+      << "Exceptions thrown by MMIO handlers should propagate out of Ref8::step";
+    throwRead  = false;
+    throwWrite = true;
+    EXPECT_THROW(f.cpu.step(1000), std::runtime_error);
+
+    throwWrite            = false;
+    const U32 readsBefore = reads;
+    const U8  r2Before    = f.cpu.registers().r[2];
+    f.cpu.step(1000);
+    EXPECT_LT(readsBefore, reads) << "Ref8 should keep running after a handler has thrown";
+    EXPECT_NE(r2Before, f.cpu.registers().r[2]);
+  }
+}
+
+TEST(Ref8_test, serialize) {
+  // Counts r1 up forever, storing r1 to 0x1080 on each iteration
+  const std::vector<U8> program{
+    0x32, 0x10,        // 0x00: LDI r6, 0x10
+    0x3A, 0x80,        // 0x02: LDI r7, 0x80
+    0x0B,              // 0x04: INC r1
+    0x0E,              // 0x05: ST r1
+    0xC0, 0x04, 0x00,  // 0x06: JP 0x0004
+  };
+
+  for(const auto mode :
+      {Ref8::ExecMode::INTERPRETER, Ref8::ExecMode::BLOCK_CACHE, Ref8::ExecMode::JIT})
+  {
+    Ref8Fixture f(program, mode);
+    f.cpu.step(1000);
+
+    StateArchive saver;
+    f.bus.serialize(saver);
+    f.cpu.serialize(saver);
+    std::vector<U8> image(saver.image_size());
+    saver.write(image);
+
+    const auto savedRegs    = f.cpu.registers();
+    const auto savedRetired = f.cpu.instructions_retired();
+    const auto savedCycles  = f.cpu.cycles();
+    f.cpu.step(1000);
+    const auto expectedRegs = f.cpu.registers();
+    const U8   expectedMem  = f.ram[0x1080];
+
+    StateArchive loader(image);
+    f.bus.serialize(loader);
+    f.cpu.serialize(loader);
+    loader.finish();
+    EXPECT_EQ(savedRegs.r, f.cpu.registers().r) << "Ref8::serialize should restore the registers";
+    EXPECT_EQ(savedRegs.pc, f.cpu.registers().pc);
+    EXPECT_EQ(savedRetired, f.cpu.instructions_retired());
+    EXPECT_EQ(savedCycles, f.cpu.cycles());
+    EXPECT_EQ(savedRegs.r[1], f.ram[0x1080]);
+
+    f.cpu.step(1000);
+    EXPECT_EQ(expectedRegs.r, f.cpu.registers().r)
+      << "Ref8 should behave identically after a state is restored";
+    EXPECT_EQ(expectedRegs.pc, f.cpu.registers().pc);
+    EXPECT_EQ(expectedMem, f.ram[0x1080]);
+  }
+}
+
+TEST(Ref8_test, selfModifyingCode) {
+  Ref8Fixture f({
+    0x32, 0x00,  // 0x00: LDI r6, 0x00
+    0x3A, 0x09,  // 0x02: LDI r7, 0x09
+    0x12, 0x1B,  // 0x04: LDI r2, 0x1B
+    0x16,        // 0x06: ST r2
+    0x00,        // 0x07: NOP
+    0x00,        // 0x08: NOP
+    0x00,        // 0x09: NOP, overwritten with INC r3
+    0x01,        // 0x0A: HLT
+  });
+
+  f.cpu.step(1000);
+  EXPECT_TRUE(f.cpu.halted());
+  EXPECT_EQ(1, f.cpu.registers().r[3])
+    << "Ref8 should execute instructions written by the block which is currently executing";
+
+  // Overwrite the NOP at 0x07 with INC r4 from outside of the CPU
+  f.bus.write8(0x07, 0x23);
+  f.cpu.reset();
+  f.cpu.step(100);
+  EXPECT_EQ(1, f.cpu.registers().r[4])
+    << "Writes to memory which has been cached by Ref8 should invalidate the cached block";
+
+  // Remapping the code should also invalidate it
+  std::vector<U8> rom(0x1000);
+  rom[0] = 0x2B;  // INC r5
+  rom[1] = 0x01;  // HLT
+  f.bus.map_rom(0x0000, rom);
+  f.cpu.reset();
+  f.cpu.step(100);
+  EXPECT_EQ(1, f.cpu.registers().r[5]) << "Remapping memory cached by Ref8 should invalidate it";
+}
+
+TEST(Ref8_test, smallAddressSpace) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus(logger, 12, 8);
+  EXPECT_THROW(Ref8(logger, bus), std::invalid_argument);
+}
+
+TEST(Ref8_test, idleLoop) {
+  // Poll an MMIO register at 0xF000 until bit 0 is set
+  const std::vector<U8> program{
+    0x32, 0xF0,        // 0x00: LDI r6, 0xF0
+    0x3A, 0x00,        // 0x02: LDI r7, 0x00
+    0x05,              // 0x04: LD r0
+    0x0A, 0x01,        // 0x05: LDI r1, 1
+    0xA1,              // 0x07: AND r1
+    0xD0, 0x04, 0x00,  // 0x08: JP Z, 0x0004
+    0x01,              // 0x0B: HLT
+  };
+
+  for(const auto mode : {Ref8::ExecMode::BLOCK_CACHE, Ref8::ExecMode::JIT}) {
+    Ref8Fixture f(program, mode);
+    U8          status = 0;
+    U32         reads  = 0;
+    f.bus.map_mmio(
+      0xF000,
+      0x1000,
+      [&]([[maybe_unused]] const U32 addr) {
+        ++reads;
+        return status;
+      },
+      []([[maybe_unused]] const U32 addr, [[maybe_unused]] const U8 val) {});
+
+    f.cpu.step(1000);
+    EXPECT_EQ(0, f.cpu.idle_cycles_skipped()) << "Idle loop skipping should be disabled by default";
+    EXPECT_LT(100, reads);
+
+    f.cpu.set_idle_skip(true);
+    reads = 0;
+    EXPECT_EQ(100'000, f.cpu.step(100'000))
+      << "Ref8 should consume exactly its budget when it skips an idle loop";
+    EXPECT_EQ(0x04, f.cpu.registers().pc);
+    EXPECT_GT(3, reads) << "Ref8 should stop running an idle loop once it reaches a fixed point";
+    EXPECT_LT(99'000, f.cpu.idle_cycles_skipped());
+
+    status = 1;
+    f.cpu.step(100);
+    EXPECT_TRUE(f.cpu.halted()) << "Ref8 should leave an idle loop once the state it polls changes";
+  }
+
+  // A loop which polls RAM is never skipped, since another Component may write to it partway through
+  // a slice; here the CPU is stepped in pieces, and the RAM is written between two of them
+  for(const auto mode : {Ref8::ExecMode::BLOCK_CACHE, Ref8::ExecMode::JIT}) {
+    Ref8Fixture f(
+      {
+        0x32, 0x10,        // 0x00: LDI r6, 0x10
+        0x3A, 0x00,        // 0x02: LDI r7, 0x00
+        0x05,              // 0x04: LD r0
+        0x0A, 0x01,        // 0x05: LDI r1, 1
+        0xA1,              // 0x07: AND r1
+        0xD0, 0x04, 0x00,  // 0x08: JP Z, 0x0004
+        0x01,              // 0x0B: HLT
+      },
+      mode);
+    f.cpu.set_idle_skip(true);
+
+    for(int slice = 0; slice < 20; ++slice) {
+      f.cpu.step(50);
+      if(slice == 15) {
+        f.bus.write8(0x1000, 1);
+      }
+    }
+
+    EXPECT_EQ(0, f.cpu.idle_cycles_skipped())
+      << "Ref8 should not skip idle loops which poll RAM, as other Components can write to it";
+    EXPECT_TRUE(f.cpu.halted()) << "Ref8 should leave a loop polling RAM once the RAM is written";
+  }
+
+  // A loop which reads a free-running counter never reaches a fixed point
+  Ref8Fixture f({
+    0x32, 0xF0,        // 0x00: LDI r6, 0xF0
+    0x3A, 0x00,        // 0x02: LDI r7, 0x00
+    0x05,              // 0x04: LD r0
+    0xC0, 0x04, 0x00,  // 0x05: JP 0x0004
+  });
+  U8 counter = 0;
+  f.bus.map_mmio(
+    0xF000,
+    0x1000,
+    [&]([[maybe_unused]] const U32 addr) { return ++counter; },
+    []([[maybe_unused]] const U32 addr, [[maybe_unused]] const U8 val) {});
+  f.cpu.set_idle_skip(true);
+  f.cpu.step(1000);
+  EXPECT_EQ(0, f.cpu.idle_cycles_skipped());
+
+  // Nor does a delay loop, which changes a register on each iteration
+  Ref8Fixture delay({
+    0x0C,              // 0x00: DEC r1
+    0xE0, 0x00, 0x00,  // 0x01: JP NZ, 0x0000
+    0x01,              // 0x04: HLT
+  });
+  delay.cpu.set_idle_skip(true);
+  delay.cpu.step(256 * 4 + 10);
+  EXPECT_EQ(0, delay.cpu.idle_cycles_skipped());
+  EXPECT_TRUE(delay.cpu.halted());
+
+  // The interpreter never skips idle loops
+  Ref8Fixture interp({0xC0, 0x00, 0x00}, Ref8::ExecMode::INTERPRETER);
+  interp.cpu.set_idle_skip(true);
+  interp.cpu.step(1000);
+  EXPECT_EQ(0, interp.cpu.idle_cycles_skipped());
+}
+
+TEST(Ref8_test, idleLoopOverrides) {
+  // Spin while storing r0 to 0x1000, which is idempotent but is not detected as an idle loop
+  const std::vector<U8> program{
+    0x32, 0x10,        // 0x00: LDI r6, 0x10
+    0x06,              // 0x02: ST r0
+    0xC0, 0x02, 0x00,  // 0x03: JP 0x0002
+  };
+
+  Ref8Fixture f(program);
+  f.cpu.set_idle_skip(true);
+  f.cpu.step(1000);
+  EXPECT_EQ(0, f.cpu.idle_cycles_skipped()) << "Loops which store to memory should not be skipped";
+
+  f.cpu.set_idle_loop_override(0x02, true);
+  f.cpu.step(1000);
+  EXPECT_LT(900, f.cpu.idle_cycles_skipped())
+    << "Ref8 should skip loops which are listed as idle loops";
+
+  // Conversely, a loop which would be detected can be excluded
+  Ref8Fixture spin({0xC0, 0x00, 0x00});
+  spin.cpu.set_idle_skip(true);
+  spin.cpu.set_idle_loop_override(0x00, false);
+  spin.cpu.step(1000);
+  EXPECT_EQ(0, spin.cpu.idle_cycles_skipped());
+
+  spin.cpu.clear_idle_loop_overrides();
+  spin.cpu.step(1000);
+  EXPECT_LT(900, spin.cpu.idle_cycles_skipped());
+}
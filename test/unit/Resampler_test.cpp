@@ -0,0 +1,119 @@
+#include "omulator/util/Resampler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+using omulator::util::Resampler;
+
+namespace {
+
+/**
+ * numFrames of a sine wave at the given frequency, with the right channel at half the amplitude of
+ * the left and inverted.
+ */
+std::vector<float> make_sine(const double freq, const double rate, const std::size_t numFrames) {
+  std::vector<float> frames(numFrames * 2);
+  for(std::size_t i = 0; i < numFrames; ++i) {
+    const double val  = std::sin(2.0 * std::numbers::pi * freq * static_cast<double>(i) / rate);
+    frames[2 * i]     = static_cast<float>(val);
+    frames[2 * i + 1] = static_cast<float>(-0.5 * val);
+  }
+
+  return frames;
+}
+
+/**
+ * Resample everything which has been pushed.
+ */
+std::vector<float> drain(Resampler &resampler) {
+  std::vector<float> out(resampler.available() * 2, 0.0F);
+  EXPECT_EQ(out.size() / 2, resampler.mix_into(out, 1.0F));
+  EXPECT_EQ(0, resampler.available());
+  return out;
+}
+
+}  // namespace
+
+TEST(Resampler_test, sine) {
+  constexpr double IN_RATE  = 32000.0;
+  constexpr double OUT_RATE = 48000.0;
+  constexpr double FREQ     = 1000.0;
+
+  Resampler resampler(IN_RATE, OUT_RATE);
+  resampler.push(make_sine(FREQ, IN_RATE, 3200));
+  const auto out = drain(resampler);
+  EXPECT_NEAR(4800, out.size() / 2, Resampler::TAPS * 2);
+
+  // Output frame j is taken from TAPS / 2 - 1 + j * (IN_RATE / OUT_RATE) in the input
+  double maxError = 0.0;
+  for(std::size_t j = 0; j < out.size() / 2; ++j) {
+    const double pos      = Resampler::TAPS / 2 - 1 + static_cast<double>(j) * IN_RATE / OUT_RATE;
+    const double expected = std::sin(2.0 * std::numbers::pi * FREQ * pos / IN_RATE);
+    const auto   left     = static_cast<double>(out[2 * j]);
+    const auto   right    = static_cast<double>(out[2 * j + 1]);
+    maxError = std::max({maxError, std::abs(left - expected), std::abs(right + 0.5 * expected)});
+  }
+  EXPECT_LT(maxError, 0.01) << "Tones well below the cutoff should pass through unchanged";
+
+  // Input can be pushed a piece at a time, with the same result
+  Resampler          pieces(IN_RATE, OUT_RATE);
+  const auto         sine = make_sine(FREQ, IN_RATE, 3200);
+  std::vector<float> joined;
+  for(std::size_t i = 0; i < sine.size(); i += 2 * 100) {
+    pieces.push(std::span<const float>(sine).subspan(i, 2 * 100));
+    const auto piece = drain(pieces);
+    joined.insert(joined.end(), piece.begin(), piece.end());
+  }
+  EXPECT_EQ(out, joined);
+}
+
+TEST(Resampler_test, bandLimited) {
+  constexpr double IN_RATE  = 48000.0;
+  constexpr double OUT_RATE = 32000.0;
+
+  // Above the output's Nyquist frequency, so it can only alias
+  Resampler resampler(IN_RATE, OUT_RATE);
+  resampler.push(make_sine(21000.0, IN_RATE, 4800));
+  const auto out = drain(resampler);
+
+  float peak = 0.0F;
+  for(const float sample : out) {
+    peak = std::max(peak, std::abs(sample));
+  }
+  EXPECT_LT(peak, 0.1F) << "Tones above the output's Nyquist frequency should be filtered out";
+}
+
+TEST(Resampler_test, adjust) {
+  Resampler nominal(44100.0, 48000.0);
+  Resampler faster(44100.0, 48000.0);
+  faster.set_adjust(1.005);
+  EXPECT_EQ(1.005, faster.adjust());
+
+  const std::vector<float> dc(2 * 44100, 0.25F);
+  nominal.push(dc);
+  faster.push(dc);
+
+  const auto nominalOut = drain(nominal);
+  const auto fasterOut  = drain(faster);
+  EXPECT_NEAR(48000 * 1.005, fasterOut.size() / 2, Resampler::TAPS * 2)
+    << "Adjusting the ratio should change the number of output frames proportionally";
+  EXPECT_NEAR(48000, nominalOut.size() / 2, Resampler::TAPS * 2);
+
+  for(const float sample : fasterOut) {
+    ASSERT_NEAR(0.25F, sample, 1e-5F) << "A constant input should come out unchanged";
+  }
+
+  faster.push(dc);
+  EXPECT_NEAR(44100, faster.reset(), Resampler::TAPS)
+    << "Resetting should report the input frames discarded, rather than the output frames";
+  EXPECT_EQ(0, faster.available());
+  EXPECT_EQ(0, faster.reset());
+
+  EXPECT_THROW(nominal.push(std::vector<float>(3)), std::invalid_argument);
+  EXPECT_THROW(Resampler(0.0, 48000.0), std::invalid_argument);
+}
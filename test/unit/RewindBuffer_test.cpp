@@ -0,0 +1,226 @@
+#include "omulator/RewindBuffer.hpp"
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/props.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+#include "test/TestSystem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using omulator::Cycle_t;
+using omulator::MemoryBus;
+using omulator::PropertyMap;
+using omulator::RewindBuffer;
+using omulator::System;
+using omulator::U64;
+using omulator::U8;
+using omulator::msg::MailboxRouter;
+using omulator::msg::MessageQueueFactory;
+using omulator::test::Scribbler;
+using omulator::test::TestSystem;
+using omulator::test::Ticker;
+
+namespace {
+
+constexpr std::size_t RAM_SIZE = 0x10000;
+
+struct RewindFixture {
+  RewindFixture()
+    : propertyMap(logger),
+      mqfactory(logger, 0),
+      mbrouter(logger, mqfactory),
+      ts(logger, RAM_SIZE) { }
+
+  System &system() { return ts.system; }
+
+  /**
+   * The contents of RAM, for comparing states.
+   */
+  std::vector<U8> ram() {
+    const auto &bus = ts.bus();
+
+    std::vector<U8> contents(RAM_SIZE);
+    for(std::size_t i = 0; i < contents.size(); ++i) {
+      contents[i] = bus.read8(static_cast<MemoryBus::Addr_t>(i));
+    }
+    return contents;
+  }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  PropertyMap                          propertyMap;
+  MessageQueueFactory                  mqfactory;
+  MailboxRouter                        mbrouter;
+  TestSystem<Scribbler, Ticker>        ts;
+};
+
+}  // namespace
+
+TEST(RewindBuffer_test, rewind) {
+  RewindFixture f;
+  RewindBuffer  rewinder(f.logger, f.mbrouter, f.propertyMap);
+  rewinder.start();
+
+  EXPECT_EQ(RewindBuffer::DEFAULT_DEPTH,
+            f.propertyMap.get_prop<U64>(omulator::props::REWIND_DEPTH).get())
+    << "RewindBuffer should set its properties to their defaults if they are not already set";
+  EXPECT_FALSE(rewinder.rewind(f.system()));
+
+  // N.B. that depth() encodes any pending snapshots, so that none of the captures are dropped
+  std::vector<std::vector<U8>> expectedRam;
+  for(std::size_t i = 0; i < 20; ++i) {
+    f.system().step(100);
+    expectedRam.push_back(f.ram());
+    ASSERT_TRUE(rewinder.capture(f.system()));
+    EXPECT_EQ(i + 1, rewinder.depth());
+  }
+
+  EXPECT_LT(rewinder.memory_usage(), 2 * RAM_SIZE)
+    << "RewindBuffer should store older snapshots as deltas";
+
+  f.system().step(1000);
+  for(int i = 19; i >= 0; --i) {
+    ASSERT_TRUE(rewinder.rewind(f.system()));
+    EXPECT_EQ(static_cast<Cycle_t>((i + 1) * 100), f.system().current_cycle());
+    EXPECT_EQ(expectedRam[static_cast<std::size_t>(i)], f.ram())
+      << "Each call to RewindBuffer::rewind should step back one snapshot";
+  }
+
+  EXPECT_FALSE(rewinder.rewind(f.system()));
+  EXPECT_EQ(0, rewinder.depth());
+  EXPECT_EQ(0, rewinder.memory_usage());
+
+  // Capturing after a rewind continues from the restored state
+  f.system().step(50);
+  rewinder.capture(f.system());
+  f.system().step(50);
+  ASSERT_TRUE(rewinder.rewind(f.system()));
+  EXPECT_EQ(150, f.system().current_cycle());
+}
+
+TEST(RewindBuffer_test, dirtyPages) {
+  RewindFixture f;
+  MemoryBus    &bus = f.ts.bus();
+  RewindBuffer  rewinder(f.logger, f.mbrouter, f.propertyMap);
+  rewinder.attach_bus(bus);
+  rewinder.start();
+  EXPECT_TRUE(bus.dirty_tracking()) << "RewindBuffer should add a dirty tracker to its MemoryBus";
+
+  // Few enough writes per capture that most of RAM is left out of each one
+  std::vector<std::vector<U8>> expectedRam;
+  for(std::size_t i = 0; i < 20; ++i) {
+    f.system().step(10);
+    expectedRam.push_back(f.ram());
+    ASSERT_TRUE(rewinder.capture(f.system()));
+    EXPECT_EQ(i + 1, rewinder.depth());
+  }
+
+  f.system().step(1000);
+  for(int i = 19; i >= 10; --i) {
+    ASSERT_TRUE(rewinder.rewind(f.system()));
+    EXPECT_EQ(static_cast<Cycle_t>((i + 1) * 10), f.system().current_cycle());
+    EXPECT_EQ(expectedRam[static_cast<std::size_t>(i)], f.ram())
+      << "RewindBuffer should fill in the RAM left out of each capture from the previous snapshot";
+  }
+
+  // Captures after a rewind or a clear must not depend on snapshots which are gone
+  f.system().step(10);
+  ASSERT_TRUE(rewinder.capture(f.system()));
+  rewinder.clear();
+  f.system().step(10);
+  const std::vector<U8> first = f.ram();
+  ASSERT_TRUE(rewinder.capture(f.system()));
+  f.system().step(10);
+  ASSERT_TRUE(rewinder.capture(f.system()));
+  f.system().step(100);
+  ASSERT_TRUE(rewinder.rewind(f.system()));
+  ASSERT_TRUE(rewinder.rewind(f.system()));
+  EXPECT_EQ(first, f.ram());
+  EXPECT_FALSE(rewinder.rewind(f.system()));
+  EXPECT_EQ(0, rewinder.dropped());
+
+  rewinder.detach_bus();
+  EXPECT_FALSE(bus.dirty_tracking());
+}
+
+TEST(RewindBuffer_test, events) {
+  RewindFixture f;
+  RewindBuffer  rewinder(f.logger, f.mbrouter, f.propertyMap);
+  rewinder.start();
+
+  const auto &ticker = f.system().get_injector().get<Ticker>();
+
+  for(int i = 0; i < 4; ++i) {
+    f.system().step(Ticker::PERIOD);
+    ASSERT_TRUE(rewinder.capture(f.system()));
+  }
+  f.system().step(Ticker::PERIOD);
+  EXPECT_EQ(5, ticker.num_fired());
+
+  ASSERT_TRUE(rewinder.rewind(f.system()));
+  ASSERT_TRUE(rewinder.rewind(f.system()));
+  EXPECT_EQ(3 * Ticker::PERIOD, f.system().current_cycle());
+  EXPECT_EQ(3, ticker.num_fired());
+  EXPECT_EQ(1, f.system().get_scheduler().size())
+    << "Events pending before a rewind should not survive it";
+
+  f.system().step(2 * Ticker::PERIOD);
+  EXPECT_EQ(5, ticker.num_fired())
+    << "A System should fire the same events after a rewind as a run without one";
+}
+
+TEST(RewindBuffer_test, limits) {
+  RewindFixture f;
+  f.propertyMap.get_prop<U64>(omulator::props::REWIND_DEPTH).set(5);
+
+  RewindBuffer rewinder(f.logger, f.mbrouter, f.propertyMap);
+  rewinder.start();
+
+  for(int i = 0; i < 20; ++i) {
+    f.system().step(100);
+    ASSERT_TRUE(rewinder.capture(f.system()));
+    rewinder.depth();
+  }
+
+  EXPECT_EQ(5, rewinder.depth()) << "RewindBuffer should honor props::REWIND_DEPTH";
+  for(int i = 19; i >= 15; --i) {
+    ASSERT_TRUE(rewinder.rewind(f.system()));
+    EXPECT_EQ(static_cast<Cycle_t>((i + 1) * 100), f.system().current_cycle())
+      << "RewindBuffer should drop the oldest snapshots first";
+  }
+  EXPECT_FALSE(rewinder.rewind(f.system()));
+
+  f.propertyMap.get_prop<U64>(omulator::props::REWIND_BUDGET_MB).set(0);
+  for(int i = 0; i < 5; ++i) {
+    f.system().step(100);
+    ASSERT_TRUE(rewinder.capture(f.system()));
+    rewinder.depth();
+  }
+
+  EXPECT_EQ(1, rewinder.depth())
+    << "RewindBuffer should honor props::REWIND_BUDGET_MB, but always keep the latest snapshot";
+
+  rewinder.clear();
+  EXPECT_EQ(0, rewinder.depth());
+}
+
+TEST(RewindBuffer_test, droppedCaptures) {
+  RewindFixture f;
+
+  // The RewindBuffer's thread is never started, so nothing is encoded in the background
+  RewindBuffer rewinder(f.logger, f.mbrouter, f.propertyMap);
+  for(std::size_t i = 0; i < RewindBuffer::MAX_PENDING; ++i) {
+    f.system().step(100);
+    EXPECT_TRUE(rewinder.capture(f.system()));
+  }
+
+  f.system().step(100);
+  EXPECT_FALSE(rewinder.capture(f.system()))
+    << "RewindBuffer should drop captures rather than letting them pile up";
+  EXPECT_EQ(1, rewinder.dropped());
+  EXPECT_EQ(RewindBuffer::MAX_PENDING, rewinder.depth());
+}
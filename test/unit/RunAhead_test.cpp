@@ -0,0 +1,232 @@
+#include "omulator/RunAhead.hpp"
+
+#include "omulator/MemoryBus.hpp"
+#include "omulator/StateArchive.hpp"
+#include "omulator/props.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+#include "test/TestSystem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using omulator::Component;
+using omulator::Cycle_t;
+using omulator::ILogger;
+using omulator::MemoryBus;
+using omulator::PropertyMap;
+using omulator::RunAhead;
+using omulator::StateArchive;
+using omulator::System;
+using omulator::U64;
+using omulator::U8;
+using omulator::msg::MailboxRouter;
+using omulator::msg::MessageQueueFactory;
+using omulator::util::TypeString;
+
+namespace {
+
+/**
+ * Counts the cycles it has been stepped and mirrors the low byte of the count into RAM, so that a
+ * presented frame can be checked against both a Component's state and memory.
+ */
+class Counter : public Component {
+public:
+  Counter(ILogger &logger, MemoryBus &bus) : Component(logger, TypeString<Counter>), bus_(bus) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    count_ += numCycles;
+    bus_.write8(0, static_cast<U8>(count_));
+    return numCycles;
+  }
+
+  void serialize(StateArchive &archive) override { archive.value(count_); }
+
+  U64 count() const noexcept { return count_; }
+
+private:
+  MemoryBus &bus_;
+  U64        count_ = 0;
+};
+
+constexpr std::size_t RAM_SIZE = 0x1000;
+
+using omulator::test::Ticker;
+using TestSystem = omulator::test::TestSystem<Counter, Ticker>;
+
+struct Presented {
+  Cycle_t cycle;
+  U64     count;
+  U8      ram;
+  U64     ticks;
+};
+
+struct RunAheadFixture {
+  RunAheadFixture()
+    : propertyMap(logger),
+      mqfactory(logger, 0),
+      mbrouter(logger, mqfactory),
+      primary(logger, RAM_SIZE) { }
+
+  void run_frame(RunAhead &runAhead) {
+    runAhead.run_frame([](System &sys) { sys.step(100); },
+                       [this](System &sys) {
+                         std::scoped_lock lck{mtx};
+                         presented.push_back({sys.current_cycle(),
+                                              sys.get_injector().get<Counter>().count(),
+                                              sys.get_injector().get<MemoryBus>().read8(0),
+                                              sys.get_injector().get<Ticker>().num_fired()});
+                       });
+  }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  PropertyMap                          propertyMap;
+  MessageQueueFactory                  mqfactory;
+  MailboxRouter                        mbrouter;
+  TestSystem                           primary;
+
+  std::mutex             mtx;
+  std::vector<Presented> presented;
+};
+
+}  // namespace
+
+TEST(RunAhead_test, disabled) {
+  RunAheadFixture f;
+  RunAhead        runAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system);
+
+  EXPECT_EQ(0, f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).get());
+  EXPECT_FALSE(runAhead.parallel());
+
+  for(int i = 0; i < 3; ++i) {
+    f.run_frame(runAhead);
+  }
+
+  ASSERT_EQ(3, f.presented.size());
+  for(std::size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ((i + 1) * 100, f.presented[i].cycle)
+      << "With run-ahead disabled, RunAhead should present each frame as it is run";
+  }
+}
+
+TEST(RunAhead_test, serial) {
+  RunAheadFixture f;
+  f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).set(2);
+  RunAhead runAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system);
+
+  for(std::size_t i = 0; i < 5; ++i) {
+    f.run_frame(runAhead);
+
+    EXPECT_EQ((i + 1) * 100, f.primary.system.current_cycle());
+    EXPECT_EQ((i + 1) * 100, f.primary.system.get_injector().get<Counter>().count())
+      << "RunAhead should restore the primary System after running ahead";
+
+    ASSERT_EQ(i + 1, f.presented.size());
+    EXPECT_EQ((i + 3) * 100, f.presented[i].cycle);
+    EXPECT_EQ((i + 3) * 100, f.presented[i].count)
+      << "RunAhead should present props::RUN_AHEAD_FRAMES frames ahead of the primary System";
+    EXPECT_EQ(static_cast<U8>((i + 3) * 100), f.presented[i].ram);
+  }
+}
+
+TEST(RunAhead_test, parallel) {
+  RunAheadFixture f;
+  TestSystem      secondary(f.logger, RAM_SIZE);
+  f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).set(2);
+  RunAhead runAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system, &secondary.system);
+  runAhead.start();
+  EXPECT_TRUE(runAhead.parallel());
+
+  for(int i = 0; i < 5; ++i) {
+    f.run_frame(runAhead);
+  }
+  runAhead.wait();
+
+  EXPECT_EQ(500, f.primary.system.current_cycle())
+    << "The primary System should never run ahead when a secondary System is given";
+
+  ASSERT_EQ(5, f.presented.size());
+  for(std::size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ((i + 3) * 100, f.presented[i].cycle);
+    EXPECT_EQ((i + 3) * 100, f.presented[i].count)
+      << "Running ahead on the secondary System should present the same frames as the primary";
+    EXPECT_EQ(static_cast<U8>((i + 3) * 100), f.presented[i].ram);
+  }
+}
+
+TEST(RunAhead_test, events) {
+  constexpr U64 FRAMES = 5;
+
+  // Each frame is one Ticker::PERIOD long, so the reference fires one event per frame
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  TestSystem                           reference(logger, RAM_SIZE);
+  for(U64 i = 0; i < FRAMES; ++i) {
+    reference.system.step(Ticker::PERIOD);
+  }
+  const U64 expected = reference.system.get_injector().get<Ticker>().num_fired();
+  ASSERT_EQ(FRAMES, expected);
+
+  for(const bool parallel : {false, true}) {
+    RunAheadFixture f;
+    TestSystem      secondary(f.logger, RAM_SIZE);
+    f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).set(2);
+    RunAhead runAhead(f.logger,
+                      f.mbrouter,
+                      f.propertyMap,
+                      f.primary.system,
+                      parallel ? &secondary.system : nullptr);
+    runAhead.start();
+
+    for(U64 i = 0; i < FRAMES; ++i) {
+      f.run_frame(runAhead);
+    }
+    runAhead.wait();
+
+    EXPECT_EQ(expected, f.primary.system.get_injector().get<Ticker>().num_fired())
+      << "Running ahead should not change the number of events fired by the primary System";
+
+    ASSERT_EQ(FRAMES, f.presented.size());
+    for(std::size_t i = 0; i < FRAMES; ++i) {
+      EXPECT_EQ(i + 3, f.presented[i].ticks)
+        << "Each presented frame should have fired the same events as a run without run-ahead";
+    }
+  }
+}
+
+TEST(RunAhead_test, errors) {
+  {
+    RunAheadFixture f;
+    EXPECT_THROW(RunAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system,
+                          &f.primary.system),
+                 std::invalid_argument)
+      << "RunAhead should not accept the same System as both the primary and the secondary";
+  }
+
+  const auto runFrame        = [](System &sys) { sys.step(100); };
+  const auto throwingPresent = []([[maybe_unused]] System &sys) {
+    throw std::runtime_error("present failed");
+  };
+
+  {
+    RunAheadFixture f;
+    f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).set(1);
+    RunAhead runAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system);
+    EXPECT_THROW(runAhead.run_frame(runFrame, throwingPresent), std::runtime_error);
+  }
+
+  RunAheadFixture f;
+  TestSystem      secondary(f.logger, RAM_SIZE);
+  f.propertyMap.get_prop<U64>(omulator::props::RUN_AHEAD_FRAMES).set(1);
+  RunAhead runAhead(f.logger, f.mbrouter, f.propertyMap, f.primary.system, &secondary.system);
+  runAhead.start();
+
+  runAhead.run_frame(runFrame, throwingPresent);
+  EXPECT_THROW(runAhead.wait(), std::runtime_error)
+    << "Exceptions thrown on the RunAhead's thread should be rethrown by wait()";
+  EXPECT_NO_THROW(runAhead.wait()) << "Exceptions should only be rethrown once";
+}
@@ -0,0 +1,80 @@
+#include "omulator/util/SpscRing.hpp"
+
+#include "omulator/oml_types.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using omulator::U32;
+using omulator::util::SpscRing;
+
+TEST(SpscRing_test, blocks) {
+  SpscRing<int> ring(6);
+  EXPECT_EQ(8, ring.capacity()) << "Capacities should be rounded up to a power of two";
+  EXPECT_EQ(0, ring.size());
+
+  const std::array<int, 5> in{1, 2, 3, 4, 5};
+  EXPECT_EQ(5, ring.push(in));
+  EXPECT_EQ(3, ring.push(in)) << "Only as many items as fit should be pushed";
+  EXPECT_EQ(8, ring.size());
+  EXPECT_EQ(0, ring.free());
+
+  std::array<int, 6> out{};
+  EXPECT_EQ(6, ring.pop(out));
+  EXPECT_EQ((std::array<int, 6>{1, 2, 3, 4, 5, 1}), out);
+
+  // This push wraps around the end of the ring
+  EXPECT_EQ(5, ring.push(in));
+  std::vector<int> rest(10);
+  EXPECT_EQ(7, ring.pop(rest));
+  EXPECT_EQ((std::vector<int>{2, 3, 1, 2, 3, 4, 5, 0, 0, 0}), rest);
+  EXPECT_EQ(0, ring.pop(rest));
+
+  EXPECT_THROW(SpscRing<int>(0), std::invalid_argument);
+}
+
+TEST(SpscRing_test, threaded) {
+  constexpr U32    NUM_ITEMS = 1'000'000;
+  SpscRing<U32>    ring(1024);
+  std::atomic_bool done = false;
+
+  // Each block continues from wherever the last push left off, so the stream is a count
+  std::thread producer([&] {
+    std::array<U32, 100> block;
+    U32                  next = 0;
+    while(next < NUM_ITEMS) {
+      for(U32 i = 0; i < block.size(); ++i) {
+        block[i] = next + i;
+      }
+
+      next += static_cast<U32>(ring.push(block));
+    }
+
+    done.store(true, std::memory_order_release);
+  });
+
+  std::array<U32, 77> block;
+  U32                 expected = 0;
+  bool                ordered  = true;
+  while(true) {
+    const bool        finished = done.load(std::memory_order_acquire);
+    const std::size_t n        = ring.pop(block);
+    for(std::size_t i = 0; i < n; ++i) {
+      ordered = ordered && block[i] == expected;
+      ++expected;
+    }
+
+    if(n == 0 && finished) {
+      break;
+    }
+  }
+  producer.join();
+
+  EXPECT_TRUE(ordered) << "Items should arrive exactly once and in order";
+  EXPECT_GE(expected, NUM_ITEMS);
+}
@@ -0,0 +1,221 @@
+#include "omulator/StateArchive.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using omulator::S16;
+using omulator::StateArchive;
+using omulator::U16;
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+
+namespace {
+
+enum class Color : U8 { RED, GREEN, BLUE };
+
+struct State {
+  U8                 a    = 0;
+  S16                b    = 0;
+  U64                c    = 0;
+  bool               d    = false;
+  Color              e    = Color::RED;
+  std::array<U16, 3> f    = {};
+  std::vector<U8>    ram  = std::vector<U8>(5000);
+  std::vector<U8>    vram = std::vector<U8>(16);
+
+  void serialize(StateArchive &archive) {
+    archive.tag("State");
+    archive.value(a);
+    archive.value(b);
+    archive.value(c);
+    archive.value(d);
+    archive.value(e);
+    archive.value(f);
+    archive.region(ram);
+    archive.region(vram);
+  }
+};
+
+State make_state() {
+  State state;
+  state.a = 0xAB;
+  state.b = -1234;
+  state.c = 0x0123'4567'89AB'CDEF;
+  state.d = true;
+  state.e = Color::BLUE;
+  state.f = {1, 2, 0xFFFF};
+  for(std::size_t i = 0; i < state.ram.size(); ++i) {
+    state.ram[i] = static_cast<U8>(i * 7);
+  }
+  state.vram.assign(state.vram.size(), 0x5A);
+  return state;
+}
+
+std::vector<U8> save(State &state) {
+  StateArchive archive;
+  state.serialize(archive);
+
+  std::vector<U8> image(archive.image_size());
+  archive.write(image);
+  return image;
+}
+
+U64 read_u64(const std::vector<U8> &image, const std::size_t offset) {
+  U64 val = 0;
+  for(std::size_t i = 0; i < sizeof(U64); ++i) {
+    val |= U64{image[offset + i]} << (8 * i);
+  }
+  return val;
+}
+
+}  // namespace
+
+TEST(StateArchive_test, roundTrip) {
+  State                 saved = make_state();
+  const std::vector<U8> image = save(saved);
+
+  State        loaded;
+  StateArchive archive(image);
+  EXPECT_TRUE(archive.loading());
+  loaded.serialize(archive);
+  EXPECT_NO_THROW(archive.finish());
+
+  EXPECT_EQ(saved.a, loaded.a);
+  EXPECT_EQ(saved.b, loaded.b);
+  EXPECT_EQ(saved.c, loaded.c);
+  EXPECT_EQ(saved.d, loaded.d);
+  EXPECT_EQ(saved.e, loaded.e);
+  EXPECT_EQ(saved.f, loaded.f);
+  EXPECT_EQ(saved.ram, loaded.ram);
+  EXPECT_EQ(saved.vram, loaded.vram);
+}
+
+TEST(StateArchive_test, format) {
+  State saved = make_state();
+
+  StateArchive archive;
+  EXPECT_FALSE(archive.loading());
+  saved.serialize(archive);
+
+  std::vector<U8> image(archive.image_size());
+  archive.write(image);
+
+  std::stringstream ss;
+  archive.write(ss);
+  EXPECT_EQ(std::string(image.begin(), image.end()), ss.str())
+    << "StateArchive should produce the same image when writing to a stream or a buffer";
+
+  EXPECT_TRUE(std::equal(StateArchive::MAGIC.begin(), StateArchive::MAGIC.end(), image.begin()));
+  EXPECT_EQ(StateArchive::VERSION, image[8]);
+
+  // Fields are packed and little-endian, following the name passed to tag()
+  const U64 fieldsOffset = read_u64(image, 16);
+  EXPECT_EQ(StateArchive::HEADER_SIZE, fieldsOffset);
+  EXPECT_EQ(4 + 5 + 1 + 2 + 8 + 1 + 1 + 6, read_u64(image, 24));
+  EXPECT_EQ(5, image[fieldsOffset]);
+  EXPECT_EQ(0xAB, image[fieldsOffset + 9]);
+  EXPECT_EQ(0xEF, image[fieldsOffset + 12]);
+
+  // Each region is stored verbatim at an aligned offset
+  const U64 tableOffset = read_u64(image, 32);
+  ASSERT_EQ(2, read_u64(image, 40));
+  EXPECT_EQ(image.size(), read_u64(image, 48));
+  for(std::size_t i = 0; i < 2; ++i) {
+    const U64 offset = read_u64(image, tableOffset + i * 16);
+    const U64 size   = read_u64(image, tableOffset + i * 16 + 8);
+    EXPECT_EQ(0, offset % StateArchive::REGION_ALIGNMENT)
+      << "StateArchive regions should be aligned so that they can be mapped from a file";
+
+    const auto &expected = i == 0 ? saved.ram : saved.vram;
+    ASSERT_EQ(expected.size(), size);
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), image.data() + offset));
+    EXPECT_EQ(offset, archive.region_offsets()[i]);
+  }
+
+  // Skipped regions are left alone, and everything else is written as usual
+  const std::vector<std::size_t> skip{1};
+  const std::size_t              vramOffset = archive.region_offsets()[1];
+  std::vector<U8>                partial(image.size(), 0xCC);
+  archive.write(partial, skip);
+  EXPECT_TRUE(std::equal(image.data(), image.data() + vramOffset, partial.data()));
+  EXPECT_EQ(0xCC, partial[vramOffset]);
+  EXPECT_EQ(0xCC, partial.back());
+}
+
+TEST(StateArchive_test, malformedImages) {
+  State                 saved = make_state();
+  const std::vector<U8> image = save(saved);
+
+  EXPECT_THROW(StateArchive(std::span(image).first(10)), std::runtime_error)
+    << "StateArchive should reject images which are too small to hold a header";
+  EXPECT_THROW(StateArchive(std::span(image).first(image.size() - 1)), std::runtime_error)
+    << "StateArchive should reject truncated images";
+
+  auto badMagic = image;
+  badMagic[0]   = 'X';
+  EXPECT_THROW(StateArchive{badMagic}, std::runtime_error);
+
+  auto badVersion = image;
+  badVersion[8]   = StateArchive::VERSION + 1;
+  EXPECT_THROW(StateArchive{badVersion}, std::runtime_error);
+
+  auto badRegion = image;
+  badRegion[read_u64(image, 32) + 8 + 3] = 0xFF;
+  EXPECT_THROW(StateArchive{badRegion}, std::runtime_error)
+    << "StateArchive should reject regions which extend past the end of the image";
+}
+
+TEST(StateArchive_test, mismatchedState) {
+  State                 saved = make_state();
+  const std::vector<U8> image = save(saved);
+
+  {
+    StateArchive archive(image);
+    EXPECT_THROW(archive.tag("Other"), std::runtime_error)
+      << "StateArchive::tag should throw if a different name was saved";
+  }
+
+  {
+    State loaded;
+    loaded.ram.resize(100);
+    StateArchive archive(image);
+    EXPECT_THROW(loaded.serialize(archive), std::runtime_error)
+      << "StateArchive::region should throw if the saved region has a different size";
+  }
+
+  {
+    StateArchive archive(image);
+    archive.tag("State");
+    U8 a = 0;
+    archive.value(a);
+    EXPECT_EQ(saved.a, a);
+    EXPECT_THROW(archive.finish(), std::runtime_error)
+      << "StateArchive::finish should throw if part of the image was not loaded";
+  }
+
+  {
+    State        loaded;
+    StateArchive archive(image);
+    loaded.serialize(archive);
+    U32 extra = 0;
+    EXPECT_THROW(archive.value(extra), std::runtime_error)
+      << "StateArchive should throw when reading past the end of the field stream";
+    EXPECT_THROW(archive.region(loaded.vram), std::runtime_error);
+  }
+}
+
+TEST(StateArchive_test, emptyArchive) {
+  StateArchive    archive;
+  std::vector<U8> image(archive.image_size());
+  archive.write(image);
+  EXPECT_EQ(StateArchive::HEADER_SIZE, image.size());
+
+  StateArchive loaded(image);
+  EXPECT_NO_THROW(loaded.finish());
+}
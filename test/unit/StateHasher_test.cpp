@@ -0,0 +1,144 @@
+#include "omulator/StateHasher.hpp"
+
+#include "omulator/MemoryBus.hpp"
+
+#include "mocks/LoggerMock.hpp"
+#include "mocks/PrimitiveIOMock.hpp"
+#include "mocks/exception_handler_mock.hpp"
+#include "test/TestSystem.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using omulator::Cycle_t;
+using omulator::MemoryBus;
+using omulator::StateHasher;
+using omulator::U64;
+using omulator::U8;
+using omulator::test::Scribbler;
+
+namespace {
+
+constexpr Cycle_t     CYCLES_PER_FRAME = 100;
+constexpr std::size_t RAM_SIZE         = 0x4000;
+
+using TestSystem = omulator::test::TestSystem<Scribbler>;
+
+/**
+ * Run for the given number of frames, hashing each one.
+ */
+void run(TestSystem &ts, StateHasher &hasher, const std::size_t numFrames) {
+  for(std::size_t i = 0; i < numFrames; ++i) {
+    ts.system.step(CYCLES_PER_FRAME);
+    hasher.hash_frame();
+  }
+}
+
+}  // namespace
+
+TEST(StateHasher_test, determinism) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  TestSystem                           a(logger, RAM_SIZE);
+  TestSystem                           b(logger, RAM_SIZE);
+  StateHasher                          hasherA(a.system, &a.bus());
+  StateHasher                          hasherB(b.system, &b.bus());
+
+  EXPECT_TRUE(a.bus().dirty_tracking()) << "A StateHasher should enable dirty tracking";
+
+  run(a, hasherA, 10);
+  run(b, hasherB, 4);
+  b.bus().write8(0x3FFF, 0xAA);
+  run(b, hasherB, 6);
+
+  ASSERT_EQ(10, hasherA.hashes().size());
+  EXPECT_EQ(std::vector<U64>(hasherA.hashes().begin(), hasherA.hashes().begin() + 4),
+            std::vector<U64>(hasherB.hashes().begin(), hasherB.hashes().begin() + 4))
+    << "Identical runs should produce identical hashes";
+  EXPECT_EQ(4, StateHasher::first_mismatch(hasherA.hashes(), hasherB.hashes()))
+    << "A change to RAM should change the hash of the frame in which it happened";
+
+  for(std::size_t i = 1; i < hasherA.hashes().size(); ++i) {
+    EXPECT_NE(hasherA.hashes()[i - 1], hasherA.hashes()[i]);
+  }
+
+  const std::vector<U64> prefix(hasherA.hashes().begin(), hasherA.hashes().begin() + 7);
+  EXPECT_EQ(std::nullopt, StateHasher::first_mismatch(hasherA.hashes(), hasherA.hashes()));
+  EXPECT_EQ(7, StateHasher::first_mismatch(hasherA.hashes(), prefix))
+    << "A stream which is a prefix of another should differ where it ends";
+}
+
+TEST(StateHasher_test, incremental) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  TestSystem                           ts(logger, RAM_SIZE);
+
+  U64 incremental;
+  {
+    StateHasher hasher(ts.system, &ts.bus());
+    run(ts, hasher, 20);
+    incremental = hasher.hashes().back();
+  }
+
+  EXPECT_FALSE(ts.bus().dirty_tracking())
+    << "A StateHasher should disable dirty tracking when it is destroyed";
+
+  StateHasher hasher(ts.system, &ts.bus());
+  EXPECT_EQ(incremental, hasher.hash_frame())
+    << "Hashing RAM incrementally should give the same result as hashing all of it";
+
+  const std::vector<U8> image = ts.system.save_state();
+  const U64             saved = hasher.hashes().back();
+  run(ts, hasher, 3);
+  ts.system.load_state(image);
+  EXPECT_EQ(saved, hasher.hash_frame()) << "Loading a state should restore its hash";
+
+  run(ts, hasher, 1);
+  EXPECT_EQ(hasher.hashes()[1], hasher.hashes().back());
+
+  hasher.clear();
+  EXPECT_TRUE(hasher.hashes().empty());
+}
+
+TEST(StateHasher_test, componentState) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  TestSystem                           a(logger, RAM_SIZE);
+  TestSystem                           b(logger, RAM_SIZE);
+  StateHasher                          hasherA(a.system, &a.bus());
+  StateHasher                          hasherB(b.system, &b.bus());
+
+  // The Scribbler writes to every address once every 0x4000 cycles, and writes the same byte each
+  // time, so after the first 0x4000 cycles RAM stays the same while its count keeps changing
+  a.system.step(0x4000);
+  b.system.step(0x4000);
+  ASSERT_EQ(hasherA.hash_frame(), hasherB.hash_frame());
+
+  b.system.step(0x4000);
+  for(MemoryBus::Addr_t addr = 0; addr < 0x4000; ++addr) {
+    ASSERT_EQ(a.bus().read8(addr), b.bus().read8(addr));
+  }
+
+  EXPECT_NE(hasherA.hashes().back(), hasherB.hash_frame())
+    << "State outside of the MemoryBus RAM should be hashed too";
+}
+
+TEST(StateHasher_test, files) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  TestSystem                           ts(logger, RAM_SIZE);
+  StateHasher                          hasher(ts.system, &ts.bus());
+  run(ts, hasher, 5);
+
+  const auto path = std::filesystem::temp_directory_path() / "StateHasher_test_files.txt";
+  hasher.write(path);
+  EXPECT_EQ(hasher.hashes(), StateHasher::read(path));
+  EXPECT_EQ(5 * 17, std::filesystem::file_size(path))
+    << "Hash streams should hold one 16-digit hash per line";
+
+  std::ofstream(path) << "0123456789abcdef\nnot a hash\n";
+  EXPECT_THROW(StateHasher::read(path), std::runtime_error);
+  std::filesystem::remove(path);
+
+  EXPECT_THROW(StateHasher::read(path), std::runtime_error);
+}
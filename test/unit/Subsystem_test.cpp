@@ -2,6 +2,7 @@
 
 #include "omulator/msg/MailboxRouter.hpp"
 
+#include "mocks/ClockMock.hpp"
 #include "mocks/LoggerMock.hpp"
 #include "mocks/PrimitiveIOMock.hpp"
 #include "mocks/exception_handler_mock.hpp"
@@ -9,12 +10,21 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <functional>
+#include <thread>
+
 using ::testing::_;
 using ::testing::Exactly;
 using ::testing::HasSubstr;
 
+using omulator::ClockMock;
+using omulator::IClock;
 using omulator::ILogger;
 using omulator::Subsystem;
+using omulator::TickPolicy;
+using omulator::TickStats;
+using omulator::TimePoint_t;
 using omulator::U64;
 using omulator::msg::MailboxReceiver;
 using omulator::msg::MailboxRouter;
@@ -44,6 +54,23 @@ public:
   Sequencer &sequencer_;
 };
 
+class TickingSubsys : public Subsystem {
+public:
+  TickingSubsys(ILogger              &logger,
+                MailboxRouter        &mbrouter,
+                ClockMock            &clock,
+                const TickPolicy      policy,
+                std::function<void()> onTick)
+    : Subsystem(logger, "TickingSubsys", mbrouter, TypeHash<TickingSubsys>) {
+    on_tick(clock, PERIOD, onTick, policy);
+    start();
+  }
+
+  ~TickingSubsys() override = default;
+
+  static constexpr std::chrono::milliseconds PERIOD{10};
+};
+
 TEST(Subsystem_test, simpleSubsystem) {
   Sequencer  sequencer(1);
   LoggerMock logger;
@@ -75,3 +102,126 @@ TEST(Subsystem_test, simpleSubsystem) {
   EXPECT_EQ(i, 42) << "A specialized subsystem should execute its message_proc() member function "
                       "when messages are sent to the Subsystem";
 }
+
+namespace {
+
+/**
+ * Runs a TickingSubsys whose first tick makes the clock jump 3.5 periods ahead; returns the stats
+ * after numTicks ticks have been observed.
+ */
+TickStats run_late_ticks(const TickPolicy policy, const U64 numTicks) {
+  Sequencer  sequencer(1);
+  LoggerMock logger;
+
+  MessageQueueFactory mqf(logger, 0);
+  MailboxRouter       mr(logger, mqf);
+
+  const TimePoint_t t0 = TimePoint_t{} + std::chrono::seconds(1);
+  ClockMock         clock(t0);
+
+  // The clock is only ever touched by the ticking thread, and sleep_until() returns immediately
+  clock.set_should_block(false);
+
+  U64       ticks = 0;
+  TickStats stats{};
+
+  EXPECT_CALL(logger, info(HasSubstr("Creating subsystem: TickingSubsys"), _)).Times(Exactly(1));
+  TickingSubsys subsys(logger, mr, clock, policy, [&] {
+    ++ticks;
+    if(ticks == 1) {
+      clock.set_now(t0 + TickingSubsys::PERIOD * 3 + TickingSubsys::PERIOD / 2);
+    }
+    else if(ticks == numTicks) {
+      stats = subsys.tick_stats();
+      sequencer.advance_step(1);
+    }
+  });
+
+  sequencer.wait_for_step(1);
+
+  return stats;
+}
+
+}  // namespace
+
+TEST(Subsystem_test, tickSkip) {
+  const TickStats stats = run_late_ticks(TickPolicy::SKIP, 2);
+
+  EXPECT_EQ(2, stats.numTicks) << "TickPolicy::SKIP should only invoke the tick hook once after a "
+                                  "late wakeup";
+  EXPECT_EQ(1, stats.lateTicks) << "A periodic Subsystem should count wakeups that miss at least "
+                                   "one full period as late";
+  EXPECT_EQ(2, stats.skippedTicks)
+    << "TickPolicy::SKIP should record each missed deadline as skipped";
+  EXPECT_EQ(std::chrono::milliseconds(25), stats.maxLateness)
+    << "A periodic Subsystem should track the largest observed lateness";
+}
+
+TEST(Subsystem_test, tickCatchUp) {
+  const TickStats stats = run_late_ticks(TickPolicy::CATCH_UP, 4);
+
+  EXPECT_EQ(4, stats.numTicks) << "TickPolicy::CATCH_UP should invoke the tick hook once for each "
+                                  "missed deadline";
+  EXPECT_EQ(1, stats.lateTicks) << "A periodic Subsystem should count wakeups that miss at least "
+                                   "one full period as late";
+  EXPECT_EQ(0, stats.skippedTicks)
+    << "TickPolicy::CATCH_UP should not skip ticks below Subsystem::MAX_CATCH_UP_TICKS";
+  EXPECT_EQ(std::chrono::milliseconds(25), stats.maxLateness)
+    << "A periodic Subsystem should track the largest observed lateness";
+}
+
+namespace {
+
+/**
+ * A clock on the host's time which sleeps with std::this_thread::sleep_until.
+ */
+class SteadyClock : public IClock {
+public:
+  TimePoint_t now() const noexcept override { return std::chrono::steady_clock::now(); }
+
+  void sleep_until(const TimePoint_t then) override { std::this_thread::sleep_until(then); }
+
+  TimePoint_t host_deadline(const TimePoint_t then) const noexcept override { return then; }
+};
+
+/**
+ * Ticks so rarely that the test would time out if messages waited for the next tick.
+ */
+class SlowTickingSubsys : public Subsystem {
+public:
+  SlowTickingSubsys(ILogger &logger, MailboxRouter &mbrouter, IClock &clock, Sequencer &sequencer)
+    : Subsystem(logger, "SlowTickingSubsys", mbrouter, TypeHash<SlowTickingSubsys>) {
+    receiver_.on(MessageType::DEMO_MSG_A, [&sequencer] { sequencer.advance_step(1); });
+    on_tick(clock, std::chrono::hours(1), [] { });
+    start();
+  }
+
+  ~SlowTickingSubsys() override = default;
+};
+
+}  // namespace
+
+TEST(Subsystem_test, tickMessages) {
+  Sequencer  sequencer(1);
+  LoggerMock logger;
+
+  MessageQueueFactory mqf(logger, 0);
+  MailboxRouter       mr(logger, mqf);
+  SteadyClock         clock;
+
+  EXPECT_CALL(logger, info(HasSubstr("Creating subsystem: SlowTickingSubsys"), _))
+    .Times(Exactly(1));
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    SlowTickingSubsys subsys(logger, mr, clock, sequencer);
+
+    // Give the thread time to run its first tick and start waiting for the next one
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mr.get_mailbox<SlowTickingSubsys>().send_single_message(MessageType::DEMO_MSG_A);
+    sequencer.wait_for_step(1);
+  }
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::minutes(1))
+    << "A periodic Subsystem should service messages and stop requests between ticks";
+}
@@ -1,14 +1,21 @@
 #include "omulator/System.hpp"
 
+#include "omulator/MemoryBus.hpp"
+
 #include "mocks/LoggerMock.hpp"
 #include "mocks/PrimitiveIOMock.hpp"
 #include "mocks/exception_handler_mock.hpp"
 #include "test/Sequencer.hpp"
+#include "test/TestSystem.hpp"
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <functional>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 using ::testing::_;
@@ -18,11 +25,16 @@ using ::testing::HasSubstr;
 using omulator::Component;
 using omulator::ComponentList_t;
 using omulator::Cycle_t;
+using omulator::EventScheduler;
 using omulator::ILogger;
+using omulator::MemoryBus;
+using omulator::StateArchive;
 using omulator::Subsystem;
 using omulator::SubsystemList_t;
 using omulator::System;
+using omulator::U16;
 using omulator::U64;
+using omulator::U8;
 using omulator::di::Injector;
 using omulator::msg::MailboxRouter;
 using omulator::msg::Message;
@@ -95,6 +107,188 @@ private:
   std::function<void()>          onDestruction_;
 };
 
+/**
+ * Records the number of cycles requested by each call to step(), and returns the number of cycles
+ * determined by stepFn.
+ */
+template<int N>
+class SliceRecorder : public Component {
+public:
+  SliceRecorder(ILogger                                 &logger,
+                std::vector<Cycle_t>                    &requests,
+                std::function<Cycle_t(const Cycle_t)> stepFn)
+    : Component(logger, TypeString<SliceRecorder>), requests_(requests), stepFn_(stepFn) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    requests_.push_back(numCycles);
+    return stepFn_(numCycles);
+  }
+
+private:
+  std::vector<Cycle_t>                 &requests_;
+  std::function<Cycle_t(const Cycle_t)> stepFn_;
+};
+
+/**
+ * Does some per-cycle work which depends on a value shared with the other groups, which it also
+ * updates every few cycles via System::defer.
+ */
+struct GroupRecord {
+  int     id;
+  Cycle_t cycle;
+  U64     state;
+
+  bool operator==(const GroupRecord &) const noexcept = default;
+};
+
+template<int N>
+class GroupMember : public Component {
+public:
+  GroupMember(ILogger                  &logger,
+              System                   &system,
+              U64                      &shared,
+              std::vector<GroupRecord> &records,
+              std::thread::id          &threadId)
+    : Component(logger, TypeString<GroupMember>),
+      system_(system),
+      shared_(shared),
+      records_(records),
+      threadId_(threadId),
+      cycle_(0),
+      state_(N) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    threadId_ = std::this_thread::get_id();
+
+    for(Cycle_t i = 0; i < numCycles; ++i) {
+      state_ = state_ * 6364136223846793005ULL + shared_;
+      ++cycle_;
+
+      if(cycle_ % (37 + N) == 0) {
+        system_.defer([this, cycle = cycle_, state = state_] {
+          shared_ ^= state;
+          records_.push_back({N, cycle, state});
+        });
+      }
+    }
+
+    // Occasionally overshoot, as a CPU would when an instruction straddles the end of a slice
+    if(cycle_ % 5 == 0) {
+      state_ = state_ * 6364136223846793005ULL + shared_;
+      ++cycle_;
+      return numCycles + 1;
+    }
+
+    return numCycles;
+  }
+
+private:
+  System                   &system_;
+  U64                      &shared_;
+  std::vector<GroupRecord> &records_;
+  std::thread::id          &threadId_;
+
+  Cycle_t cycle_;
+  U64     state_;
+};
+
+/**
+ * Increments a counter in emulated memory once per cycle, and keeps track of how many times it has
+ * been stepped.
+ */
+class BusCounter : public Component {
+public:
+  BusCounter(ILogger &logger, MemoryBus &bus)
+    : Component(logger, TypeString<BusCounter>), bus_(bus), numSteps_(0) { }
+
+  Cycle_t step(const Cycle_t numCycles) override {
+    for(Cycle_t i = 0; i < numCycles; ++i) {
+      bus_.write<U16>(0x10, static_cast<U16>(bus_.read<U16>(0x10) + 1));
+    }
+    ++numSteps_;
+    return numCycles;
+  }
+
+  void serialize(StateArchive &archive) override { archive.value(numSteps_); }
+
+  U64 num_steps() const noexcept { return numSteps_; }
+
+private:
+  MemoryBus &bus_;
+  U64        numSteps_;
+};
+
+/**
+ * Waits in its onEnd hook for every other ShutdownSubsys to reach their onEnd hooks as well, which
+ * can only happen if they are all shut down concurrently. The wait is bounded so that a serial
+ * shutdown results in a test failure rather than a deadlock.
+ */
+template<int N>
+class ShutdownSubsys : public Subsystem {
+public:
+  ShutdownSubsys(ILogger          &logger,
+                 MailboxRouter    &mbrouter,
+                 std::atomic<U64> &numEnded,
+                 bool             &overlapped)
+    : Subsystem(
+      logger, TypeString<ShutdownSubsys>, mbrouter, TypeHash<ShutdownSubsys>, [] {}, [&] {
+        numEnded.fetch_add(1, std::memory_order_acq_rel);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(numEnded.load(std::memory_order_acquire) < NUM_SUBSYSTEMS
+              && std::chrono::steady_clock::now() < deadline)
+        {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        overlapped = numEnded.load(std::memory_order_acquire) >= NUM_SUBSYSTEMS;
+      }) { }
+
+  static constexpr U64 NUM_SUBSYSTEMS = 2;
+};
+
+struct GroupRunResult {
+  std::vector<GroupRecord> records;
+  std::thread::id          leadThread;
+  std::thread::id          otherThread;
+};
+
+GroupRunResult run_groups(const omulator::GroupExecution execution) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+  GroupRunResult                       result;
+  U64                                  shared = 1;
+  std::thread::id                      unusedThread;
+
+  System system(logger, "testsystem", injector);
+  auto  &childInjector = system.get_injector();
+  childInjector.addRecipe<GroupMember<0>>([&]([[maybe_unused]] Injector &inj) {
+    return new GroupMember<0>(logger, system, shared, result.records, result.leadThread);
+  });
+  childInjector.addRecipe<GroupMember<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new GroupMember<1>(logger, system, shared, result.records, result.otherThread);
+  });
+  childInjector.addRecipe<GroupMember<2>>([&]([[maybe_unused]] Injector &inj) {
+    return new GroupMember<2>(logger, system, shared, result.records, unusedThread);
+  });
+
+  system.make_component_list<GroupMember<0>, GroupMember<1>, GroupMember<2>>();
+  system.set_timeslice(7);
+  system.set_component_groups({{0}, {1, 2}}, 100, execution);
+
+  std::function<void()> periodic = [&] {
+    shared += system.current_cycle();
+    system.get_scheduler().schedule_in(333, periodic);
+  };
+  system.get_scheduler().schedule_at(333, periodic);
+
+  for(int i = 0; i < 10; ++i) {
+    system.step(1000);
+  }
+
+  return result;
+}
+
 }  // namespace
 
 TEST(System_test, emptySystemWarning) {
@@ -107,6 +301,9 @@ TEST(System_test, emptySystemWarning) {
   EXPECT_CALL(logger, warn(HasSubstr("has no components!"), _)).Times(Exactly(1));
   EXPECT_CALL(logger, warn(HasSubstr("has no subsystems!"), _)).Times(Exactly(1));
   system.step(1);
+
+  // LoggerMock is strict, so any further warnings would fail the test
+  system.step(1);
 }
 
 TEST(System_test, simpleSystem) {
@@ -220,3 +417,384 @@ TEST(System_test, simpleSystem) {
   EXPECT_EQ(MAGIC + 1, destructionTracker)
     << "A System should destroy all of its components and subsystems on destruction";
 }
+
+TEST(System_test, parallelShutdown) {
+  Injector injector;
+
+  std::atomic<U64> numEnded    = 0;
+  bool             overlapped0 = false;
+  bool             overlapped1 = false;
+
+  injector.bindImpl<ILogger, LoggerMock>();
+  auto &logger = injector.get<LoggerMock>();
+
+  injector.addRecipe<omulator::msg::MessageQueueFactory>([](Injector &injectorInstance) {
+    static std::atomic<U64> factoryInstanceCounter = 0;
+    return new omulator::msg::MessageQueueFactory(
+      injectorInstance.get<ILogger>(),
+      factoryInstanceCounter.fetch_add(1, std::memory_order_acq_rel));
+  });
+  injector.addCtorRecipe<MailboxRouter, ILogger &, MessageQueueFactory &>();
+
+  {
+    EXPECT_CALL(logger, info(HasSubstr("Creating component: testsystem"), _)).Times(Exactly(1));
+    System system(logger, "testsystem", injector);
+
+    system.get_injector().addRecipe<ShutdownSubsys<0>>([&](Injector &inj) {
+      return new ShutdownSubsys<0>(
+        inj.get<ILogger>(), inj.get<MailboxRouter>(), numEnded, overlapped0);
+    });
+    system.get_injector().addRecipe<ShutdownSubsys<1>>([&](Injector &inj) {
+      return new ShutdownSubsys<1>(
+        inj.get<ILogger>(), inj.get<MailboxRouter>(), numEnded, overlapped1);
+    });
+
+    EXPECT_CALL(logger, info(HasSubstr("Creating subsystem"), _)).Times(Exactly(2));
+    system.make_subsystem_list<ShutdownSubsys<0>, ShutdownSubsys<1>>();
+  }
+
+  EXPECT_EQ(2, numEnded.load()) << "A System should shut down all of its Subsystems on destruction";
+  EXPECT_TRUE(overlapped0 && overlapped1)
+    << "A System should stop all of its Subsystems before joining any of them, so that they shut "
+       "down in parallel";
+}
+
+TEST(System_test, timeslices) {
+  LoggerMock logger;
+  Injector   injector;
+
+  std::vector<Cycle_t> leadRequests;
+  std::vector<Cycle_t> followerRequests;
+  Cycle_t              leadOvershoot = 0;
+
+  injector.addRecipe<SliceRecorder<0>>([&]([[maybe_unused]] Injector &inj) {
+    // Ends each slice early after 4 cycles, unless an overshoot is requested
+    return new SliceRecorder<0>(logger, leadRequests, [&](const Cycle_t numCycles) {
+      return leadOvershoot > 0 ? numCycles + leadOvershoot : std::min<Cycle_t>(numCycles, 4);
+    });
+  });
+  injector.addRecipe<SliceRecorder<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<1>(
+      logger, followerRequests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+
+  EXPECT_CALL(logger, info(HasSubstr("Creating component"), _)).Times(Exactly(3));
+  System system(logger, "testsystem", injector);
+  system.make_component_list<SliceRecorder<0>, SliceRecorder<1>>();
+
+  EXPECT_EQ(1, system.timeslice()) << "Systems should run in lockstep by default";
+  EXPECT_THROW(system.set_timeslice(0), std::invalid_argument);
+  system.set_timeslice(10);
+
+  EXPECT_CALL(logger, warn(HasSubstr("has no subsystems!"), _)).Times(Exactly(1));
+  EXPECT_EQ(10, system.step(10));
+  EXPECT_EQ(10, system.current_cycle());
+  EXPECT_EQ((std::vector<Cycle_t>{10, 6, 2}), leadRequests)
+    << "System::step should give the lead Component the remainder of each timeslice";
+  EXPECT_EQ((std::vector<Cycle_t>{4, 4, 2}), followerRequests)
+    << "System::step should only run the other Components up to the point reached by the lead";
+
+  leadRequests.clear();
+  followerRequests.clear();
+  leadOvershoot = 1;
+
+  EXPECT_EQ(6, system.step(5))
+    << "System::step should account for a lead Component running past the end of the timeslice";
+  EXPECT_EQ(16, system.current_cycle());
+  EXPECT_EQ((std::vector<Cycle_t>{5}), leadRequests);
+  EXPECT_EQ((std::vector<Cycle_t>{6}), followerRequests)
+    << "System::step should run the other Components up to the point reached by the lead, even if "
+       "the lead ran past the end of the timeslice";
+}
+
+TEST(System_test, events) {
+  LoggerMock logger;
+  Injector   injector;
+
+  std::vector<Cycle_t> leadRequests;
+  std::vector<Cycle_t> followerRequests;
+  std::vector<Cycle_t> eventCycles;
+
+  injector.addRecipe<SliceRecorder<0>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<0>(
+      logger, leadRequests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+  injector.addRecipe<SliceRecorder<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<1>(
+      logger, followerRequests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+
+  EXPECT_CALL(logger, info(HasSubstr("Creating component"), _)).Times(Exactly(3));
+  System system(logger, "testsystem", injector);
+  system.make_component_list<SliceRecorder<0>, SliceRecorder<1>>();
+  system.set_timeslice(100);
+
+  EXPECT_EQ(&system.get_scheduler(), &system.get_injector().get<EventScheduler>())
+    << "Components should be able to retrieve the System's EventScheduler via its Injector";
+
+  auto &scheduler = system.get_scheduler();
+  scheduler.schedule_at(30, [&] { eventCycles.push_back(system.current_cycle()); });
+  scheduler.schedule_at(250, [&] { eventCycles.push_back(system.current_cycle()); });
+  const auto cancelled = scheduler.schedule_at(60, [&] { eventCycles.push_back(0); });
+  scheduler.cancel(cancelled);
+
+  EXPECT_CALL(logger, warn(HasSubstr("has no subsystems!"), _)).Times(Exactly(1));
+  EXPECT_EQ(300, system.step(300));
+
+  EXPECT_EQ((std::vector<Cycle_t>{30, 100, 100, 20, 50}), leadRequests)
+    << "System::step should end timeslices at the next scheduled event";
+  EXPECT_EQ(leadRequests, followerRequests);
+  EXPECT_EQ((std::vector<Cycle_t>{30, 250}), eventCycles)
+    << "System::step should fire events once all Components have reached the event's timestamp";
+  EXPECT_EQ(300, scheduler.now());
+}
+
+TEST(System_test, componentGroups) {
+  const auto serialResult   = run_groups(omulator::GroupExecution::SERIAL);
+  const auto parallelResult = run_groups(omulator::GroupExecution::PARALLEL);
+
+  EXPECT_FALSE(serialResult.records.empty());
+  EXPECT_EQ(serialResult.records, parallelResult.records)
+    << "Running Component groups in parallel should produce the same results as running them "
+       "serially";
+
+  EXPECT_EQ(serialResult.leadThread, serialResult.otherThread)
+    << "GroupExecution::SERIAL should run all groups on the calling thread";
+  EXPECT_EQ(std::this_thread::get_id(), parallelResult.leadThread)
+    << "GroupExecution::PARALLEL should run the first group on the calling thread";
+  EXPECT_NE(parallelResult.leadThread, parallelResult.otherThread)
+    << "GroupExecution::PARALLEL should run the other groups on worker threads";
+}
+
+TEST(System_test, invalidComponentGroups) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+  std::vector<Cycle_t>                 requests;
+
+  injector.addRecipe<SliceRecorder<0>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<0>(
+      logger, requests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+  injector.addRecipe<SliceRecorder<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<1>(
+      logger, requests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+
+  System system(logger, "testsystem", injector);
+  system.make_component_list<SliceRecorder<0>, SliceRecorder<1>>();
+
+  EXPECT_EQ(0, system.lookahead());
+  EXPECT_THROW(system.set_component_groups({{0}, {1}}, 0), std::invalid_argument);
+  EXPECT_THROW(system.set_component_groups({{0}, {}, {1}}, 10), std::invalid_argument);
+  EXPECT_THROW(system.set_component_groups({{0}, {0, 1}}, 10), std::invalid_argument);
+  EXPECT_THROW(system.set_component_groups({{0}, {2}}, 10), std::invalid_argument);
+  EXPECT_THROW(system.set_component_groups({{1}}, 10), std::invalid_argument)
+    << "Every Component must belong to a group";
+
+  system.set_component_groups({{1}, {0}}, 10);
+  EXPECT_EQ(10, system.lookahead());
+}
+
+TEST(System_test, staticComponentList) {
+  LoggerMock logger;
+  Injector   injector;
+
+  std::vector<Cycle_t> leadRequests;
+  std::vector<Cycle_t> followerRequests;
+
+  injector.addRecipe<SliceRecorder<0>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<0>(logger, leadRequests, [](const Cycle_t numCycles) {
+      return std::min<Cycle_t>(numCycles, 4);
+    });
+  });
+  injector.addRecipe<SliceRecorder<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<1>(
+      logger, followerRequests, [](const Cycle_t numCycles) { return numCycles; });
+  });
+
+  EXPECT_CALL(logger, info(HasSubstr("Creating component"), _)).Times(Exactly(3));
+  System system(logger, "testsystem", injector);
+  system.make_static_component_list<SliceRecorder<0>, SliceRecorder<1>>();
+  EXPECT_THROW((system.make_component_list<SliceRecorder<0>>()), std::runtime_error);
+
+  system.set_timeslice(10);
+
+  EXPECT_CALL(logger, warn(HasSubstr("has no subsystems!"), _)).Times(Exactly(1));
+  EXPECT_EQ(10, system.step(10));
+  EXPECT_EQ((std::vector<Cycle_t>{10, 6, 2}), leadRequests)
+    << "A System created with make_static_component_list should follow the same scheduling rules "
+       "as one created with make_component_list";
+  EXPECT_EQ((std::vector<Cycle_t>{4, 4, 2}), followerRequests)
+    << "A System created with make_static_component_list should follow the same scheduling rules "
+       "as one created with make_component_list";
+}
+
+TEST(System_test, componentTiming) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+
+  std::vector<Cycle_t> leadRequests;
+  std::vector<Cycle_t> followerRequests;
+
+  injector.addRecipe<SliceRecorder<0>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<0>(logger, leadRequests, [](const Cycle_t numCycles) {
+      return std::min<Cycle_t>(numCycles, 4);
+    });
+  });
+  injector.addRecipe<SliceRecorder<1>>([&]([[maybe_unused]] Injector &inj) {
+    return new SliceRecorder<1>(logger, followerRequests, [](const Cycle_t numCycles) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      return numCycles;
+    });
+  });
+
+  System system(logger, "testsystem", injector);
+  system.make_static_component_list<SliceRecorder<0>, SliceRecorder<1>>();
+  system.set_timeslice(10);
+  EXPECT_TRUE(system.component_ticks().empty())
+    << "Component timing should be disabled by default";
+
+  system.set_component_timing(true);
+  ASSERT_EQ(2, system.component_ticks().size());
+  EXPECT_EQ(10, system.step(10));
+  EXPECT_EQ((std::vector<Cycle_t>{10, 6, 2}), leadRequests)
+    << "Component timing should not affect scheduling";
+  EXPECT_EQ((std::vector<Cycle_t>{4, 4, 2}), followerRequests);
+
+  const std::vector<U64> ticks = system.component_ticks();
+  EXPECT_LT(0, ticks[0]);
+  EXPECT_LT(ticks[0], ticks[1]) << "System should time each Component separately";
+
+  system.set_component_timing(true);
+  EXPECT_EQ((std::vector<U64>{0, 0}), system.component_ticks())
+    << "Enabling component timing should reset the counts";
+
+  system.set_component_timing(false);
+  EXPECT_TRUE(system.component_ticks().empty());
+  ASSERT_EQ(2, system.components().size());
+  EXPECT_EQ(TypeString<SliceRecorder<1>>, system.components()[1].get().name());
+}
+
+TEST(System_test, memoryBus) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+
+  // A recipe in the parent Injector will be used to create an instance in each System's child
+  // Injector, provided that the parent never instantiates the type itself
+  injector.addRecipe<MemoryBus>([&]([[maybe_unused]] Injector &inj) {
+    auto *bus = new MemoryBus(logger, 16, 8);
+    bus->add_ram(0x0000, 0x100);
+    return bus;
+  });
+
+  System systemA(logger, "systemA", injector);
+  System systemB(logger, "systemB", injector);
+  for(System *system : {&systemA, &systemB}) {
+    system->get_injector().addRecipe<BusCounter>(
+      [&](Injector &inj) { return new BusCounter(logger, inj.get<MemoryBus>()); });
+    system->make_component_list<BusCounter>();
+  }
+
+  systemA.step(100);
+  systemB.step(30);
+
+  auto &busA = systemA.get_injector().get<MemoryBus>();
+  auto &busB = systemB.get_injector().get<MemoryBus>();
+  EXPECT_NE(&busA, &busB) << "Each System should get its own MemoryBus";
+  EXPECT_EQ(100, busA.read<U16>(0x10))
+    << "Components should be able to take the System's MemoryBus as a dependency";
+  EXPECT_EQ(30, busB.read<U16>(0x10));
+}
+
+TEST(System_test, saveState) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  Injector                             injector;
+
+  injector.addRecipe<MemoryBus>([&]([[maybe_unused]] Injector &inj) {
+    auto *bus = new MemoryBus(logger, 16, 8);
+    bus->add_ram(0x0000, 0x100);
+    return bus;
+  });
+
+  System systemA(logger, "system", injector);
+  System systemB(logger, "system", injector);
+  for(System *system : {&systemA, &systemB}) {
+    system->get_injector().addRecipe<BusCounter>(
+      [&](Injector &inj) { return new BusCounter(logger, inj.get<MemoryBus>()); });
+    system->make_component_list<BusCounter>();
+    system->register_state(system->get_injector().get<MemoryBus>());
+  }
+
+  auto &busA     = systemA.get_injector().get<MemoryBus>();
+  auto &busB     = systemB.get_injector().get<MemoryBus>();
+  auto &counterA = systemA.get_injector().get<BusCounter>();
+  auto &counterB = systemB.get_injector().get<BusCounter>();
+
+  systemA.step(100);
+  const std::vector<U8> image = systemA.save_state();
+  systemA.step(50);
+  EXPECT_EQ(150, busA.read<U16>(0x10));
+
+  systemA.load_state(image);
+  EXPECT_EQ(100, systemA.current_cycle()) << "System::load_state should restore the cycle count";
+  EXPECT_EQ(100, systemA.get_scheduler().now());
+  EXPECT_EQ(100, busA.read<U16>(0x10))
+    << "System::load_state should restore Components registered with register_state";
+  EXPECT_EQ(100, counterA.num_steps())
+    << "System::load_state should restore the state of each Component in the component list";
+
+  systemB.load_state(image);
+  EXPECT_EQ(100, systemB.current_cycle())
+    << "A state should be loadable by any System which has been set up the same way";
+  EXPECT_EQ(100, busB.read<U16>(0x10));
+  systemA.step(30);
+  systemB.step(30);
+  EXPECT_EQ(130, busA.read<U16>(0x10));
+  EXPECT_EQ(130, busB.read<U16>(0x10));
+  EXPECT_EQ(counterA.num_steps(), counterB.num_steps());
+
+  const auto path = std::filesystem::temp_directory_path() / "System_test_saveState.omlstate";
+  systemA.save_state(path);
+  systemA.step(10);
+  systemA.load_state(path);
+  std::filesystem::remove(path);
+  EXPECT_EQ(130, systemA.current_cycle());
+  EXPECT_EQ(130, busA.read<U16>(0x10));
+
+  EXPECT_THROW(systemA.load_state(std::filesystem::path("/nonexistent/state.omlstate")),
+               std::runtime_error);
+
+  // A System with a different set of Components should reject the state
+  System systemC(logger, "system", injector);
+  systemC.get_injector().addRecipe<BusCounter>(
+    [&](Injector &inj) { return new BusCounter(logger, inj.get<MemoryBus>()); });
+  systemC.make_component_list<BusCounter>();
+  EXPECT_THROW(systemC.load_state(image), std::runtime_error)
+    << "System::load_state should throw if the state was saved from a different configuration";
+}
+
+TEST(System_test, saveStateEvents) {
+  ::testing::NiceMock<LoggerMockKlass> logger;
+
+  omulator::test::TestSystem<omulator::test::Ticker> ts(logger, 0x1000);
+  auto &ticker    = ts.system.get_injector().get<omulator::test::Ticker>();
+  auto &scheduler = ts.system.get_scheduler();
+
+  ts.system.step(150);
+  EXPECT_EQ(1, ticker.num_fired());
+  const std::vector<U8> image = ts.system.save_state();
+
+  ts.system.step(100);
+  EXPECT_EQ(2, ticker.num_fired());
+
+  ts.system.load_state(image);
+  EXPECT_EQ(1, ticker.num_fired());
+  EXPECT_EQ(1, scheduler.size())
+    << "System::load_state should cancel the events pending before the load, and Components should "
+       "be able to reschedule theirs";
+  EXPECT_EQ(200, scheduler.next_event_cycle());
+
+  ts.system.step(100);
+  EXPECT_EQ(2, ticker.num_fired())
+    << "An event pending when the state was saved should fire exactly once after it is loaded";
+}
@@ -0,0 +1,215 @@
+#include "omulator/Tracer.hpp"
+
+#include "omulator/cpu/Ref8.hpp"
+
+#include "mocks/LoggerMock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+using omulator::Cycle_t;
+using omulator::MemoryBus;
+using omulator::TraceEntry;
+using omulator::Tracer;
+using omulator::TraceReader;
+using omulator::U64;
+using omulator::U8;
+using omulator::cpu::Ref8;
+
+namespace {
+
+/**
+ * Counts r1 up forever, storing it to 0x1000 on each iteration; each iteration of the loop takes
+ * seven cycles.
+ */
+constexpr std::initializer_list<U8> PROGRAM{
+  0x32, 0x10,        // 0x00: LDI r6, 0x10
+  0x3A, 0x00,        // 0x02: LDI r7, 0x00
+  0x0B,              // 0x04: INC r1
+  0x41,              // 0x05: MOV r0, r1
+  0x06,              // 0x06: ST r0
+  0xC0, 0x04, 0x00,  // 0x07: JP 0x0004
+};
+
+/**
+ * The LDIs, then three iterations of the loop; 14 instructions.
+ */
+constexpr Cycle_t CYCLES = 4 + 7 * 3;
+
+std::filesystem::path trace_path(const std::string &name) {
+  return std::filesystem::temp_directory_path() / ("Tracer_test_" + name + ".omltrace");
+}
+
+struct TracerFixture {
+  TracerFixture(const std::filesystem::path &path, const U64 capacity)
+    : bus(logger, 16, 12), ram(bus.add_ram(0x0000, 0x10000)), cpu(logger, bus), tracer(logger) {
+    std::copy(PROGRAM.begin(), PROGRAM.end(), ram.begin());
+    tracer.open(path, capacity);
+    cpu.set_tracer(&tracer);
+  }
+
+  ::testing::NiceMock<LoggerMockKlass> logger;
+  MemoryBus                            bus;
+  std::span<U8>                        ram;
+  Ref8                                 cpu;
+  Tracer                               tracer;
+};
+
+}  // namespace
+
+TEST(Tracer_test, record) {
+  const auto path = trace_path("record");
+  {
+    TracerFixture f(path, 64);
+    f.cpu.step(CYCLES);
+    EXPECT_EQ(CYCLES, f.cpu.cycles());
+
+    const TraceReader reader(path);
+    ASSERT_EQ(14, reader.size());
+    EXPECT_EQ(14, reader.count());
+    EXPECT_EQ(0, reader.first());
+
+    EXPECT_EQ(0, reader.at(0).cycle);
+    EXPECT_EQ(0x00, reader.at(0).pc);
+    EXPECT_EQ(0x32, reader.at(0).opcode);
+
+    const TraceEntry &inc = reader.at(2);
+    EXPECT_EQ(4, inc.cycle);
+    EXPECT_EQ(0x04, inc.pc);
+    EXPECT_EQ(0x0B, inc.opcode);
+    EXPECT_EQ(0x10, inc.regs[6]) << "Trace entries should hold the registers";
+    EXPECT_EQ(0, inc.regs[1]) << "Trace entries should hold the registers from before the insn ran";
+    EXPECT_EQ(1, reader.at(3).regs[1]);
+    EXPECT_EQ(2, reader.at(7).regs[1]);
+    EXPECT_EQ(11, reader.at(6).cycle);
+
+    EXPECT_EQ("#2 cycle=4 pc=0x0004 op=0x0b regs=00000000000010000000000000000000",
+              TraceReader::format(2, inc));
+
+    std::stringstream ss;
+    reader.decode(ss);
+    EXPECT_EQ(14, std::count(std::istreambuf_iterator<char>(ss), {}, '\n'));
+
+    f.cpu.set_tracer(nullptr);
+    EXPECT_EQ(Ref8::ExecMode::BLOCK_CACHE, f.cpu.exec_mode());
+    f.cpu.step(CYCLES);
+    EXPECT_EQ(14, TraceReader(path).count()) << "A detached Tracer should not record anything";
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(Tracer_test, ring) {
+  const auto path = trace_path("ring");
+  {
+    TracerFixture f(path, 4);
+    f.cpu.step(CYCLES);
+
+    const TraceReader reader(path);
+    ASSERT_EQ(4, reader.size()) << "A trace should only retain its capacity's worth of entries";
+    EXPECT_EQ(14, reader.count());
+    EXPECT_EQ(10, reader.first());
+    EXPECT_EQ(0x04, reader.at(0).pc) << "Entries should be returned oldest first";
+    EXPECT_EQ(4 + 7 * 2, reader.at(0).cycle);
+    EXPECT_EQ(0x07, reader.at(3).pc);
+    EXPECT_THROW(reader.at(4), std::out_of_range);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST(Tracer_test, triggers) {
+  const auto path  = trace_path("triggers");
+  const auto path2 = trace_path("cycleTriggers");
+  {
+    TracerFixture f(path, 64);
+    f.tracer.start_at_pc(0x05);
+    f.tracer.stop_at_pc(0x07);
+    f.cpu.step(CYCLES);
+
+    {
+      const TraceReader reader(path);
+      ASSERT_EQ(6, reader.size());
+      for(std::size_t i = 0; i < reader.size(); ++i) {
+        EXPECT_EQ(i % 2 == 0 ? 0x05 : 0x06, reader.at(i).pc)
+          << "PC triggers should fire every time their instruction is reached";
+      }
+    }
+
+    f.tracer.clear_triggers();
+    f.tracer.start_at_cycle(100);
+    f.tracer.stop_at_cycle(120);
+    f.tracer.open(path2, 64);
+    f.cpu.step(200);
+
+    {
+      // Instructions start on cycles 95, 96, 97, 99, 102, ... 116, 117, 118, 120
+      const TraceReader reader(path2);
+      ASSERT_EQ(11, reader.size());
+      EXPECT_EQ(102, reader.at(0).cycle);
+      EXPECT_EQ(118, reader.at(10).cycle);
+    }
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(path2);
+}
+
+TEST(Tracer_test, firstDivergence) {
+  const auto pathA = trace_path("divergenceA");
+  const auto pathB = trace_path("divergenceB");
+  const auto pathC = trace_path("divergenceC");
+  {
+    TracerFixture a(pathA, 64);
+    a.cpu.step(CYCLES);
+
+    {
+      TracerFixture b(pathB, 64);
+      b.cpu.step(CYCLES);
+      EXPECT_EQ(std::nullopt,
+                TraceReader::first_divergence(TraceReader(pathA), TraceReader(pathB)));
+    }
+
+    {
+      TracerFixture b(pathB, 64);
+      b.ram[0x04] = 0x0C;  // DEC r1
+      b.cpu.step(CYCLES);
+      EXPECT_EQ(2, TraceReader::first_divergence(TraceReader(pathA), TraceReader(pathB)));
+    }
+
+    {
+      TracerFixture b(pathB, 64);
+      b.cpu.step(4 + 7 * 2);
+      EXPECT_EQ(10, TraceReader::first_divergence(TraceReader(pathA), TraceReader(pathB)))
+        << "A trace which is a prefix of another should diverge where it ends";
+    }
+
+    {
+      TracerFixture b(pathB, 4);
+      b.cpu.step(CYCLES);
+      EXPECT_EQ(std::nullopt,
+                TraceReader::first_divergence(TraceReader(pathA), TraceReader(pathB)))
+        << "Traces should be compared from the first entry which both retain";
+
+      TracerFixture c(pathC, 64);
+      c.cpu.step(4);
+      EXPECT_THROW(TraceReader::first_divergence(TraceReader(pathC), TraceReader(pathB)),
+                   std::runtime_error);
+    }
+  }
+
+  std::ofstream(pathB) << "not a trace";
+  EXPECT_THROW(TraceReader{pathB}, std::runtime_error);
+
+  std::filesystem::remove(pathA);
+  std::filesystem::remove(pathB);
+  std::filesystem::remove(pathC);
+}
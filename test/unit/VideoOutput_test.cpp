@@ -0,0 +1,142 @@
+#include "omulator/graphics/VideoOutput.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using omulator::U16;
+using omulator::U32;
+using omulator::U64;
+using omulator::U8;
+using omulator::graphics::rgba;
+using omulator::graphics::VideoOutput;
+
+TEST(VideoOutput_test, dirtyLines) {
+  VideoOutput video(16, 4, VideoOutput::PixelFormat::INDEXED8);
+  EXPECT_EQ(16, video.line_bytes());
+
+  const std::vector<U32> colors{rgba(0, 0, 0), rgba(0xFF, 0, 0), rgba(0, 0xFF, 0)};
+  video.set_palette(colors);
+
+  auto frame = video.acquire();
+  EXPECT_EQ(0, frame.number);
+  EXPECT_EQ(16 * 4, frame.pixels.size());
+
+  // As when the display keeps up with the emulation
+  const auto presentAndAcquire = [&] {
+    const std::size_t converted = video.present();
+    video.acquire();
+    return converted;
+  };
+
+  // Every slot starts out needing every line
+  EXPECT_EQ(4, presentAndAcquire());
+  EXPECT_EQ(4, presentAndAcquire());
+  EXPECT_EQ(4, presentAndAcquire());
+  EXPECT_EQ(0, presentAndAcquire()) << "Unchanged lines should not be converted again";
+
+  std::ranges::fill(video.line(2), U8{1});
+  EXPECT_EQ(1, video.present());
+
+  frame = video.acquire();
+  EXPECT_EQ(5, frame.number);
+  EXPECT_EQ(rgba(0xFF, 0, 0), frame.pixels[2 * 16 + 3]);
+  EXPECT_EQ(rgba(0, 0, 0), frame.pixels[1 * 16 + 3]);
+
+  // The other two slots still hold the old line 2, so each of them converts it once more
+  EXPECT_EQ(1, video.present());
+  EXPECT_EQ(1, video.present());
+  EXPECT_EQ(0, video.present());
+
+  frame = video.acquire();
+  EXPECT_EQ(8, frame.number) << "Only the newest frame should be acquired";
+  EXPECT_EQ(rgba(0xFF, 0, 0), frame.pixels[2 * 16 + 3]);
+
+  // Palette changes affect every line
+  video.set_palette(std::vector<U32>{rgba(0, 0, 0xFF)}, 1);
+  EXPECT_EQ(4, presentAndAcquire());
+  EXPECT_EQ(4, presentAndAcquire());
+  EXPECT_EQ(4, presentAndAcquire());
+  video.set_palette(std::vector<U32>{rgba(0, 0, 0xFF)}, 1);
+  EXPECT_EQ(0, video.present()) << "Setting the palette to what it already holds changes nothing";
+
+  frame = video.acquire();
+  EXPECT_EQ(12, frame.number);
+  EXPECT_EQ(rgba(0, 0, 0xFF), frame.pixels[2 * 16 + 3]);
+
+  EXPECT_THROW(video.line(4), std::out_of_range);
+  EXPECT_THROW(video.line16(0), std::logic_error);
+  EXPECT_THROW(video.set_palette(std::vector<U32>(2), 255), std::out_of_range);
+}
+
+TEST(VideoOutput_test, formats) {
+  VideoOutput rgb(8, 2, VideoOutput::PixelFormat::RGB565);
+  EXPECT_EQ(16, rgb.line_bytes());
+  rgb.line16(1)[7] = 0xF800;
+  rgb.present();
+  EXPECT_EQ(rgba(0xFF, 0, 0), rgb.acquire().pixels[15]);
+
+  VideoOutput planar(16, 2, VideoOutput::PixelFormat::PLANAR, 2);
+  EXPECT_EQ(4, planar.line_bytes());
+  planar.set_palette(std::vector<U32>{rgba(0, 0, 0), rgba(1, 1, 1), rgba(2, 2, 2), rgba(3, 3, 3)});
+
+  // Plane 0 then plane 1, two bytes each; the leftmost pixel gets index 3
+  const std::vector<U8> bits{0x80, 0x00, 0x80, 0x01};
+  std::ranges::copy(bits, planar.line(0).begin());
+  planar.present();
+
+  const auto frame = planar.acquire();
+  EXPECT_EQ(rgba(3, 3, 3), frame.pixels[0]);
+  EXPECT_EQ(rgba(0, 0, 0), frame.pixels[1]);
+  EXPECT_EQ(rgba(2, 2, 2), frame.pixels[15]);
+
+  EXPECT_THROW(VideoOutput(0, 2, VideoOutput::PixelFormat::RGB555), std::invalid_argument);
+  EXPECT_THROW(VideoOutput(12, 2, VideoOutput::PixelFormat::PLANAR, 2), std::invalid_argument);
+  EXPECT_THROW(VideoOutput(16, 2, VideoOutput::PixelFormat::PLANAR, 9), std::invalid_argument);
+}
+
+TEST(VideoOutput_test, threaded) {
+  constexpr U32 WIDTH      = 64;
+  constexpr U32 HEIGHT     = 32;
+  constexpr U64 NUM_FRAMES = 5000;
+
+  VideoOutput video(WIDTH, HEIGHT, VideoOutput::PixelFormat::RGB555);
+
+  // Each frame fills every line with its own number, so a torn frame would hold a mix of numbers
+  std::atomic_bool done = false;
+  std::thread      producer([&] {
+    for(U64 n = 1; n <= NUM_FRAMES; ++n) {
+      for(U32 y = 0; y < HEIGHT; ++y) {
+        std::ranges::fill(video.line16(y), static_cast<U16>(n & 0x7FFF));
+      }
+      video.present();
+    }
+
+    done.store(true, std::memory_order_release);
+  });
+
+  U64  lastNumber = 0;
+  bool consistent = true;
+  bool ordered    = true;
+  while(!done.load(std::memory_order_acquire)) {
+    const auto frame = video.acquire();
+    if(frame.number == 0) {
+      continue;
+    }
+
+    const auto mismatch = std::ranges::adjacent_find(frame.pixels, std::ranges::not_equal_to{});
+    consistent          = consistent && mismatch == frame.pixels.end();
+    ordered             = ordered && frame.number >= lastNumber;
+    lastNumber          = frame.number;
+  }
+  producer.join();
+
+  EXPECT_TRUE(consistent) << "Frames should never be modified while they are acquired";
+  EXPECT_TRUE(ordered) << "Frames should be acquired in the order they were presented";
+  EXPECT_EQ(NUM_FRAMES, video.acquire().number);
+}
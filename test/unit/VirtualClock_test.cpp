@@ -0,0 +1,75 @@
+#include "omulator/VirtualClock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using omulator::TimePoint_t;
+using omulator::VirtualClock;
+
+using namespace std::chrono_literals;
+
+TEST(VirtualClock_test, unlimitedSpeed) {
+  VirtualClock clock;
+
+  EXPECT_EQ(TimePoint_t{}, clock.now()) << "VirtualClock should start at a fixed time point";
+
+  const auto realStart = std::chrono::steady_clock::now();
+  clock.sleep_until(clock.now() + 1h);
+  const auto realElapsed = std::chrono::steady_clock::now() - realStart;
+
+  EXPECT_EQ(TimePoint_t{} + 1h, clock.now())
+    << "VirtualClock::sleep_until should advance the clock to the requested time point";
+  EXPECT_LT(realElapsed, 1s)
+    << "VirtualClock::sleep_until should not block when the speed multiplier is UNLIMITED";
+
+  clock.sleep_until(TimePoint_t{} + 1min);
+  EXPECT_EQ(TimePoint_t{} + 1h, clock.now()) << "VirtualClock should never move backwards";
+
+  clock.advance(5ms);
+  EXPECT_EQ(TimePoint_t{} + 1h + 5ms, clock.now())
+    << "VirtualClock::advance should move the clock forward by the requested duration";
+}
+
+TEST(VirtualClock_test, multipliedSpeed) {
+  VirtualClock clock(10.0);
+
+  EXPECT_EQ(10.0, clock.speed_multiplier());
+
+  const auto realStart = std::chrono::steady_clock::now();
+  clock.sleep_until(clock.now() + 200ms);
+  const auto realElapsed = std::chrono::steady_clock::now() - realStart;
+
+  EXPECT_EQ(TimePoint_t{} + 200ms, clock.now());
+  EXPECT_GE(realElapsed, 15ms)
+    << "VirtualClock::sleep_until should block for the virtual duration divided by the multiplier";
+  EXPECT_LT(realElapsed, 200ms)
+    << "VirtualClock::sleep_until should block for the virtual duration divided by the multiplier";
+}
+
+TEST(VirtualClock_test, lateAnchor) {
+  VirtualClock clock(10.0);
+
+  // Time spent before the first sleep (e.g. setting up the app) shouldn't be caught up on
+  std::this_thread::sleep_for(100ms);
+
+  auto realStart = std::chrono::steady_clock::now();
+  clock.sleep_until(clock.now() + 200ms);
+  EXPECT_GE(std::chrono::steady_clock::now() - realStart, 15ms)
+    << "VirtualClock should anchor its pacing on the first call to sleep_until";
+
+  std::this_thread::sleep_for(100ms);
+  clock.reanchor();
+
+  realStart = std::chrono::steady_clock::now();
+  clock.sleep_until(clock.now() + 200ms);
+  EXPECT_GE(std::chrono::steady_clock::now() - realStart, 15ms)
+    << "VirtualClock::reanchor should restart pacing from the current time";
+}
+
+TEST(VirtualClock_test, invalidSpeed) {
+  EXPECT_THROW(VirtualClock(-1.0), std::invalid_argument)
+    << "VirtualClock should reject negative speed multipliers";
+}
@@ -0,0 +1,55 @@
+#include "omulator/cpu/X64Emitter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using omulator::U8;
+using omulator::cpu::X64Emitter;
+
+TEST(X64Emitter_test, emit) {
+  std::array<U8, 16> buf{};
+  X64Emitter         emitter(buf.data(), buf.data() + buf.size());
+
+  emitter.emit({0x48, 0xB8});
+  emitter.emit64(0x0102'0304'0506'0708);
+  emitter.emit16(0xBEEF);
+  EXPECT_EQ(buf.data() + 12, emitter.cursor());
+  EXPECT_FALSE(emitter.overflowed());
+
+  const std::vector<U8> expected{0x48, 0xB8, 8, 7, 6, 5, 4, 3, 2, 1, 0xEF, 0xBE};
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buf.begin()))
+    << "X64Emitter should write immediates in little-endian order";
+
+  emitter.emit32(0xFFFF'FFFF);
+  EXPECT_FALSE(emitter.overflowed());
+  emitter.emit8(0xCC);
+  EXPECT_TRUE(emitter.overflowed()) << "X64Emitter should detect when it runs out of space";
+  EXPECT_EQ(buf.data() + buf.size(), emitter.cursor());
+}
+
+TEST(X64Emitter_test, branches) {
+  std::array<U8, 16> buf{};
+  X64Emitter         emitter(buf.data(), buf.data() + buf.size());
+
+  // A backwards jmp to itself, and a forwards jcc which is patched afterwards
+  U8 *const jmpSite = emitter.jmp(buf.data());
+  ASSERT_EQ(buf.data() + 1, jmpSite);
+  EXPECT_EQ(0xE9, buf[0]);
+  EXPECT_EQ(0xFB, buf[1]) << "X64Emitter branch displacements should be relative to the next "
+                             "instruction";
+  EXPECT_EQ(0xFF, buf[4]);
+
+  U8 *const jccSite = emitter.jcc(X64Emitter::Cond::NE, buf.data());
+  EXPECT_EQ(0x0F, buf[5]);
+  EXPECT_EQ(0x85, buf[6]);
+  X64Emitter::patch_rel32(jccSite, buf.data() + 16);
+  EXPECT_EQ(5, buf[7]);
+  EXPECT_EQ(0, buf[10]);
+
+  emitter.emit8(0x90);
+  EXPECT_EQ(nullptr, emitter.jmp(buf.data()))
+    << "X64Emitter should not return a patch site for a branch which didn't fit";
+}
@@ -0,0 +1,75 @@
+#include "omulator/util/XorDelta.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using omulator::U8;
+using omulator::util::xor_delta_apply;
+using omulator::util::xor_delta_encode;
+
+TEST(XorDelta_test, roundTrip) {
+  std::mt19937    rng(1234);
+  std::vector<U8> from(10000);
+  for(auto &byte : from) {
+    byte = static_cast<U8>(rng());
+  }
+
+  // A mix of isolated changes, short gaps, and changes at either end
+  std::vector<U8> to = from;
+  const std::array<std::size_t, 10> changes{0, 1, 2, 100, 102, 105, 5000, 5001, 5010, 9999};
+  for(const std::size_t idx : changes) {
+    to[idx] = static_cast<U8>(~to[idx]);
+  }
+
+  std::vector<U8> delta;
+  xor_delta_encode(from, to, delta);
+  EXPECT_LT(delta.size(), 50) << "XOR deltas should be proportional to the amount of change";
+
+  std::vector<U8> buf = from;
+  xor_delta_apply(delta, buf);
+  EXPECT_EQ(to, buf) << "Applying an XOR delta to the original buffer should produce the new one";
+
+  xor_delta_apply(delta, buf);
+  EXPECT_EQ(from, buf) << "Applying an XOR delta to the new buffer should produce the original one";
+
+  std::vector<U8> same;
+  xor_delta_encode(from, from, same);
+  EXPECT_TRUE(same.empty()) << "The XOR delta between identical buffers should be empty";
+}
+
+TEST(XorDelta_test, largeRuns) {
+  std::vector<U8> from(100000, 0x00);
+  std::vector<U8> to(100000, 0x00);
+  for(std::size_t i = 300; i < 70000; ++i) {
+    to[i] = static_cast<U8>(i | 1);
+  }
+
+  std::vector<U8> delta{0xAA};
+  xor_delta_encode(from, to, delta);
+  EXPECT_EQ(0xAA, delta.front()) << "xor_delta_encode should append to its output";
+
+  std::vector<U8> buf = from;
+  xor_delta_apply(std::span(delta).subspan(1), buf);
+  EXPECT_EQ(to, buf);
+}
+
+TEST(XorDelta_test, invalidInput) {
+  const std::vector<U8> a(16), b(17);
+  std::vector<U8>       delta;
+  EXPECT_THROW(xor_delta_encode(a, b, delta), std::invalid_argument);
+
+  std::vector<U8> buf(16);
+  const U8        pastEnd[] = {10, 10, 0};
+  EXPECT_THROW(xor_delta_apply(pastEnd, buf), std::runtime_error)
+    << "xor_delta_apply should reject runs which extend past the end of the buffer";
+
+  const U8 truncated[] = {0x80};
+  EXPECT_THROW(xor_delta_apply(truncated, buf), std::runtime_error);
+
+  const U8 missingData[] = {0, 4, 1, 2};
+  EXPECT_THROW(xor_delta_apply(missingData, buf), std::runtime_error);
+}